@@ -0,0 +1,118 @@
+/*********************************************************************
+ *  bench_harness.hpp – minimal benchmark runner shared by the        *
+ *                      benchmark programs                            *
+ *                                                                   *
+ *  Every case has an untimed setup (run before each repetition, so  *
+ *  operations that consume their input such as deletes start from  *
+ *  the same state every time) and a timed body. A case is run       *
+ *  `warmup` times without recording, then `reps` times; the report  *
+ *  gives min/mean/p50/p90/p99/max per repetition and ops/sec and    *
+ *  bytes/sec derived from the median. Results print as a table and  *
+ *  can be written as JSON for comparing two builds.                 *
+ *********************************************************************/
+
+#ifndef BENCH_HARNESS_HPP
+#define BENCH_HARNESS_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+struct Case {
+  std::string name;
+  size_t rows = 0;                      // table size the case runs at
+  size_t ops = 0;                       // operations per repetition (rows added, rows copied, ...)
+  size_t bytes = 0;                     // bytes produced/consumed per repetition (0: not meaningful)
+  std::function<void()> setup;          // untimed; may be empty
+  std::function<void()> run;            // timed
+};
+
+struct Result {
+  std::string name;
+  size_t rows = 0;
+  size_t ops = 0;
+  size_t bytes = 0;
+  std::vector<double> samples_ns;       // one per repetition, sorted
+  double Percentile(double p) const {   // nearest rank
+    if (samples_ns.empty()) return 0;
+    size_t rank = static_cast<size_t>(p / 100.0 * static_cast<double>(samples_ns.size()) + 0.5);
+    rank = std::min(std::max<size_t>(rank, 1), samples_ns.size());
+    return samples_ns[rank - 1];
+  }
+  double Mean() const {
+    double sum = 0;
+    for (double s : samples_ns) sum += s;
+    return samples_ns.empty() ? 0 : sum / static_cast<double>(samples_ns.size());
+  }
+  double OpsPerSec() const { return Rate(ops); }
+  double BytesPerSec() const { return Rate(bytes); }
+
+private:
+  double Rate(size_t amount) const {
+    double median = Percentile(50);
+    return median > 0 ? static_cast<double>(amount) * 1e9 / median : 0;
+  }
+};
+
+struct Options {
+  int warmup = 1;
+  int reps = 5;
+  std::string filter;                   // only cases whose name contains it
+};
+
+inline Result Run(const Case& c, const Options& options) {
+  Result result;
+  result.name = c.name;
+  result.rows = c.rows;
+  result.ops = c.ops;
+  result.bytes = c.bytes;
+  for (int i = 0; i < options.warmup + options.reps; ++i) {
+    if (c.setup) c.setup();
+    auto start = std::chrono::steady_clock::now();
+    c.run();
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    if (i >= options.warmup) result.samples_ns.push_back(ns);
+  }
+  std::sort(result.samples_ns.begin(), result.samples_ns.end());
+  return result;
+}
+
+inline void PrintHeader(std::FILE* out) {
+  std::fprintf(out, "%-24s %10s %12s %12s %12s %12s %14s %12s\n", "benchmark", "rows", "min (ms)", "p50 (ms)",
+               "p99 (ms)", "max (ms)", "ops/sec", "MB/sec");
+}
+
+inline void PrintResult(std::FILE* out, const Result& r) {
+  std::fprintf(out, "%-24s %10zu %12.3f %12.3f %12.3f %12.3f %14.0f %12.1f\n", r.name.c_str(), r.rows,
+               r.Percentile(0) / 1e6, r.Percentile(50) / 1e6, r.Percentile(99) / 1e6, r.Percentile(100) / 1e6,
+               r.OpsPerSec(), r.BytesPerSec() / 1e6);
+  std::fflush(out);
+}
+
+// {"benchmarks": [{"name": ..., "rows": ..., ..., "p50_ns": ..., "ops_per_sec": ...}, ...]}
+inline bool WriteJson(const std::string& path, const std::vector<Result>& results, const Options& options) {
+  std::FILE* out = std::fopen(path.c_str(), "w");
+  if (out == nullptr) return false;
+  std::fprintf(out, "{\n  \"warmup\": %d,\n  \"reps\": %d,\n  \"benchmarks\": [", options.warmup, options.reps);
+  for (size_t i = 0; i < results.size(); ++i) {
+    const Result& r = results[i];
+    std::fprintf(out,
+                 "%s\n    {\"name\": \"%s\", \"rows\": %zu, \"ops\": %zu, \"bytes\": %zu, "
+                 "\"min_ns\": %.0f, \"mean_ns\": %.0f, \"p50_ns\": %.0f, \"p90_ns\": %.0f, \"p99_ns\": %.0f, "
+                 "\"max_ns\": %.0f, \"ops_per_sec\": %.1f, \"bytes_per_sec\": %.1f}",
+                 i == 0 ? "" : ",", r.name.c_str(), r.rows, r.ops, r.bytes, r.Percentile(0), r.Mean(),
+                 r.Percentile(50), r.Percentile(90), r.Percentile(99), r.Percentile(100), r.OpsPerSec(),
+                 r.BytesPerSec());
+  }
+  std::fprintf(out, "\n  ]\n}\n");
+  return std::fclose(out) == 0;
+}
+
+}  // namespace bench
+
+#endif
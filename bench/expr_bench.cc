@@ -0,0 +1,176 @@
+/*********************************************************************
+ *  expr_bench.cc – tree-walking Evaluate vs compiled expressions    *
+ *                                                                   *
+ *  Every expression is planned against a players table, the rows    *
+ *  its scan produces are collected once, and then the expression    *
+ *  runs over all of them twice: with Evaluate, one row and one node *
+ *  at a time, and compiled (expr_compiler.hpp) over batches of 1024 *
+ *  rows, loading each batch included. Both must agree on every      *
+ *  value; the benchmark stops if they do not.                       *
+ *                                                                   *
+ *  Run                                                              *
+ *     make run_expr_bench                                           *
+ *     ./expr_bench [--rows=N] [--seed=N] [--reps=N] [--filter=S]    *
+ *                  [--json=PATH]                                    *
+ *********************************************************************/
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench_harness.hpp"
+#include "db.hpp"
+#include "expr_compiler.hpp"
+#include "sql_parser.hpp"
+
+struct Config {
+  size_t rows = 1000000;
+  uint64_t seed = 42;
+  std::string json_path;
+  bench::Options options;
+};
+
+struct Expression {
+  const char* name;
+  const char* sql;
+};
+
+static const Expression kExpressions[] = {
+    {"ratio_filter", "Goal / Average_shots_per_game > 1.5"},
+    {"int_arith", "Goal * 3 + Assists - 1"},
+    {"double_arith", "Average_shots_per_game * 0.5 + Minutes / 90.0"},
+    {"decimal_compare", "Salary * 1.1 > 5000"},
+    {"conjunction", "Goal > 5 AND Average_shots_per_game < 2.0 OR Team = 'Shanghai'"},
+    {"null_check", "Assists IS NULL OR NOT (Goal = Assists)"},
+};
+
+static void Load(Database& db, const Config& config) {
+  db.Execute("CREATE TABLE players (Name TEXT, Team TEXT ENCODING DICTIONARY, Goal INT, Assists INT, "
+             "Average_shots_per_game DOUBLE, Minutes INT, Salary DECIMAL)");
+  static const char* const kTeams[] = {"Shanghai", "Beijing", "Shandong", "Wuhan", "Chengdu"};
+  std::mt19937_64 rng(config.seed);
+  std::uniform_int_distribution<int> goals(0, 30);
+  std::uniform_real_distribution<double> shots(0.1, 6);
+  std::uniform_int_distribution<int> minutes(0, 3420);
+  std::uniform_int_distribution<int> cents(100000, 1000000);
+  DbTable& players = db.GetTable("players");
+  for (size_t i = 0; i < config.rows; ++i) {
+    char salary[32];
+    const int salary_cents = cents(rng);
+    std::snprintf(salary, sizeof(salary), "%d.%02d", salary_cents / 100, salary_cents % 100);
+    std::vector<std::optional<std::string>> row = {
+        "player" + std::to_string(i), std::string(kTeams[i % 5]), std::to_string(goals(rng)), std::nullopt,
+        std::to_string(static_cast<int>(shots(rng) * 100) / 100.0), std::to_string(minutes(rng)), salary};
+    if (i % 10 != 0) row[3] = std::to_string(goals(rng) / 2);  // every tenth player has no assists recorded
+    players.AddRow(row);
+  }
+}
+
+static bool ParseArgs(int argc, char** argv, Config& config) {
+  config.options.reps = 5;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const size_t eq = arg.find('=');
+    const std::string key = arg.substr(0, eq);
+    const std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+    if (key == "--rows") config.rows = std::strtoul(value.c_str(), nullptr, 10);
+    else if (key == "--seed") config.seed = std::strtoull(value.c_str(), nullptr, 10);
+    else if (key == "--reps") config.options.reps = std::atoi(value.c_str());
+    else if (key == "--filter") config.options.filter = value;
+    else if (key == "--json") config.json_path = value;
+    else return false;
+  }
+  return config.rows > 0 && config.options.reps > 0;
+}
+
+int main(int argc, char** argv) {
+  Config config;
+  if (!ParseArgs(argc, argv, config)) {
+    std::fprintf(stderr, "usage: %s [--rows=N] [--seed=N] [--reps=N] [--filter=S] [--json=PATH]\n", argv[0]);
+    return 2;
+  }
+  Database db;
+  Load(db, config);
+  std::printf("players: %zu rows, batches of 1024\n\n", config.rows);
+
+  const size_t batch_rows = 1024;
+  std::vector<bench::Result> results;
+  bench::PrintHeader(stdout);
+  for (const Expression& expression : kExpressions) {
+    if (!config.options.filter.empty() &&
+        std::string(expression.name).find(config.options.filter) == std::string::npos) {
+      continue;
+    }
+    const PlanPtr plan = PlanSelect(ParseSql(std::string("SELECT ") + expression.sql + " FROM players").select, db);
+    const Expr& expr = *plan->exprs[0];
+    std::vector<Row> rows;
+    std::unique_ptr<Operator> scan = BuildOperator(*plan->children[0]);
+    scan->Open();
+    for (Row row; scan->Next(row);) rows.push_back(row);
+
+    const CompiledExpr compiled = CompileExpr(expr);
+    if (!compiled.Compiled()) {
+      std::fprintf(stderr, "%s: does not compile\n", expression.name);
+      return 1;
+    }
+    // Chunks of rows as the executor's operators pull them.
+    std::vector<std::vector<Row>> chunks;
+    for (size_t begin = 0; begin < rows.size(); begin += batch_rows) {
+      const size_t end = std::min(rows.size(), begin + batch_rows);
+      chunks.emplace_back(rows.begin() + static_cast<std::ptrdiff_t>(begin),
+                          rows.begin() + static_cast<std::ptrdiff_t>(end));
+    }
+    Batch batch;
+    ValueVector out;
+    for (const std::vector<Row>& chunk : chunks) {
+      if (!batch.Load(chunk, chunk.size(), compiled.Inputs())) std::abort();
+      compiled.Evaluate(batch, out);
+      for (size_t i = 0; i < chunk.size(); ++i) {
+        const Value expected = Evaluate(expr, chunk[i]);
+        if (out.nulls[i] != expected.null || CompareValues(out.Get(i), expected) != 0) {
+          std::fprintf(stderr, "%s: compiled and interpreted values differ\n", expression.name);
+          return 1;
+        }
+      }
+    }
+
+    bench::Case interpreted;
+    interpreted.name = std::string(expression.name) + "/interpreted";
+    interpreted.rows = rows.size();
+    interpreted.ops = rows.size();
+    interpreted.run = [&] {
+      size_t nulls = 0;
+      for (const Row& row : rows) nulls += Evaluate(expr, row).null;
+      if (nulls > rows.size()) std::abort();
+    };
+    results.push_back(bench::Run(interpreted, config.options));
+    bench::PrintResult(stdout, results.back());
+
+    bench::Case batched;
+    batched.name = std::string(expression.name) + "/compiled";
+    batched.rows = rows.size();
+    batched.ops = rows.size();
+    batched.run = [&] {
+      size_t nulls = 0;
+      for (const std::vector<Row>& chunk : chunks) {
+        if (!batch.Load(chunk, chunk.size(), compiled.Inputs())) std::abort();
+        compiled.Evaluate(batch, out);
+        for (size_t i = 0; i < chunk.size(); ++i) nulls += out.nulls[i];
+      }
+      if (nulls > rows.size()) std::abort();
+    };
+    results.push_back(bench::Run(batched, config.options));
+    bench::PrintResult(stdout, results.back());
+  }
+  if (!config.json_path.empty() && !bench::WriteJson(config.json_path, results, config.options)) {
+    std::fprintf(stderr, "cannot write %s\n", config.json_path.c_str());
+    return 1;
+  }
+  return 0;
+}
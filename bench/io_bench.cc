@@ -0,0 +1,189 @@
+/*********************************************************************
+ *  io_bench.cc – blocking vs asynchronous writes of exports and     *
+ *  checkpoint chunk images                                          *
+ *                                                                   *
+ *  A players table is exported to CSV the way the driver used to    *
+ *  (GetRows into an std::ofstream) and with DbTable::ExportCsv on    *
+ *  both AsyncWriter backends; then its chunk images are serialized  *
+ *  and written with one blocking write per ~1 MiB batch, and handed *
+ *  to an AsyncWriter batch by batch. Every case ends with the data  *
+ *  in the file (fdatasync for the chunk images, like a checkpoint). *
+ *  Finally Database::Compact writes a whole checkpoint.             *
+ *                                                                   *
+ *  Run                                                              *
+ *     make run_io_bench                                             *
+ *     ./io_bench [--rows=N] [--dir=PATH] [--reps=N] [--filter=S]    *
+ *                [--json=PATH]                                      *
+ *********************************************************************/
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "async_io.hpp"
+#include "bench_harness.hpp"
+#include "db.hpp"
+
+struct Config {
+  size_t rows = 1000000;
+  std::string dir;  // scratch directory; a fresh one under /tmp by default
+  std::string json_path;
+  bench::Options options;
+};
+
+static void Load(DbTable& players, size_t rows) {
+  static const char* const kTeams[] = {"Shanghai", "Beijing", "Shandong", "Wuhan", "Chengdu"};
+  players.AddColumn({"Name", DataType::kString});
+  players.AddColumn({"Team", DataType::kString});
+  players.AddColumn({"Goal", DataType::kInt});
+  players.AddColumn({"Average_shots_per_game", DataType::kDouble});
+  for (size_t i = 0; i < rows; ++i) {
+    players.AddRow({"player" + std::to_string(i), kTeams[i % 5], std::to_string(i % 31),
+                    std::to_string(static_cast<double>(i % 600) / 100.0)});
+  }
+}
+
+static void ExportWithOfstream(const DbTable& table, const std::string& path) {
+  std::ofstream csv(path);
+  const auto& columns = table.GetColumnDescriptions();
+  for (size_t i = 0; i < columns.size(); ++i) {
+    csv << columns[i].first << (i + 1 < columns.size() ? "," : "");
+  }
+  csv << "\n";
+  for (const auto& row : table.GetRows()) {
+    for (size_t i = 0; i < row.size(); ++i) {
+      csv << row[i] << (i + 1 < row.size() ? "," : "");
+    }
+    csv << "\n";
+  }
+  if (!csv) std::abort();
+}
+
+// Serializes every chunk of table and passes the images on in batches of about 1 MiB.
+template <typename Sink>
+static size_t SerializeChunks(const DbTable& table, Sink&& sink) {
+  size_t bytes = 0;
+  std::string batch;
+  for (unsigned int chunk : table.Chunks()) {
+    BinaryWriter image;
+    table.SerializeChunk(chunk, image);
+    batch.append(image.Data());
+    if (batch.size() >= (1 << 20)) {
+      bytes += batch.size();
+      sink(batch);
+      batch = std::string();
+    }
+  }
+  bytes += batch.size();
+  sink(batch);
+  return bytes;
+}
+
+static bool ParseArgs(int argc, char** argv, Config& config) {
+  config.options.reps = 5;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const size_t eq = arg.find('=');
+    const std::string key = arg.substr(0, eq);
+    const std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+    if (key == "--rows") config.rows = std::strtoul(value.c_str(), nullptr, 10);
+    else if (key == "--dir") config.dir = value;
+    else if (key == "--reps") config.options.reps = std::atoi(value.c_str());
+    else if (key == "--filter") config.options.filter = value;
+    else if (key == "--json") config.json_path = value;
+    else return false;
+  }
+  return config.rows > 0 && config.options.reps > 0;
+}
+
+int main(int argc, char** argv) {
+  Config config;
+  if (!ParseArgs(argc, argv, config)) {
+    std::fprintf(stderr, "usage: %s [--rows=N] [--dir=PATH] [--reps=N] [--filter=S] [--json=PATH]\n", argv[0]);
+    return 2;
+  }
+  bool own_dir = config.dir.empty();
+  if (own_dir) {
+    char tmpl[] = "/tmp/io_bench_XXXXXX";
+    if (::mkdtemp(tmpl) == nullptr) {
+      std::fprintf(stderr, "cannot create a scratch directory\n");
+      return 1;
+    }
+    config.dir = tmpl;
+  }
+  Database db;
+  db.Open(config.dir + "/db");
+  db.CreateTable("players");
+  DbTable& players = db.GetTable("players");
+  Load(players, config.rows);
+  const std::string csv = config.dir + "/players.csv";
+  const std::string chunks = config.dir + "/chunks.bin";
+  {
+    AsyncWriter probe(csv, 0, true);
+    std::printf("players: %zu rows in %s, io_uring backend: %s\n\n", config.rows, config.dir.c_str(),
+                probe.Backend() == AsyncIoBackend::kIoUring ? "available" : "not available");
+  }
+  players.ExportCsv(csv);
+  const size_t csv_bytes = std::filesystem::file_size(csv);
+  AsyncIoOptions threads;
+  threads.allow_io_uring = false;
+
+  std::vector<bench::Case> cases;
+  cases.push_back({"export/ofstream", config.rows, config.rows, csv_bytes, nullptr,
+                   [&] { ExportWithOfstream(players, csv); }});
+  cases.push_back({"export/async_io_uring", config.rows, config.rows, csv_bytes, nullptr,
+                   [&] { players.ExportCsv(csv); }});
+  cases.push_back({"export/async_threads", config.rows, config.rows, csv_bytes, nullptr,
+                   [&] { players.ExportCsv(csv, threads); }});
+  const size_t chunk_bytes = SerializeChunks(players, [](const std::string&) {});
+  cases.push_back({"chunks/blocking", config.rows, players.Chunks().size(), chunk_bytes, nullptr, [&] {
+                     const int fd = ::open(chunks.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+                     if (fd < 0) std::abort();
+                     uint64_t offset = 0;
+                     SerializeChunks(players, [&](const std::string& batch) {
+                       for (size_t done = 0; done < batch.size();) {
+                         const ssize_t n = ::pwrite(fd, batch.data() + done, batch.size() - done,
+                                                    static_cast<off_t>(offset + done));
+                         if (n <= 0) std::abort();
+                         done += static_cast<size_t>(n);
+                       }
+                       offset += batch.size();
+                     });
+                     if (::fdatasync(fd) != 0) std::abort();
+                     ::close(fd);
+                   }});
+  for (bool allow_io_uring : {true, false}) {
+    AsyncIoOptions options;
+    options.allow_io_uring = allow_io_uring;
+    cases.push_back({allow_io_uring ? "chunks/async_io_uring" : "chunks/async_threads", config.rows,
+                     players.Chunks().size(), chunk_bytes, nullptr, [&, options] {
+                       AsyncWriter out(chunks, 0, true, options);
+                       SerializeChunks(players, [&](std::string& batch) { out.Write(std::move(batch)); });
+                       out.Sync();
+                       out.Close();
+                     }});
+  }
+  cases.push_back({"checkpoint/compact", config.rows, players.Chunks().size(), 0, nullptr, [&] { db.Compact(); }});
+
+  std::vector<bench::Result> results;
+  bench::PrintHeader(stdout);
+  for (const bench::Case& c : cases) {
+    if (!config.options.filter.empty() && c.name.find(config.options.filter) == std::string::npos) continue;
+    results.push_back(bench::Run(c, config.options));
+    bench::PrintResult(stdout, results.back());
+  }
+  if (own_dir) std::filesystem::remove_all(config.dir);
+  if (!config.json_path.empty() && !bench::WriteJson(config.json_path, results, config.options)) {
+    std::fprintf(stderr, "cannot write %s\n", config.json_path.c_str());
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,187 @@
+/*********************************************************************
+ *  join_bench.cc – naive vs cost-based plans on a star schema       *
+ *                                                                   *
+ *  A sales fact table (sorted by date, like an append-only log)     *
+ *  references four dimensions: dates, products, stores and          *
+ *  customers. Every query runs twice through the SQL planner and    *
+ *  executor: once planned naively (FROM order, WHERE above all      *
+ *  joins) and once by the optimizer, so the difference is the plan  *
+ *  alone. Planning is part of the timed run. Both plans must return *
+ *  the same rows; the benchmark stops if they do not.               *
+ *                                                                   *
+ *  Run                                                              *
+ *     make run_join_bench                                           *
+ *     ./join_bench [--sales=N] [--seed=N] [--reps=N] [--filter=S]   *
+ *                  [--explain] [--json=PATH]                        *
+ *********************************************************************/
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench_harness.hpp"
+#include "db.hpp"
+#include "sql_parser.hpp"
+
+struct Config {
+  size_t sales = 200000;
+  uint64_t seed = 42;
+  bool explain = false;
+  std::string json_path;
+  bench::Options options;
+};
+
+struct Query {
+  const char* name;
+  const char* sql;
+};
+
+// Star-schema-benchmark style queries: one to four dimensions, filters of varying selectivity.
+static const Query kQueries[] = {
+    {"q1_one_dim", "SELECT SUM(f.price * f.quantity) FROM sales f JOIN dates d ON f.date_id = d.id "
+                   "WHERE d.year = 2021 AND f.quantity < 10"},
+    {"q2_two_dims", "SELECT d.year, p.brand, SUM(f.price) FROM sales f JOIN dates d ON f.date_id = d.id "
+                    "JOIN products p ON f.product_id = p.id WHERE p.category = 'cat3' "
+                    "GROUP BY d.year, p.brand ORDER BY d.year, p.brand"},
+    {"q3_three_dims", "SELECT c.segment, s.region, SUM(f.price) FROM sales f JOIN customers c ON f.customer_id = c.id "
+                      "JOIN stores s ON f.store_id = s.id JOIN dates d ON f.date_id = d.id "
+                      "WHERE s.region = 'east' AND d.year >= 2022 AND c.segment = 'retail' "
+                      "GROUP BY c.segment, s.region"},
+    {"q4_four_dims", "SELECT d.month, COUNT(*) FROM sales f JOIN products p ON f.product_id = p.id "
+                     "JOIN customers c ON f.customer_id = c.id JOIN stores s ON f.store_id = s.id "
+                     "JOIN dates d ON f.date_id = d.id WHERE p.brand = 'brand42' AND s.region = 'north' "
+                     "AND d.year = 2019 GROUP BY d.month ORDER BY d.month"},
+    {"q5_few_days", "SELECT COUNT(*), SUM(f.price) FROM dates d JOIN sales f ON f.date_id = d.id "
+                    "WHERE d.year = 2020 AND d.month = 3 AND d.day <= 3"},
+    {"q6_comma_join", "SELECT COUNT(*) FROM stores s, sales f WHERE s.id = f.store_id AND s.region = 'west'"},
+};
+
+static void Load(Database& db, const Config& config) {
+  std::mt19937_64 rng(config.seed);
+  db.Execute("CREATE TABLE dates (id INT, year INT, month INT, day INT)");
+  db.Execute("CREATE TABLE products (id INT, category TEXT ENCODING DICTIONARY, brand TEXT ENCODING DICTIONARY)");
+  db.Execute("CREATE TABLE stores (id INT, region TEXT ENCODING DICTIONARY)");
+  db.Execute("CREATE TABLE customers (id INT, segment TEXT ENCODING DICTIONARY)");
+  db.Execute("CREATE TABLE sales (date_id INT, product_id INT, store_id INT, customer_id INT, quantity INT, "
+             "price DOUBLE)");
+
+  const int days = 7 * 365;
+  for (int i = 0; i < days; ++i) {
+    const int day_of_year = i % 365;
+    db.GetTable("dates").AddRow({std::to_string(i), std::to_string(2018 + i / 365),
+                                 std::to_string(std::min(day_of_year / 30, 11) + 1),
+                                 std::to_string(day_of_year % 30 + 1)});
+  }
+  for (int i = 0; i < 1000; ++i) {
+    db.GetTable("products").AddRow({std::to_string(i), "cat" + std::to_string(i % 10),
+                                    "brand" + std::to_string(i % 100)});
+  }
+  static const char* const kRegions[] = {"north", "south", "east", "west", "central"};
+  for (int i = 0; i < 50; ++i) {
+    db.GetTable("stores").AddRow({std::to_string(i), kRegions[i % 5]});
+  }
+  static const char* const kSegments[] = {"retail", "wholesale", "online", "corporate", "public"};
+  for (int i = 0; i < 2000; ++i) {
+    db.GetTable("customers").AddRow({std::to_string(i), kSegments[i % 5]});
+  }
+  std::uniform_int_distribution<int> product(0, 999);
+  std::uniform_int_distribution<int> store(0, 49);
+  std::uniform_int_distribution<int> customer(0, 1999);
+  std::uniform_int_distribution<int> quantity(1, 50);
+  std::uniform_real_distribution<double> price(1, 500);
+  DbTable& sales = db.GetTable("sales");
+  for (size_t i = 0; i < config.sales; ++i) {
+    const size_t date = i * days / config.sales;
+    sales.AddRow({std::to_string(date), std::to_string(product(rng)), std::to_string(store(rng)),
+                  std::to_string(customer(rng)), std::to_string(quantity(rng)),
+                  std::to_string(static_cast<int>(price(rng) * 100) / 100.0)});
+  }
+  for (const char* name : {"dates", "products", "stores", "customers", "sales"}) db.GetTable(name).Analyze();
+}
+
+static std::vector<std::string> Rows(const PlanNode& plan) {
+  std::unique_ptr<Operator> root = BuildOperator(plan);
+  root->Open();
+  std::vector<std::string> rows;
+  Row row;
+  while (root->Next(row)) {
+    std::string line;
+    for (const Value& value : row) line += value.ToString() + "|";
+    rows.push_back(line);
+  }
+  std::sort(rows.begin(), rows.end());
+  return rows;
+}
+
+static bool ParseArgs(int argc, char** argv, Config& config) {
+  config.options.reps = 3;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const size_t eq = arg.find('=');
+    const std::string key = arg.substr(0, eq);
+    const std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+    if (key == "--sales") config.sales = std::strtoul(value.c_str(), nullptr, 10);
+    else if (key == "--seed") config.seed = std::strtoull(value.c_str(), nullptr, 10);
+    else if (key == "--reps") config.options.reps = std::atoi(value.c_str());
+    else if (key == "--filter") config.options.filter = value;
+    else if (key == "--explain") config.explain = true;
+    else if (key == "--json") config.json_path = value;
+    else return false;
+  }
+  return config.sales > 0 && config.options.reps > 0;
+}
+
+int main(int argc, char** argv) {
+  Config config;
+  if (!ParseArgs(argc, argv, config)) {
+    std::fprintf(stderr, "usage: %s [--sales=N] [--seed=N] [--reps=N] [--filter=S] [--explain] [--json=PATH]\n",
+                 argv[0]);
+    return 2;
+  }
+  Database db;
+  Load(db, config);
+  std::printf("star schema: %zu sales rows, 2555 dates, 1000 products, 50 stores, 2000 customers\n\n", config.sales);
+
+  PlannerOptions naive;
+  naive.optimize = false;
+  PlannerOptions optimized;
+  std::vector<bench::Result> results;
+  bench::PrintHeader(stdout);
+  for (const Query& query : kQueries) {
+    if (!config.options.filter.empty() && std::string(query.name).find(config.options.filter) == std::string::npos) {
+      continue;
+    }
+    const Statement statement = ParseSql(query.sql);
+    const PlanPtr naive_plan = PlanSelect(statement.select, db, naive);
+    const PlanPtr optimized_plan = PlanSelect(statement.select, db, optimized);
+    const std::vector<std::string> expected = Rows(*naive_plan);
+    if (Rows(*optimized_plan) != expected) {
+      std::fprintf(stderr, "%s: the optimized plan returns different rows\n", query.name);
+      return 1;
+    }
+    if (config.explain) {
+      std::printf("-- %s\nnaive:\n%soptimized:\n%s\n", query.sql, naive_plan->Explain().c_str(),
+                  optimized_plan->Explain().c_str());
+    }
+    for (const PlannerOptions* options : std::vector<const PlannerOptions*>{&naive, &optimized}) {
+      bench::Case c;
+      c.name = std::string(query.name) + (options->optimize ? "/optimized" : "/naive");
+      c.rows = config.sales;
+      c.ops = 1;
+      c.run = [&, options] {
+        const PlanPtr plan = PlanSelect(statement.select, db, *options);
+        if (Rows(*plan).size() != expected.size()) std::abort();
+      };
+      results.push_back(bench::Run(c, config.options));
+      bench::PrintResult(stdout, results.back());
+    }
+  }
+  if (!config.json_path.empty() && !bench::WriteJson(config.json_path, results, config.options)) {
+    std::fprintf(stderr, "cannot write %s\n", config.json_path.c_str());
+    return 1;
+  }
+  return 0;
+}
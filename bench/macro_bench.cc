@@ -0,0 +1,206 @@
+/*********************************************************************
+ *  macro_bench.cc – mixed insert/delete/scan/export workload on a   *
+ *                   generated league table                          *
+ *                                                                   *
+ *  The table (width, rows, distinct values per column, uniform or   *
+ *  zipfian values) and the operation schedule are generated from    *
+ *  --seed, so two runs with the same flags do the same work. With   *
+ *  --rate the schedule is open loop: operation i is due at          *
+ *  start + i / rate and its latency is measured from that moment,   *
+ *  so a stall shows up in the tail of every operation queued behind *
+ *  it instead of being hidden.                                      *
+ *                                                                   *
+ *  Run                                                              *
+ *     make run_macro_bench                                          *
+ *     ./macro_bench [--rows=N] [--width=N] [--ops=N] [--seed=N]     *
+ *                   [--mix=insert:40,delete:20,scan:39.9,export:0.1]*
+ *                   [--dist=zipf|uniform] [--theta=0.99]            *
+ *                   [--cardinality=N] [--rate=OPS] [--json=PATH]    *
+ *********************************************************************/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench_harness.hpp"
+#include "db_table.hpp"
+#include "workload.hpp"
+
+enum OpKind { kInsert, kDelete, kScan, kExport, kOpKinds };
+static const char* const kOpNames[kOpKinds] = {"insert", "delete", "scan", "export"};
+
+struct Config {
+  size_t rows = 100000;
+  size_t width = 11;
+  size_t ops = 10000;
+  size_t cardinality = 1000;
+  uint64_t seed = 42;
+  double theta = 0.99;
+  double rate = 0;                            // ops/sec; 0 runs closed loop (as fast as possible)
+  workload::Distribution distribution = workload::Distribution::kZipfian;
+  double mix[kOpKinds] = {40, 20, 39.9, 0.1}; // relative weights
+  std::string json_path;
+};
+
+static bool ParseMix(const std::string& text, double* mix) {
+  for (int k = 0; k < kOpKinds; ++k) mix[k] = 0;
+  std::stringstream in(text);
+  std::string item;
+  while (std::getline(in, item, ',')) {
+    size_t colon = item.find(':');
+    if (colon == std::string::npos) return false;
+    const std::string name = item.substr(0, colon);
+    int kind = 0;
+    while (kind < kOpKinds && name != kOpNames[kind]) ++kind;
+    if (kind == kOpKinds) return false;
+    mix[kind] = std::atof(item.c_str() + colon + 1);
+  }
+  return true;
+}
+
+static bool ParseArgs(int argc, char** argv, Config& config) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const size_t eq = arg.find('=');
+    const std::string key = arg.substr(0, eq);
+    const std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+    if (key == "--rows") config.rows = std::strtoul(value.c_str(), nullptr, 10);
+    else if (key == "--width") config.width = std::strtoul(value.c_str(), nullptr, 10);
+    else if (key == "--ops") config.ops = std::strtoul(value.c_str(), nullptr, 10);
+    else if (key == "--cardinality") config.cardinality = std::strtoul(value.c_str(), nullptr, 10);
+    else if (key == "--seed") config.seed = std::strtoull(value.c_str(), nullptr, 10);
+    else if (key == "--theta") config.theta = std::atof(value.c_str());
+    else if (key == "--rate") config.rate = std::atof(value.c_str());
+    else if (key == "--json") config.json_path = value;
+    else if (key == "--dist" && (value == "zipf" || value == "uniform")) {
+      config.distribution = value == "zipf" ? workload::Distribution::kZipfian : workload::Distribution::kUniform;
+    } else if (key == "--mix") {
+      if (!ParseMix(value, config.mix)) return false;
+    } else {
+      return false;
+    }
+  }
+  return config.width > 0 && config.cardinality > 0;
+}
+
+int main(int argc, char** argv) {
+  Config config;
+  if (!ParseArgs(argc, argv, config)) {
+    std::fprintf(stderr, "usage: %s [--rows=N] [--width=N] [--ops=N] [--seed=N] [--mix=insert:W,delete:W,scan:W,"
+                 "export:W] [--dist=zipf|uniform] [--theta=T] [--cardinality=N] [--rate=OPS] [--json=PATH]\n",
+                 argv[0]);
+    return 2;
+  }
+
+  workload::RowGenerator rows(workload::LeagueSchema(config.width, config.cardinality, config.distribution),
+                              config.seed, config.theta);
+  DbTable table;
+  rows.AddColumns(table);
+  std::vector<unsigned int> live_ids;         // ids of the rows still in the table, in any order
+  unsigned int next_id = 0;                   // ids are handed out in insertion order
+
+  auto load_start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < config.rows; ++i) {
+    table.AddRow(rows.NextRow());
+    live_ids.push_back(next_id++);
+  }
+  const double load_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - load_start).count();
+
+  // The schedule is drawn before anything runs, from its own generator, so it does not depend on the data.
+  std::mt19937_64 schedule_rng(config.seed ^ 0x9e3779b97f4a7c15ULL);
+  std::discrete_distribution<int> pick(config.mix, config.mix + kOpKinds);
+  std::vector<int> schedule(config.ops);
+  for (int& kind : schedule) kind = pick(schedule_rng);
+
+  std::vector<bench::Result> latency(kOpKinds);
+  for (int k = 0; k < kOpKinds; ++k) latency[k].name = kOpNames[k];
+  volatile size_t sink = 0;
+  std::mt19937_64& rng = rows.Rng();
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < schedule.size(); ++i) {
+    auto due = start;
+    if (config.rate > 0) {
+      due += std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+          std::chrono::duration<double>(static_cast<double>(i) / config.rate));
+      std::this_thread::sleep_until(due);
+    } else {
+      due = std::chrono::steady_clock::now();
+    }
+    int kind = schedule[i];
+    if (kind == kDelete && live_ids.empty()) kind = kInsert;
+    switch (kind) {
+    case kInsert:
+      table.AddRow(rows.NextRow());
+      live_ids.push_back(next_id++);
+      break;
+    case kDelete: {
+      size_t victim = std::uniform_int_distribution<size_t>(0, live_ids.size() - 1)(rng);
+      table.DeleteRowById(live_ids[victim]);
+      live_ids[victim] = live_ids.back();
+      live_ids.pop_back();
+      break;
+    }
+    case kScan: {
+      // equality on a random column with a value drawn like the data, so hot values are scanned for as often
+      const size_t col = std::uniform_int_distribution<size_t>(0, config.width - 1)(rng);
+      sink = sink + table.Filter(static_cast<unsigned int>(col), CompareOp::kEq, rows.NextValue(col)).size();
+      break;
+    }
+    case kExport: {
+      std::ostringstream csv;
+      workload::ExportCsv(table, csv);
+      sink = sink + static_cast<size_t>(csv.tellp());
+      break;
+    }
+    }
+    latency[kind].samples_ns.push_back(
+        std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - due).count());
+  }
+  const double run_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  std::printf("table: %zu columns, %zu rows loaded in %.3f s (%.0f rows/sec), %zu distinct values per column (%s)\n",
+              config.width, config.rows, load_s, load_s > 0 ? static_cast<double>(config.rows) / load_s : 0.0,
+              config.cardinality, config.distribution == workload::Distribution::kZipfian ? "zipfian" : "uniform");
+  std::printf("run:   %zu ops in %.3f s = %.0f ops/sec%s, %zu rows left\n", schedule.size(), run_s,
+              run_s > 0 ? static_cast<double>(schedule.size()) / run_s : 0.0,
+              config.rate > 0 ? " (open loop)" : "", live_ids.size());
+  std::printf("%-8s %10s %12s %12s %12s %12s %12s %12s\n", "op", "count", "ops/sec", "p50 (us)", "p90 (us)",
+              "p99 (us)", "p99.9 (us)", "max (us)");
+  for (bench::Result& r : latency) {
+    std::sort(r.samples_ns.begin(), r.samples_ns.end());
+    r.ops = r.samples_ns.size();
+    std::printf("%-8s %10zu %12.0f %12.1f %12.1f %12.1f %12.1f %12.1f\n", r.name.c_str(), r.ops,
+                run_s > 0 ? static_cast<double>(r.ops) / run_s : 0.0, r.Percentile(50) / 1e3, r.Percentile(90) / 1e3,
+                r.Percentile(99) / 1e3, r.Percentile(99.9) / 1e3, r.Percentile(100) / 1e3);
+  }
+
+  if (!config.json_path.empty()) {
+    std::FILE* out = std::fopen(config.json_path.c_str(), "w");
+    if (out == nullptr) {
+      std::fprintf(stderr, "cannot write %s\n", config.json_path.c_str());
+      return 1;
+    }
+    std::fprintf(out, "{\n  \"rows\": %zu, \"width\": %zu, \"cardinality\": %zu, \"seed\": %llu, \"rate\": %.1f,\n",
+                 config.rows, config.width, config.cardinality, static_cast<unsigned long long>(config.seed),
+                 config.rate);
+    std::fprintf(out, "  \"load_rows_per_sec\": %.1f, \"ops\": %zu, \"ops_per_sec\": %.1f,\n  \"latency\": [",
+                 load_s > 0 ? static_cast<double>(config.rows) / load_s : 0.0, schedule.size(),
+                 run_s > 0 ? static_cast<double>(schedule.size()) / run_s : 0.0);
+    for (int k = 0; k < kOpKinds; ++k) {
+      const bench::Result& r = latency[k];
+      std::fprintf(out, "%s\n    {\"op\": \"%s\", \"count\": %zu, \"p50_ns\": %.0f, \"p90_ns\": %.0f, "
+                   "\"p99_ns\": %.0f, \"p999_ns\": %.0f, \"max_ns\": %.0f}",
+                   k == 0 ? "" : ",", r.name.c_str(), r.ops, r.Percentile(50), r.Percentile(90), r.Percentile(99),
+                   r.Percentile(99.9), r.Percentile(100));
+    }
+    std::fprintf(out, "\n  ]\n}\n");
+    std::fclose(out);
+  }
+  return 0;
+}
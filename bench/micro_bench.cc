@@ -0,0 +1,137 @@
+/*********************************************************************
+ *  micro_bench.cc – per-operation timings of DbTable at growing     *
+ *                   table sizes                                     *
+ *                                                                   *
+ *  Run                                                              *
+ *     make bench                  (all cases, 1K..1M rows)          *
+ *     ./micro_bench [--rows=1000,10000000] [--reps=N] [--warmup=N]  *
+ *                   [--filter=copy] [--json=results.json]           *
+ *                                                                   *
+ *  Compare two builds by diffing the p50_ns / ops_per_sec of their  *
+ *  JSON files.                                                      *
+ *********************************************************************/
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "bench_harness.hpp"
+#include "db_table.hpp"
+#include "workload.hpp"
+
+// A league table like the driver's: two strings, two ints, a double.
+static void AddColumns(DbTable& table) {
+  table.AddColumn({"Team_Name", DataType::kString});
+  table.AddColumn({"Ranking", DataType::kInt});
+  table.AddColumn({"Goal", DataType::kInt});
+  table.AddColumn({"Average_shots_per_game", DataType::kDouble});
+  table.AddColumn({"Coach", DataType::kString});
+}
+
+static std::vector<std::string> MakeRow(size_t i) {
+  return {"Team " + std::to_string(i % 1000), std::to_string(i % 20 + 1), std::to_string(i % 97),
+          std::to_string(static_cast<double>(i % 300) / 10.0), "Coach " + std::to_string(i % 5000)};
+}
+
+static void Fill(DbTable& table, size_t rows) {
+  AddColumns(table);
+  for (size_t i = 0; i < rows; ++i) {
+    table.AddRow(MakeRow(i));
+  }
+}
+
+static std::vector<size_t> ParseSizes(const std::string& list) {
+  std::vector<size_t> sizes;
+  std::stringstream in(list);
+  std::string item;
+  while (std::getline(in, item, ',')) {
+    if (!item.empty()) sizes.push_back(std::strtoul(item.c_str(), nullptr, 10));
+  }
+  return sizes;
+}
+
+int main(int argc, char** argv) {
+  std::vector<size_t> sizes = {1000, 10000, 100000, 1000000};
+  bench::Options options;
+  std::string json_path;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg.rfind("--rows=", 0) == 0) {
+      sizes = ParseSizes(arg.substr(7));
+    } else if (arg.rfind("--reps=", 0) == 0) {
+      options.reps = std::max(1, std::atoi(arg.c_str() + 7));
+    } else if (arg.rfind("--warmup=", 0) == 0) {
+      options.warmup = std::max(0, std::atoi(arg.c_str() + 9));
+    } else if (arg.rfind("--filter=", 0) == 0) {
+      options.filter = arg.substr(9);
+    } else if (arg.rfind("--json=", 0) == 0) {
+      json_path = arg.substr(7);
+    } else {
+      std::fprintf(stderr, "usage: %s [--rows=N,...] [--reps=N] [--warmup=N] [--filter=S] [--json=PATH]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  std::vector<bench::Result> results;
+  volatile size_t sink = 0;
+  bench::PrintHeader(stdout);
+  for (size_t rows : sizes) {
+    DbTable source;  // read-only input of the copy / export cases
+    Fill(source, rows);
+    std::unique_ptr<DbTable> table;  // rebuilt by the setup of every case that consumes its table
+    auto fresh = [&] { table = std::make_unique<DbTable>(source); };
+
+    std::ostringstream probe;
+    probe << source;
+    const size_t print_bytes = probe.str().size();
+    probe.str("");
+    workload::ExportCsv(source, probe);  // to memory, so the disk is not measured
+    const size_t csv_bytes = probe.str().size();
+    size_t cell_bytes = 0;
+    for (const auto& row : source.GetRows()) {
+      for (const std::string& cell : row) cell_bytes += cell.size();
+    }
+    BinaryWriter image;
+    source.Serialize(image);
+
+    std::vector<std::vector<std::string>> input(rows);
+    for (size_t i = 0; i < rows; ++i) input[i] = MakeRow(i);
+
+    const std::vector<bench::Case> cases = {
+        {"AddRow", rows, rows, 0,
+         [&] { table = std::make_unique<DbTable>(); AddColumns(*table); },
+         [&] { for (const auto& row : input) table->AddRow(row); }},
+        // 4 more columns on a 5-column table: capacity 8 -> 16 resizes every row once
+        {"AddColumn+ResizeRows", rows, 4, 0, fresh,
+         [&] { for (int c = 0; c < 4; ++c) table->AddColumn({"Extra" + std::to_string(c), DataType::kInt}); }},
+        {"DeleteRowById", rows, rows, 0, fresh,
+         [&] { for (unsigned int id = 0; id < rows; ++id) table->DeleteRowById(id); }},
+        {"DeleteColumnByIdx", rows, rows, 0, fresh, [&] { table->DeleteColumnByIdx(0); }},
+        {"DeepCopy", rows, rows, image.Size(), [&] { table.reset(); },
+         [&] { table = std::make_unique<DbTable>(source); }},
+        {"GetRows", rows, rows, cell_bytes, nullptr, [&] { sink = sink + source.GetRows().size(); }},
+        {"operator<<", rows, rows, print_bytes, nullptr,
+         [&] { std::ostringstream os; os << source; sink = sink + static_cast<size_t>(os.tellp()); }},
+        {"ExportCSV", rows, rows, csv_bytes, nullptr,
+         [&] { std::ostringstream os; workload::ExportCsv(source, os); sink = sink + static_cast<size_t>(os.tellp()); }},
+    };
+    for (const bench::Case& c : cases) {
+      if (!options.filter.empty() && c.name.find(options.filter) == std::string::npos) continue;
+      results.push_back(bench::Run(c, options));
+      bench::PrintResult(stdout, results.back());
+    }
+  }
+
+  if (!json_path.empty()) {
+    if (!bench::WriteJson(json_path, results, options)) {
+      std::fprintf(stderr, "cannot write %s\n", json_path.c_str());
+      return 1;
+    }
+    std::printf("wrote %s\n", json_path.c_str());
+  }
+  return 0;
+}
@@ -0,0 +1,102 @@
+/*********************************************************************
+ *  rle_bench.cc – run-length encoded columns against the plain      *
+ *                 layout: filter, count, sum and group-by           *
+ *                                                                   *
+ *  Run                                                              *
+ *     make rle_bench && ./rle_bench [rows] [run length]             *
+ *********************************************************************/
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "db_table.hpp"
+#include "run_length_column.hpp"
+
+// A sorted season column, a flag column with long runs and an unsorted score column that has no runs at all.
+static void Fill(DbTable& table, Encoding encoding, size_t rows, size_t run_length) {
+  table.AddColumn({"Season", DataType::kInt}, encoding);
+  table.AddColumn({"Flag", DataType::kString}, encoding);
+  table.AddColumn({"Score", DataType::kInt});
+  for (size_t i = 0; i < rows; ++i) {
+    table.AddRow({std::to_string(2000 + i / run_length), (i / run_length) % 2 == 0 ? "Y" : "N",
+                  std::to_string((i * 7919) % 1000)});
+  }
+}
+
+// Best of `reps` runs, in milliseconds.
+static double Time(const std::function<void()>& body, int reps = 5) {
+  double best = 0;
+  for (int r = 0; r < reps; ++r) {
+    auto start = std::chrono::steady_clock::now();
+    body();
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    if (r == 0 || ms < best) best = ms;
+  }
+  return best;
+}
+
+int main(int argc, char** argv) {
+  size_t rows = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+  size_t run_length = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 50000;
+  if (run_length == 0) run_length = 1;
+
+  DbTable plain;
+  DbTable rle;
+  Fill(plain, Encoding::kPlain, rows, run_length);
+  Fill(rle, Encoding::kRunLength, rows, run_length);
+  // Delete every 100th row so the live bitmap has holes, like a table that has seen deletes.
+  for (unsigned int id = 0; id < rows; id += 100) {
+    plain.DeleteRowById(id);
+    rle.DeleteRowById(id);
+  }
+
+  const std::string mid_season = std::to_string(2000 + rows / run_length / 2);
+  struct Op {
+    const char* name;
+    std::function<void(const DbTable&)> run;
+  };
+  volatile double sink = 0;
+  const std::vector<Op> ops = {
+      {"filter season = mid", [&](const DbTable& t) { sink = sink + t.Filter(0, CompareOp::kEq, mid_season).size(); }},
+      {"count season >= mid", [&](const DbTable& t) { sink = sink + t.Count(0, CompareOp::kGe, mid_season); }},
+      {"count flag = Y", [&](const DbTable& t) { sink = sink + t.Count(1, CompareOp::kEq, "Y"); }},
+      {"sum season", [&](const DbTable& t) { sink = sink + t.Aggregate(0, AggregateFn::kSum); }},
+      {"group by season", [&](const DbTable& t) { sink = sink + t.GroupByCount(0).size(); }},
+      {"group by flag", [&](const DbTable& t) { sink = sink + t.GroupByCount(1).size(); }},
+  };
+
+  std::printf("rows=%zu run length=%zu\n", rows, run_length);
+  std::printf("%-22s %12s %12s %9s\n", "operation", "plain (ms)", "rle (ms)", "speedup");
+  for (const Op& op : ops) {
+    double plain_ms = Time([&] { op.run(plain); });
+    double rle_ms = Time([&] { op.run(rle); });
+    std::printf("%-22s %12.3f %12.3f %8.1fx\n", op.name, plain_ms, rle_ms, rle_ms > 0 ? plain_ms / rle_ms : 0.0);
+  }
+
+  std::printf("\n%-8s %8s %14s %14s %8s\n", "column", "runs", "raw bytes", "encoded bytes", "ratio");
+  for (unsigned int col = 0; col < 2; ++col) {
+    const Column* column = rle.GetColumn(col);
+    size_t runs = 0;
+    size_t raw = 0;
+    size_t encoded = 0;
+    double ratio = 0;
+    if (const auto* ints = dynamic_cast<const RunLengthColumn<int32_t>*>(column)) {
+      runs = ints->RunCount();
+      raw = ints->RawBytes();
+      encoded = ints->EncodedBytes();
+      ratio = ints->CompressionRatio();
+    } else if (const auto* strings = dynamic_cast<const RunLengthColumn<std::string>*>(column)) {
+      runs = strings->RunCount();
+      raw = strings->RawBytes();
+      encoded = strings->EncodedBytes();
+      ratio = strings->CompressionRatio();
+    }
+    std::printf("%-8s %8zu %14zu %14zu %7.0fx\n", rle.GetColumnDescriptions()[col].first.c_str(), runs, raw, encoded,
+                ratio);
+  }
+  return 0;
+}
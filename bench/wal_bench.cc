@@ -0,0 +1,84 @@
+/*********************************************************************
+ *  wal_bench.cc – commits/sec of the write-ahead log at different   *
+ *                 group-commit windows                              *
+ *                                                                   *
+ *  Run                                                              *
+ *     make wal_bench && ./wal_bench [threads] [seconds] [dir]       *
+ *********************************************************************/
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "binary_io.hpp"
+#include "wal.hpp"
+
+struct BenchResult {
+  double commits_per_sec;
+  double syncs_per_sec;
+  double avg_batch;
+};
+
+// Every worker thread commits AddRow-sized records as fast as it can for `seconds`.
+static BenchResult RunOnce(const std::string& path, int threads, double seconds,
+                           std::chrono::microseconds window) {
+  std::remove(path.c_str());
+  WalOptions options;
+  options.group_commit_window = window;
+  WriteAheadLog wal(path, options);
+
+  BinaryWriter payload;
+  payload.PutString("league_data");
+  payload.PutU32(3);
+  payload.PutString("Shanghai ShenHua FC");
+  payload.PutString("1");
+  payload.PutString("17.6");
+
+  std::atomic<bool> stop{false};
+  std::atomic<uint64_t> commits{0};
+  std::vector<std::thread> workers;
+  auto start = std::chrono::steady_clock::now();
+  for (int t = 0; t < threads; ++t) {
+    workers.emplace_back([&] {
+      uint64_t local = 0;
+      while (!stop.load(std::memory_order_relaxed)) {
+        wal.AppendAndCommit(WalRecordType::kAddRow, payload.Data());
+        ++local;
+      }
+      commits += local;
+    });
+  }
+  std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+  stop = true;
+  for (auto& w : workers) w.join();
+  double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  BenchResult r{};
+  r.commits_per_sec = static_cast<double>(commits.load()) / elapsed;
+  r.syncs_per_sec = static_cast<double>(wal.SyncCount()) / elapsed;
+  r.avg_batch = wal.SyncCount() == 0 ? 0.0 : static_cast<double>(commits.load()) / static_cast<double>(wal.SyncCount());
+  std::remove(path.c_str());
+  return r;
+}
+
+int main(int argc, char** argv) {
+  int threads = argc > 1 ? std::atoi(argv[1]) : 8;
+  double seconds = argc > 2 ? std::atof(argv[2]) : 2.0;
+  std::string dir = argc > 3 ? argv[3] : ".";
+  std::string path = dir + "/wal_bench_" + std::to_string(::getpid()) + ".log";
+
+  const std::vector<int> windows_us = {0, 50, 100, 250, 500, 1000, 2000};
+  std::printf("threads=%d seconds=%.1f file=%s\n", threads, seconds, path.c_str());
+  std::printf("%12s %14s %12s %12s\n", "window(us)", "commits/sec", "syncs/sec", "avg batch");
+  for (int us : windows_us) {
+    BenchResult r = RunOnce(path, threads, seconds, std::chrono::microseconds(us));
+    std::printf("%12d %14.0f %12.0f %12.1f\n", us, r.commits_per_sec, r.syncs_per_sec, r.avg_batch);
+  }
+  return 0;
+}
@@ -0,0 +1,167 @@
+/*********************************************************************
+ *  workload.hpp – synthetic tables and operation schedules for the  *
+ *                 benchmark programs                                *
+ *                                                                   *
+ *  A table is described column by column (type, encoding, number of *
+ *  distinct values and how often each is drawn: uniform or zipfian) *
+ *  and rows are generated from a seed, so every run of a benchmark  *
+ *  sees exactly the same data and the same operation schedule.      *
+ *  LeagueSchema() widens the league table of the driver example to  *
+ *  any number of columns.                                           *
+ *********************************************************************/
+
+#ifndef WORKLOAD_HPP
+#define WORKLOAD_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <ostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "db_table.hpp"
+#include "value_types.hpp"
+
+namespace workload {
+
+enum class Distribution { kUniform, kZipfian };
+
+struct ColumnSpec {
+  std::string name;
+  DataType type = DataType::kInt;
+  Encoding encoding = Encoding::kPlain;
+  size_t cardinality = 1000;            // distinct values
+  Distribution distribution = Distribution::kUniform;
+};
+
+// Draws ranks in [0, n): uniformly, or with P(rank k) proportional to 1 / (k + 1)^theta (rank 0 is the hottest).
+class RankGenerator {
+public:
+  RankGenerator(size_t n, Distribution distribution, double theta): n_(std::max<size_t>(n, 1)) {
+    if (distribution != Distribution::kZipfian) return;
+    cdf_.resize(n_);
+    double sum = 0;
+    for (size_t k = 0; k < n_; ++k) {
+      sum += 1.0 / std::pow(static_cast<double>(k + 1), theta);
+      cdf_[k] = sum;
+    }
+    for (double& c : cdf_) c /= sum;
+  }
+
+  template <typename Rng>
+  size_t Next(Rng& rng) const {
+    if (cdf_.empty()) return std::uniform_int_distribution<size_t>(0, n_ - 1)(rng);
+    const double u = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+    return std::min<size_t>(static_cast<size_t>(std::lower_bound(cdf_.begin(), cdf_.end(), u) - cdf_.begin()),
+                            n_ - 1);
+  }
+
+private:
+  size_t n_;
+  std::vector<double> cdf_;             // empty for uniform
+};
+
+// Text of the rank-th distinct value of a column of the given type (what AddRow and Filter take).
+inline std::string ValueText(const ColumnSpec& column, size_t rank) {
+  switch (column.type) {
+  case DataType::kString: return column.name + " " + std::to_string(rank);
+  case DataType::kDouble: return std::to_string(static_cast<double>(rank) / 10.0);
+  case DataType::kInt: return std::to_string(rank);
+  case DataType::kInt64: return std::to_string(static_cast<int64_t>(rank) * 1000003);
+  case DataType::kBool: return rank % 2 == 0 ? "true" : "false";
+  case DataType::kDate: return FormatInt64Value(DataType::kDate, 19000 + static_cast<int64_t>(rank));
+  case DataType::kTimestamp:
+    return FormatInt64Value(DataType::kTimestamp, (1700000000LL + static_cast<int64_t>(rank)) * 1000000);
+  case DataType::kDecimal: return FormatInt64Value(DataType::kDecimal, static_cast<int64_t>(rank) * 25);
+  }
+  return "";
+}
+
+/* The columns of the driver's league table (team name, ranking, goals, shots, passes, ...), repeated with a numeric
+suffix until there are `width` of them. */
+inline std::vector<ColumnSpec> LeagueSchema(size_t width, size_t cardinality, Distribution distribution) {
+  static const std::pair<const char*, DataType> kLeague[] = {
+      {"Team_Name", DataType::kString},        {"Ranking", DataType::kInt},
+      {"Goal", DataType::kInt},                {"Average_shots_per_game", DataType::kDouble},
+      {"Average_shots_on_target_per_game", DataType::kDouble},
+      {"Average_passes_per_game", DataType::kInt},
+      {"Probability_of_successful_passes_per_game", DataType::kDouble},
+      {"Key_passes", DataType::kInt},          {"Goals_conceded", DataType::kInt},
+      {"Tackles", DataType::kInt},             {"Clearance", DataType::kInt},
+  };
+  const size_t league_width = sizeof(kLeague) / sizeof(kLeague[0]);
+  std::vector<ColumnSpec> columns;
+  for (size_t i = 0; i < width; ++i) {
+    ColumnSpec column;
+    column.name = kLeague[i % league_width].first;
+    if (i >= league_width) column.name += "_" + std::to_string(i / league_width);
+    column.type = kLeague[i % league_width].second;
+    column.cardinality = cardinality;
+    column.distribution = distribution;
+    columns.push_back(column);
+  }
+  return columns;
+}
+
+// Rows of a table described by ColumnSpecs. Every column draws its own rank per row from one seeded generator.
+class RowGenerator {
+public:
+  RowGenerator(std::vector<ColumnSpec> columns, uint64_t seed, double theta = 0.99)
+      : columns_(std::move(columns)), rng_(seed) {
+    if (columns_.empty()) throw std::invalid_argument("A workload table needs at least one column");
+    for (const ColumnSpec& column : columns_) {
+      ranks_.emplace_back(column.cardinality, column.distribution, theta);
+      std::vector<std::string> values;
+      values.reserve(column.cardinality);
+      for (size_t rank = 0; rank < column.cardinality; ++rank) values.push_back(ValueText(column, rank));
+      values_.push_back(std::move(values));
+    }
+  }
+
+  const std::vector<ColumnSpec>& Columns() const { return columns_; }
+
+  void AddColumns(DbTable& table) const {
+    for (const ColumnSpec& column : columns_) table.AddColumn({column.name, column.type}, column.encoding);
+  }
+
+  std::vector<std::string> NextRow() {
+    std::vector<std::string> row;
+    row.reserve(columns_.size());
+    for (size_t col = 0; col < columns_.size(); ++col) row.push_back(NextValue(col));
+    return row;
+  }
+
+  // A value drawn with the column's own distribution (so predicates hit hot values as often as rows hold them).
+  const std::string& NextValue(size_t col) { return values_[col][ranks_[col].Next(rng_)]; }
+
+  std::mt19937_64& Rng() { return rng_; }
+
+private:
+  std::vector<ColumnSpec> columns_;
+  std::vector<RankGenerator> ranks_;
+  std::vector<std::vector<std::string>> values_;  // distinct values per column, by rank
+  std::mt19937_64 rng_;
+};
+
+// The format of ExportTableToCSV in the driver: a header of column names, then one line per row.
+inline void ExportCsv(const DbTable& table, std::ostream& out) {
+  const auto& columns = table.GetColumnDescriptions();
+  for (size_t i = 0; i < columns.size(); ++i) {
+    out << columns[i].first << (i + 1 < columns.size() ? "," : "");
+  }
+  out << "\n";
+  for (const auto& row : table.GetRows()) {
+    for (size_t i = 0; i < row.size(); ++i) {
+      out << row[i] << (i + 1 < row.size() ? "," : "");
+    }
+    out << "\n";
+  }
+}
+
+}  // namespace workload
+
+#endif
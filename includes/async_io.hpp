@@ -0,0 +1,75 @@
+/*
+Notes:
+
+Asynchronous writes:
+1. An AsyncWriter writes a file front to back without making the thread that produces the bytes wait for the device:
+   Write takes a buffer (moved in, never copied) and returns once it is queued, so the caller formats or serializes
+   the next buffer while earlier ones are written. Sync waits for everything written so far and fdatasyncs; Close
+   waits and closes the file. Writes to one AsyncWriter come from one thread.
+2. On Linux writes go through io_uring, set up with raw system calls (no liburing). Queued writes are submitted
+   together: one io_uring_enter once batch_bytes are waiting (or on Sync/Close), with up to queue_depth writes in
+   flight. Short writes are resubmitted for the rest.
+3. Where io_uring is not available (other systems, old kernels, seccomp filters that deny it) or allow_io_uring is
+   false, a pool of threads issues the writes with pwritev, a run of queued buffers that follow each other per call.
+   Backend() says which one is in use.
+4. At most max_pending_bytes are queued or in flight; Write blocks until older writes finish to stay under it (a
+   single larger buffer is let through alone).
+5. The first failed write is reported by the next Write, Sync or Close as std::runtime_error; opening the file
+   throws std::runtime_error too.
+*/
+
+#ifndef ASYNC_IO_HPP
+#define ASYNC_IO_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+enum class AsyncIoBackend { kIoUring, kThreadPool };
+
+struct AsyncIoOptions {
+  size_t queue_depth = 32;                // io_uring: writes in flight at once
+  size_t batch_bytes = 1 << 20;           // io_uring: queued bytes that trigger a submission
+  size_t threads = 2;                     // thread pool: writer threads
+  size_t max_pending_bytes = 64 << 20;    // queued and in flight
+  bool allow_io_uring = true;
+};
+
+struct AsyncIoStats {
+  uint64_t writes = 0;       // buffers handed to Write
+  uint64_t bytes = 0;
+  uint64_t submissions = 0;  // io_uring_enter calls that submitted writes, or pwritev calls of the thread pool
+  uint64_t syncs = 0;
+};
+
+const char* AsyncIoBackendName(AsyncIoBackend backend);  // "io_uring", "thread pool"
+
+class AsyncWriter {
+public:
+  // Opens (creating it if needed, emptying it when truncate) the file at path; the first Write goes to offset.
+  AsyncWriter(const std::string& path, uint64_t offset, bool truncate,
+              const AsyncIoOptions& options = AsyncIoOptions());
+  ~AsyncWriter();  // Close(), without reporting errors
+  AsyncWriter(const AsyncWriter&) = delete;
+  AsyncWriter& operator=(const AsyncWriter&) = delete;
+
+  void Write(std::string data);  // at Offset(), which then moves past it
+  void Sync();
+  void Close();
+  uint64_t Offset() const { return offset_; }
+  AsyncIoBackend Backend() const { return backend_; }
+  AsyncIoStats Stats() const;
+
+  class Engine;  // a backend; defined in async_io.cc
+
+private:
+  std::string path_;
+  int fd_ = -1;
+  uint64_t offset_ = 0;
+  AsyncIoBackend backend_ = AsyncIoBackend::kThreadPool;
+  std::unique_ptr<Engine> engine_;
+  AsyncIoStats stats_;  // syncs, and everything once closed
+};
+
+#endif
@@ -0,0 +1,111 @@
+/*
+Notes:
+
+BinaryWriter / BinaryReader:
+1. Little helpers used by the write-ahead log and the snapshot file to turn values into bytes and back.
+2. Integers are written in little-endian order so the files are portable between the machines we run on.
+3. BinaryReader throws std::runtime_error when asked to read past the end (a torn or truncated record).
+*/
+
+#ifndef BINARY_IO_HPP
+#define BINARY_IO_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+class BinaryWriter {
+public:
+  void PutU8(uint8_t v) { buf_.push_back(static_cast<char>(v)); }
+  void PutU32(uint32_t v) {
+    for (int i = 0; i < 4; ++i) buf_.push_back(static_cast<char>((v >> (8 * i)) & 0xFF));
+  }
+  void PutU64(uint64_t v) {
+    for (int i = 0; i < 8; ++i) buf_.push_back(static_cast<char>((v >> (8 * i)) & 0xFF));
+  }
+  void PutI32(int32_t v) { PutU32(static_cast<uint32_t>(v)); }
+  void PutDouble(double v) {
+    uint64_t bits = 0;
+    std::memcpy(&bits, &v, sizeof(bits));
+    PutU64(bits);
+  }
+  void PutString(const std::string& s) {
+    PutU32(static_cast<uint32_t>(s.size()));
+    buf_.append(s);
+  }
+  void PutBytes(const void* data, std::size_t size) { buf_.append(static_cast<const char*>(data), size); }
+
+  const std::string& Data() const { return buf_; }
+  std::string& Data() { return buf_; }
+  std::size_t Size() const { return buf_.size(); }
+  void Clear() { buf_.clear(); }
+
+private:
+  std::string buf_;
+};
+
+class BinaryReader {
+public:
+  BinaryReader(const char* data, std::size_t size): data_(data), size_(size) {}
+  explicit BinaryReader(const std::string& data): data_(data.data()), size_(data.size()) {}
+
+  uint8_t GetU8() {
+    Need(1);
+    return static_cast<uint8_t>(data_[pos_++]);
+  }
+  uint32_t GetU32() {
+    Need(4);
+    uint32_t v = 0;
+    for (int i = 0; i < 4; ++i) v |= static_cast<uint32_t>(static_cast<uint8_t>(data_[pos_ + i])) << (8 * i);
+    pos_ += 4;
+    return v;
+  }
+  uint64_t GetU64() {
+    Need(8);
+    uint64_t v = 0;
+    for (int i = 0; i < 8; ++i) v |= static_cast<uint64_t>(static_cast<uint8_t>(data_[pos_ + i])) << (8 * i);
+    pos_ += 8;
+    return v;
+  }
+  int32_t GetI32() { return static_cast<int32_t>(GetU32()); }
+  double GetDouble() {
+    uint64_t bits = GetU64();
+    double v = 0;
+    std::memcpy(&v, &bits, sizeof(v));
+    return v;
+  }
+  std::string GetString() {
+    uint32_t len = GetU32();
+    Need(len);
+    std::string s(data_ + pos_, len);
+    pos_ += len;
+    return s;
+  }
+  void GetBytes(void* out, std::size_t size) {
+    Need(size);
+    std::memcpy(out, data_ + pos_, size);
+    pos_ += size;
+  }
+
+  bool AtEnd() const { return pos_ == size_; }
+  std::size_t Position() const { return pos_; }
+  std::size_t Remaining() const { return size_ - pos_; }
+
+private:
+  void Need(std::size_t n) const {
+    if (size_ - pos_ < n) {
+      throw std::runtime_error("Truncated binary record");
+    }
+  }
+
+  const char* data_;
+  std::size_t size_;
+  std::size_t pos_ = 0;
+};
+
+// CRC-32 (IEEE polynomial) used to detect torn or corrupted records on disk.
+uint32_t Crc32(const void* data, std::size_t size, uint32_t crc = 0);
+
+#endif
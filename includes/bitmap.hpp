@@ -0,0 +1,25 @@
+/*
+Notes:
+
+Row bitmaps:
+1. The live-row bitmap and the per-column validity bitmaps are std::vector<uint64_t> with one bit per row id
+   (bit id % 64 of word id / 64), so whole-column operations run 64 rows per instruction.
+2. AndBitmaps combines two bitmaps 128 bits per SSE2 step; CountBits is a popcount per word.
+3. A validity bitmap only exists once its column has held a NULL, and ids past its end are valid (not NULL), so rows
+   appended after the last NULL never have to touch it.
+*/
+
+#ifndef BITMAP_HPP
+#define BITMAP_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// out = a & b over a's length; words past the end of b count as all ones.
+void AndBitmaps(const std::vector<uint64_t>& a, const std::vector<uint64_t>& b, std::vector<uint64_t>& out);
+
+// Number of set bits.
+size_t CountBits(const std::vector<uint64_t>& bits);
+
+#endif
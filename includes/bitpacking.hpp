@@ -0,0 +1,29 @@
+/*
+Notes:
+
+Bit-packing:
+1. Packs unsigned 32-bit values into `width` bits each (width 0..32).
+2. The layout is "vertical" with 4 lanes: value i belongs to lane i % 4 and word k of lane j is stored at index
+   4 * k + j. All four lanes have the same shape, so one SSE2 register unpacks four values per step.
+3. count must be a multiple of kPackLanes.
+*/
+
+#ifndef BITPACKING_HPP
+#define BITPACKING_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+static const size_t kPackLanes = 4;
+
+// Bits needed to store max_value (0 for 0).
+unsigned BitWidth(uint64_t max_value);
+
+// Number of 32-bit words PackBlock writes for count values of the given width.
+size_t PackedWords(size_t count, unsigned width);
+
+void PackBlock(const uint32_t* in, size_t count, unsigned width, uint32_t* out);  // out must be zeroed
+void UnpackBlock(const uint32_t* in, size_t count, unsigned width, uint32_t* out);
+uint32_t UnpackOne(const uint32_t* in, size_t index, unsigned width);
+
+#endif
@@ -0,0 +1,125 @@
+/*
+Notes:
+
+Buffer pool:
+1. A BufferPool caches the pages (kPageSize bytes) of one file in a fixed number of frames, so that structures kept
+   in pages (PagedTable, paged_table.hpp) can be larger than memory while the pages in use stay in it.
+2. Fetch pins a page: its frame is not reused while a PageGuard for it exists. MutableData marks the page dirty;
+   dirty pages are written back when their frame is reused and by Flush. Fetch throws std::runtime_error when every
+   frame is pinned, std::out_of_range for a page past the end of the file.
+3. Frames are replaced with CLOCK: a hit sets the reference bit of its frame; the hand clears set bits as it passes
+   and takes the first unpinned frame whose bit is clear.
+4. Scans do not flush the pool. A page fetched with AccessHint::kScan goes into a ring of at most scan_frames frames
+   that scans recycle oldest first, so a scan of any length leaves the other frames (and their hot pages) alone.
+   A kScan hit does not count as a reference; a kRandom fetch of a page in the ring moves it out of the ring.
+5. A kScan miss reads ahead: it loads the page and the uncached pages after it, up to prefetch_pages in all, with a
+   single read.
+6. Not thread-safe: one user at a time, like the mutating methods of DbTable.
+*/
+
+#ifndef BUFFER_POOL_HPP
+#define BUFFER_POOL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+enum class AccessHint { kRandom, kScan };
+
+struct BufferPoolOptions {
+  size_t frames = 1024;       // pages held in memory
+  size_t scan_frames = 32;    // frames scans recycle among themselves (at most frames / 2)
+  size_t prefetch_pages = 8;  // pages a scan miss reads at once (at most scan_frames / 2)
+  bool sync = true;           // false skips fdatasync in Flush (tests / benchmarks only)
+};
+
+struct BufferPoolStats {
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  uint64_t reads = 0;       // pages read from the file, prefetched ones included
+  uint64_t prefetched = 0;  // pages read ahead of a scan
+  uint64_t writes = 0;      // dirty pages written back
+  uint64_t evictions = 0;   // cached pages whose frame was reused
+  size_t frames = 0;
+  size_t cached = 0;        // frames holding a page
+  size_t pinned = 0;
+  size_t dirty = 0;
+};
+
+class BufferPool;
+
+// A pinned page; unpins it when destroyed. Move-only.
+class PageGuard {
+public:
+  PageGuard() = default;
+  PageGuard(PageGuard&& rhs) noexcept;
+  PageGuard& operator=(PageGuard&& rhs) noexcept;
+  PageGuard(const PageGuard&) = delete;
+  PageGuard& operator=(const PageGuard&) = delete;
+  ~PageGuard() { Release(); }
+
+  explicit operator bool() const { return pool_ != nullptr; }
+  uint32_t PageNo() const;
+  const char* Data() const;
+  char* MutableData();  // marks the page dirty
+  void Release();
+
+private:
+  friend class BufferPool;
+  PageGuard(BufferPool* pool, size_t frame): pool_(pool), frame_(frame) {}
+  BufferPool* pool_ = nullptr;
+  size_t frame_ = 0;
+};
+
+class BufferPool {
+public:
+  static const size_t kPageSize = 8192;
+
+  // Opens (or creates) the file at path. Throws std::invalid_argument for options without a frame.
+  explicit BufferPool(const std::string& path, const BufferPoolOptions& options = BufferPoolOptions());
+  ~BufferPool();  // writes back the dirty pages; every PageGuard must be gone
+  BufferPool(const BufferPool&) = delete;
+  BufferPool& operator=(const BufferPool&) = delete;
+
+  PageGuard Fetch(uint32_t page, AccessHint hint = AccessHint::kRandom);
+  PageGuard NewPage();             // a zeroed, dirty page appended to the file
+  uint32_t PageCount() const { return page_count_; }
+  bool IsCached(uint32_t page) const { return page_table_.count(page) != 0; }
+  void Flush();                    // writes back every dirty page and syncs the file
+  BufferPoolStats Stats() const;
+  const std::string& Path() const { return path_; }
+
+private:
+  friend class PageGuard;
+  struct Frame {
+    uint32_t page = 0;
+    bool used = false;        // holds a page
+    bool referenced = false;  // CLOCK reference bit
+    bool dirty = false;
+    bool scan = false;        // in ring_
+    int pins = 0;
+  };
+
+  char* FrameData(size_t frame) { return &memory_[frame * kPageSize]; }
+  size_t Victim(AccessHint hint);                          // an unpinned frame, emptied
+  size_t Install(uint32_t page, const char* data, AccessHint hint);
+  void Prefetch(uint32_t page);                            // reads page and the uncached pages after it
+  void WriteBack(size_t frame);
+  void Unpin(size_t frame) { --frames_[frame].pins; }
+
+  std::string path_;
+  BufferPoolOptions options_;
+  int fd_ = -1;
+  uint32_t page_count_ = 0;
+  std::vector<char> memory_;     // frames * kPageSize
+  std::vector<Frame> frames_;
+  std::unordered_map<uint32_t, size_t> page_table_;  // page -> frame
+  std::deque<size_t> ring_;      // frames of scanned pages, oldest first
+  size_t hand_ = 0;              // CLOCK hand
+  BufferPoolStats stats_;
+};
+
+#endif
@@ -0,0 +1,205 @@
+/*
+Notes:
+
+Column:
+1. Columnar storage for one column of a DbTable whose values do not live in the row arrays (encoded columns).
+2. Values are indexed by row id: position = id - BaseId(). Ids only ever grow, so the column is append-only; rows that
+   are deleted later keep their (now dead) value and are skipped through the table's live bitmap.
+   NULLs work the same way: the column stores a placeholder and the table masks it out with the column's validity
+   bitmap before handing the bitmap to a scan.
+3. Every encoded column knows how to filter and group itself, so scans never have to box values into strings.
+*/
+
+#ifndef COLUMN_HPP
+#define COLUMN_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "binary_io.hpp"
+#include "memory_usage.hpp"
+
+enum class DataType { kString, kDouble, kInt, kInt64, kBool, kDate, kTimestamp, kDecimal };  // see value_types.hpp
+
+inline bool IsKnownDataType(uint8_t type) {
+  return type <= static_cast<uint8_t>(DataType::kDecimal);
+}
+
+// Physical layout of a column. kPlain keeps one heap cell per row inside the row arrays (the original layout).
+enum class Encoding : uint8_t {
+  kPlain = 0,
+  kDictionary = 1,  // kString: codes + dictionary
+  kCompressed = 2,  // kInt: blocks of 1024 values, each frame-of-reference, delta or bit-packed
+  kRunLength = 3,   // kString/kDouble/kInt: runs of (value, length); sorted columns binary-search their runs
+  kCompact = 4      // kString: 16-byte headers, short strings inline, long ones in a per-column heap
+};
+
+inline bool IsKnownEncoding(uint8_t encoding) {
+  return encoding <= static_cast<uint8_t>(Encoding::kCompact);
+}
+
+// Sorted, disjoint [first, second) position ranges a scan is restricted to (DbTable derives them from its zone maps).
+using PositionRanges = std::vector<std::pair<size_t, size_t>>;
+
+enum class CompareOp { kEq, kNe, kLt, kLe, kGt, kGe };
+const char* CompareOpSymbol(CompareOp op);  // "=", "!=", "<", "<=", ">", ">="
+
+enum class AggregateFn { kCount, kSum, kMin, kMax, kAvg };
+const char* AggregateFnName(AggregateFn fn);  // "count", "sum", "min", "max", "avg"
+
+// Running count/sum/min/max of the numeric values of a column.
+struct AggregateState {
+  size_t count = 0;
+  double sum = 0;
+  double min = std::numeric_limits<double>::infinity();
+  double max = -std::numeric_limits<double>::infinity();
+  void Add(double v) {
+    ++count;
+    sum += v;
+    if (v < min) min = v;
+    if (v > max) max = v;
+  }
+  // kMin/kMax/kAvg of no rows are NaN.
+  double Result(AggregateFn fn) const {
+    if (fn == AggregateFn::kCount) return static_cast<double>(count);
+    if (fn == AggregateFn::kSum) return sum;
+    if (count == 0) return std::numeric_limits<double>::quiet_NaN();
+    if (fn == AggregateFn::kMin) return min;
+    if (fn == AggregateFn::kMax) return max;
+    return sum / static_cast<double>(count);
+  }
+};
+
+// Bit per row id: set while the row exists.
+inline bool IsLive(const std::vector<uint64_t>& live, unsigned int id) {
+  size_t word = id / 64;
+  return word < live.size() && ((live[word] >> (id % 64)) & 1) != 0;
+}
+
+// True when every id in [first, first + count) is live (checked a word at a time).
+inline bool AllLive(const std::vector<uint64_t>& live, unsigned int first, size_t count) {
+  size_t id = first;
+  const size_t end = first + count;
+  while (id < end) {
+    size_t word = id / 64;
+    if (word >= live.size()) return false;
+    unsigned int bit = static_cast<unsigned int>(id % 64);
+    size_t take = end - id < 64 - bit ? end - id : 64 - bit;
+    uint64_t mask = (take == 64 ? ~uint64_t{0} : ((uint64_t{1} << take) - 1)) << bit;
+    if ((live[word] & mask) != mask) return false;
+    id += take;
+  }
+  return true;
+}
+
+// Number of live ids in [first, first + count) (popcount a word at a time).
+inline size_t CountLive(const std::vector<uint64_t>& live, unsigned int first, size_t count) {
+  size_t id = first;
+  const size_t end = first + count;
+  size_t live_count = 0;
+  while (id < end) {
+    size_t word = id / 64;
+    if (word >= live.size()) break;
+    unsigned int bit = static_cast<unsigned int>(id % 64);
+    size_t take = end - id < 64 - bit ? end - id : 64 - bit;
+    uint64_t mask = (take == 64 ? ~uint64_t{0} : ((uint64_t{1} << take) - 1)) << bit;
+    live_count += static_cast<size_t>(__builtin_popcountll(live[word] & mask));
+    id += take;
+  }
+  return live_count;
+}
+
+// Can some value in [lo, hi] satisfy `value op constant`? (used to skip whole blocks)
+template <typename T>
+bool RangeMayMatch(const T& lo, const T& hi, CompareOp op, const T& constant) {
+  switch (op) {
+  case CompareOp::kEq: return !(constant < lo) && !(hi < constant);
+  case CompareOp::kNe: return lo < constant || constant < hi || constant < lo || hi < constant;
+  case CompareOp::kLt: return lo < constant;
+  case CompareOp::kLe: return !(constant < lo);
+  case CompareOp::kGt: return constant < hi;
+  case CompareOp::kGe: return !(hi < constant);
+  }
+  return true;
+}
+
+// Does every value in [lo, hi] satisfy `value op constant`? (lets a block be taken without decoding it)
+template <typename T>
+bool RangeAllMatch(const T& lo, const T& hi, CompareOp op, const T& constant) {
+  switch (op) {
+  case CompareOp::kEq: return !(lo < constant) && !(constant < lo) && !(hi < constant) && !(constant < hi);
+  case CompareOp::kNe: return constant < lo || hi < constant;
+  case CompareOp::kLt: return hi < constant;
+  case CompareOp::kLe: return !(constant < hi);
+  case CompareOp::kGt: return constant < lo;
+  case CompareOp::kGe: return !(lo < constant);
+  }
+  return false;
+}
+
+template <typename T>
+bool Compare(const T& lhs, CompareOp op, const T& rhs) {
+  switch (op) {
+  case CompareOp::kEq: return lhs == rhs;
+  case CompareOp::kNe: return !(lhs == rhs);
+  case CompareOp::kLt: return lhs < rhs;
+  case CompareOp::kLe: return !(rhs < lhs);
+  case CompareOp::kGt: return rhs < lhs;
+  case CompareOp::kGe: return !(lhs < rhs);
+  }
+  return false;
+}
+
+class Column {
+public:
+  Column(DataType type, unsigned int base_id): type_(type), base_id_(base_id) {}
+  virtual ~Column() = default;
+  virtual Column* Clone() const = 0;
+  virtual Encoding GetEncoding() const = 0;
+
+  virtual void Append(const std::string& text) = 0;  // value of the next id; throws if text does not parse
+  virtual void AppendDefault() = 0;                  // "" / 0, for rows created before the column (and id gaps)
+  virtual void AppendNull() { AppendDefault(); }     // placeholder under a NULL (the table's validity bitmap has it)
+  virtual void PopBack() = 0;                        // undoes the last append (AddRow failed on a later column)
+  virtual size_t Size() const = 0;
+  virtual std::string GetString(size_t pos) const = 0;
+  virtual void Print(size_t pos, std::ostream& os) const { os << GetString(pos); }  // operator<< formatting
+
+  virtual void SerializeValue(size_t pos, BinaryWriter& out) const = 0;
+  virtual void AppendSerialized(BinaryReader& in) = 0;
+
+  virtual double GetNumber(size_t pos) const;        // numeric columns only (string columns throw)
+  virtual int64_t GetInteger(size_t pos) const;      // stored value of the fixed-width types (others throw)
+
+  // Appends the ids of live rows inside ranges whose value satisfies `value op constant`, in id order.
+  virtual void Filter(CompareOp op, const std::string& constant, const std::vector<uint64_t>& live,
+                      const PositionRanges& ranges, std::vector<unsigned int>& out) const = 0;
+  // Number of ids Filter would return.
+  virtual size_t CountMatches(CompareOp op, const std::string& constant, const std::vector<uint64_t>& live,
+                              const PositionRanges& ranges) const;
+  // Number of live rows per distinct value.
+  virtual void GroupByCount(const std::vector<uint64_t>& live, std::map<std::string, size_t>& out) const = 0;
+  // Count/sum/min/max over the live rows of a numeric column (string columns throw std::invalid_argument).
+  virtual AggregateState Aggregate(const std::vector<uint64_t>& live) const;
+
+  virtual Footprint Memory() const = 0;  // the column object and everything it owns (see memory_usage.hpp)
+
+  DataType Type() const { return type_; }
+  unsigned int BaseId() const { return base_id_; }
+
+protected:
+  DataType type_;
+  unsigned int base_id_;
+};
+
+/* Creates an empty column with the given layout: nullptr for kPlain kString/kDouble/kInt columns, which have no column
+object, and a fixed-width column (fixed_width_column.hpp) for kPlain columns of the other types. */
+Column* NewColumn(DataType type, Encoding encoding, unsigned int base_id);
+
+#endif
@@ -0,0 +1,125 @@
+/*
+Notes:
+
+ColumnStats:
+1. Statistics DbTable keeps per column to estimate how many rows a predicate selects without scanning:
+     distinct values    HyperLogLog sketch (2^12 one-byte registers, ~1.6% standard error), fed on every insert
+     equi-depth histogram  up to kHistogramBuckets buckets holding about the same number of values each; a bucket
+                        knows its upper bound, its value count and its distinct count
+     most common values up to kMostCommon values that occur more often than the average value
+     min / max          kept on every insert
+2. Analyze() rebuilds everything from the current rows (DbTable collects every non-NULL value, sorts and cuts). Between
+   two Analyze() calls inserts keep the sketch and min/max exact, and bump the count of the histogram bucket and most
+   common value they fall into; bucket bounds and distinct counts stay as analyzed. Deletes are not subtracted
+   (a sketch cannot forget a value), so estimates drift with churn until the next Analyze().
+3. Numbers (kInt, kDouble and the int64 types of value_types.hpp) are summarized as doubles and interpolate linearly
+   inside a bucket; strings are summarized as strings and count half a bucket for a constant inside it.
+4. Selectivities are fractions of the non-NULL values; DbTable scales them by its NULL fraction.
+*/
+
+#ifndef COLUMN_STATS_HPP
+#define COLUMN_STATS_HPP
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "column.hpp"
+#include "memory_usage.hpp"
+
+class HyperLogLog {
+public:
+  static const unsigned int kPrecision = 12;
+
+  void Add(uint64_t hash);
+  double Estimate() const;
+  void Merge(const HyperLogLog& other);  // the sketch of the union
+  void Clear() { registers_.assign(registers_.size(), 0); }
+  Footprint Memory() const { return VectorBuffer(registers_); }
+
+  static uint64_t Hash(double value);
+  static uint64_t Hash(const std::string& value);
+
+private:
+  std::vector<uint8_t> registers_ = std::vector<uint8_t>(size_t{1} << kPrecision, 0);
+};
+
+// Histogram and most common values of one column, over numbers (T = double) or strings.
+template <typename T>
+class ValueStats {
+public:
+  static constexpr size_t kHistogramBuckets = 64;
+  static constexpr size_t kMostCommon = 16;
+
+  void Add(const T& value);
+  void Build(std::vector<T>& values);  // sorts values and replaces the histogram and most common values
+
+  // Fractions of the values (not of the rows) equal to / below `value`; `distinct` is used before any Build.
+  double Equal(const T& value, double distinct) const;
+  double Less(const T& value) const;
+
+  bool Empty() const { return count_ == 0; }
+  const T& Min() const { return min_; }
+  const T& Max() const { return max_; }
+  bool Built() const { return !upper_.empty(); }
+  size_t BucketCount() const { return upper_.size(); }
+  const std::vector<std::pair<T, uint64_t>>& MostCommon() const { return most_common_; }
+  Footprint Memory() const;
+
+private:
+  size_t BucketOf(const T& value) const;  // first bucket whose upper bound is >= value
+  double InsideBucket(size_t bucket, const T& value) const;  // part of the bucket below value
+
+  uint64_t count_ = 0;  // values added since the last Build, plus those it was built from
+  T min_{};
+  T max_{};
+  std::vector<T> upper_;             // inclusive upper bound per bucket, ascending; the first starts at hist_min_
+  std::vector<uint64_t> counts_;
+  std::vector<uint64_t> distinct_;
+  uint64_t hist_total_ = 0;
+  T hist_min_{};
+  std::vector<std::pair<T, uint64_t>> most_common_;  // by descending count
+};
+
+class ColumnStats {
+public:
+  explicit ColumnStats(DataType type): numeric_(type != DataType::kString) {}
+
+  void AddNumber(double value);
+  void AddString(const std::string& value);
+  void AddNull() { ++modified_; }
+  void RemoveRow() { ++modified_; }
+
+  /* Analyze: BeginAnalyze() drops everything, the Add* calls that follow only collect, FinishAnalyze() builds the
+  histogram and most common values from what was collected. */
+  void BeginAnalyze();
+  void FinishAnalyze();
+
+  bool IsNumeric() const { return numeric_; }
+  bool Analyzed() const { return analyzed_; }
+  uint64_t ModifiedSinceAnalyze() const { return modified_; }
+  double DistinctCount() const { return sketch_.Estimate(); }
+  const HyperLogLog& Sketch() const { return sketch_; }
+  const ValueStats<double>& Numbers() const { return numbers_; }
+  const ValueStats<std::string>& Strings() const { return strings_; }
+
+  // Fraction of the non-NULL values satisfying `value op constant`.
+  double Selectivity(CompareOp op, double constant) const;
+  double Selectivity(CompareOp op, const std::string& constant) const;
+
+  Footprint Memory() const;
+
+private:
+  bool numeric_;
+  bool analyzed_ = false;
+  bool collecting_ = false;
+  uint64_t modified_ = 0;  // rows added or removed since the last Analyze
+  HyperLogLog sketch_;
+  ValueStats<double> numbers_;
+  ValueStats<std::string> strings_;
+  std::vector<double> collected_numbers_;
+  std::vector<std::string> collected_strings_;
+};
+
+#endif
@@ -0,0 +1,81 @@
+/*
+Notes:
+
+CompactStringColumn:
+1. Stores a kString column as one 16-byte StringHeader per row instead of one heap-allocated std::string per row:
+     length (4 bytes) | first 4 bytes (prefix) | next 8 bytes          strings of up to kInlineLength (12) bytes
+     length (4 bytes) | first 4 bytes (prefix) | offset into heap_     longer strings
+   Long strings are appended to heap_, a single append-only byte buffer owned by the column; an offset rather than a
+   pointer keeps the headers valid when the buffer grows and lets a copy of the column copy the buffer in one go.
+2. Comparisons look at the length and the prefix first, which decides most of them without touching the heap.
+3. Deleted rows keep their bytes in heap_ (the column is append-only, like every Column).
+*/
+
+#ifndef COMPACT_STRING_COLUMN_HPP
+#define COMPACT_STRING_COLUMN_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "column.hpp"
+
+struct StringHeader {
+  uint32_t length = 0;
+  char prefix[4] = {0, 0, 0, 0};
+  union {
+    char rest[8];     // bytes 4..11 of an inline string (zero padded)
+    uint64_t offset;  // start of a long string in the heap
+  };
+  StringHeader(): offset(0) {}
+};
+static_assert(sizeof(StringHeader) == 16, "StringHeader must stay 16 bytes");
+
+class CompactStringColumn : public Column {
+public:
+  static const uint32_t kInlineLength = 12;
+
+  explicit CompactStringColumn(unsigned int base_id): Column(DataType::kString, base_id) {}
+  Column* Clone() const override { return new CompactStringColumn(*this); }
+  Encoding GetEncoding() const override { return Encoding::kCompact; }
+
+  void Append(const std::string& text) override { AppendValue(text); }
+  void AppendDefault() override { headers_.emplace_back(); }
+  void PopBack() override;
+  size_t Size() const override { return headers_.size(); }
+  std::string GetString(size_t pos) const override { return std::string(View(pos)); }
+  void Print(size_t pos, std::ostream& os) const override { os << View(pos); }
+
+  void SerializeValue(size_t pos, BinaryWriter& out) const override;
+  void AppendSerialized(BinaryReader& in) override { AppendValue(in.GetString()); }
+
+  void Filter(CompareOp op, const std::string& constant, const std::vector<uint64_t>& live,
+              const PositionRanges& ranges, std::vector<unsigned int>& out) const override;
+  void GroupByCount(const std::vector<uint64_t>& live, std::map<std::string, size_t>& out) const override;
+
+  void AppendValue(std::string_view text);
+  std::string_view View(size_t pos) const;  // valid until the next append
+  const StringHeader& Header(size_t pos) const { return headers_[pos]; }
+  static bool IsInline(const StringHeader& header) { return header.length <= kInlineLength; }
+  size_t HeapBytes() const { return heap_.size(); }
+  Footprint Memory() const override {  // the heap is one block however many strings it holds
+    Footprint footprint;
+    footprint.Add(sizeof(CompactStringColumn));
+    footprint += VectorBuffer(headers_);
+    footprint += VectorBuffer(heap_);
+    return footprint;
+  }
+
+private:
+  static StringHeader MakeHeader(std::string_view text);
+  const char* Data(const StringHeader& header) const;
+  // <0, 0, >0 like std::string::compare, deciding on the 4-byte prefixes whenever they differ.
+  int CompareTo(const StringHeader& header, const StringHeader& constant, std::string_view constant_text) const;
+
+  std::vector<StringHeader> headers_;
+  std::vector<char> heap_;
+};
+
+#endif
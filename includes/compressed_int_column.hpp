@@ -0,0 +1,83 @@
+/*
+Notes:
+
+CompressedIntColumn:
+1. Stores a kInt column in blocks of kBlockSize (1024) values. The newest block is a plain vector; once it is full it
+   is sealed into one of three encodings, whichever needs the fewest bits per value:
+     kBitPack: the raw values (all non-negative),      width = bits(max)
+     kFor:     frame of reference, value - min,         width = bits(max - min)
+     kDelta:   first value + (delta - min delta),       width = bits(max delta - min delta)  (sorted / trending data)
+2. Each sealed block remembers its min/max so filters can skip it (or take it whole) without decoding.
+3. Scans and aggregates decode one block at a time into a 4 KiB buffer (UnpackBlock unpacks 4 values per SSE2 step).
+*/
+
+#ifndef COMPRESSED_INT_COLUMN_HPP
+#define COMPRESSED_INT_COLUMN_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "column.hpp"
+
+enum class BlockEncoding : uint8_t { kBitPack, kFor, kDelta };
+
+class CompressedIntColumn : public Column {
+public:
+  static const size_t kBlockSize = 1024;
+
+  explicit CompressedIntColumn(unsigned int base_id);
+  CompressedIntColumn(const CompressedIntColumn& rhs);
+  CompressedIntColumn& operator=(const CompressedIntColumn&) = delete;
+  Column* Clone() const override { return new CompressedIntColumn(*this); }
+  Encoding GetEncoding() const override { return Encoding::kCompressed; }
+
+  void Append(const std::string& text) override { AppendValue(std::stoi(text)); }
+  void AppendDefault() override { AppendValue(0); }
+  void AppendNull() override { AppendValue(tail_.empty() ? 0 : tail_.back()); }  // repeats: a delta of 0 packs best
+  void PopBack() override { tail_.pop_back(); }
+  size_t Size() const override { return blocks_.size() * kBlockSize + tail_.size(); }
+  std::string GetString(size_t pos) const override { return std::to_string(GetValue(pos)); }
+  double GetNumber(size_t pos) const override { return GetValue(pos); }
+
+  void SerializeValue(size_t pos, BinaryWriter& out) const override { out.PutI32(GetValue(pos)); }
+  void AppendSerialized(BinaryReader& in) override { AppendValue(in.GetI32()); }
+
+  void Filter(CompareOp op, const std::string& constant, const std::vector<uint64_t>& live,
+              const PositionRanges& ranges, std::vector<unsigned int>& out) const override;
+  void GroupByCount(const std::vector<uint64_t>& live, std::map<std::string, size_t>& out) const override;
+  AggregateState Aggregate(const std::vector<uint64_t>& live) const override;
+  Footprint Memory() const override;
+
+  void AppendValue(int32_t value);
+  int32_t GetValue(size_t pos) const;
+
+  // Block access for batch consumers: DecodeBlock writes BlockLength(block) values to out.
+  size_t BlockCount() const { return blocks_.size() + (tail_.empty() ? 0 : 1); }
+  size_t BlockLength(size_t block) const { return block < blocks_.size() ? kBlockSize : tail_.size(); }
+  void DecodeBlock(size_t block, int32_t* out) const;
+  bool BlockSealed(size_t block) const { return block < blocks_.size(); }
+  BlockEncoding GetBlockEncoding(size_t block) const { return blocks_[block].encoding; }
+  unsigned BlockWidth(size_t block) const { return blocks_[block].width; }
+  size_t CompressedBytes() const;  // packed words + block headers + the plain tail
+
+private:
+  struct Block {
+    BlockEncoding encoding = BlockEncoding::kFor;
+    uint8_t width = 0;
+    int32_t base = 0;       // kFor: min, kDelta: first value
+    int64_t delta_min = 0;  // kDelta: smallest delta
+    int32_t min = 0;
+    int32_t max = 0;
+    std::vector<uint32_t> words;
+  };
+
+  void Seal();
+  void BlockRange(size_t block, int32_t& lo, int32_t& hi) const;
+
+  std::vector<Block> blocks_;
+  std::vector<int32_t> tail_;  // the unsealed block (at most kBlockSize values)
+  uint64_t serial_;            // identifies this column in the per-thread decode cache
+};
+
+#endif
@@ -0,0 +1,70 @@
+/*
+Notes:
+
+Data chunks:
+1. The unit the vectorized part of the executor (sql_executor.hpp) passes between operators: up to
+   DataChunk::kCapacity rows stored column by column, one ValueVector per output slot of the producing plan node,
+   plus a selection vector. A Filter does not move rows; it shrinks the selection, and the operators above only read
+   the selected rows.
+2. A ValueVector holds the values of one type: int64 for every type but kString and kDouble (kBool as 0/1, kDecimal
+   scaled, as in Value), doubles for kDouble and pointers to strings for kString. The strings either belong to the
+   vector itself (Set, for values read from a table) or to whatever the vector was built from (the rows a Batch was
+   loaded from, a constant, the input chunk of a Project), so a chunk is only valid until its producer is asked for
+   the next one.
+3. Batch::Load transposes executor rows into vectors for the operators whose input is not vectorized; it returns false
+   when a non-NULL value does not have the type of its slot.
+*/
+
+#ifndef DATA_CHUNK_HPP
+#define DATA_CHUNK_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "value.hpp"
+
+using Row = std::vector<Value>;
+
+// The values of one column of a batch.
+struct ValueVector {
+  DataType type = DataType::kInt;
+  size_t size = 0;
+  std::vector<uint8_t> nulls;              // 1 for NULL; a NULL holds 0, 0.0 or ""
+  std::vector<int64_t> integers;           // every type but kString and kDouble (kBool as 0/1)
+  std::vector<double> numbers;             // kDouble
+  std::vector<const std::string*> texts;   // kString: into strings, the rows the batch was loaded from, or constants
+  std::vector<std::string> strings;        // kString values owned by the vector (see Set)
+
+  void Reset(DataType type, size_t size);  // size values of type, contents unspecified
+  Value Get(size_t i) const;
+  // Stores value i, copying a string into the vector; throws std::invalid_argument when value is of another type.
+  void Set(size_t i, const Value& value);
+  void Set(size_t i, Value&& value);
+};
+
+struct Batch {
+  size_t size = 0;
+  std::vector<ValueVector> columns;  // by input slot; only the slots in `inputs` of Load are filled
+
+  // Loads rows[0, count); inputs are (slot, type) pairs. False when a non-NULL value has another type.
+  bool Load(const std::vector<Row>& rows, size_t count, const std::vector<std::pair<int, DataType>>& inputs);
+};
+
+struct DataChunk {
+  static constexpr size_t kCapacity = 1024;
+
+  Batch batch;                      // every column is filled; batch.size rows
+  bool selective = false;           // false: every row of batch is selected
+  std::vector<uint32_t> selection;  // while selective: the selected rows of batch, ascending
+
+  void Reset(const std::vector<DataType>& types, size_t size);  // size rows of these columns, all selected
+  size_t Count() const { return selective ? selection.size() : batch.size; }  // selected rows
+  size_t Index(size_t i) const { return selective ? selection[i] : i; }      // the batch row of selected row i
+  void GetRow(size_t i, Row& row) const;                                      // selected row i
+  void Select(const std::vector<uint32_t>& rows);  // keeps selected rows that are also in rows (ascending)
+};
+
+#endif
@@ -17,15 +17,125 @@ By using both DbTable and Database, you can dynamically manage complex datasets
 
 #include <iostream>
 #include <map>
+#include <memory>
 #include <string>
 
 #include "db_table.hpp"
+#include "materialized_view.hpp"
+#include "partitioned_table.hpp"
+#include "plan_cache.hpp"
+#include "result_cache.hpp"
+#include "sql_executor.hpp"
+#include "wal.hpp"
+
+// Where one checkpointed chunk lives inside the data file.
+struct ChunkLocation {
+    uint64_t offset = 0;
+    uint32_t length = 0;
+};
+
+struct CheckpointStats {
+    size_t chunks_written = 0;   // dirty chunks serialized by this checkpoint
+    size_t chunks_kept = 0;      // clean chunks still referenced from the previous data file
+    uint64_t bytes_written = 0;  // chunk bytes + manifest bytes
+    bool compacted = false;      // the data file was rewritten to drop garbage
+};
+
+class Database;
+
+/* A statement parsed and planned once by Database::Prepare and run many times with different values for its ?
+parameters. Bind checks a value against the type the plan gives the parameter (what a column it is compared with or
+stored in holds, text when nothing tells) the way INSERT checks values; every parameter must be bound before Execute.
+Bindings stay until they are replaced or cleared. A statement whose tables changed schema replans itself on its next
+Execute. It must not outlive its Database. */
+class PreparedStatement {
+public:
+    size_t ParameterCount() const { return query_->parameter_types.size(); }
+    DataType ParameterType(size_t index) const;  // 1-based, like Bind
+    PreparedStatement& Bind(size_t index, const Value& value);
+    void ClearBindings();
+    const std::string& Sql() const { return query_->sql; }  // normalized text
+
+    QueryResult Execute();
+    QueryResult Execute(const std::vector<Value>& values);  // binds values[i] to parameter i + 1 first
+
+private:
+    friend class Database;
+    PreparedStatement(Database* db, PreparedQueryPtr query);
+    size_t CheckIndex(size_t index) const;
+
+    Database* db_;
+    PreparedQueryPtr query_;
+    std::vector<Value> values_;  // as bound; converted to the parameter types on Execute
+    std::vector<bool> bound_;
+};
 
 class Database {
 public:
     void CreateTable(const std::string& table_name);
     void DropTable(const std::string& table_name);
     DbTable& GetTable(const std::string& table_name);
+    bool HasTable(const std::string& table_name) const { return tables_.count(table_name) != 0; }
+
+    /* Runs one SQL statement (see sql_parser.hpp for the grammar, sql_executor.hpp for how it runs). A SELECT returns
+    its columns and rows, INSERT and DELETE the number of rows they changed in `affected`. Parse and planning errors
+    throw std::invalid_argument, unknown tables std::out_of_range. */
+    QueryResult Execute(const std::string& sql);
+
+    /* Parses and plans sql once; ? marks a parameter (see PreparedStatement). Execute and Prepare share an LRU cache
+    of plans keyed by the normalized text (plan_cache.hpp), so running the same statement again skips the parser and
+    the planner either way. */
+    PreparedStatement Prepare(const std::string& sql);
+    PlanCacheStats GetPlanCacheStats() const { return plan_cache_.Stats(); }
+    void SetPlanCacheCapacity(size_t capacity) { plan_cache_.SetCapacity(capacity); }  // 0 turns caching off
+
+    /* Results of SELECTs (result_cache.hpp): running the same query with the same parameters again returns a copy of
+    the stored rows as long as none of the tables it reads changed since. Off until a byte budget is set. */
+    ResultCacheStats GetResultCacheStats() const { return result_cache_.Stats(); }
+    void SetResultCacheBudget(size_t bytes) { result_cache_.SetBudget(bytes); }  // 0 turns caching off
+
+    /* Materialized views (materialized_view.hpp): a SELECT over one table whose result is kept up to date as rows
+    are added to and deleted from the table, so reading it costs O(rows of the result) instead of a query. A table
+    that views read cannot be dropped. Copies of a database compute the views of the original over their own tables.
+    Unknown view names throw std::out_of_range, a name that is taken std::invalid_argument. */
+    MaterializedView& CreateMaterializedView(const std::string& view_name, const std::string& select_sql);
+    void DropMaterializedView(const std::string& view_name);
+    MaterializedView& GetMaterializedView(const std::string& view_name);
+    bool HasMaterializedView(const std::string& view_name) const { return views_.count(view_name) != 0; }
+
+    /* Partitioned tables (partitioned_table.hpp): one logical table split into partitions by hash or range of a key
+    column, so writers of different partitions do not contend and scans run per partition in parallel. They share
+    the names of tables (CreateTable and CreatePartitionedTable reject a name either one uses), are copied with the
+    database, and are not visible to SQL or persisted by Checkpoint. Unknown names throw std::out_of_range, a name
+    that is taken std::invalid_argument. */
+    PartitionedTable& CreatePartitionedTable(const std::string& table_name,
+                                             const std::vector<std::pair<std::string, DataType>>& columns,
+                                             const PartitionSpec& spec);
+    void DropPartitionedTable(const std::string& table_name);
+    PartitionedTable& GetPartitionedTable(const std::string& table_name);
+    bool HasPartitionedTable(const std::string& table_name) const { return partitioned_.count(table_name) != 0; }
+
+    /* Durability. Open() loads the last checkpoint (<data_dir>/manifest.db + the data file it names), replays
+    <data_dir>/wal.log on top of it and from then on logs every CreateTable/DropTable and every table mutation
+    before applying it. Checkpoint() appends only the dirty chunks of each table to the data file, commits a new
+    manifest and truncates the log, so its I/O is proportional to churn; Compact() rewrites everything into a fresh
+    data file. Both write the chunk images with an AsyncWriter (async_io.hpp) while they serialize the next ones.
+    Checkpoints only read the tables, so readers may keep going; writers must wait for it to finish.
+    Copies of a durable database are plain in-memory databases. */
+    void Open(const std::string& data_dir, const WalOptions& options = WalOptions());
+    CheckpointStats Checkpoint();
+    CheckpointStats Compact();
+    bool IsDurable() const { return wal_ != nullptr; }
+
+    /* Memory held by every table (see DbTable::MemoryUsage), broken down by column, storage and overhead, and the
+    total of the database. */
+    std::string MemoryReport() const;
+
+    /* Operation counts and latencies (see metrics.hpp). GetMetrics sums the catalog operations (CreateTable,
+    DropTable, GetTable) and the operations of every table and partitioned table; MetricsText lists them per scope
+    ("catalog", "table:<name>" and "partitioned:<name>") as Prometheus-style text for a scraper. */
+    MetricsSnapshot GetMetrics() const;
+    std::string MetricsText() const;
 
     Database() = default;
     Database(const Database& rhs);
@@ -36,6 +146,27 @@ public:
 private:
   std::map<std::string, DbTable*> tables_;  // maps table name -> table. table_ is an instance of db_table.
   //In simple words, it gives a table that can dynamically adjusting its row/col a name and saved them into a map.
+  WriteAheadLog* wal_ = nullptr;  // owned; only set for durable databases
+  std::string data_dir_;
+  Metrics metrics_;                // catalog operations; tables keep their own
+  uint32_t data_generation_ = 0;   // data file is <data_dir>/data.<generation>.db
+  uint64_t data_file_size_ = 0;    // bytes of the data file referenced by the manifest
+  uint64_t live_bytes_ = 0;        // bytes of chunks the manifest still points at
+  std::map<std::string, std::map<unsigned int, ChunkLocation>> chunk_index_;  // table -> chunk -> location
+  PlanCache plan_cache_;           // not copied
+  uint64_t catalog_version_ = 0;   // bumped when tables go away (DropTable, assignment); cached plans check it
+  ResultCache result_cache_;       // not copied
+  std::map<std::string, std::unique_ptr<MaterializedView>> views_;  // listen to tables_, so go before them
+  std::map<std::string, std::unique_ptr<PartitionedTable>> partitioned_;
+  friend class PreparedStatement;
+  PreparedQueryPtr Plan(const std::string& sql);  // from the cache, or parsed and planned (and cached)
+  bool IsCurrent(const PreparedQuery& query) const;
+  bool IsCurrent(const CachedResult& entry) const;
+  QueryResult Run(const PreparedQuery& query, const std::vector<Value>* parameters);
+  void ApplyLogRecord(const WalRecord& record);
+  uint64_t LoadCheckpoint();
+  CheckpointStats WriteCheckpoint(bool compact);
+  std::string DataFilePath(uint32_t generation) const;
 };
 
 std::ostream& operator<<(std::ostream& os, const Database& db);
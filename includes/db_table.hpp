@@ -4,19 +4,81 @@
 #include <initializer_list>
 #include <iostream>
 #include <map>
+#include <optional>
+#include <set>
 #include <string>
 #include <utility>
 #include <vector>
 
-enum class DataType { kString, kDouble, kInt };
+#include "async_io.hpp"
+#include "binary_io.hpp"
+#include "column.hpp"
+#include "column_stats.hpp"
+#include "memory_usage.hpp"
+#include "metrics.hpp"
+#include "query_trace.hpp"
+#include "value.hpp"
+#include "zone_map.hpp"
+
+class WriteAheadLog;
+class DbTable;
+
+/* Hears about the rows of a table as they change, to keep data derived from them up to date (materialized views, see
+materialized_view.hpp). OnInsert runs once AddRow added the row, OnDelete before DeleteRowById removes it, so both can
+still read it through a cursor. Schema changes and assignment only bump DbTable::SchemaVersion. Must not throw. */
+class TableListener {
+public:
+  virtual ~TableListener() = default;
+  virtual void OnInsert(const DbTable& table, unsigned int id) = 0;
+  virtual void OnDelete(const DbTable& table, unsigned int id) = 0;
+};
+
+// Bytes held by one column: its values (heap cells or Column object), validity bitmap, zone map and statistics.
+struct ColumnMemory {
+  std::string name;
+  DataType type = DataType::kString;
+  Encoding encoding = Encoding::kPlain;
+  Footprint data;
+  Footprint validity;
+  Footprint zone_map;
+  Footprint stats;
+  Footprint Total() const {
+    Footprint total = data;
+    total += validity;
+    total += zone_map;
+    total += stats;
+    return total;
+  }
+};
+
+/* Bytes held by a table (see memory_usage.hpp). row_arrays are the void* arrays of row_col_capacity_ slots, of which
+unused_row_capacity bytes belong to slots no column uses yet; map_nodes are the nodes of the row map; bookkeeping is
+the live bitmap, zone row counts, dirty chunk set and column descriptions; metrics are the latency histograms (see
+metrics.hpp). */
+struct TableMemory {
+  std::vector<ColumnMemory> columns;
+  Footprint row_arrays;
+  size_t unused_row_capacity = 0;
+  Footprint map_nodes;
+  Footprint bookkeeping;
+  Footprint metrics;
+  Footprint Total() const;
+};
+
+std::ostream& operator<<(std::ostream& os, const TableMemory& memory);
 
 class DbTable {
 public:
   DbTable() = default; // default constructor
   void AddColumn(const std::pair<std::string, DataType>& col_desc); /* this function is responsible for resizing the col.
   e.g. If the table only has two cols while we have three cols are needed for "Name, UIN, GPA"*/
+  void AddColumn(const std::pair<std::string, DataType>& col_desc, Encoding encoding); // e.g. kDictionary for team names
+  // null_default: rows that already exist get NULL in the new column instead of ""/0
+  void AddColumn(const std::pair<std::string, DataType>& col_desc, Encoding encoding, bool null_default);
   void DeleteColumnByIdx(unsigned int col_idx);
   void AddRow(const std::initializer_list<std::string>& col_data);
+  void AddRow(const std::vector<std::string>& col_data); // same as above, for rows built at run time (WAL replay, loaders)
+  void AddRow(const std::vector<std::optional<std::string>>& col_data); // std::nullopt stores NULL
   void DeleteRowById(unsigned int id);
 
   DbTable(const DbTable& rhs);
@@ -27,10 +89,102 @@ public:
   that interacts with std::ostream. To allow it to access private members of DbTable,
   we declare it as a friend of the DbTable class.*/
   std::vector<std::vector<std::string>> GetRows() const;
+  /* Writes the column names and then every row (the text of GetRows, comma separated) to the file at path, replacing
+  it. Rows are formatted into buffers of about 1 MiB that an AsyncWriter writes while the next one is formatted.
+  Throws std::runtime_error when the file cannot be written. */
+  void ExportCsv(const std::string& path, const AsyncIoOptions& options = AsyncIoOptions()) const;
   const std::vector<std::pair<std::string, DataType>>& GetColumnDescriptions() const {
     return col_descs_;
 }
+  // Changes whenever the columns do (AddColumn, DeleteColumnByIdx, assignment, loading an image); plans check it.
+  uint64_t SchemaVersion() const { return schema_version_; }
+  // Changes whenever the rows or the columns do (AddRow, DeleteRowById, schema changes, ...); cached results check it.
+  uint64_t DataVersion() const { return data_version_; }
+  std::vector<std::string> GetRow(unsigned int id) const;  // GetRow/GetRows show NULL as "" (operator<< as NULL)
+  bool IsNull(unsigned int id, unsigned int col_idx) const;
+  size_t NullCount(unsigned int col_idx) const;
+  size_t RowCount() const { return rows_.size(); }
+  unsigned int NextId() const { return next_unique_id_; }  // the id the next AddRow gives its row
+  Encoding GetColumnEncoding(unsigned int col_idx) const;
+  const Column* GetColumn(unsigned int col_idx) const;  // nullptr for kPlain kString/kDouble/kInt columns
+  const ZoneMap& GetZoneMap(unsigned int col_idx) const;
+  /* Memory held by the table, per column and per kind of overhead. Plain cells are counted as they are created and
+  freed, so this costs O(columns) plus what encoded columns need to size themselves (dictionaries walk their
+  distinct strings). */
+  TableMemory MemoryUsage() const;
+  /* Operation counts and latencies (see metrics.hpp): AddRow, DeleteRowById, AddColumn, DeleteColumnByIdx, the
+  scans below and the exports (GetRows, ExportCsv, operator<<). Safe to call while other threads use the table. */
+  MetricsSnapshot GetMetrics() const { return metrics_.Snapshot(); }
+
+  /* Scans. Filter returns the ids of the rows whose value in col_idx satisfies `value op constant` (in id order);
+  GroupByCount counts the rows per distinct value. Numbers compare numerically, strings lexicographically.
+  Filter and Count only look at the zones (ZoneMap::kZoneRows ids) whose min/max can match.
+  NULL never satisfies a comparison (not even kNe), is not a group of GroupByCount and is skipped by every aggregate:
+  kCount counts the non-NULL values. FilterNull returns the ids whose value is NULL. */
+  std::vector<unsigned int> Filter(unsigned int col_idx, CompareOp op, const std::string& value) const;
+  size_t Count(unsigned int col_idx, CompareOp op, const std::string& value) const;  // Filter(...).size()
+  std::vector<unsigned int> FilterNull(unsigned int col_idx) const;
+  std::map<std::string, size_t> GroupByCount(unsigned int col_idx) const;
+  double Aggregate(unsigned int col_idx, AggregateFn fn) const;  // kMin/kMax/kAvg of no rows are NaN
+
+  /* Row-at-a-time reads for pipelined consumers (the SQL executor). A RowCursor walks the rows in id order; GetValue
+  reads one cell as a typed Value without formatting it as text. A cursor stays valid while rows are added, and while
+  rows other than the one it points at are deleted. */
+  class RowCursor {
+  public:
+    bool Valid() const { return it_ != end_; }
+    unsigned int Id() const { return it_->first; }
+    void Next() { ++it_; }
+
+  private:
+    friend class DbTable;
+    std::map<unsigned int, void**>::const_iterator it_;
+    std::map<unsigned int, void**>::const_iterator end_;
+  };
+  RowCursor Rows() const;                   // at the first row
+  RowCursor Seek(unsigned int id) const;    // at the first row whose id is >= id
+  Value GetValue(const RowCursor& row, unsigned int col_idx) const;
+
+  /* Statistics (see column_stats.hpp). Analyze() rebuilds the histograms and most common values of every column from
+  the current rows; inserts keep them up to date in between. EstimateSelectivity is the estimated fraction of rows
+  Filter would return, EstimateDistinct the number of distinct non-NULL values and EstimateJoinSelectivity the
+  fraction of the cross product an equi-join of the two columns keeps (1 / the larger distinct count). */
+  void Analyze();
+  const ColumnStats& GetColumnStats(unsigned int col_idx) const;
+  double EstimateSelectivity(unsigned int col_idx, CompareOp op, const std::string& value) const;
+  double EstimateDistinct(unsigned int col_idx) const;
+  static double EstimateJoinSelectivity(const DbTable& left, unsigned int left_col,
+                                        const DbTable& right, unsigned int right_col);
+  /* Access path estimates from the zone maps. EstimateScanRows is the number of rows Filter(col_idx, op, value) would
+  visit after zone pruning (exact, O(zones)); EstimateLookupRows the average it visits for Filter(col_idx, kEq, v)
+  with v one of the column's values, assuming values spread evenly between the column's min and max (a sorted key
+  column visits about one zone, an unsorted one every zone). */
+  uint64_t EstimateScanRows(unsigned int col_idx, CompareOp op, const std::string& value) const;
+  double EstimateLookupRows(unsigned int col_idx) const;
 
+  /* Durability hooks used by Database. Once a log is attached every mutation is written to the WAL (and committed)
+  before it is applied to the table. Copies of a table are never attached to a log. */
+  void AttachLog(WriteAheadLog* wal, const std::string& table_name);
+  void DetachLog();
+  // Listeners are not owned and must be removed before they go away; copies of a table have none.
+  void AddListener(TableListener* listener);
+  void RemoveListener(TableListener* listener);
+  void Serialize(BinaryWriter& out) const;   // full image: schema, ids and cells
+  void Deserialize(BinaryReader& in);        // replaces the contents of this table with an image
+
+  /* Incremental checkpointing. Rows are grouped into chunks of kChunkRows consecutive ids. AddRow/DeleteRowById
+  mark the chunk they touch as dirty; schema changes (and copy-assignment) mark the whole table dirty.
+  Checkpoint only rewrites dirty chunks and then calls ClearDirty(). */
+  static const unsigned int kChunkRows = 4096;
+  std::vector<unsigned int> Chunks() const;       // sorted numbers of the chunks holding rows
+  std::vector<unsigned int> DirtyChunks() const;  // sorted chunk numbers
+  bool AllDirty() const { return all_dirty_; }
+  void ClearDirty();
+  bool ChunkEmpty(unsigned int chunk) const;
+  void SerializeSchema(BinaryWriter& out) const;
+  void DeserializeSchema(BinaryReader& in);      // empties the table and installs the schema
+  void SerializeChunk(unsigned int chunk, BinaryWriter& out) const;
+  void DeserializeChunk(BinaryReader& in);       // adds the rows of one chunk
 
 
   private:
@@ -38,8 +192,64 @@ public:
   unsigned int row_col_capacity_ = 2;
   std::map<unsigned int, void**> rows_;
   std::vector<std::pair<std::string, DataType>> col_descs_;
+  std::vector<Column*> columns_;  // parallel to col_descs_: owned storage of encoded columns, nullptr for plain ones
+  std::vector<uint64_t> live_;    // bit per row id, set while the row exists (lets column scans skip the map)
+  WriteAheadLog* wal_ = nullptr;  // not owned; set by Database::Open
+  std::string wal_name_;          // name of this table inside the log records
+  bool all_dirty_ = true;                 // a new (or copied) table has never been checkpointed
+  std::set<unsigned int> dirty_chunks_;   // only used while all_dirty_ is false
+  std::vector<ZoneMap> zone_maps_;        // parallel to col_descs_
+  /* Parallel to col_descs_: bit per id, clear when the value is NULL (see bitmap.hpp). Empty while the column has
+  never held a NULL; columns with a bitmap serialize a presence byte before every cell. */
+  std::vector<std::vector<uint64_t>> validity_;
+  std::vector<uint32_t> zone_rows_;       // live rows per zone; a zone's bounds are reset when it empties
+  std::vector<Footprint> cell_memory_;    // parallel to col_descs_: heap cells of plain columns
+  mutable Metrics metrics_;               // recorded by const scans too; not copied
+  std::vector<ColumnStats> stats_;        // parallel to col_descs_; not persisted, rebuilt as rows are loaded
+  uint64_t schema_version_ = 0;           // see SchemaVersion(); not copied
+  uint64_t data_version_ = 0;             // see DataVersion(); not copied
+  std::vector<TableListener*> listeners_; // not owned; not copied
+
+  struct ZoneRange {
+    unsigned int first_id;
+    unsigned int end_id;
+    bool all_match;  // every row in [first_id, end_id) satisfies the predicate
+  };
+  std::vector<unsigned int> FilterIds(unsigned int col_idx, CompareOp op, const std::string& value) const;
+  std::vector<ZoneRange> PrunedZones(unsigned int col_idx, CompareOp op, const std::string& value) const;
+  uint64_t ScanBytes(size_t col, uint64_t rows) const;
+  uint64_t RowsInZones(const std::vector<ZoneRange>& zones) const;
+  std::string ScanDetail(size_t col, const std::string& op, const std::string& value) const;
+  void TraceScan(TraceSpan& span, size_t col, uint64_t rows_in, uint64_t rows_out) const;
+  std::vector<ZoneRange> ZoneRanges(unsigned int col_idx, CompareOp op, const std::string& value) const;
+  PositionRanges ToPositions(const Column* column, const std::vector<ZoneRange>& zones) const;
+  void AddToZones(unsigned int id, void** row);
+  void CountZoneRow(unsigned int id);
+  void RemoveFromZones(unsigned int id);
+  void AddToStats(unsigned int id, void** row);
+  void AddValueToStats(ColumnStats& stats, size_t col, unsigned int id, void** row) const;
+  double NullFraction(size_t col) const;
+  void MarkDirty(unsigned int id);
+  void SerializeRow(unsigned int id, void** row, BinaryWriter& out) const;
+  void DeserializeRows(BinaryReader& in);
   void ResizeRows();// helper functions are included in the private class.
   void FreeRowMemory(unsigned int id);
+  void InsertRow(const std::string* col_data, const char* nulls, size_t size);  // nulls may be nullptr
+  void ClearRows();
+  void ClearColumns();
+  void CopyContents(const DbTable& rhs);
+  void* NewCell(size_t col, const std::string& text);
+  void* NewDefaultCell(size_t col);
+  void* CopyCell(size_t col, const void* cell);
+  void FreeCell(size_t col, void* cell);
+  void* TrackCell(size_t col, void* cell);  // counts a new heap cell in cell_memory_
+  Footprint CellFootprint(size_t col, const void* cell) const;
+  std::string CellToString(size_t col, unsigned int id, void** row) const;
+  void PadColumn(size_t col, unsigned int id);
+  void SetLive(unsigned int id, bool live);
+  bool CellIsNull(size_t col, unsigned int id) const;
+  void SetNull(size_t col, unsigned int id);
+  const std::vector<uint64_t>& LiveValues(size_t col, std::vector<uint64_t>& scratch) const;
 };
 
 #endif
@@ -0,0 +1,64 @@
+/*
+Notes:
+
+DictionaryColumn:
+1. Stores a low-cardinality kString column as one small integer code per row plus a dictionary of the distinct strings.
+2. Codes start 8 bits wide and are widened to 16 and then 32 bits only when the dictionary outgrows them.
+3. Equality filters look the constant up once and then compare codes; range filters and GROUP BY evaluate each
+   distinct value once and then work per code, so the per-row work is integer only.
+*/
+
+#ifndef DICTIONARY_COLUMN_HPP
+#define DICTIONARY_COLUMN_HPP
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "column.hpp"
+
+class DictionaryColumn : public Column {
+public:
+  explicit DictionaryColumn(unsigned int base_id): Column(DataType::kString, base_id) {}
+  Column* Clone() const override { return new DictionaryColumn(*this); }
+  Encoding GetEncoding() const override { return Encoding::kDictionary; }
+
+  void Append(const std::string& text) override { AppendCode(Intern(text)); }
+  void AppendDefault() override { Append(""); }
+  void PopBack() override;
+  size_t Size() const override { return size_; }
+  std::string GetString(size_t pos) const override { return dictionary_[CodeAt(pos)]; }
+
+  void SerializeValue(size_t pos, BinaryWriter& out) const override { out.PutString(GetString(pos)); }
+  void AppendSerialized(BinaryReader& in) override { Append(in.GetString()); }
+
+  void Filter(CompareOp op, const std::string& constant, const std::vector<uint64_t>& live,
+              const PositionRanges& ranges, std::vector<unsigned int>& out) const override;
+  void GroupByCount(const std::vector<uint64_t>& live, std::map<std::string, size_t>& out) const override;
+  Footprint Memory() const override;
+
+  uint32_t CodeAt(size_t pos) const;
+  unsigned int CodeWidth() const { return width_; }       // bytes per code: 1, 2 or 4
+  size_t DictionarySize() const { return dictionary_.size(); }
+
+private:
+  uint32_t Intern(const std::string& text);
+  void AppendCode(uint32_t code);
+  void Widen(unsigned int width);
+  template <typename Code>
+  void FilterCodes(const std::vector<Code>& codes, const std::vector<char>& match, const std::vector<uint64_t>& live,
+                   const PositionRanges& ranges, std::vector<unsigned int>& out) const;
+  template <typename Code>
+  void CountCodes(const std::vector<Code>& codes, const std::vector<uint64_t>& live, std::vector<size_t>& counts) const;
+
+  std::vector<std::string> dictionary_;                 // code -> string
+  std::unordered_map<std::string, uint32_t> lookup_;    // string -> code
+  // Exactly one of these holds the codes, depending on width_.
+  std::vector<uint8_t> codes8_;
+  std::vector<uint16_t> codes16_;
+  std::vector<uint32_t> codes32_;
+  unsigned int width_ = 1;
+  size_t size_ = 0;
+};
+
+#endif
@@ -0,0 +1,61 @@
+/*
+Notes:
+
+Compiled expressions:
+1. CompileExpr turns a bound expression (sql_planner.hpp) into a tree of closures, one per node, that each run their
+   node over a whole batch of rows in one loop. The loop is a template instantiated for the operands' physical types
+   (int64 or double values, a column or a constant, kDecimal scaled back on the fly) and its operator, chosen once when
+   the expression is compiled, so a batch switches on types once per node instead of once per cell like Evaluate.
+2. Batches are columnar (data_chunk.hpp): one ValueVector (values of one type and a NULL flag per row) for every
+   input slot the expressions read, each of the type the expression gives its column. Batch::Load transposes rows into
+   them and returns false when a value does not have the type of its slot; those rows are left to Evaluate.
+3. Results equal Evaluate's, with one difference: both sides of AND and OR are computed for every row, so compiled
+   code may throw (integer overflow, a parameter without a value) for a row Evaluate would have short-circuited. The
+   executor evaluates a batch that throws again row by row with Evaluate, which throws only if the query really fails.
+4. Some expressions do not compile: aggregates, arithmetic on strings, comparisons of numbers with strings and AND, OR
+   or NOT over doubles or strings. Compiled() is false for them and callers use Evaluate.
+5. A CompiledExpr keeps scratch vectors for the results of its inner nodes, so one instance must not run on two
+   threads at once.
+*/
+
+#ifndef EXPR_COMPILER_HPP
+#define EXPR_COMPILER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "data_chunk.hpp"
+#include "sql_ast.hpp"
+#include "sql_executor.hpp"
+#include "value.hpp"
+
+using Kernel = std::function<void(const Batch& batch, ValueVector& out)>;
+
+class CompiledExpr {
+public:
+  bool Compiled() const { return static_cast<bool>(kernel_); }
+  DataType Type() const { return type_; }
+  int Slot() const { return slot_; }  // the input slot when the expression is a plain column, else -1
+  const std::vector<std::pair<int, DataType>>& Inputs() const { return inputs_; }  // the slots it reads
+
+  void Evaluate(const Batch& batch, ValueVector& out) const;               // one value per row of batch
+  void Select(const Batch& batch, std::vector<uint32_t>& selected) const;  // the rows where it is true
+
+private:
+  friend CompiledExpr CompileExpr(const Expr& expr);
+
+  DataType type_ = DataType::kInt;
+  int slot_ = -1;
+  std::vector<std::pair<int, DataType>> inputs_;
+  Kernel kernel_;
+  std::shared_ptr<ValueVector> scratch_;  // the result Select reads
+};
+
+CompiledExpr CompileExpr(const Expr& expr);
+
+#endif
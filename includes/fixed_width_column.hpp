@@ -0,0 +1,99 @@
+/*
+Notes:
+
+Fixed-width columns:
+1. Native storage of the types from value_types.hpp. They have no encoding (GetEncoding() is kPlain) but, unlike the
+   original kString/kDouble/kInt columns, keep their values in a Column object instead of one heap cell per row:
+     Int64Column: one int64_t per row (kInt64, kDate, kTimestamp, kDecimal)
+     BoolColumn:  one bit per row, 64 rows per word
+2. Filters parse the constant once with ParseInt64Value and compare integers. BoolColumn evaluates a predicate for
+   whole words (each of the two values either matches or it does not), so it never looks at single bits.
+*/
+
+#ifndef FIXED_WIDTH_COLUMN_HPP
+#define FIXED_WIDTH_COLUMN_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "column.hpp"
+#include "value_types.hpp"
+
+class Int64Column : public Column {
+public:
+  Int64Column(DataType type, unsigned int base_id): Column(type, base_id) {}
+  Column* Clone() const override { return new Int64Column(*this); }
+  Encoding GetEncoding() const override { return Encoding::kPlain; }
+
+  void Append(const std::string& text) override { values_.push_back(ParseInt64Value(type_, text)); }
+  void AppendDefault() override { values_.push_back(0); }
+  void PopBack() override { values_.pop_back(); }
+  size_t Size() const override { return values_.size(); }
+  std::string GetString(size_t pos) const override { return FormatInt64Value(type_, values_[pos]); }
+  double GetNumber(size_t pos) const override { return Int64ValueToDouble(type_, values_[pos]); }
+  int64_t GetInteger(size_t pos) const override { return values_[pos]; }
+
+  void SerializeValue(size_t pos, BinaryWriter& out) const override {
+    out.PutU64(static_cast<uint64_t>(values_[pos]));
+  }
+  void AppendSerialized(BinaryReader& in) override { values_.push_back(static_cast<int64_t>(in.GetU64())); }
+
+  void Filter(CompareOp op, const std::string& constant, const std::vector<uint64_t>& live,
+              const PositionRanges& ranges, std::vector<unsigned int>& out) const override;
+  void GroupByCount(const std::vector<uint64_t>& live, std::map<std::string, size_t>& out) const override;
+  AggregateState Aggregate(const std::vector<uint64_t>& live) const override;
+  Footprint Memory() const override {
+    Footprint footprint;
+    footprint.Add(sizeof(Int64Column));
+    footprint += VectorBuffer(values_);
+    return footprint;
+  }
+
+private:
+  std::vector<int64_t> values_;
+};
+
+class BoolColumn : public Column {
+public:
+  explicit BoolColumn(unsigned int base_id): Column(DataType::kBool, base_id) {}
+  Column* Clone() const override { return new BoolColumn(*this); }
+  Encoding GetEncoding() const override { return Encoding::kPlain; }
+
+  void Append(const std::string& text) override { AppendValue(ParseInt64Value(DataType::kBool, text) != 0); }
+  void AppendDefault() override { AppendValue(false); }
+  void PopBack() override;
+  size_t Size() const override { return size_; }
+  std::string GetString(size_t pos) const override { return GetValue(pos) ? "true" : "false"; }
+  double GetNumber(size_t pos) const override { return GetValue(pos) ? 1 : 0; }
+  int64_t GetInteger(size_t pos) const override { return GetValue(pos) ? 1 : 0; }
+
+  void SerializeValue(size_t pos, BinaryWriter& out) const override { out.PutU8(GetValue(pos) ? 1 : 0); }
+  void AppendSerialized(BinaryReader& in) override { AppendValue(in.GetU8() != 0); }
+
+  void Filter(CompareOp op, const std::string& constant, const std::vector<uint64_t>& live,
+              const PositionRanges& ranges, std::vector<unsigned int>& out) const override;
+  size_t CountMatches(CompareOp op, const std::string& constant, const std::vector<uint64_t>& live,
+                      const PositionRanges& ranges) const override;
+  void GroupByCount(const std::vector<uint64_t>& live, std::map<std::string, size_t>& out) const override;
+  AggregateState Aggregate(const std::vector<uint64_t>& live) const override;
+  Footprint Memory() const override {
+    Footprint footprint;
+    footprint.Add(sizeof(BoolColumn));
+    footprint += VectorBuffer(bits_);
+    return footprint;
+  }
+
+  void AppendValue(bool value);
+  bool GetValue(size_t pos) const { return ((bits_[pos / 64] >> (pos % 64)) & 1) != 0; }
+  size_t CountTrue(const std::vector<uint64_t>& live, size_t first, size_t end) const;  // live true rows in [first, end)
+
+private:
+  // Bits of positions [pos, pos + 64) (shifted down so pos is bit 0; positions past the end are 0).
+  uint64_t WordAt(size_t pos) const;
+
+  std::vector<uint64_t> bits_;
+  size_t size_ = 0;
+};
+
+#endif
@@ -0,0 +1,116 @@
+/*
+Notes:
+
+Materialized views:
+1. A view keeps the result of a SELECT over one table: WHERE, then either plain output expressions or GROUP BY with
+   COUNT/SUM/AVG/MIN/MAX and HAVING. JOIN, ORDER BY, LIMIT/OFFSET and parameters are rejected with
+   std::invalid_argument when the view is created.
+2. It listens to its table (TableListener in db_table.hpp) and applies every added or deleted row as a delta: the row
+   runs through the scan predicates, filters and projections of the plan on its own; a view without aggregates keeps
+   its output row by row id, an aggregating view adds it to or takes it from the accumulators of its group (MIN and
+   MAX keep a count per value so deletes can take the extreme away). A group is dropped when its last row goes.
+3. Read() returns the result in O(rows of the result): HAVING and the output expressions of an aggregating view run
+   over its groups, nothing runs over the table. Rows come in row id order, groups in the order they were created;
+   SUM and AVG of doubles can differ from a fresh query in the last bits since deletes subtract.
+4. A schema change of the table (or replacing it) and a delta that fails (an integer overflow of SUM) leave the view
+   stale; the next Read() replans and recomputes it from the table, and throws if the SELECT itself fails.
+   Copies of a database start their views stale, so a view whose SELECT no longer plans copies like any other.
+5. Views are not persisted with Database::Checkpoint; create them after Open().
+*/
+
+#ifndef MATERIALIZED_VIEW_HPP
+#define MATERIALIZED_VIEW_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "db_table.hpp"
+#include "sql_ast.hpp"
+#include "sql_executor.hpp"
+#include "sql_planner.hpp"
+
+class Database;
+
+struct MaterializedViewStats {
+  uint64_t inserts = 0;   // added rows of the table applied as deltas (whether they passed the WHERE or not)
+  uint64_t deletes = 0;   // deleted rows applied as deltas
+  uint64_t rebuilds = 0;  // full computations: creation, then schema changes and failed deltas
+  size_t rows = 0;        // rows (without aggregates) or groups held
+};
+
+class MaterializedView : public TableListener {
+public:
+  // Plans select_sql against db, computes it and starts listening to its table.
+  MaterializedView(Database& db, const std::string& name, const std::string& select_sql);
+  // A view of db with the name and SELECT of rhs; it is stale and computed by the first Read().
+  MaterializedView(Database& db, const MaterializedView& rhs);
+  ~MaterializedView() override;
+  MaterializedView(const MaterializedView&) = delete;
+  MaterializedView& operator=(const MaterializedView&) = delete;
+
+  const std::string& Name() const { return name_; }
+  const std::string& Sql() const { return sql_; }
+  const std::string& TableName() const { return table_name_; }
+  const DbTable& Table() const { return *table_; }
+
+  QueryResult Read();
+  MaterializedViewStats Stats() const;
+
+  void OnInsert(const DbTable& table, unsigned int id) override;
+  void OnDelete(const DbTable& table, unsigned int id) override;
+
+private:
+  struct ValueLess {
+    bool operator()(const Value& a, const Value& b) const { return CompareValues(a, b) < 0; }
+  };
+  // One aggregate of a group; Add with sign -1 takes back a value added before.
+  struct Accumulator {
+    int64_t count = 0;                      // non-NULL values (rows for COUNT(*))
+    int64_t exact_sum = 0;                  // SUM typed kInt64
+    double sum = 0;
+    std::map<Value, int64_t, ValueLess> values;  // MIN/MAX: how often each value occurs
+    void Add(const AggregateCall& call, const Value& value, int sign);
+    Value Result(const AggregateCall& call) const;
+  };
+  struct Group {
+    Row key;
+    int64_t rows = 0;
+    std::vector<Accumulator> states;  // per aggregate
+  };
+  struct KeyHash {
+    size_t operator()(const Row& key) const;
+  };
+  struct KeyEqual {
+    bool operator()(const Row& a, const Row& b) const;
+  };
+
+  void Build();                          // (re)plans and computes the view from every row of the table
+  void Apply(const DbTable::RowCursor& row, int sign);  // +1 for an added row, -1 for a deleted one
+  bool Passes(const DbTable::RowCursor& row, Row& values) const;  // the row after the nodes below the aggregate
+  void Delta(unsigned int id, int sign);
+
+  Database& db_;
+  std::string name_;
+  std::string sql_;
+  std::string table_name_;
+  Statement statement_;
+  DbTable* table_ = nullptr;
+  uint64_t schema_version_ = 0;          // of table_ when the view was planned
+  bool stale_ = false;
+  PlanPtr plan_;
+  const PlanNode* scan_ = nullptr;
+  std::vector<const PlanNode*> lower_;   // Filter/Project nodes from the scan up to the aggregate (or the root)
+  const PlanNode* aggregate_ = nullptr;  // nullptr when the view does not aggregate
+  std::vector<const PlanNode*> upper_;   // Filter (HAVING)/Project nodes above the aggregate, bottom up
+  std::map<unsigned int, Row> rows_;     // without aggregates: output row per row id
+  std::list<Group> groups_;              // with aggregates, in the order they were created
+  std::unordered_map<Row, std::list<Group>::iterator, KeyHash, KeyEqual> index_;
+  MaterializedViewStats stats_;
+};
+
+#endif
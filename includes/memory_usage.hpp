@@ -0,0 +1,72 @@
+/*
+Notes:
+
+Memory accounting:
+1. A Footprint is a pair of byte counts: `used` is what the data needs, `allocated` what the allocator hands out for
+   it. The difference (Slack) is unused vector/row capacity plus allocator rounding.
+2. Heap blocks are estimated the way glibc malloc sizes them: the request plus an 8-byte header, rounded up to 16,
+   at least 32 bytes. std::map/std::set nodes are 32 bytes of tree links plus the value.
+3. std::string keeps short strings inside the object (SSO); only longer ones own a separate heap buffer.
+*/
+
+#ifndef MEMORY_USAGE_HPP
+#define MEMORY_USAGE_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Bytes malloc reserves for a request of `request` bytes (0 for no allocation).
+inline size_t AllocatedBytes(size_t request) {
+  if (request == 0) return 0;
+  size_t chunk = (request + 8 + 15) & ~size_t{15};
+  return chunk < 32 ? 32 : chunk;
+}
+
+// Bytes of one red-black tree node holding a value of value_size bytes.
+inline size_t TreeNodeBytes(size_t value_size) {
+  return AllocatedBytes(32 + value_size);
+}
+
+struct Footprint {
+  size_t used = 0;
+  size_t allocated = 0;
+
+  void Add(size_t request) {  // one heap block of `request` bytes
+    used += request;
+    allocated += AllocatedBytes(request);
+  }
+  void Remove(size_t request) {
+    used -= request;
+    allocated -= AllocatedBytes(request);
+  }
+  size_t Slack() const { return allocated - used; }
+  Footprint& operator+=(const Footprint& rhs) {
+    used += rhs.used;
+    allocated += rhs.allocated;
+    return *this;
+  }
+  Footprint& operator-=(const Footprint& rhs) {
+    used -= rhs.used;
+    allocated -= rhs.allocated;
+    return *this;
+  }
+};
+
+// The heap buffer of a string (nothing while it fits in the object itself).
+inline Footprint StringHeap(const std::string& s) {
+  Footprint footprint;
+  if (s.capacity() > std::string().capacity()) footprint.Add(s.capacity() + 1);
+  return footprint;
+}
+
+// The buffer of a vector: its size is used, its capacity is allocated (element heaps are not included).
+template <typename T>
+Footprint VectorBuffer(const std::vector<T>& v) {
+  Footprint footprint;
+  footprint.used = v.size() * sizeof(T);
+  footprint.allocated = AllocatedBytes(v.capacity() * sizeof(T));
+  return footprint;
+}
+
+#endif
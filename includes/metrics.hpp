@@ -0,0 +1,127 @@
+/*
+Notes:
+
+Metrics:
+1. Every Database and DbTable owns a Metrics object that counts its operations and records their latency in a
+   log-linear (HDR-style) histogram: values below 16 ns get a bucket each, every power of two above that is split into
+   16 equal buckets, so a percentile read from the histogram is within 1/16 (6.25%) of the true value. Latencies
+   from 2^40 ns (~18 minutes) up share the last bucket; the exact maximum is kept separately.
+2. Recording is sharded per thread: a thread always writes to the same one of kShards cache-line aligned shards, with
+   relaxed atomic adds, so concurrent scans of one table do not fight over a counter. Shards, and within a shard the
+   histogram of each operation (~4.7 KB), are allocated on first use, so a table that is only used from one thread
+   for a few kinds of operations carries one small shard and a few histograms; Memory() reports what is held.
+3. Snapshot() sums the shards into plain numbers; it may run concurrently with recording (a snapshot taken while
+   operations are in flight can miss some of them). Operations that throw are counted in `errors` as well.
+4. Copies of a table or database start with empty metrics.
+*/
+
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "memory_usage.hpp"
+
+enum class MetricOp : uint8_t {
+  kAddRow,
+  kDeleteRow,
+  kAddColumn,
+  kDeleteColumn,
+  kScan,           // Filter, Count, FilterNull, GroupByCount, Aggregate
+  kExport,         // GetRows, ExportCsv, operator<<
+  kCatalogLookup,  // Database::GetTable
+  kCreateTable,
+  kDropTable,
+};
+const size_t kMetricOps = 9;
+const char* MetricOpName(MetricOp op);  // e.g. "add_row"
+
+struct HistogramSnapshot {
+  static const size_t kSubBuckets = 16;
+  static const size_t kBuckets = kSubBuckets + (40 - 4) * kSubBuckets;  // up to 2^40 ns
+
+  std::vector<uint64_t> buckets = std::vector<uint64_t>(kBuckets, 0);
+  uint64_t count = 0;
+  uint64_t sum_ns = 0;
+  uint64_t max_ns = 0;
+
+  static size_t BucketOf(uint64_t ns);
+  static uint64_t BucketUpper(size_t bucket);  // largest value that falls in the bucket
+  double Percentile(double p) const;           // p in [0, 100]; 0 without samples
+  double Mean() const { return count == 0 ? 0 : static_cast<double>(sum_ns) / static_cast<double>(count); }
+  HistogramSnapshot& operator+=(const HistogramSnapshot& rhs);
+};
+
+struct OpMetrics {
+  uint64_t errors = 0;
+  HistogramSnapshot latency;  // latency.count is the number of operations
+};
+
+struct MetricsSnapshot {
+  std::vector<OpMetrics> ops = std::vector<OpMetrics>(kMetricOps);
+  const OpMetrics& operator[](MetricOp op) const { return ops[static_cast<size_t>(op)]; }
+  MetricsSnapshot& operator+=(const MetricsSnapshot& rhs);
+};
+
+/* Prometheus-style text lines for every operation of the snapshot that ran at least once, e.g.
+     db_ops_total{scope="table:league",op="add_row"} 1000
+     db_op_latency_ns{scope="table:league",op="add_row",quantile="0.99"} 1279 */
+void WriteMetricsText(std::ostream& os, const std::string& scope, const MetricsSnapshot& snapshot);
+
+class Metrics {
+public:
+  static const size_t kShards = 16;
+
+  Metrics() = default;
+  Metrics(const Metrics&) = delete;
+  Metrics& operator=(const Metrics&) = delete;
+  ~Metrics();
+
+  void Record(MetricOp op, uint64_t ns, bool failed);
+  MetricsSnapshot Snapshot() const;
+  Footprint Memory() const;  // the shards and histograms allocated so far
+
+private:
+  struct alignas(64) OpHistogram {
+    std::atomic<uint64_t> buckets[HistogramSnapshot::kBuckets] = {};
+    std::atomic<uint64_t> errors{0};
+    std::atomic<uint64_t> sum_ns{0};
+    std::atomic<uint64_t> max_ns{0};
+  };
+  struct alignas(64) Shard {
+    std::atomic<OpHistogram*> ops[kMetricOps] = {};
+  };
+  Shard& LocalShard();
+  static OpHistogram& Histogram(Shard& shard, MetricOp op);
+
+  std::atomic<Shard*> shards_[kShards] = {};
+};
+
+// Times the enclosing scope and records it on destruction, as failed if it is left by an exception.
+class ScopedLatency {
+public:
+  ScopedLatency(Metrics& metrics, MetricOp op)
+      : metrics_(metrics), op_(op), exceptions_(std::uncaught_exceptions()), start_(std::chrono::steady_clock::now()) {}
+  ScopedLatency(const ScopedLatency&) = delete;
+  ScopedLatency& operator=(const ScopedLatency&) = delete;
+  ~ScopedLatency() {
+    const auto elapsed = std::chrono::steady_clock::now() - start_;
+    metrics_.Record(op_, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()),
+                    std::uncaught_exceptions() > exceptions_);
+  }
+
+private:
+  Metrics& metrics_;
+  MetricOp op_;
+  int exceptions_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+#endif
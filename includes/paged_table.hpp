@@ -0,0 +1,102 @@
+/*
+Notes:
+
+PagedTable:
+1. The out-of-core storage mode for tables: the rows live in slotted pages of a file that is read through a
+   BufferPool (buffer_pool.hpp), so a table can be larger than memory while the pages in use stay cached. Memory
+   holds the first row id of every page, not the rows.
+2. Page 0 holds the schema and the next row id; every other page holds rows with consecutive ids:
+     [first id u32][slots u16][start of the records u16][slot: offset u16, length u16]* ... free ... [records]
+   Records grow down from the end of the page; a slot with offset 0 is a deleted row. A record is a presence byte per
+   column, each followed (unless NULL) by the value: a length-prefixed string for kString, a double for kDouble and
+   an int64 for every other type (as Value holds it).
+3. AddRow parses its texts like DbTable::AddRow and appends to the last page; a row too large for an empty page
+   throws std::invalid_argument. DeleteRowById clears its slot; the space of deleted rows is not reused.
+4. Rows(), Filter, Count and GetRows scan with AccessHint::kScan, so they read ahead and go through the scan ring of
+   the pool instead of pushing hot pages out. GetRow and DeleteRowById fetch the one page they need.
+5. Flush writes the dirty pages and the header; the destructor flushes too. Opening an existing file reads every page
+   once (as a scan) to rebuild the page directory and the row count.
+*/
+
+#ifndef PAGED_TABLE_HPP
+#define PAGED_TABLE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "buffer_pool.hpp"
+#include "column.hpp"
+#include "data_chunk.hpp"
+#include "value.hpp"
+
+class PagedTable {
+public:
+  /* Opens the table stored at path, or creates it with columns when the file is new. Opening an existing table with
+  columns that differ from the stored ones throws std::invalid_argument; empty columns take whatever is stored. */
+  PagedTable(const std::string& path, const std::vector<std::pair<std::string, DataType>>& columns,
+             const BufferPoolOptions& options = BufferPoolOptions());
+  ~PagedTable();
+  PagedTable(const PagedTable&) = delete;
+  PagedTable& operator=(const PagedTable&) = delete;
+
+  const std::vector<std::pair<std::string, DataType>>& GetColumnDescriptions() const { return col_descs_; }
+  void AddRow(const std::vector<std::optional<std::string>>& col_data);  // std::nullopt stores NULL
+  void DeleteRowById(unsigned int id);
+  std::vector<std::string> GetRow(unsigned int id) const;  // like DbTable::GetRow: NULL as ""
+  std::vector<std::vector<std::string>> GetRows() const;
+  size_t RowCount() const { return row_count_; }
+  size_t PageCount() const { return first_ids_.size(); }  // pages holding rows
+
+  // Same semantics as DbTable::Filter and DbTable::Count, by scanning every page.
+  std::vector<unsigned int> Filter(unsigned int col_idx, CompareOp op, const std::string& value) const;
+  size_t Count(unsigned int col_idx, CompareOp op, const std::string& value) const;
+
+  /* Walks the rows in id order, keeping the page it is on pinned. A cursor must not outlive its table and is
+  invalidated by AddRow and DeleteRowById. */
+  class RowCursor {
+  public:
+    bool Valid() const { return index_ < table_->first_ids_.size(); }
+    unsigned int Id() const { return table_->first_ids_[index_] + slot_; }
+    void Next();
+
+  private:
+    friend class PagedTable;
+    explicit RowCursor(const PagedTable* table): table_(table) {}
+    void Settle();  // moves forward to the next row that exists
+
+    const PagedTable* table_;
+    PageGuard page_;
+    size_t index_ = 0;   // into first_ids_
+    uint32_t slot_ = 0;
+    mutable Row row_;    // decoded by the first GetValue on this row
+    mutable bool decoded_ = false;
+  };
+  RowCursor Rows() const;
+  Value GetValue(const RowCursor& row, unsigned int col_idx) const;
+
+  void Flush();
+  BufferPoolStats PoolStats() const { return pool_.Stats(); }
+
+private:
+  struct Location {
+    size_t index;   // into first_ids_
+    uint32_t slot;
+  };
+  bool Find(unsigned int id, Location& location) const;
+  void WriteHeader();
+  std::string EncodeRow(const std::vector<std::optional<std::string>>& col_data) const;
+  void DecodeRow(const char* page, uint32_t slot, Row& row) const;
+
+  mutable BufferPool pool_;  // reading fetches pages
+  std::vector<std::pair<std::string, DataType>> col_descs_;
+  std::vector<unsigned int> first_ids_;  // per data page (page i + 1 of the file)
+  unsigned int next_id_ = 0;
+  size_t row_count_ = 0;
+  bool header_dirty_ = false;
+};
+
+#endif
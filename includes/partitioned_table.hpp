@@ -0,0 +1,121 @@
+/*
+Notes:
+
+PartitionedTable:
+1. One logical table whose rows are spread over N DbTable partitions by the value of a key column: kHash puts a row
+   in partition HashValue(key) % N, kRange in the partition whose [lower bound, upper bound) holds the key, with the
+   split points given in ascending order (N = split points + 1, the first and last partitions are open-ended). Keys
+   are cast to the column type first, so "07" and "7" of an integer key land together; NULL keys go to partition 0.
+2. A row id encodes where the row lives: id = (id in the partition) * N + partition. Ids are unique but do not follow
+   insertion order; GetRows lists the rows partition by partition.
+3. Every partition has its own std::shared_mutex. AddRow and DeleteRowById lock only the partition the key or id
+   names, so writers of different partitions never wait for each other; scans hold a partition shared while they
+   read it. The columns are fixed when the table is created.
+4. Filter, Count, GroupByCount and Aggregate first prune: a filter on the key column skips the partitions that cannot
+   hold a match (kEq on a hash key reads one partition; range keys also prune kLt/kLe/kGt/kGe), every other filter
+   reads all of them. The remaining partitions are scanned in parallel, one thread per partition up to scan_threads,
+   unless they hold fewer than kParallelRows rows together; the results are merged (Filter returns ids in ascending
+   order).
+5. Partitioned tables live in a Database next to its tables (see db.hpp) but SQL does not see them and Checkpoint
+   does not persist them.
+*/
+
+#ifndef PARTITIONED_TABLE_HPP
+#define PARTITIONED_TABLE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "db_table.hpp"
+#include "value.hpp"
+
+enum class PartitionMethod { kHash, kRange };
+
+struct PartitionSpec {
+  PartitionMethod method = PartitionMethod::kHash;
+  std::string column;               // the partition key
+  size_t partitions = 1;            // kHash only; kRange has bounds.size() + 1
+  std::vector<std::string> bounds;  // kRange only: ascending split points
+
+  static PartitionSpec Hash(const std::string& column, size_t partitions);
+  static PartitionSpec Range(const std::string& column, const std::vector<std::string>& bounds);
+};
+
+struct PartitionStats {
+  uint64_t scans = 0;               // Filter, Count, GroupByCount and Aggregate calls
+  uint64_t partitions_scanned = 0;
+  uint64_t partitions_pruned = 0;
+  uint64_t parallel_scans = 0;      // scans that ran on more than one thread
+  std::vector<size_t> rows;         // per partition
+};
+
+class PartitionedTable {
+public:
+  static const size_t kParallelRows = 16384;  // fewer rows are scanned on the calling thread
+
+  /* Creates the partitions with the given columns. An unknown key column, no partitions, or range bounds that do not
+  parse as the key type or are not strictly ascending throw std::invalid_argument. scan_threads 0 uses
+  std::thread::hardware_concurrency(). */
+  PartitionedTable(const std::vector<std::pair<std::string, DataType>>& columns, const PartitionSpec& spec,
+                   size_t scan_threads = 0);
+  PartitionedTable(const PartitionedTable& rhs);  // copies the rows; stats start over
+  PartitionedTable& operator=(const PartitionedTable&) = delete;
+
+  const std::vector<std::pair<std::string, DataType>>& GetColumnDescriptions() const { return col_descs_; }
+  const PartitionSpec& Spec() const { return spec_; }
+  size_t PartitionCount() const { return partitions_.size(); }
+  size_t PartitionFor(const std::optional<std::string>& key) const;  // where a row with this key goes
+  size_t PartitionOf(unsigned int id) const { return id % partitions_.size(); }
+
+  unsigned int AddRow(const std::vector<std::optional<std::string>>& col_data);  // returns the id of the row
+  void DeleteRowById(unsigned int id);
+  std::vector<std::string> GetRow(unsigned int id) const;
+  std::vector<std::vector<std::string>> GetRows() const;
+  size_t RowCount() const;
+
+  // Same semantics as the DbTable scans, over every partition that can match.
+  std::vector<unsigned int> Filter(unsigned int col_idx, CompareOp op, const std::string& value) const;
+  size_t Count(unsigned int col_idx, CompareOp op, const std::string& value) const;
+  std::map<std::string, size_t> GroupByCount(unsigned int col_idx) const;
+  double Aggregate(unsigned int col_idx, AggregateFn fn) const;
+  std::vector<size_t> PrunePartitions(unsigned int col_idx, CompareOp op, const std::string& value) const;
+
+  /* A partition as a plain table, to inspect it; unlike the methods above this takes no lock, so nothing may write
+  to the partitioned table meanwhile. */
+  const DbTable& Partition(size_t index) const { return partitions_.at(index)->table; }
+  PartitionStats Stats() const;
+  MetricsSnapshot GetMetrics() const;  // summed over the partitions
+  void SetScanThreads(size_t threads);  // 0: std::thread::hardware_concurrency()
+
+private:
+  struct Part {
+    mutable std::shared_mutex mutex;
+    DbTable table;
+  };
+  std::vector<size_t> AllPartitions() const;
+  // Runs scan(i, partition) for every index i into parts, holding partition parts[i] shared, possibly in parallel.
+  void Scan(const std::vector<size_t>& parts, const std::function<void(size_t, const DbTable&)>& scan) const;
+  Value KeyValue(const std::string& text) const;
+
+  std::vector<std::pair<std::string, DataType>> col_descs_;
+  PartitionSpec spec_;
+  unsigned int key_col_ = 0;
+  std::vector<Value> bounds_;  // spec_.bounds cast to the key type
+  std::vector<std::unique_ptr<Part>> partitions_;
+  std::atomic<size_t> scan_threads_{1};
+  mutable std::atomic<uint64_t> scans_{0};
+  mutable std::atomic<uint64_t> partitions_scanned_{0};
+  mutable std::atomic<uint64_t> partitions_pruned_{0};
+  mutable std::atomic<uint64_t> parallel_scans_{0};
+};
+
+#endif
@@ -0,0 +1,79 @@
+/*
+Notes:
+
+Plan cache:
+1. Database keeps the parsed statement and plan of recently run SQL in an LRU cache keyed by NormalizeSql of the text
+   (sql_parser.hpp), so running the same statement again, from Database::Execute or a PreparedStatement, skips the
+   parser and the planner. CREATE and DROP are never cached.
+2. An entry remembers DbTable::SchemaVersion of every table it uses and the catalog version of the database (bumped by
+   DropTable and assignment). It is only used while all of them are unchanged: AddColumn and DeleteColumnByIdx
+   make the entries of their table stale (found and replanned on their next lookup), DropTable removes the entries
+   that use the dropped table right away. Plans are not replanned when only rows change, so their row estimates age.
+3. Entries are shared: a PreparedStatement keeps using its entry after it was evicted or replaced, and replans itself
+   when the entry has become stale.
+*/
+
+#ifndef PLAN_CACHE_HPP
+#define PLAN_CACHE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "sql_ast.hpp"
+#include "sql_planner.hpp"
+
+// One statement ready to run.
+struct PreparedQuery {
+  std::string sql;                         // normalized text
+  Statement statement;
+  PlanPtr plan;                            // SELECT and DELETE; nullptr for the other statements
+  std::vector<DataType> parameter_types;   // one per ?
+  uint64_t catalog_version = 0;            // of the Database when it was planned
+  std::vector<std::pair<const DbTable*, uint64_t>> schemas;  // every table it uses and its SchemaVersion
+
+  bool Uses(const DbTable* table) const;
+};
+
+using PreparedQueryPtr = std::shared_ptr<const PreparedQuery>;
+
+struct PlanCacheStats {
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  uint64_t invalidations = 0;  // entries dropped because a schema changed
+  uint64_t evictions = 0;      // entries dropped to stay within the capacity
+  size_t entries = 0;
+  size_t capacity = 0;
+};
+
+class PlanCache {
+public:
+  explicit PlanCache(size_t capacity = kDefaultCapacity): capacity_(capacity) {}
+
+  /* The entry for sql (normalized), nullptr when there is none or when `current` says it is stale, in which case it is
+  removed. A hit makes the entry the most recently used. */
+  PreparedQueryPtr Find(const std::string& sql, const std::function<bool(const PreparedQuery&)>& current);
+  void Insert(PreparedQueryPtr query);  // replaces an entry with the same text, evicts the least recently used
+  void Invalidate(const DbTable* table);  // removes every entry that uses table
+  void Clear();
+  void SetCapacity(size_t capacity);      // 0 disables caching
+  PlanCacheStats Stats() const;
+
+  static const size_t kDefaultCapacity = 256;
+
+private:
+  void Erase(std::list<PreparedQueryPtr>::iterator it);
+
+  size_t capacity_;
+  std::list<PreparedQueryPtr> lru_;  // most recently used first
+  std::unordered_map<std::string, std::list<PreparedQueryPtr>::iterator> index_;
+  PlanCacheStats stats_;
+};
+
+#endif
@@ -0,0 +1,111 @@
+/*
+Notes:
+
+QueryTrace:
+1. EXPLAIN ANALYZE for DbTable scans. While a trace is active on a thread (TraceScope), every scan of every table run
+   by that thread records a span per operator: its rows in and out, an estimate of the bytes it touched, and its wall
+   and CPU (thread) time. Spans opened inside another span become its children, so a caller can wrap several scans
+   in a span of its own ("Join", "Query", ...) and get the whole pipeline as one tree.
+2. Operators recorded by DbTable:
+     Filter / Count   a scan with one comparison; children ZonePrune (rows of the zones that may match) and
+                      ColumnScan (encoded and fixed-width columns) or RowScan (plain columns, walks the row map)
+     FilterNull, GroupByCount, Aggregate, Export (GetRows)
+   Bytes are estimated from the storage of the column: row map nodes plus cells for plain columns, the column's
+   Memory() per row for the others.
+3. Without an active trace a span is a thread_local load and a branch, so scans are never slower untraced.
+4. A trace belongs to one thread; activate a separate trace per thread and merge their output if a query fans out.
+5. Print() writes the tree; WriteChromeTrace() writes the Chrome trace event format ("X" events, microseconds) that
+   chrome://tracing and Perfetto open.
+*/
+
+#ifndef QUERY_TRACE_HPP
+#define QUERY_TRACE_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+class QueryTrace {
+public:
+  struct Span {
+    std::string name;    // operator, e.g. "Filter"
+    std::string detail;  // e.g. "goals >= 50"
+    int parent = -1;     // index into Spans(), -1 for a root
+    uint64_t rows_in = 0;
+    uint64_t rows_out = 0;
+    uint64_t bytes = 0;
+    uint64_t start_ns = 0;  // since the trace was created (or cleared)
+    uint64_t wall_ns = 0;
+    uint64_t cpu_ns = 0;
+  };
+
+  QueryTrace(): start_(std::chrono::steady_clock::now()) {}
+
+  size_t Begin(const std::string& name);  // opens a child of the innermost open span
+  void End(size_t span);                  // closes `span` (and anything still open inside it)
+  Span& At(size_t span) { return spans_[span]; }
+  const std::vector<Span>& Spans() const { return spans_; }
+  const Span* Find(const std::string& name) const;  // first span with that name, nullptr if none
+  void Clear();
+
+  void Print(std::ostream& os) const;
+  void WriteChromeTrace(std::ostream& os) const;
+
+  static QueryTrace* Active();  // the trace of the calling thread, nullptr when none
+
+private:
+  static uint64_t ThreadCpuNs();
+
+  std::chrono::steady_clock::time_point start_;
+  std::vector<Span> spans_;
+  std::vector<size_t> open_;          // stack of open spans
+  std::vector<uint64_t> cpu_start_;   // parallel to spans_
+};
+
+// Makes `trace` the active trace of this thread for the lifetime of the scope (nullptr turns tracing off).
+class TraceScope {
+public:
+  explicit TraceScope(QueryTrace* trace);
+  TraceScope(const TraceScope&) = delete;
+  TraceScope& operator=(const TraceScope&) = delete;
+  ~TraceScope();
+
+private:
+  QueryTrace* previous_;
+};
+
+/* One operator span of the active trace, closed when the object goes out of scope (also by an exception). Does nothing
+when no trace is active; check it (`if (span)`) before computing a detail or a byte estimate. */
+class TraceSpan {
+public:
+  explicit TraceSpan(const char* name): trace_(QueryTrace::Active()) {
+    if (trace_ != nullptr) index_ = trace_->Begin(name);
+  }
+  TraceSpan(const TraceSpan&) = delete;
+  TraceSpan& operator=(const TraceSpan&) = delete;
+  ~TraceSpan() {
+    if (trace_ != nullptr) trace_->End(index_);
+  }
+
+  explicit operator bool() const { return trace_ != nullptr; }
+  void SetDetail(const std::string& detail) {
+    if (trace_ != nullptr) trace_->At(index_).detail = detail;
+  }
+  void SetRows(uint64_t rows_in, uint64_t rows_out) {
+    if (trace_ == nullptr) return;
+    trace_->At(index_).rows_in = rows_in;
+    trace_->At(index_).rows_out = rows_out;
+  }
+  void SetBytes(uint64_t bytes) {
+    if (trace_ != nullptr) trace_->At(index_).bytes = bytes;
+  }
+
+private:
+  QueryTrace* trace_;
+  size_t index_ = 0;
+};
+
+#endif
@@ -0,0 +1,81 @@
+/*
+Notes:
+
+Result cache:
+1. Database can keep the results of SELECTs, so that running the same read again between writes copies the stored
+   rows instead of planning and executing it. Entries are keyed by the fingerprint of the plan: the normalized text
+   (NormalizeSql in sql_parser.hpp, the key of the plan cache too) plus the values its parameters were run with.
+2. An entry remembers DbTable::DataVersion of every table the plan reads and the catalog version of the database.
+   AddRow, DeleteRowById and schema changes bump the version of their table, so an entry is only returned while none
+   of its tables changed; stale entries are dropped when they are looked up, entries of a dropped table right away.
+3. Entries are charged the heap bytes of their rows (estimated like memory_usage.hpp) and the least recently used
+   are evicted to stay within the byte budget; a result larger than the whole budget is not stored. The budget is 0,
+   which turns the cache off, until Database::SetResultCacheBudget sets one.
+*/
+
+#ifndef RESULT_CACHE_HPP
+#define RESULT_CACHE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "db_table.hpp"
+#include "sql_executor.hpp"
+
+// The result of one SELECT run with one set of parameter values.
+struct CachedResult {
+  std::string key;                  // ResultCache::Key
+  QueryResult result;
+  uint64_t catalog_version = 0;     // of the Database when it ran
+  std::vector<std::pair<const DbTable*, uint64_t>> versions;  // every table the plan reads and its DataVersion
+  size_t bytes = 0;                 // set by Insert
+
+  bool Uses(const DbTable* table) const;
+};
+
+struct ResultCacheStats {
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  uint64_t invalidations = 0;  // entries dropped because a table changed or went away
+  uint64_t evictions = 0;      // entries dropped to stay within the budget
+  size_t entries = 0;
+  size_t bytes = 0;            // charged to the entries held
+  size_t budget = 0;
+};
+
+class ResultCache {
+public:
+  explicit ResultCache(size_t budget = 0): budget_(budget) {}
+
+  /* The result stored under key, nullptr when there is none or when `current` says it is stale, in which case it is
+  removed. A hit makes the entry the most recently used; the pointer is valid until the cache changes. */
+  const QueryResult* Find(const std::string& key, const std::function<bool(const CachedResult&)>& current);
+  void Insert(CachedResult entry);        // replaces an entry with the same key, evicts the least recently used
+  void Invalidate(const DbTable* table);  // removes every entry that reads table
+  void Clear();
+  void SetBudget(size_t bytes);           // 0 disables caching
+  size_t Budget() const { return budget_; }
+  ResultCacheStats Stats() const;
+
+  // The key of normalized sql run with parameters (nullptr for none).
+  static std::string Key(const std::string& sql, const std::vector<Value>* parameters);
+  static size_t ResultBytes(const QueryResult& result);
+
+private:
+  void Erase(std::list<CachedResult>::iterator it);
+  void Evict(size_t needed);  // until `needed` more bytes fit
+
+  size_t budget_;
+  size_t bytes_ = 0;
+  std::list<CachedResult> lru_;  // most recently used first
+  std::unordered_map<std::string, std::list<CachedResult>::iterator> index_;
+  ResultCacheStats stats_;
+};
+
+#endif
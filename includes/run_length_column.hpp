@@ -0,0 +1,71 @@
+/*
+Notes:
+
+RunLengthColumn<T>:
+1. Stores a column as runs of (value, end position). Good for columns that are sorted or have long runs
+   (rankings, seasons, flags): a season column of a million rows is a handful of runs.
+2. Filter, Count, Aggregate and GroupByCount evaluate the predicate once per run and count the live rows of a run with
+   popcounts over the table's live bitmap, so runs are never expanded (Filter still has to list every matching id).
+3. While every appended value is >= the previous one the column is "sorted" and its runs are strictly increasing:
+   range predicates then binary-search the runs instead of visiting them.
+4. Instantiated for int32_t (kInt), double (kDouble) and std::string (kString).
+*/
+
+#ifndef RUN_LENGTH_COLUMN_HPP
+#define RUN_LENGTH_COLUMN_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "column.hpp"
+
+template <typename T>
+class RunLengthColumn : public Column {
+public:
+  RunLengthColumn(DataType type, unsigned int base_id): Column(type, base_id) {}
+  Column* Clone() const override { return new RunLengthColumn(*this); }
+  Encoding GetEncoding() const override { return Encoding::kRunLength; }
+
+  void Append(const std::string& text) override;
+  void AppendDefault() override;
+  void AppendNull() override;  // extends the last run, so NULLs neither break runs nor the sorted order
+  void PopBack() override;
+  size_t Size() const override { return ends_.empty() ? 0 : ends_.back(); }
+  std::string GetString(size_t pos) const override;
+  void Print(size_t pos, std::ostream& os) const override;
+  double GetNumber(size_t pos) const override;
+
+  void SerializeValue(size_t pos, BinaryWriter& out) const override;
+  void AppendSerialized(BinaryReader& in) override;
+
+  void Filter(CompareOp op, const std::string& constant, const std::vector<uint64_t>& live,
+              const PositionRanges& ranges, std::vector<unsigned int>& out) const override;
+  size_t CountMatches(CompareOp op, const std::string& constant, const std::vector<uint64_t>& live,
+                      const PositionRanges& ranges) const override;
+  void GroupByCount(const std::vector<uint64_t>& live, std::map<std::string, size_t>& out) const override;
+  AggregateState Aggregate(const std::vector<uint64_t>& live) const override;
+  Footprint Memory() const override;
+
+  void AppendValue(const T& value);
+  const T& ValueAt(size_t pos) const { return values_[RunOf(pos)]; }
+
+  // Compression statistics.
+  size_t RunCount() const { return values_.size(); }
+  bool Sorted() const { return sorted_; }
+  size_t EncodedBytes() const;     // runs actually stored (values + run ends)
+  size_t RawBytes() const;         // the same values stored one after another without runs
+  double CompressionRatio() const; // RawBytes / EncodedBytes
+
+private:
+  size_t RunOf(size_t pos) const;
+  size_t RunStart(size_t run) const { return run == 0 ? 0 : ends_[run - 1]; }
+  template <typename Visit>
+  void ForEachMatchingRun(CompareOp op, const std::string& constant, const PositionRanges& ranges, Visit visit) const;
+
+  std::vector<T> values_;        // value of each run
+  std::vector<uint32_t> ends_;   // exclusive end position of each run
+  bool sorted_ = true;           // values_ is strictly increasing
+};
+
+#endif
@@ -0,0 +1,118 @@
+/*
+Notes:
+
+SQL syntax tree:
+1. What ParseSql (sql_parser.hpp) produces: one Statement per call. Expressions are Expr trees; the parser only fills
+   in names and literals, the planner (sql_planner.hpp) builds bound copies in which every column reference is a slot
+   of the input row and every node knows its result type.
+2. Names are kept as written (quoted identifiers without their quotes); keywords are case-insensitive, table and
+   column names are not, like the names given to Database::CreateTable and DbTable::AddColumn.
+3. A `?` is a parameter, numbered from 0 in the order it appears. It prints as ?1, ?2, ... (the 1-based number
+   PreparedStatement::Bind takes). The planner types it after what it is compared with or computed with (text when
+   nothing tells), and the executor reads its value from the parameters of the statement being run.
+*/
+
+#ifndef SQL_AST_HPP
+#define SQL_AST_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "column.hpp"
+#include "value.hpp"
+
+enum class ExprKind { kLiteral, kColumn, kUnary, kBinary, kIsNull, kAggregate, kParameter };
+enum class UnaryOp { kNeg, kNot };
+enum class BinaryOp { kAdd, kSub, kMul, kDiv, kMod, kEq, kNe, kLt, kLe, kGt, kGe, kAnd, kOr };
+
+const char* BinaryOpSymbol(BinaryOp op);  // "+", ..., "=", "<>", ..., "AND", "OR"
+bool IsComparison(BinaryOp op);
+CompareOp ToCompareOp(BinaryOp op);       // comparisons only
+BinaryOp Mirror(BinaryOp op);             // a < b  <=>  b > a
+
+struct Expr;
+using ExprPtr = std::unique_ptr<Expr>;
+
+struct Expr {
+  ExprKind kind = ExprKind::kLiteral;
+  Value literal;            // kLiteral
+  std::string table;        // kColumn: qualifier as written ("" when none)
+  std::string name;         // kColumn
+  UnaryOp unary = UnaryOp::kNeg;
+  BinaryOp binary = BinaryOp::kEq;
+  bool negated = false;     // kIsNull: IS NOT NULL
+  AggregateFn fn = AggregateFn::kCount;
+  bool star = false;        // kAggregate: COUNT(*)
+  int parameter = -1;       // kParameter: 0-based position among the statement's parameters
+  std::vector<ExprPtr> args;  // operands: 1 for kUnary/kIsNull/kAggregate (none for COUNT(*)), 2 for kBinary
+
+  // Set by the planner on bound expressions.
+  int slot = -1;            // kColumn: index into the input row
+  DataType type = DataType::kInt;
+
+  ExprPtr Clone() const;
+  std::string ToString() const;  // SQL text, used for EXPLAIN and default column names
+};
+
+ExprPtr MakeLiteral(Value value);
+ExprPtr MakeColumn(std::string table, std::string name);
+ExprPtr MakeUnary(UnaryOp op, ExprPtr operand);
+ExprPtr MakeBinary(BinaryOp op, ExprPtr left, ExprPtr right);
+ExprPtr MakeParameter(int index);
+
+struct SelectItem {
+  ExprPtr expr;        // nullptr for * (or t.*)
+  std::string table;   // t of t.*
+  std::string alias;
+};
+
+struct TableRef {
+  std::string name;
+  std::string alias;   // "" when none; the table is then referred to by its name
+  ExprPtr on;          // join condition; nullptr for the first table and for cross joins
+};
+
+struct OrderItem {
+  ExprPtr expr;
+  bool descending = false;
+};
+
+struct SelectStmt {
+  std::vector<SelectItem> items;
+  std::vector<TableRef> from;   // joined left to right
+  ExprPtr where;
+  std::vector<ExprPtr> group_by;
+  ExprPtr having;
+  std::vector<OrderItem> order_by;
+  std::optional<int64_t> limit;
+  int64_t offset = 0;
+};
+
+struct ColumnDef {
+  std::string name;
+  DataType type = DataType::kString;
+  Encoding encoding = Encoding::kPlain;
+};
+
+enum class StatementKind { kSelect, kInsert, kDelete, kCreateTable, kDropTable };
+
+struct Statement {
+  StatementKind kind = StatementKind::kSelect;
+  bool explain = false;                       // EXPLAIN SELECT ...
+  SelectStmt select;                          // kSelect
+  std::string table;                          // every other kind
+  std::vector<std::string> columns;           // kInsert: target columns, empty for all of them in order
+  std::vector<std::vector<ExprPtr>> values;   // kInsert: one list of expressions per row
+  ExprPtr where;                              // kDelete
+  std::vector<ColumnDef> column_defs;         // kCreateTable
+  bool if_exists = false;                     // kDropTable: DROP TABLE IF EXISTS
+  bool if_not_exists = false;                 // kCreateTable: CREATE TABLE IF NOT EXISTS
+  size_t parameters = 0;                      // number of ? in the statement
+};
+
+#endif
@@ -0,0 +1,94 @@
+/*
+Notes:
+
+SQL executor:
+1. Runs the plans of sql_planner.hpp as a pipeline of pull-based operators: Open() prepares an operator, every Next()
+   produces one row (or NextChunk a chunk of them, see 7). Scan and Limit pass rows through without holding them; only
+   the operators that must see all of their input hold rows: the build side of a join, the groups of an Aggregate
+   and the input of a Sort.
+   Rows are vectors of Values read straight from the tables (DbTable::GetValue), never text.
+2. Expressions follow SQL: comparisons and arithmetic with a NULL operand are NULL, AND/OR use three-valued logic and
+   a row passes a WHERE, ON or HAVING only when its condition is true. Integer arithmetic stays exact (int64; overflow
+   throws std::out_of_range), anything with a double or decimal is computed in doubles, and division or modulo by zero
+   is NULL.
+3. Aggregates skip NULLs: COUNT(x) counts the non-NULL values, SUM/AVG/MIN/MAX of no values are NULL and an aggregation
+   without GROUP BY returns one row even for an empty input.
+4. INSERT converts every value to its column type before the first row is added, so a bad value adds nothing; DELETE
+   collects the row ids first and then deletes them. CREATE TABLE adds the columns with their encodings and drops the
+   table again if one of them fails. EXPLAIN returns the plan, one line per row.
+5. Database::Execute runs every statement inside a "Query" span of the active trace (query_trace.hpp), so the spans
+   of the table scans it triggers show up as its children.
+6. The values of parameters (?) come from the ParameterScope of the calling thread, already converted to the types
+   the plan gives them (PreparedStatement does that); a parameter without a value throws std::invalid_argument when
+   it is read. A scan predicate whose parameter is NULL matches nothing, like any comparison with NULL.
+7. Scan, Filter and Project also produce DataChunks (data_chunk.hpp): a Scan reads up to 1024 rows into column
+   vectors, a Filter runs its compiled predicate (expr_compiler.hpp) over a chunk and narrows its selection, a Project
+   computes its expressions a chunk at a time. Filter and Project pull chunks when their input produces them, and so do
+   Aggregate and the statement itself, which turns the chunks into rows only for on_row. The other operators pull
+   rows; a Filter or Project above them runs over batches of 1024 rows pulled one by one. Either way a LIMIT is read
+   ahead by up to one batch (an error in a row past the limit can still fail the query), and expressions that do not
+   compile, or throw for a batch, are evaluated one row at a time with Evaluate.
+*/
+
+#ifndef SQL_EXECUTOR_HPP
+#define SQL_EXECUTOR_HPP
+
+#include <cstddef>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "data_chunk.hpp"
+#include "sql_ast.hpp"
+#include "sql_planner.hpp"
+#include "value.hpp"
+
+class Database;
+
+struct QueryResult {
+  std::vector<std::string> columns;
+  std::vector<DataType> types;
+  std::vector<Row> rows;
+  size_t affected = 0;  // rows inserted or deleted
+
+  std::vector<std::vector<std::string>> StringRows() const;  // like DbTable::GetRows: NULL as ""
+};
+
+std::ostream& operator<<(std::ostream& os, const QueryResult& result);  // header line, then one line per row
+
+class Operator {
+public:
+  virtual ~Operator() = default;
+  virtual void Open() = 0;
+  virtual bool Next(Row& row) = 0;  // false when there are no more rows
+
+  /* The vectorized interface, for operators whose ProducesChunks() is true: NextChunk fills chunk with the next rows
+  (at least one selected), false when there are none. A consumer pulls either rows or chunks between two Open()s. */
+  virtual bool ProducesChunks() const { return false; }
+  virtual bool NextChunk(DataChunk&) { return false; }
+};
+
+std::unique_ptr<Operator> BuildOperator(const PlanNode& plan);
+Value Evaluate(const Expr& expr, const Row& row);  // a bound expression over a row of its input
+
+// Makes `parameters` the values of ? on this thread while it lives; scopes nest.
+class ParameterScope {
+public:
+  explicit ParameterScope(const std::vector<Value>* parameters);
+  ~ParameterScope();
+  ParameterScope(const ParameterScope&) = delete;
+  ParameterScope& operator=(const ParameterScope&) = delete;
+
+private:
+  const std::vector<Value>* previous_;
+};
+
+/* Runs one statement. `plan` is its plan when it has one already (PlanSelect for a SELECT, PlanRowIds for a DELETE),
+nullptr to plan it now. Rows of a SELECT go to on_row as they are produced (the plan's column names and types are in
+`header`); other statements report the rows they changed. Returns the number of rows produced or changed. */
+size_t ExecuteStatement(Database& db, const Statement& statement, const PlanNode* plan, QueryResult& header,
+                        const std::function<void(const Row&)>& on_row);
+
+#endif
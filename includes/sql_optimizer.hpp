@@ -0,0 +1,56 @@
+/*
+Notes:
+
+Cost-based join optimizer:
+1. Takes the scans of a FROM clause and every ON and WHERE conjunct (all joins are inner, so a conjunct may be applied
+   anywhere its columns are available) and returns the join tree the cost model prefers. Conjuncts reading one table go
+   into its scan (PushIntoScan) or a Filter right above it, conjuncts reading several tables are applied by the
+   lowest join that has all of them, and conjuncts reading no column end up in a Filter on top.
+2. Row estimates: a scan returns its table's rows times the selectivity of its predicates (DbTable::EstimateSelectivity),
+   an equality between columns of two tables keeps DbTable::EstimateJoinSelectivity of the pairs, and any other
+   condition kDefaultSelectivity (kDefaultEqualitySelectivity for equalities with a computed side). Conditions are
+   assumed independent.
+3. Join order: with up to kDpRelations tables every subset's cheapest plan is found by dynamic programming over all
+   splits into two subsets (bushy trees), considering cross products only for subsets no condition connects. Larger
+   joins are built greedily: the pair of partial plans with the smallest result is joined until one is left.
+4. Join methods (PlanNode::join_method) and their costs, in abstract units of one comparison:
+     kHash        build * kHashBuildCost + probe * kHashProbeCost + output * kOutputCost
+     kNestedLoop  left * right * kCompareCost + right + output * kOutputCost (only without equi keys)
+     kLookup      left * (kLookupCost + rows visited by one DbTable::Filter(kEq)) + matches * kSeekCost + output
+                  * kOutputCost; only when the right side is one Scan and an equi key is one of its columns, of the
+                  same type as the left key. Cheap when the left side is small and the key column is sorted or
+                  compact enough for its zone maps to prune (DbTable::EstimateLookupRows).
+   The children's costs are added to all of them.
+5. Scan access (PlanNode::access): a sequential walk costs rows * (kRowCost + predicates * kCompareCost); DbTable::Filter
+   on one predicate costs the rows of the zones it visits (DbTable::EstimateScanRows) * kFilterRowCost plus a seek and
+   the remaining checks for every match. The cheaper one is chosen.
+6. Joins of more than 64 tables throw std::invalid_argument.
+*/
+
+#ifndef SQL_OPTIMIZER_HPP
+#define SQL_OPTIMIZER_HPP
+
+#include <cstddef>
+#include <vector>
+
+#include "sql_planner.hpp"
+
+struct CostModel {
+  static constexpr double kFilterRowCost = 1;   // a row DbTable::Filter compares
+  static constexpr double kRowCost = 4;         // a row a sequential scan decodes
+  static constexpr double kCompareCost = 1;
+  static constexpr double kSeekCost = 12;       // positioning a cursor on a row id
+  static constexpr double kHashBuildCost = 6;
+  static constexpr double kHashProbeCost = 4;
+  static constexpr double kLookupCost = 8;      // setting up one DbTable::Filter call
+  static constexpr double kOutputCost = 2;
+  static constexpr double kDefaultSelectivity = 1.0 / 3;
+  static constexpr double kDefaultEqualitySelectivity = 0.1;
+  static constexpr size_t kDpRelations = 10;
+};
+
+/* Joins `scans` (Scan nodes in FROM order) under `conjuncts`, which are bound to the concatenation of the scans'
+columns in that order. The result produces the same columns in some other order, found by their names. */
+PlanPtr OptimizeJoins(std::vector<PlanPtr> scans, std::vector<ExprPtr> conjuncts);
+
+#endif
@@ -0,0 +1,39 @@
+/*
+Notes:
+
+SQL parser:
+1. Recursive descent over a hand-written lexer; one statement per call, an optional trailing ';'. Grammar:
+     statement  := [EXPLAIN] select | insert | delete | create | drop
+     select     := SELECT item {, item} FROM table {join} [WHERE expr] [GROUP BY expr {, expr}] [HAVING expr]
+                   [ORDER BY expr [ASC|DESC] {, ...}] [LIMIT n [OFFSET n]]
+     item       := * | name.* | expr [[AS] alias]
+     table      := name [[AS] alias]
+     join       := [INNER] JOIN table ON expr | CROSS JOIN table | , table
+     insert     := INSERT INTO name [(col {, col})] VALUES (expr {, expr}) {, (...)}
+     delete     := DELETE FROM name [WHERE expr]
+     create     := CREATE TABLE [IF NOT EXISTS] name (col type [ENCODING enc] {, ...})
+     drop       := DROP TABLE [IF EXISTS] name
+     expr       := OR < AND < NOT < comparison (= <> != < <= > >=, IS [NOT] NULL) < + - < * / % < unary - < primary
+     primary    := literal | ? | column | name.column | COUNT(*) | COUNT|SUM|AVG|MIN|MAX(expr) | (expr)
+2. Literals: integers (int64), decimals with '.' or an exponent (double), 'strings' ('' escapes a quote), TRUE, FALSE,
+   NULL. Identifiers are letters, digits and '_', or "double quoted" for any other name (e.g. "Goal Scored").
+3. Type names: TEXT/VARCHAR/STRING/CHAR, INT/INTEGER, BIGINT/INT64, DOUBLE/FLOAT/REAL, BOOL/BOOLEAN, DATE, TIMESTAMP,
+   DECIMAL/NUMERIC (an optional "(n)" or "(p, s)" after a type is accepted and ignored). Encodings: PLAIN,
+   DICTIONARY, COMPRESSED, RUNLENGTH, COMPACT.
+4. Syntax errors throw std::invalid_argument naming the offending token and its offset.
+5. NormalizeSql only runs the lexer: tokens joined by single spaces, comments and a trailing ';' dropped, keywords and
+   function names upper-cased and names as written, so two texts of the same statement that differ only in layout
+   or keyword case normalize alike (the key of the plan cache, plan_cache.hpp). Lexical errors throw like ParseSql.
+*/
+
+#ifndef SQL_PARSER_HPP
+#define SQL_PARSER_HPP
+
+#include <string>
+
+#include "sql_ast.hpp"
+
+Statement ParseSql(const std::string& sql);
+std::string NormalizeSql(const std::string& sql);
+
+#endif
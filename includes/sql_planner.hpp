@@ -0,0 +1,136 @@
+/*
+Notes:
+
+SQL planner:
+1. Turns a parsed SELECT into a tree of logical operators. Every node lists the columns it produces; expressions
+   above a node are bound to it: column references become slots of its output row and every node carries the
+   type it evaluates to.
+     Scan       one table; reads only the columns the query mentions and applies the `column op constant`
+                conjuncts that reach it (predicates). Its access path is a sequential walk of the rows, or DbTable::Filter
+                on the first predicate (zone pruning and encoded-column scans, then one seek per match) when the
+                cost model says fewer rows are touched that way
+     Filter     rows for which `predicate` is true
+     Join       inner join of children[0] and children[1] on left_keys = right_keys plus `predicate`:
+                  kHash        builds a hash table over children[1], streams children[0] through it
+                  kNestedLoop  no equi keys: every pair of rows
+                  kLookup      children[1] is a Scan that is never run as such: every row of children[0] looks its
+                               key up with DbTable::Filter(kEq) on the first right key and checks the scan's predicates
+     Aggregate  one row per distinct group_by (or a single row without GROUP BY): group keys then aggregates
+     Project    exprs
+     Sort       sort_keys, stable, NULLs first ascending
+     Limit      offset, then at most limit rows
+2. With PlannerOptions::optimize (the default) the join order, the place of every WHERE/ON conjunct and the join
+   methods come from the cost-based optimizer (sql_optimizer.hpp). Without it joins run left-deep in FROM order with
+   hash or nested loop joins, and the WHERE of a join is a Filter above all of them.
+3. Comparing a column with a string literal converts the literal to the column type ('2024-01-31' for a date column),
+   so a literal that does not parse as that type is an error when the query is planned, as it is for DbTable::Filter.
+4. Unknown or ambiguous names, aggregates outside an aggregation and non-grouped columns next to aggregates throw
+   std::invalid_argument; unknown tables throw std::out_of_range like Database::GetTable.
+*/
+
+#ifndef SQL_PLANNER_HPP
+#define SQL_PLANNER_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "db_table.hpp"
+#include "sql_ast.hpp"
+
+class Database;
+
+enum class PlanKind { kScan, kFilter, kJoin, kAggregate, kProject, kSort, kLimit };
+enum class ScanAccess { kSequential, kFilter };
+enum class JoinMethod { kHash, kNestedLoop, kLookup };
+
+struct PlanColumn {
+  std::string table;  // qualifier the column is reached by ("" for computed columns)
+  std::string name;
+  DataType type = DataType::kString;
+  const DbTable* source = nullptr;  // the table and column it is read from, for statistics (nullptr when computed)
+  int source_column = -1;
+};
+
+struct ScanPredicate {
+  unsigned int column = 0;  // column index in the table
+  CompareOp op = CompareOp::kEq;
+  Value constant;           // already of the column type
+  std::string text;         // the constant as DbTable::Filter reads it
+  int parameter = -1;       // >= 0: constant and text come from this parameter when the scan opens
+};
+
+struct AggregateCall {
+  AggregateFn fn = AggregateFn::kCount;
+  ExprPtr arg;              // bound to the input of the Aggregate; nullptr for COUNT(*)
+  DataType type = DataType::kInt64;
+};
+
+struct SortKey {
+  ExprPtr expr;
+  bool descending = false;
+};
+
+struct PlanNode;
+using PlanPtr = std::unique_ptr<PlanNode>;
+
+struct PlanNode {
+  PlanKind kind = PlanKind::kScan;
+  std::vector<PlanColumn> columns;  // output row
+  std::vector<PlanPtr> children;
+
+  // kScan
+  std::string table_name;
+  std::string alias;
+  const DbTable* table = nullptr;
+  std::vector<unsigned int> scan_columns;  // table column of every output slot
+  bool with_row_id = false;                // one more slot after scan_columns: the row id (kInt64)
+  std::vector<ScanPredicate> predicates;   // the one kFilter access runs through first, then most selective first
+  ScanAccess access = ScanAccess::kSequential;
+  double estimated_rows = 0;               // rows produced (every node)
+  double estimated_cost = 0;               // scans and joins: cost of the subtree (sql_optimizer.hpp)
+
+  ExprPtr predicate;                       // kFilter; kJoin: condition besides the keys (may be null)
+  JoinMethod join_method = JoinMethod::kHash;
+  std::vector<ExprPtr> left_keys;          // kJoin: bound to children[0]
+  std::vector<ExprPtr> right_keys;         // kJoin: bound to children[1]
+  std::vector<ExprPtr> group_by;           // kAggregate: bound to the input
+  std::vector<AggregateCall> aggregates;   // kAggregate
+  std::vector<ExprPtr> exprs;              // kProject
+  std::vector<SortKey> sort_keys;          // kSort
+  int64_t limit = -1;                      // kLimit: -1 for no limit
+  int64_t offset = 0;
+
+  std::string Explain() const;  // one line per node, children indented
+};
+
+struct PlannerOptions {
+  bool optimize = true;  // false keeps FROM order and plans WHERE above the joins (for comparing plans)
+};
+
+// Plans a SELECT against the tables of db.
+PlanPtr PlanSelect(const SelectStmt& select, Database& db, const PlannerOptions& options = PlannerOptions());
+
+/* Plans `SELECT <row id> FROM table WHERE where`, the rows a DELETE removes: a Scan with_row_id whose last slot is the
+row id, under a Filter for what the scan cannot apply itself. */
+PlanPtr PlanRowIds(const std::string& table_name, const Expr* where, Database& db);
+
+// Binds a constant expression (no column references), e.g. a value of INSERT.
+ExprPtr BindConstant(const Expr& expr);
+
+// Building blocks shared with the optimizer.
+void SplitAnd(ExprPtr expr, std::vector<ExprPtr>& conjuncts);
+ExprPtr Conjoin(std::vector<ExprPtr>& conjuncts);  // nullptr for none
+PlanPtr MakeFilter(PlanPtr input, ExprPtr predicate);
+// Moves the conjuncts a scan can apply into it, picks its access path and returns the rest (nullptr for none).
+ExprPtr PushIntoScan(PlanNode& scan, ExprPtr condition);
+/* `value` as a constant DbTable::Filter compares a column of `type` with the same result as CompareValues: false for
+values that change when converted (2.5 for an int column) and for plain numbers against dates, times or booleans. */
+bool ToFilterConstant(const Value& value, DataType type, Value& constant);
+
+// Sets types[i] to the type the plan (or bound expression) gives parameter i; parameters it does not use keep theirs.
+void CollectParameterTypes(const PlanNode& plan, std::vector<DataType>& types);
+void CollectParameterTypes(const Expr* expr, std::vector<DataType>& types);
+
+#endif
@@ -0,0 +1,75 @@
+/*
+Notes:
+
+Value:
+1. One typed cell as the SQL executor sees it. The DataType says how the payload is read:
+     kString                  text
+     kDouble                  number
+     kInt and the int64 types integer (kDecimal scaled by kDecimalScale, kDate in days, ...; see value_types.hpp)
+   plus a NULL flag. A NULL keeps the type of the column or expression it came from.
+2. CompareValues orders values the way DbTable::Filter does: numbers numerically (integers exactly while both sides
+   are unscaled, through doubles once a kDouble or kDecimal is involved), strings byte-wise. A string never equals a
+   number; the planner converts literals to the column type before they meet.
+3. HashValue is consistent with CompareValues == 0 (numbers hash their double value), so joins and GROUP BY can mix
+   kInt and kDouble keys.
+*/
+
+#ifndef VALUE_HPP
+#define VALUE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <utility>
+
+#include "column.hpp"
+
+struct Value {
+  DataType type = DataType::kInt;
+  bool null = true;
+  int64_t integer = 0;
+  double number = 0;
+  std::string text;
+
+  static Value Null(DataType type) {
+    Value v;
+    v.type = type;
+    return v;
+  }
+  static Value Integer(DataType type, int64_t integer) {
+    Value v;
+    v.type = type;
+    v.null = false;
+    v.integer = integer;
+    return v;
+  }
+  static Value Number(double number) {
+    Value v;
+    v.type = DataType::kDouble;
+    v.null = false;
+    v.number = number;
+    return v;
+  }
+  static Value Text(std::string text) {
+    Value v;
+    v.type = DataType::kString;
+    v.null = false;
+    v.text = std::move(text);
+    return v;
+  }
+  static Value Bool(bool b) { return Integer(DataType::kBool, b ? 1 : 0); }
+
+  bool IsNumeric() const { return type != DataType::kString; }
+  bool IsInteger() const { return type != DataType::kString && type != DataType::kDouble; }
+  double AsDouble() const;        // numbers only; kDecimal scaled back
+  bool IsTrue() const { return !null && (type == DataType::kDouble ? number != 0 : IsInteger() && integer != 0); }
+  std::string ToString() const;   // the text AddRow parses back into the same value ("" for NULL)
+};
+
+int CompareValues(const Value& a, const Value& b);  // <0, 0, >0; NULLs are equal to each other and sort first
+size_t HashValue(const Value& v);
+Value CastValue(const Value& v, DataType type);     // converts a literal to a column type (throws like AddRow)
+std::ostream& operator<<(std::ostream& os, const Value& v);  // NULL as "NULL"
+
+#endif
@@ -0,0 +1,42 @@
+/*
+Notes:
+
+Fixed-width value types:
+1. kInt64, kBool, kDate, kTimestamp and kDecimal are all stored as one int64_t per row (kBool as one bit):
+     kInt64:     the value
+     kBool:      0 / 1, written "false" / "true" (also parsed from "0" / "1", any case)
+     kDate:      days since 1970-01-01, written YYYY-MM-DD
+     kTimestamp: microseconds since 1970-01-01 00:00:00 UTC, written YYYY-MM-DD HH:MM:SS[.ffffff]
+                 (parsed with a ' ' or 'T' separator, an optional trailing 'Z', and a plain date means midnight)
+     kDecimal:   fixed point with kDecimalDigits (4) fraction digits, i.e. value * 10^4, written with all 4 digits
+2. Comparisons of these types are integer comparisons, so a time-range filter never parses a row.
+3. Parse* throw std::invalid_argument for malformed text and std::out_of_range for values that do not fit.
+*/
+
+#ifndef VALUE_TYPES_HPP
+#define VALUE_TYPES_HPP
+
+#include <cstdint>
+#include <string>
+
+#include "column.hpp"
+
+const int kDecimalDigits = 4;
+const int64_t kDecimalScale = 10000;
+
+// True for the types stored as int64_t (every fixed-width type added after kInt).
+inline bool IsInt64Type(DataType type) {
+  return type == DataType::kInt64 || type == DataType::kBool || type == DataType::kDate ||
+         type == DataType::kTimestamp || type == DataType::kDecimal;
+}
+
+int64_t ParseInt64Value(DataType type, const std::string& text);
+std::string FormatInt64Value(DataType type, int64_t value);
+double Int64ValueToDouble(DataType type, int64_t value);  // kDecimal is scaled back; everything else as is
+
+const char* DataTypeName(DataType type);  // "std::string", "double", "int", "int64", "bool", "date", ...
+
+int64_t DaysFromCivil(int64_t year, unsigned month, unsigned day);
+void CivilFromDays(int64_t days, int64_t& year, unsigned& month, unsigned& day);
+
+#endif
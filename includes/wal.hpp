@@ -0,0 +1,86 @@
+/*
+Notes:
+
+WriteAheadLog:
+1. An append-only binary log of every mutation made to a durable Database.
+2. Each record is [payload length][crc32][lsn][type][payload]; replay stops at the first torn or corrupt record.
+3. Commits are grouped: the first committer becomes the leader, waits for the group-commit window so that
+   other threads can add their records, then writes the whole batch and issues a single fdatasync.
+4. A failed write or fdatasync breaks the log: the file is cut back to the end of the last batch that made it, and
+   from then on Append and every Commit of a record that is not durable yet throw std::runtime_error with the first
+   error (the leader's own Commit included), so nobody is told a lost record is safe. Truncate (after a checkpoint
+   has saved the tables) starts a fresh log and clears the error.
+*/
+
+#ifndef WAL_HPP
+#define WAL_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+
+enum class WalRecordType : uint8_t {
+  kCreateTable = 1,
+  kDropTable = 2,
+  kAddColumn = 3,
+  kDeleteColumn = 4,
+  kAddRow = 5,
+  kDeleteRow = 6,
+  kReplaceTable = 7, // copy-assignment onto a durable table: the payload is the full table image
+  kAddRowWithNulls = 8  // kAddRow with a presence byte before every cell (only used for rows holding a NULL)
+};
+
+struct WalRecord {
+  uint64_t lsn = 0;
+  WalRecordType type = WalRecordType::kCreateTable;
+  std::string payload;
+};
+
+struct WalOptions {
+  std::chrono::microseconds group_commit_window{0};  // how long a leader waits for followers before syncing
+  bool sync = true;                                  // false skips fdatasync (tests / benchmarks only)
+};
+
+class WriteAheadLog {
+public:
+  // Opens (or creates) the log at path. Records after the last valid one are cut off.
+  explicit WriteAheadLog(const std::string& path, const WalOptions& options = WalOptions());
+  ~WriteAheadLog();
+  WriteAheadLog(const WriteAheadLog&) = delete;
+  WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+  uint64_t Append(WalRecordType type, const std::string& payload);  // buffers a record, returns its lsn
+  void Commit(uint64_t lsn);                                        // blocks until lsn is on disk
+  void AppendAndCommit(WalRecordType type, const std::string& payload) { Commit(Append(type, payload)); }
+  void Truncate();                                                  // drops every record (after a checkpoint)
+
+  uint64_t LastLsn() const;
+  uint64_t DurableLsn() const;
+  uint64_t SyncCount() const;
+  void SetNextLsn(uint64_t lsn);  // used after recovery so lsns keep increasing past the snapshot
+
+  // Calls apply for every valid record with lsn > after_lsn. Returns the byte offset of the valid prefix.
+  static uint64_t Replay(const std::string& path, uint64_t after_lsn,
+                         const std::function<void(const WalRecord&)>& apply, uint64_t* last_lsn = nullptr);
+
+private:
+  void FlushLocked(std::unique_lock<std::mutex>& lock);
+
+  std::string path_;
+  WalOptions options_;
+  int fd_ = -1;
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  std::string pending_;          // encoded records not yet written
+  uint64_t next_lsn_ = 1;
+  uint64_t durable_lsn_ = 0;
+  uint64_t sync_count_ = 0;
+  bool flushing_ = false;        // a leader is currently writing a batch
+  uint64_t file_end_ = 0;        // bytes of the log that hold whole, written batches
+  std::string error_;            // the failure that broke the log; empty while it works
+};
+
+#endif
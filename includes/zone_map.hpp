@@ -0,0 +1,84 @@
+/*
+Notes:
+
+ZoneMap:
+1. Min/max and NULL count of one column per zone of kZoneRows (64K) consecutive row ids. DbTable keeps one per column and consults it
+   before scanning: zones whose [min, max] cannot satisfy a predicate are skipped, zones that satisfy it entirely are
+   taken without comparing a single value.
+2. Bounds only ever widen while rows are added. Deleting rows leaves them as they are (still correct, just looser)
+   until the zone is empty, when DbTable resets it.
+3. kDouble/kInt columns keep their bounds as doubles (every int is exact), string columns as strings and the int64
+   types of value_types.hpp as int64_t (a double would round timestamps and large int64 values). A zone holding a NaN
+   cannot be ordered and always has to be scanned.
+*/
+
+#ifndef ZONE_MAP_HPP
+#define ZONE_MAP_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "binary_io.hpp"
+#include "column.hpp"
+
+class ZoneMap {
+public:
+  static const unsigned int kZoneRows = 65536;
+
+  explicit ZoneMap(DataType type): type_(type) {}
+
+  void AddNumber(unsigned int id, double value);
+  void AddString(unsigned int id, const std::string& value);
+  void AddInteger(unsigned int id, int64_t value);
+  void AddNull(unsigned int id);
+  void RemoveNull(unsigned int id);  // a NULL row was deleted
+  void Reset(size_t zone);
+  void Clear() { zones_.clear(); }
+
+  size_t ZoneCount() const { return zones_.size(); }
+  bool HasValues(size_t zone) const {
+    return zone < zones_.size() && (zones_[zone].has_values || zones_[zone].has_nan);
+  }
+  size_t NullCount(size_t zone) const { return zone < zones_.size() ? zones_[zone].null_count : 0; }
+  double Min(size_t zone) const { return zones_[zone].min; }
+  double Max(size_t zone) const { return zones_[zone].max; }
+  const std::string& MinString(size_t zone) const { return zones_[zone].str_min; }
+  const std::string& MaxString(size_t zone) const { return zones_[zone].str_max; }
+  int64_t MinInteger(size_t zone) const { return zones_[zone].int_min; }
+  int64_t MaxInteger(size_t zone) const { return zones_[zone].int_max; }
+
+  /* Can some value of the zone satisfy `value op constant`? Does every row? NULL never satisfies a comparison, so zones
+  holding only NULLs never match and zones holding any NULL never match entirely. */
+  bool MayMatch(size_t zone, CompareOp op, double constant) const;
+  bool MayMatch(size_t zone, CompareOp op, const std::string& constant) const;
+  bool MayMatch(size_t zone, CompareOp op, int64_t constant) const;
+  bool AllMatch(size_t zone, CompareOp op, double constant) const;
+  bool AllMatch(size_t zone, CompareOp op, const std::string& constant) const;
+  bool AllMatch(size_t zone, CompareOp op, int64_t constant) const;
+
+  Footprint Memory() const;  // the zones and their string bounds
+
+  void Serialize(BinaryWriter& out) const;
+  void Deserialize(BinaryReader& in);  // replaces every zone
+
+private:
+  struct Zone {
+    bool has_values = false;
+    bool has_nan = false;
+    uint32_t null_count = 0;
+    double min = 0;
+    double max = 0;
+    std::string str_min;
+    std::string str_max;
+    int64_t int_min = 0;
+    int64_t int_max = 0;
+  };
+
+  Zone& ZoneOf(unsigned int id);
+
+  DataType type_;
+  std::vector<Zone> zones_;
+};
+
+#endif
@@ -0,0 +1,446 @@
+#include "async_io.hpp"
+
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define HAVE_IO_URING 1
+#endif
+#endif
+#endif
+
+static std::string ErrnoMessage(const std::string& what) {
+    return what + ": " + std::strerror(errno);
+}
+
+const char* AsyncIoBackendName(AsyncIoBackend backend) {
+    return backend == AsyncIoBackend::kIoUring ? "io_uring" : "thread pool";
+}
+
+class AsyncWriter::Engine {
+public:
+    virtual ~Engine() = default;
+    virtual void Submit(std::string data, uint64_t offset) = 0;
+    virtual void Drain() = 0;  // waits for every write submitted so far; throws the first error
+    virtual AsyncIoStats Stats() const = 0;
+};
+
+namespace {
+
+// Writer threads; each takes the oldest queued buffer plus the ones that directly follow it and writes them at once.
+class ThreadPoolEngine : public AsyncWriter::Engine {
+public:
+    ThreadPoolEngine(int fd, const std::string& path, const AsyncIoOptions& options)
+        : fd_(fd), path_(path), max_pending_bytes_(options.max_pending_bytes) {
+        for (size_t i = 0; i < std::max<size_t>(1, options.threads); ++i) {
+            workers_.emplace_back([this] { Work(); });
+        }
+    }
+
+    ~ThreadPoolEngine() override {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        work_.notify_all();
+        for (std::thread& worker : workers_) {
+            worker.join();
+        }
+    }
+
+    void Submit(std::string data, uint64_t offset) override {
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [&] {
+            return pending_bytes_ == 0 || pending_bytes_ + data.size() <= max_pending_bytes_ || !error_.empty();
+        });
+        if (!error_.empty()) throw std::runtime_error(error_);
+        ++stats_.writes;
+        stats_.bytes += data.size();
+        pending_bytes_ += data.size();
+        queue_.push_back(Job{std::move(data), offset});
+        work_.notify_one();
+    }
+
+    void Drain() override {
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [this] { return pending_bytes_ == 0; });
+        if (!error_.empty()) throw std::runtime_error(error_);
+    }
+
+    AsyncIoStats Stats() const override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+private:
+    struct Job {
+        std::string data;
+        uint64_t offset;
+    };
+    static const size_t kMaxBatch = 64;  // buffers per pwritev
+
+    void Work() {
+        for (;;) {
+            std::vector<Job> batch;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                work_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+                if (queue_.empty()) return;
+                do {
+                    batch.push_back(std::move(queue_.front()));
+                    queue_.pop_front();
+                } while (!queue_.empty() && batch.size() < kMaxBatch &&
+                         queue_.front().offset == batch.back().offset + batch.back().data.size());
+                ++stats_.submissions;
+            }
+            std::string error;
+            try {
+                WriteBatch(batch);
+            } catch (const std::exception& e) {
+                error = e.what();
+            }
+            size_t bytes = 0;
+            for (const Job& job : batch) {
+                bytes += job.data.size();
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                pending_bytes_ -= bytes;
+                if (error_.empty()) error_ = error;
+            }
+            done_.notify_all();
+        }
+    }
+
+    void WriteBatch(std::vector<Job>& batch) const {
+        std::vector<iovec> iov(batch.size());
+        for (size_t i = 0; i < batch.size(); ++i) {
+            iov[i].iov_base = batch[i].data.data();
+            iov[i].iov_len = batch[i].data.size();
+        }
+        uint64_t offset = batch[0].offset;
+        size_t first = 0;
+        while (first < iov.size()) {
+            ssize_t n = ::pwritev(fd_, &iov[first], static_cast<int>(iov.size() - first), static_cast<off_t>(offset));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) throw std::runtime_error(ErrnoMessage("Cannot write " + path_));
+            offset += static_cast<uint64_t>(n);
+            for (size_t left = static_cast<size_t>(n); left > 0;) {  // drop what was written
+                const size_t step = std::min(left, iov[first].iov_len);
+                iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + step;
+                iov[first].iov_len -= step;
+                left -= step;
+                if (iov[first].iov_len == 0) ++first;
+            }
+        }
+    }
+
+    int fd_;
+    std::string path_;
+    size_t max_pending_bytes_;
+    mutable std::mutex mutex_;
+    std::condition_variable work_;  // a job was queued, or stop_
+    std::condition_variable done_;  // pending_bytes_ went down
+    std::deque<Job> queue_;
+    size_t pending_bytes_ = 0;      // queued or being written
+    std::string error_;             // the first failure
+    bool stop_ = false;
+    AsyncIoStats stats_;
+    std::vector<std::thread> workers_;  // last: they start using the members above right away
+};
+
+#ifdef HAVE_IO_URING
+/* One io_uring instance per writer. Only the writing thread touches the rings, so the tails it owns are plain loads
+and the indices the kernel shares are read with acquire and published with release. Every write has a slot in
+requests_ (its user_data) until it has completed in full. */
+class UringEngine : public AsyncWriter::Engine {
+public:
+    UringEngine(int fd, const std::string& path, const AsyncIoOptions& options)
+        : fd_(fd), path_(path), options_(options) {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        const size_t depth = std::min<size_t>(std::max<size_t>(1, options.queue_depth), 4096);
+        const unsigned entries = static_cast<unsigned>(depth);
+        ring_ = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+        if (ring_ < 0) {
+            throw std::runtime_error(ErrnoMessage("io_uring_setup"));
+        }
+        try {
+            sq_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            cq_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            const bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+            if (single) sq_size_ = cq_size_ = std::max(sq_size_, cq_size_);
+            sq_ring_ = Map(sq_size_, IORING_OFF_SQ_RING);
+            cq_ring_ = single ? sq_ring_ : Map(cq_size_, IORING_OFF_CQ_RING);
+            sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+            sqes_ = static_cast<io_uring_sqe*>(Map(sqes_size_, IORING_OFF_SQES));
+        } catch (...) {
+            Release();
+            throw;
+        }
+        char* sq = static_cast<char*>(sq_ring_);
+        sq_head_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        char* cq = static_cast<char*>(cq_ring_);
+        cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        requests_.resize(entries);
+        for (unsigned slot = entries; slot > 0; --slot) {
+            free_.push_back(slot - 1);
+        }
+    }
+
+    ~UringEngine() override {
+        try {  // the kernel may still be reading the buffers
+            while (free_.size() < requests_.size()) {
+                Enter(1);
+                Reap();
+            }
+        } catch (const std::exception&) {
+        }
+        Release();
+    }
+
+    void Submit(std::string data, uint64_t offset) override {
+        ThrowIfFailed();
+        while (free_.empty() || (pending_bytes_ > 0 && pending_bytes_ + data.size() > options_.max_pending_bytes)) {
+            Enter(1);
+            Reap();
+            ThrowIfFailed();
+        }
+        const unsigned slot = free_.back();
+        free_.pop_back();
+        Request& request = requests_[slot];
+        request.offset = offset;
+        request.done = 0;
+        request.data = std::move(data);
+        ++stats_.writes;
+        stats_.bytes += request.data.size();
+        pending_bytes_ += request.data.size();
+        queued_bytes_ += request.data.size();
+        Queue(slot);
+        if (queued_bytes_ >= options_.batch_bytes) Enter(0);
+        Reap();
+    }
+
+    void Drain() override {
+        while (free_.size() < requests_.size()) {
+            Enter(1);
+            Reap();
+        }
+        ThrowIfFailed();
+    }
+
+    AsyncIoStats Stats() const override { return stats_; }
+
+private:
+    struct Request {
+        std::string data;
+        uint64_t offset = 0;
+        size_t done = 0;  // bytes written so far
+    };
+
+    void* Map(size_t size, uint64_t offset) const {
+        void* p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_,
+                         static_cast<off_t>(offset));
+        if (p == MAP_FAILED) throw std::runtime_error(ErrnoMessage("Cannot map the io_uring rings"));
+        return p;
+    }
+
+    void Release() {
+        if (sqes_ != nullptr) ::munmap(sqes_, sqes_size_);
+        if (cq_ring_ != nullptr && cq_ring_ != sq_ring_) ::munmap(cq_ring_, cq_size_);
+        if (sq_ring_ != nullptr) ::munmap(sq_ring_, sq_size_);
+        ::close(ring_);
+    }
+
+    // Adds the rest of a write to the submission queue; it goes to the kernel with the next Enter.
+    void Queue(unsigned slot) {
+        const Request& request = requests_[slot];
+        const unsigned tail = *sq_tail_;
+        const unsigned index = tail & sq_mask_;
+        io_uring_sqe& sqe = sqes_[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_WRITE;
+        sqe.fd = fd_;
+        sqe.addr = reinterpret_cast<uint64_t>(request.data.data() + request.done);
+        sqe.len = static_cast<uint32_t>(std::min<size_t>(request.data.size() - request.done, 1u << 30));
+        sqe.off = request.offset + request.done;
+        sqe.user_data = slot;
+        sq_array_[index] = index;
+        __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+    }
+
+    // Submits every queued write and waits until at least min_complete writes completed.
+    void Enter(unsigned min_complete) {
+        for (;;) {
+            const unsigned to_submit = *sq_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+            if (to_submit == 0 && min_complete == 0) return;
+            const unsigned flags = min_complete > 0 ? IORING_ENTER_GETEVENTS : 0;
+            if (::syscall(__NR_io_uring_enter, ring_, to_submit, min_complete, flags, nullptr, 0) < 0) {
+                if (errno == EINTR) continue;
+                throw std::runtime_error(ErrnoMessage("io_uring_enter"));
+            }
+            if (to_submit > 0) ++stats_.submissions;
+            queued_bytes_ = 0;
+            return;
+        }
+    }
+
+    void Reap() {
+        unsigned head = *cq_head_;
+        const unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head) {
+            const io_uring_cqe& cqe = cqes_[head & cq_mask_];
+            Complete(static_cast<unsigned>(cqe.user_data), cqe.res);
+        }
+        __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+    }
+
+    void Complete(unsigned slot, int result) {
+        Request& request = requests_[slot];
+        if (result == -EINTR || result == -EAGAIN) {
+            Queue(slot);
+            return;
+        }
+        if (result > 0) {
+            request.done += static_cast<size_t>(result);
+            if (request.done < request.data.size()) {  // short write: the rest goes again
+                Queue(slot);
+                return;
+            }
+        } else if (error_.empty()) {
+            error_ = "Cannot write " + path_ + ": " + (result < 0 ? std::strerror(-result) : "no progress");
+        }
+        pending_bytes_ -= request.data.size();
+        std::string().swap(request.data);
+        free_.push_back(slot);
+    }
+
+    void ThrowIfFailed() const {
+        if (!error_.empty()) throw std::runtime_error(error_);
+    }
+
+    int fd_;
+    std::string path_;
+    AsyncIoOptions options_;
+    int ring_ = -1;
+    void* sq_ring_ = nullptr;
+    void* cq_ring_ = nullptr;
+    io_uring_sqe* sqes_ = nullptr;
+    size_t sq_size_ = 0;
+    size_t cq_size_ = 0;
+    size_t sqes_size_ = 0;
+    unsigned* sq_head_ = nullptr;
+    unsigned* sq_tail_ = nullptr;
+    unsigned* sq_array_ = nullptr;
+    unsigned sq_mask_ = 0;
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned cq_mask_ = 0;
+    io_uring_cqe* cqes_ = nullptr;
+    std::vector<Request> requests_;
+    std::vector<unsigned> free_;  // slots of requests_ not in use
+    size_t pending_bytes_ = 0;    // queued or in flight
+    size_t queued_bytes_ = 0;     // queued since the last submission
+    std::string error_;
+    AsyncIoStats stats_;
+};
+#endif
+
+}  // namespace
+
+AsyncWriter::AsyncWriter(const std::string& path, uint64_t offset, bool truncate, const AsyncIoOptions& options)
+    : path_(path), offset_(offset) {
+    fd_ = ::open(path_.c_str(), O_WRONLY | O_CREAT | (truncate ? O_TRUNC : 0), 0644);
+    if (fd_ < 0) {
+        throw std::runtime_error(ErrnoMessage("Cannot open " + path_));
+    }
+    try {
+#ifdef HAVE_IO_URING
+        if (options.allow_io_uring) {
+            try {
+                engine_ = std::make_unique<UringEngine>(fd_, path_, options);
+                backend_ = AsyncIoBackend::kIoUring;
+            } catch (const std::runtime_error&) {  // not available here: the threads take over
+            }
+        }
+#endif
+        if (engine_ == nullptr) engine_ = std::make_unique<ThreadPoolEngine>(fd_, path_, options);
+    } catch (...) {
+        ::close(fd_);
+        throw;
+    }
+}
+
+AsyncWriter::~AsyncWriter() {
+    try {
+        Close();
+    } catch (const std::exception&) {
+    }
+}
+
+void AsyncWriter::Write(std::string data) {
+    if (engine_ == nullptr) {
+        throw std::runtime_error(path_ + " is closed");
+    }
+    if (data.empty()) return;
+    const size_t size = data.size();
+    engine_->Submit(std::move(data), offset_);
+    offset_ += size;
+}
+
+void AsyncWriter::Sync() {
+    if (engine_ == nullptr) {
+        throw std::runtime_error(path_ + " is closed");
+    }
+    engine_->Drain();
+    if (::fdatasync(fd_) != 0) {
+        throw std::runtime_error(ErrnoMessage("Cannot fdatasync " + path_));
+    }
+    ++stats_.syncs;
+}
+
+void AsyncWriter::Close() {
+    if (engine_ == nullptr) return;
+    std::exception_ptr error;
+    try {
+        engine_->Drain();
+    } catch (...) {
+        error = std::current_exception();
+    }
+    stats_ = Stats();
+    engine_.reset();
+    ::close(fd_);
+    fd_ = -1;
+    if (error) std::rethrow_exception(error);
+}
+
+AsyncIoStats AsyncWriter::Stats() const {
+    if (engine_ == nullptr) return stats_;
+    AsyncIoStats stats = engine_->Stats();
+    stats.syncs = stats_.syncs;
+    return stats;
+}
@@ -0,0 +1,33 @@
+#include "bitmap.hpp"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+
+void AndBitmaps(const std::vector<uint64_t>& a, const std::vector<uint64_t>& b, std::vector<uint64_t>& out) {
+    out.resize(a.size());
+    const size_t both = a.size() < b.size() ? a.size() : b.size();
+    size_t w = 0;
+#if defined(__SSE2__)
+    for (; w + 2 <= both; w += 2) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a.data() + w));
+        __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b.data() + w));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out.data() + w), _mm_and_si128(x, y));
+    }
+#endif
+    for (; w < both; ++w) {
+        out[w] = a[w] & b[w];
+    }
+    for (; w < a.size(); ++w) {
+        out[w] = a[w];
+    }
+}
+
+size_t CountBits(const std::vector<uint64_t>& bits) {
+    size_t count = 0;
+    for (uint64_t word : bits) {
+        count += static_cast<size_t>(__builtin_popcountll(word));
+    }
+    return count;
+}
@@ -0,0 +1,121 @@
+#include "bitpacking.hpp"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+
+unsigned BitWidth(uint64_t max_value) {
+    unsigned width = 0;
+    while (max_value != 0) {
+        ++width;
+        max_value >>= 1;
+    }
+    return width;
+}
+
+size_t PackedWords(size_t count, unsigned width) {
+    size_t per_lane = count / kPackLanes;
+    return kPackLanes * ((per_lane * width + 31) / 32);
+}
+
+static uint32_t Mask(unsigned width) {
+    return width >= 32 ? 0xFFFFFFFFu : (uint32_t{1} << width) - 1;
+}
+
+void PackBlock(const uint32_t* in, size_t count, unsigned width, uint32_t* out) {
+    if (width == 0) return;
+    size_t per_lane = count / kPackLanes;
+    for (size_t lane = 0; lane < kPackLanes; ++lane) {
+        unsigned bit = 0;
+        size_t word = 0;
+        for (size_t k = 0; k < per_lane; ++k) {
+            uint32_t v = in[kPackLanes * k + lane] & Mask(width);
+            out[kPackLanes * word + lane] |= v << bit;
+            if (bit + width > 32) {
+                out[kPackLanes * (word + 1) + lane] |= v >> (32 - bit);
+            }
+            bit += width;
+            if (bit >= 32) {
+                bit -= 32;
+                ++word;
+            }
+        }
+    }
+}
+
+uint32_t UnpackOne(const uint32_t* in, size_t index, unsigned width) {
+    if (width == 0) return 0;
+    size_t lane = index % kPackLanes;
+    size_t bit_pos = (index / kPackLanes) * width;
+    size_t word = bit_pos / 32;
+    unsigned bit = static_cast<unsigned>(bit_pos % 32);
+    uint32_t v = in[kPackLanes * word + lane] >> bit;
+    if (bit + width > 32) {
+        v |= in[kPackLanes * (word + 1) + lane] << (32 - bit);
+    }
+    return v & Mask(width);
+}
+
+#if defined(__SSE2__)
+
+// Four lanes at a time: each step shifts the current word of every lane right, pulls in the spill-over bits from the
+// next word when a value straddles two words, masks and stores four consecutive output values.
+void UnpackBlock(const uint32_t* in, size_t count, unsigned width, uint32_t* out) {
+    size_t per_lane = count / kPackLanes;
+    if (width == 0) {
+        for (size_t i = 0; i < count; ++i) out[i] = 0;
+        return;
+    }
+    const size_t words_per_lane = (per_lane * width + 31) / 32;
+    const __m128i* src = reinterpret_cast<const __m128i*>(in);
+    __m128i* dst = reinterpret_cast<__m128i*>(out);
+    const __m128i mask = _mm_set1_epi32(static_cast<int>(Mask(width)));
+    __m128i cur = _mm_loadu_si128(src);
+    unsigned bit = 0;
+    size_t word = 0;
+    for (size_t k = 0; k < per_lane; ++k) {
+        __m128i v = _mm_srl_epi32(cur, _mm_cvtsi32_si128(static_cast<int>(bit)));
+        bit += width;
+        if (bit >= 32) {
+            bit -= 32;
+            ++word;
+            if (word < words_per_lane) {
+                cur = _mm_loadu_si128(src + word);
+                if (bit > 0) {
+                    v = _mm_or_si128(v, _mm_sll_epi32(cur, _mm_cvtsi32_si128(static_cast<int>(width - bit))));
+                }
+            }
+        }
+        _mm_storeu_si128(dst + k, _mm_and_si128(v, mask));
+    }
+}
+
+#else
+
+void UnpackBlock(const uint32_t* in, size_t count, unsigned width, uint32_t* out) {
+    size_t per_lane = count / kPackLanes;
+    if (width == 0) {
+        for (size_t i = 0; i < count; ++i) out[i] = 0;
+        return;
+    }
+    const uint32_t mask = Mask(width);
+    for (size_t lane = 0; lane < kPackLanes; ++lane) {
+        unsigned bit = 0;
+        size_t word = 0;
+        for (size_t k = 0; k < per_lane; ++k) {
+            uint32_t v = in[kPackLanes * word + lane] >> bit;
+            if (bit + width > 32) {
+                v |= in[kPackLanes * (word + 1) + lane] << (32 - bit);
+            }
+            out[kPackLanes * k + lane] = v & mask;
+            bit += width;
+            if (bit >= 32) {
+                bit -= 32;
+                ++word;
+            }
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,259 @@
+#include "buffer_pool.hpp"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+static std::string ErrnoMessage(const std::string& what) {
+    return what + ": " + std::strerror(errno);
+}
+
+static void ReadPages(int fd, char* out, uint32_t first, size_t count, const std::string& path) {
+    const size_t size = count * BufferPool::kPageSize;
+    const uint64_t offset = static_cast<uint64_t>(first) * BufferPool::kPageSize;
+    size_t done = 0;
+    while (done < size) {
+        ssize_t n = ::pread(fd, out + done, size - done, static_cast<off_t>(offset + done));
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) throw std::runtime_error(ErrnoMessage("Cannot read " + path));
+        if (n == 0) throw std::runtime_error("Page " + std::to_string(first) + " is past the end of " + path);
+        done += static_cast<size_t>(n);
+    }
+}
+
+
+PageGuard::PageGuard(PageGuard&& rhs) noexcept: pool_(rhs.pool_), frame_(rhs.frame_) {
+    rhs.pool_ = nullptr;
+}
+
+PageGuard& PageGuard::operator=(PageGuard&& rhs) noexcept {
+    if (this != &rhs) {
+        Release();
+        pool_ = rhs.pool_;
+        frame_ = rhs.frame_;
+        rhs.pool_ = nullptr;
+    }
+    return *this;
+}
+
+uint32_t PageGuard::PageNo() const {
+    return pool_->frames_[frame_].page;
+}
+
+const char* PageGuard::Data() const {
+    return pool_->FrameData(frame_);
+}
+
+char* PageGuard::MutableData() {
+    pool_->frames_[frame_].dirty = true;
+    return pool_->FrameData(frame_);
+}
+
+void PageGuard::Release() {
+    if (pool_ == nullptr) return;
+    pool_->Unpin(frame_);
+    pool_ = nullptr;
+}
+
+
+BufferPool::BufferPool(const std::string& path, const BufferPoolOptions& options)
+    : path_(path), options_(options) {
+    if (options_.frames == 0) {
+        throw std::invalid_argument("A buffer pool needs at least one frame");
+    }
+    options_.scan_frames = std::min(options_.scan_frames, options_.frames / 2);
+    options_.prefetch_pages = std::max<size_t>(1, std::min(options_.prefetch_pages, options_.scan_frames / 2));
+    fd_ = ::open(path_.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd_ < 0) {
+        throw std::runtime_error(ErrnoMessage("Cannot open " + path_));
+    }
+    struct stat st;
+    if (::fstat(fd_, &st) != 0) {
+        ::close(fd_);
+        throw std::runtime_error(ErrnoMessage("Cannot stat " + path_));
+    }
+    if (st.st_size % kPageSize != 0) {
+        ::close(fd_);
+        throw std::runtime_error(path_ + " is not a whole number of pages");
+    }
+    page_count_ = static_cast<uint32_t>(st.st_size / kPageSize);
+    memory_.resize(options_.frames * kPageSize);
+    frames_.resize(options_.frames);
+}
+
+BufferPool::~BufferPool() {
+    try {
+        Flush();
+    } catch (const std::exception&) {  // nothing to report it to; the pages are lost like on a crash
+    }
+    ::close(fd_);
+}
+
+PageGuard BufferPool::Fetch(uint32_t page, AccessHint hint) {
+    if (page >= page_count_) {
+        throw std::out_of_range("Page " + std::to_string(page) + " does not exist in " + path_);
+    }
+    auto found = page_table_.find(page);
+    if (found != page_table_.end()) {
+        ++stats_.hits;
+        Frame& frame = frames_[found->second];
+        if (hint == AccessHint::kRandom) {
+            frame.referenced = true;
+            if (frame.scan) {
+                ring_.erase(std::find(ring_.begin(), ring_.end(), found->second));
+                frame.scan = false;
+            }
+        }
+        ++frame.pins;
+        return PageGuard(this, found->second);
+    }
+    ++stats_.misses;
+    if (hint == AccessHint::kScan && options_.prefetch_pages > 1) {
+        Prefetch(page);
+        const size_t frame = page_table_.at(page);
+        ++frames_[frame].pins;
+        return PageGuard(this, frame);
+    }
+    const size_t frame = Victim(hint);
+    ReadPages(fd_, FrameData(frame), page, 1, path_);
+    ++stats_.reads;
+    frames_[frame] = Frame{page, true, hint == AccessHint::kRandom, false, hint == AccessHint::kScan, 1};
+    if (hint == AccessHint::kScan) ring_.push_back(frame);
+    page_table_[page] = frame;
+    return PageGuard(this, frame);
+}
+
+PageGuard BufferPool::NewPage() {
+    const size_t frame = Victim(AccessHint::kRandom);
+    const uint32_t page = page_count_++;
+    std::memset(FrameData(frame), 0, kPageSize);
+    frames_[frame] = Frame{page, true, true, true, false, 1};
+    page_table_[page] = frame;
+    return PageGuard(this, frame);
+}
+
+// Pages are written in page order, so a flush after a bulk load is one sequential pass over the file.
+void BufferPool::Flush() {
+    std::vector<std::pair<uint32_t, size_t>> dirty;
+    for (size_t i = 0; i < frames_.size(); ++i) {
+        if (frames_[i].used && frames_[i].dirty) dirty.emplace_back(frames_[i].page, i);
+    }
+    std::sort(dirty.begin(), dirty.end());
+    for (const auto& [page, frame] : dirty) {
+        WriteBack(frame);
+    }
+    if (options_.sync && !dirty.empty() && ::fdatasync(fd_) != 0) {
+        throw std::runtime_error(ErrnoMessage("Cannot fdatasync " + path_));
+    }
+}
+
+BufferPoolStats BufferPool::Stats() const {
+    BufferPoolStats stats = stats_;
+    stats.frames = frames_.size();
+    for (const Frame& frame : frames_) {
+        stats.cached += frame.used;
+        stats.pinned += frame.pins > 0;
+        stats.dirty += frame.used && frame.dirty;
+    }
+    return stats;
+}
+
+/* Scans recycle the oldest unpinned frame of their ring once it is full. Everything else runs the CLOCK hand for at
+most two turns, and so does a scan whose ring is still filling up: it takes a frame outside the ring so that the ring
+grows, and falls back on its ring when it cannot. The victim leaves the ring before a dirty page is written back,
+so if that write throws the frame stays cached as an ordinary frame. */
+size_t BufferPool::Victim(AccessHint hint) {
+    size_t victim = frames_.size();
+    auto recycle = [this, &victim] {
+        for (size_t i = 0; i < ring_.size() && victim == frames_.size(); ++i) {
+            const size_t frame = ring_.front();
+            ring_.pop_front();
+            if (frames_[frame].pins == 0) {
+                frames_[frame].scan = false;
+                victim = frame;
+            } else {
+                ring_.push_back(frame);
+            }
+        }
+    };
+    const bool grow = hint == AccessHint::kScan && ring_.size() < options_.scan_frames;
+    if (hint == AccessHint::kScan && !grow) recycle();
+    for (size_t step = 0; victim == frames_.size() && step < 2 * frames_.size(); ++step) {
+        const size_t frame = hand_;
+        hand_ = (hand_ + 1) % frames_.size();
+        Frame& candidate = frames_[frame];
+        if (!candidate.used) return frame;
+        if (candidate.pins > 0 || (candidate.scan && grow)) continue;
+        if (candidate.referenced) {
+            candidate.referenced = false;
+            continue;
+        }
+        if (candidate.scan) {
+            ring_.erase(std::find(ring_.begin(), ring_.end(), frame));
+            candidate.scan = false;
+        }
+        victim = frame;
+    }
+    if (hint == AccessHint::kScan && victim == frames_.size()) recycle();
+    if (victim == frames_.size()) {
+        throw std::runtime_error("Every frame of the buffer pool " + path_ + " is pinned");
+    }
+    if (frames_[victim].dirty) WriteBack(victim);
+    page_table_.erase(frames_[victim].page);
+    frames_[victim] = Frame();
+    ++stats_.evictions;
+    return victim;
+}
+
+/* One read of page and the uncached pages right after it; the pages go into the scan ring unpinned. Read-ahead stops
+early instead of failing when the frames run out. */
+void BufferPool::Prefetch(uint32_t page) {
+    size_t count = 1;
+    while (count < options_.prefetch_pages && page + count < page_count_ && !IsCached(page + count)) {
+        ++count;
+    }
+    std::vector<char> pages(count * kPageSize);
+    ReadPages(fd_, pages.data(), page, count, path_);
+    stats_.reads += count;
+    std::vector<size_t> installed;
+    try {
+        for (size_t i = 0; i < count; ++i) {
+            const size_t frame = Victim(AccessHint::kScan);
+            std::memcpy(FrameData(frame), &pages[i * kPageSize], kPageSize);
+            frames_[frame] = Frame{static_cast<uint32_t>(page + i), true, false, false, true, 1};  // pinned for now
+            ring_.push_back(frame);
+            page_table_[page + static_cast<uint32_t>(i)] = frame;
+            installed.push_back(frame);
+            if (i > 0) ++stats_.prefetched;
+        }
+    } catch (const std::runtime_error&) {
+        if (installed.empty()) throw;
+    }
+    for (size_t frame : installed) {
+        Unpin(frame);
+    }
+}
+
+void BufferPool::WriteBack(size_t frame) {
+    const char* data = FrameData(frame);
+    uint64_t offset = static_cast<uint64_t>(frames_[frame].page) * kPageSize;
+    size_t left = kPageSize;
+    while (left > 0) {
+        ssize_t n = ::pwrite(fd_, data, left, static_cast<off_t>(offset));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error(ErrnoMessage("Cannot write " + path_));
+        }
+        data += n;
+        left -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+    frames_[frame].dirty = false;
+    ++stats_.writes;
+}
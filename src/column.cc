@@ -0,0 +1,83 @@
+#include "column.hpp"
+
+#include <stdexcept>
+
+#include "compact_string_column.hpp"
+#include "compressed_int_column.hpp"
+#include "dictionary_column.hpp"
+#include "fixed_width_column.hpp"
+#include "run_length_column.hpp"
+
+
+const char* CompareOpSymbol(CompareOp op) {
+    switch (op) {
+    case CompareOp::kEq: return "=";
+    case CompareOp::kNe: return "!=";
+    case CompareOp::kLt: return "<";
+    case CompareOp::kLe: return "<=";
+    case CompareOp::kGt: return ">";
+    case CompareOp::kGe: return ">=";
+    }
+    return "";
+}
+
+const char* AggregateFnName(AggregateFn fn) {
+    switch (fn) {
+    case AggregateFn::kCount: return "count";
+    case AggregateFn::kSum: return "sum";
+    case AggregateFn::kMin: return "min";
+    case AggregateFn::kMax: return "max";
+    case AggregateFn::kAvg: return "avg";
+    }
+    return "";
+}
+
+AggregateState Column::Aggregate(const std::vector<uint64_t>&) const {
+    throw std::invalid_argument("Column is not numeric");
+}
+
+double Column::GetNumber(size_t) const {
+    throw std::invalid_argument("Column is not numeric");
+}
+
+int64_t Column::GetInteger(size_t) const {
+    throw std::invalid_argument("Column is not fixed-width");
+}
+
+size_t Column::CountMatches(CompareOp op, const std::string& constant, const std::vector<uint64_t>& live,
+                            const PositionRanges& ranges) const {
+    std::vector<unsigned int> ids;
+    Filter(op, constant, live, ranges, ids);
+    return ids.size();
+}
+
+
+Column* NewColumn(DataType type, Encoding encoding, unsigned int base_id) {
+    switch (encoding) {
+    case Encoding::kPlain:
+        if (type == DataType::kBool) return new BoolColumn(base_id);
+        if (IsInt64Type(type)) return new Int64Column(type, base_id);
+        return nullptr;
+    case Encoding::kDictionary:
+        if (type != DataType::kString) {
+            throw std::invalid_argument("Dictionary encoding needs a string column");
+        }
+        return new DictionaryColumn(base_id);
+    case Encoding::kCompressed:
+        if (type != DataType::kInt) {
+            throw std::invalid_argument("Compressed encoding needs an int column");
+        }
+        return new CompressedIntColumn(base_id);
+    case Encoding::kRunLength:
+        if (type == DataType::kString) return new RunLengthColumn<std::string>(type, base_id);
+        if (type == DataType::kDouble) return new RunLengthColumn<double>(type, base_id);
+        if (type == DataType::kInt) return new RunLengthColumn<int32_t>(type, base_id);
+        throw std::invalid_argument("Run-length encoding needs a string, double or int column");
+    case Encoding::kCompact:
+        if (type != DataType::kString) {
+            throw std::invalid_argument("Compact encoding needs a string column");
+        }
+        return new CompactStringColumn(base_id);
+    }
+    throw std::invalid_argument("Unknown column encoding");
+}
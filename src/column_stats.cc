@@ -0,0 +1,262 @@
+#include "column_stats.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+
+// splitmix64 finalizer: spreads every input bit over the whole word, which the register index and rank rely on.
+static uint64_t Mix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+uint64_t HyperLogLog::Hash(double value) {
+    if (value == 0) value = 0;  // -0.0 and 0.0 are the same value
+    uint64_t bits = 0;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return Mix(bits);
+}
+
+uint64_t HyperLogLog::Hash(const std::string& value) {
+    return Mix(std::hash<std::string>()(value));
+}
+
+// The top kPrecision bits pick a register, which keeps the longest run of leading zeros seen in the remaining bits.
+void HyperLogLog::Add(uint64_t hash) {
+    const size_t index = static_cast<size_t>(hash >> (64 - kPrecision));
+    const uint64_t rest = (hash << kPrecision) | (uint64_t{1} << (kPrecision - 1));
+    const uint8_t rank = static_cast<uint8_t>(__builtin_clzll(rest) + 1);
+    if (rank > registers_[index]) registers_[index] = rank;
+}
+
+// Harmonic mean of the registers, with linear counting while many registers are still empty.
+double HyperLogLog::Estimate() const {
+    const double m = static_cast<double>(registers_.size());
+    double sum = 0;
+    size_t zeros = 0;
+    for (uint8_t reg : registers_) {
+        sum += std::ldexp(1.0, -static_cast<int>(reg));
+        if (reg == 0) ++zeros;
+    }
+    const double estimate = 0.7213 / (1 + 1.079 / m) * m * m / sum;
+    if (estimate <= 2.5 * m && zeros > 0) {
+        return m * std::log(m / static_cast<double>(zeros));
+    }
+    return estimate;
+}
+
+void HyperLogLog::Merge(const HyperLogLog& other) {
+    for (size_t i = 0; i < registers_.size(); ++i) {
+        registers_[i] = std::max(registers_[i], other.registers_[i]);
+    }
+}
+
+// Part of [lo, hi] below value: linear for numbers, half for strings (no notion of distance).
+static double Interpolate(double lo, double hi, double value) {
+    if (!(hi > lo)) return 0.5;
+    return std::clamp((value - lo) / (hi - lo), 0.0, 1.0);
+}
+
+static double Interpolate(const std::string&, const std::string&, const std::string&) {
+    return 0.5;
+}
+
+static Footprint HeapOf(const double&) { return Footprint(); }
+static Footprint HeapOf(const std::string& value) { return StringHeap(value); }
+
+template <typename T>
+void ValueStats<T>::Add(const T& value) {
+    if (count_ == 0 || value < min_) min_ = value;
+    if (count_ == 0 || max_ < value) max_ = value;
+    ++count_;
+    if (upper_.empty()) return;
+    size_t bucket = BucketOf(value);
+    if (bucket == upper_.size()) {  // past the last bound: the last bucket grows
+        bucket = upper_.size() - 1;
+        upper_.back() = value;
+    }
+    if (value < hist_min_) hist_min_ = value;
+    ++counts_[bucket];
+    ++hist_total_;
+    for (auto& [common, count] : most_common_) {
+        if (common == value) {
+            ++count;
+            break;
+        }
+    }
+}
+
+/* Cuts the sorted values into kHistogramBuckets runs of about the same length, never splitting equal values over two
+buckets, and keeps the values that occur more often than the average value as most common values. */
+template <typename T>
+void ValueStats<T>::Build(std::vector<T>& values) {
+    *this = ValueStats<T>();
+    if (values.empty()) return;
+    std::sort(values.begin(), values.end());
+    const size_t n = values.size();
+    count_ = n;
+    hist_total_ = n;
+    min_ = hist_min_ = values.front();
+    max_ = values.back();
+
+    std::vector<std::pair<T, uint64_t>> runs;
+    for (size_t i = 0; i < n;) {
+        size_t j = i + 1;
+        while (j < n && values[j] == values[i]) ++j;
+        runs.emplace_back(values[i], j - i);
+        i = j;
+    }
+    const double average = static_cast<double>(n) / static_cast<double>(runs.size());
+    const size_t keep = std::min(kMostCommon, runs.size());
+    std::partial_sort(runs.begin(), runs.begin() + static_cast<std::ptrdiff_t>(keep), runs.end(),
+                      [](const auto& a, const auto& b) { return a.second > b.second; });
+    for (size_t i = 0; i < keep && runs[i].second > 1 && static_cast<double>(runs[i].second) > average; ++i) {
+        most_common_.push_back(runs[i]);
+    }
+
+    const size_t buckets = std::min(kHistogramBuckets, n);
+    size_t start = 0;
+    for (size_t k = 0; k < buckets && start < n; ++k) {
+        size_t end = std::max(start, (k + 1) * n / buckets - 1);
+        while (end + 1 < n && values[end + 1] == values[end]) ++end;
+        uint64_t distinct = 1;
+        for (size_t i = start + 1; i <= end; ++i) {
+            if (!(values[i] == values[i - 1])) ++distinct;
+        }
+        upper_.push_back(values[end]);
+        counts_.push_back(end - start + 1);
+        distinct_.push_back(distinct);
+        start = end + 1;
+    }
+}
+
+template <typename T>
+size_t ValueStats<T>::BucketOf(const T& value) const {
+    return static_cast<size_t>(std::lower_bound(upper_.begin(), upper_.end(), value) - upper_.begin());
+}
+
+template <typename T>
+double ValueStats<T>::InsideBucket(size_t bucket, const T& value) const {
+    return Interpolate(bucket == 0 ? hist_min_ : upper_[bucket - 1], upper_[bucket], value);
+}
+
+template <typename T>
+double ValueStats<T>::Equal(const T& value, double distinct) const {
+    if (count_ == 0 || value < min_ || max_ < value) return 0;
+    if (!Built()) return distinct >= 1 ? 1 / distinct : 1;
+    for (const auto& [common, count] : most_common_) {
+        if (common == value) return static_cast<double>(count) / static_cast<double>(hist_total_);
+    }
+    const size_t bucket = std::min(BucketOf(value), upper_.size() - 1);
+    return static_cast<double>(counts_[bucket]) / static_cast<double>(distinct_[bucket]) /
+           static_cast<double>(hist_total_);
+}
+
+template <typename T>
+double ValueStats<T>::Less(const T& value) const {
+    if (count_ == 0 || !(min_ < value)) return 0;
+    if (max_ < value) return 1;
+    if (!Built()) return Interpolate(min_, max_, value);
+    const size_t bucket = std::min(BucketOf(value), upper_.size() - 1);
+    uint64_t below = 0;
+    for (size_t b = 0; b < bucket; ++b) {
+        below += counts_[b];
+    }
+    const double inside = static_cast<double>(counts_[bucket]) * InsideBucket(bucket, value);
+    return (static_cast<double>(below) + inside) / static_cast<double>(hist_total_);
+}
+
+template <typename T>
+Footprint ValueStats<T>::Memory() const {
+    Footprint footprint = VectorBuffer(upper_);
+    footprint += VectorBuffer(counts_);
+    footprint += VectorBuffer(distinct_);
+    footprint += VectorBuffer(most_common_);
+    for (const T& bound : upper_) {
+        footprint += HeapOf(bound);
+    }
+    for (const auto& common : most_common_) {
+        footprint += HeapOf(common.first);
+    }
+    footprint += HeapOf(min_);
+    footprint += HeapOf(max_);
+    footprint += HeapOf(hist_min_);
+    return footprint;
+}
+
+template class ValueStats<double>;
+template class ValueStats<std::string>;
+
+void ColumnStats::AddNumber(double value) {
+    sketch_.Add(HyperLogLog::Hash(value));
+    if (collecting_) {
+        if (value == value) collected_numbers_.push_back(value);
+        return;
+    }
+    ++modified_;
+    if (value == value) numbers_.Add(value);  // NaN cannot be ordered
+}
+
+void ColumnStats::AddString(const std::string& value) {
+    sketch_.Add(HyperLogLog::Hash(value));
+    if (collecting_) {
+        collected_strings_.push_back(value);
+        return;
+    }
+    ++modified_;
+    strings_.Add(value);
+}
+
+void ColumnStats::BeginAnalyze() {
+    sketch_.Clear();
+    numbers_ = ValueStats<double>();
+    strings_ = ValueStats<std::string>();
+    collected_numbers_.clear();
+    collected_strings_.clear();
+    collecting_ = true;
+}
+
+void ColumnStats::FinishAnalyze() {
+    numbers_.Build(collected_numbers_);
+    strings_.Build(collected_strings_);
+    std::vector<double>().swap(collected_numbers_);
+    std::vector<std::string>().swap(collected_strings_);
+    collecting_ = false;
+    analyzed_ = true;
+    modified_ = 0;
+}
+
+template <typename T>
+static double Select(const ValueStats<T>& values, double distinct, CompareOp op, const T& constant) {
+    const double equal = values.Equal(constant, distinct);
+    const double less = values.Less(constant);
+    double selectivity = 0;
+    switch (op) {
+    case CompareOp::kEq: selectivity = equal; break;
+    case CompareOp::kNe: selectivity = values.Empty() ? 0 : 1 - equal; break;
+    case CompareOp::kLt: selectivity = less; break;
+    case CompareOp::kLe: selectivity = less + equal; break;
+    case CompareOp::kGt: selectivity = values.Empty() ? 0 : 1 - less - equal; break;
+    case CompareOp::kGe: selectivity = values.Empty() ? 0 : 1 - less; break;
+    }
+    return std::clamp(selectivity, 0.0, 1.0);
+}
+
+double ColumnStats::Selectivity(CompareOp op, double constant) const {
+    return Select(numbers_, DistinctCount(), op, constant);
+}
+
+double ColumnStats::Selectivity(CompareOp op, const std::string& constant) const {
+    return Select(strings_, DistinctCount(), op, constant);
+}
+
+Footprint ColumnStats::Memory() const {
+    Footprint footprint = sketch_.Memory();
+    footprint += numbers_.Memory();
+    footprint += strings_.Memory();
+    return footprint;
+}
@@ -0,0 +1,105 @@
+#include "compact_string_column.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+
+
+// Inline strings keep all their bytes in prefix + rest, which are contiguous (bytes 4..15 of the header).
+StringHeader CompactStringColumn::MakeHeader(std::string_view text) {
+    StringHeader header;
+    header.length = static_cast<uint32_t>(text.size());
+    if (text.size() <= kInlineLength) {
+        std::memcpy(reinterpret_cast<char*>(&header) + offsetof(StringHeader, prefix), text.data(), text.size());
+    } else {
+        std::memcpy(header.prefix, text.data(), sizeof(header.prefix));
+    }
+    return header;
+}
+
+const char* CompactStringColumn::Data(const StringHeader& header) const {
+    if (IsInline(header)) {
+        return reinterpret_cast<const char*>(&header) + offsetof(StringHeader, prefix);
+    }
+    return heap_.data() + header.offset;
+}
+
+void CompactStringColumn::AppendValue(std::string_view text) {
+    if (text.size() > UINT32_MAX) {
+        throw std::length_error("String too long");
+    }
+    StringHeader header = MakeHeader(text);
+    if (!IsInline(header)) {
+        header.offset = heap_.size();
+        heap_.insert(heap_.end(), text.begin(), text.end());
+    }
+    headers_.push_back(header);
+}
+
+// The last long string is also the last thing in the heap, so undoing it just shrinks the heap.
+void CompactStringColumn::PopBack() {
+    const StringHeader& header = headers_.back();
+    if (!IsInline(header)) {
+        heap_.resize(header.offset);
+    }
+    headers_.pop_back();
+}
+
+std::string_view CompactStringColumn::View(size_t pos) const {
+    const StringHeader& header = headers_[pos];
+    return std::string_view(Data(header), header.length);
+}
+
+void CompactStringColumn::SerializeValue(size_t pos, BinaryWriter& out) const {
+    const std::string_view text = View(pos);
+    out.PutU32(static_cast<uint32_t>(text.size()));
+    out.PutBytes(text.data(), text.size());
+}
+
+int CompactStringColumn::CompareTo(const StringHeader& header, const StringHeader& constant,
+                                   std::string_view constant_text) const {
+    const size_t common = std::min<size_t>(header.length, constant.length);
+    int result = std::memcmp(header.prefix, constant.prefix, std::min<size_t>(common, sizeof(header.prefix)));
+    if (result != 0) return result;
+    if (common > sizeof(header.prefix)) {
+        result = std::memcmp(Data(header) + sizeof(header.prefix), constant_text.data() + sizeof(header.prefix),
+                             common - sizeof(header.prefix));
+        if (result != 0) return result;
+    }
+    return header.length < constant.length ? -1 : (header.length > constant.length ? 1 : 0);
+}
+
+/* Equality compares length + prefix as one 8-byte block first; only strings that agree on both are compared further
+(inline strings by their remaining 8 bytes, which are zero padded, long strings in the heap). */
+void CompactStringColumn::Filter(CompareOp op, const std::string& constant, const std::vector<uint64_t>& live,
+                                 const PositionRanges& ranges, std::vector<unsigned int>& out) const {
+    const StringHeader key = MakeHeader(constant);
+    for (const auto& [begin, end] : ranges) {
+        for (size_t pos = begin; pos < end; ++pos) {
+            const StringHeader& header = headers_[pos];
+            bool match;
+            if (op == CompareOp::kEq || op == CompareOp::kNe) {
+                bool equal = std::memcmp(&header, &key, 8) == 0;
+                if (equal) {
+                    equal = IsInline(header) ? std::memcmp(header.rest, key.rest, sizeof(key.rest)) == 0
+                                             : std::memcmp(Data(header), constant.data(), header.length) == 0;
+                }
+                match = equal == (op == CompareOp::kEq);
+            } else {
+                match = Compare(CompareTo(header, key, constant), op, 0);
+            }
+            const unsigned int id = base_id_ + static_cast<unsigned int>(pos);
+            if (match && IsLive(live, id)) out.push_back(id);
+        }
+    }
+}
+
+void CompactStringColumn::GroupByCount(const std::vector<uint64_t>& live, std::map<std::string, size_t>& out) const {
+    std::map<std::string_view, size_t> counts;
+    for (size_t pos = 0; pos < headers_.size(); ++pos) {
+        if (IsLive(live, base_id_ + static_cast<unsigned int>(pos))) ++counts[View(pos)];
+    }
+    for (const auto& [value, count] : counts) {
+        out[std::string(value)] += count;
+    }
+}
@@ -0,0 +1,244 @@
+#include "compressed_int_column.hpp"
+
+#include <atomic>
+#include <unordered_map>
+
+#include "bitpacking.hpp"
+
+
+static std::atomic<uint64_t> next_serial{1};
+
+/* Random access into a delta block needs the prefix sum of everything before it, so GetValue decodes the whole
+block once into a per-thread cache. Row-by-row readers (GetRows, operator<<, checkpoints) walk ids in order and hit
+the cache 1023 times out of 1024; sealed blocks never change, so the cache only has to know which column/block it
+holds. */
+struct DecodeCache {
+    uint64_t serial = 0;
+    size_t block = 0;
+    int32_t values[CompressedIntColumn::kBlockSize];
+};
+static thread_local DecodeCache decode_cache;
+
+
+CompressedIntColumn::CompressedIntColumn(unsigned int base_id):
+    Column(DataType::kInt, base_id),
+    serial_(next_serial++) {
+    tail_.reserve(kBlockSize);
+}
+
+// Sealed blocks are copied wholesale; the copy gets its own identity in the decode cache.
+CompressedIntColumn::CompressedIntColumn(const CompressedIntColumn& rhs):
+    Column(rhs),
+    blocks_(rhs.blocks_),
+    tail_(rhs.tail_),
+    serial_(next_serial++) {
+}
+
+void CompressedIntColumn::AppendValue(int32_t value) {
+    if (tail_.size() == kBlockSize) {
+        Seal();
+    }
+    tail_.push_back(value);
+}
+
+// Picks the narrowest of bit-pack / frame-of-reference / delta for the full tail and packs it.
+void CompressedIntColumn::Seal() {
+    int32_t lo = tail_[0];
+    int32_t hi = tail_[0];
+    int64_t dlo = 0;
+    int64_t dhi = 0;
+    for (size_t i = 0; i < tail_.size(); ++i) {
+        if (tail_[i] < lo) lo = tail_[i];
+        if (tail_[i] > hi) hi = tail_[i];
+        if (i > 0) {
+            int64_t d = static_cast<int64_t>(tail_[i]) - tail_[i - 1];
+            if (i == 1 || d < dlo) dlo = d;
+            if (i == 1 || d > dhi) dhi = d;
+        }
+    }
+    unsigned bitpack_width = lo >= 0 ? BitWidth(static_cast<uint64_t>(hi)) : 64;
+    unsigned for_width = BitWidth(static_cast<uint64_t>(static_cast<int64_t>(hi) - lo));
+    unsigned delta_width = BitWidth(static_cast<uint64_t>(dhi - dlo));
+
+    Block block;
+    block.min = lo;
+    block.max = hi;
+    std::vector<uint32_t> packed(kBlockSize);
+    if (bitpack_width <= for_width && bitpack_width <= delta_width) {
+        block.encoding = BlockEncoding::kBitPack;
+        block.width = static_cast<uint8_t>(bitpack_width);
+        for (size_t i = 0; i < kBlockSize; ++i) packed[i] = static_cast<uint32_t>(tail_[i]);
+    } else if (for_width <= delta_width) {
+        block.encoding = BlockEncoding::kFor;
+        block.width = static_cast<uint8_t>(for_width);
+        block.base = lo;
+        for (size_t i = 0; i < kBlockSize; ++i) {
+            packed[i] = static_cast<uint32_t>(static_cast<int64_t>(tail_[i]) - lo);
+        }
+    } else {
+        block.encoding = BlockEncoding::kDelta;
+        block.width = static_cast<uint8_t>(delta_width);
+        block.base = tail_[0];
+        block.delta_min = dlo;
+        packed[0] = 0;
+        for (size_t i = 1; i < kBlockSize; ++i) {
+            packed[i] = static_cast<uint32_t>(static_cast<int64_t>(tail_[i]) - tail_[i - 1] - dlo);
+        }
+    }
+    block.words.assign(PackedWords(kBlockSize, block.width), 0);
+    PackBlock(packed.data(), kBlockSize, block.width, block.words.data());
+    blocks_.push_back(std::move(block));
+    tail_.clear();
+}
+
+void CompressedIntColumn::DecodeBlock(size_t block, int32_t* out) const {
+    if (block == blocks_.size()) {
+        for (size_t i = 0; i < tail_.size(); ++i) out[i] = tail_[i];
+        return;
+    }
+    const Block& b = blocks_[block];
+    uint32_t raw[kBlockSize];
+    UnpackBlock(b.words.data(), kBlockSize, b.width, raw);
+    if (b.encoding == BlockEncoding::kBitPack) {
+        for (size_t i = 0; i < kBlockSize; ++i) out[i] = static_cast<int32_t>(raw[i]);
+    } else if (b.encoding == BlockEncoding::kFor) {
+        const uint32_t base = static_cast<uint32_t>(b.base);
+        for (size_t i = 0; i < kBlockSize; ++i) out[i] = static_cast<int32_t>(base + raw[i]);  // wraps mod 2^32
+    } else {
+        int64_t v = b.base;
+        out[0] = b.base;
+        for (size_t i = 1; i < kBlockSize; ++i) {
+            v += b.delta_min + raw[i];
+            out[i] = static_cast<int32_t>(v);
+        }
+    }
+}
+
+int32_t CompressedIntColumn::GetValue(size_t pos) const {
+    size_t block = pos / kBlockSize;
+    size_t offset = pos % kBlockSize;
+    if (block == blocks_.size()) {
+        return tail_[offset];
+    }
+    const Block& b = blocks_[block];
+    if (b.encoding == BlockEncoding::kBitPack) {
+        return static_cast<int32_t>(UnpackOne(b.words.data(), offset, b.width));
+    }
+    if (b.encoding == BlockEncoding::kFor) {
+        return static_cast<int32_t>(static_cast<uint32_t>(b.base) + UnpackOne(b.words.data(), offset, b.width));
+    }
+    if (decode_cache.serial != serial_ || decode_cache.block != block) {
+        DecodeBlock(block, decode_cache.values);
+        decode_cache.serial = serial_;
+        decode_cache.block = block;
+    }
+    return decode_cache.values[offset];
+}
+
+void CompressedIntColumn::BlockRange(size_t block, int32_t& lo, int32_t& hi) const {
+    if (block < blocks_.size()) {
+        lo = blocks_[block].min;
+        hi = blocks_[block].max;
+        return;
+    }
+    lo = hi = tail_.empty() ? 0 : tail_[0];
+    for (int32_t v : tail_) {
+        if (v < lo) lo = v;
+        if (v > hi) hi = v;
+    }
+}
+
+/* Blocks whose [min, max] cannot match are skipped and blocks that match entirely are taken without decoding. A block
+that straddles the edge of a range is only scanned over the positions inside it. */
+void CompressedIntColumn::Filter(CompareOp op, const std::string& constant, const std::vector<uint64_t>& live,
+                                 const PositionRanges& ranges, std::vector<unsigned int>& out) const {
+    const int64_t c = std::stoll(constant);
+    int32_t values[kBlockSize];
+    for (const auto& [begin, end] : ranges) {
+        for (size_t block = begin / kBlockSize; block * kBlockSize < end; ++block) {
+            const size_t block_start = block * kBlockSize;
+            const unsigned int first_id = base_id_ + static_cast<unsigned int>(block_start);
+            const size_t from = begin > block_start ? begin - block_start : 0;
+            const size_t to = end < block_start + BlockLength(block) ? end - block_start : BlockLength(block);
+            int32_t lo = 0;
+            int32_t hi = 0;
+            BlockRange(block, lo, hi);
+            if (!RangeMayMatch<int64_t>(lo, hi, op, c)) continue;
+            if (RangeAllMatch<int64_t>(lo, hi, op, c)) {
+                for (size_t i = from; i < to; ++i) {
+                    if (IsLive(live, first_id + static_cast<unsigned int>(i))) out.push_back(first_id + static_cast<unsigned int>(i));
+                }
+                continue;
+            }
+            DecodeBlock(block, values);
+            for (size_t i = from; i < to; ++i) {
+                unsigned int id = first_id + static_cast<unsigned int>(i);
+                if (Compare<int64_t>(values[i], op, c) && IsLive(live, id)) out.push_back(id);
+            }
+        }
+    }
+}
+
+void CompressedIntColumn::GroupByCount(const std::vector<uint64_t>& live, std::map<std::string, size_t>& out) const {
+    std::unordered_map<int32_t, size_t> counts;
+    int32_t values[kBlockSize];
+    for (size_t block = 0; block < BlockCount(); ++block) {
+        const unsigned int first_id = base_id_ + static_cast<unsigned int>(block * kBlockSize);
+        DecodeBlock(block, values);
+        for (size_t i = 0; i < BlockLength(block); ++i) {
+            if (IsLive(live, first_id + static_cast<unsigned int>(i))) ++counts[values[i]];
+        }
+    }
+    for (const auto& [value, count] : counts) {
+        out[std::to_string(value)] += count;
+    }
+}
+
+// Fully live blocks are summed in a branch-free loop over the decoded batch; others check the live bit per row.
+AggregateState CompressedIntColumn::Aggregate(const std::vector<uint64_t>& live) const {
+    AggregateState state;
+    int32_t values[kBlockSize];
+    for (size_t block = 0; block < BlockCount(); ++block) {
+        const unsigned int first_id = base_id_ + static_cast<unsigned int>(block * kBlockSize);
+        const size_t n = BlockLength(block);
+        DecodeBlock(block, values);
+        if (AllLive(live, first_id, n)) {
+            int64_t sum = 0;
+            int32_t lo = values[0];
+            int32_t hi = values[0];
+            for (size_t i = 0; i < n; ++i) {
+                sum += values[i];
+                lo = values[i] < lo ? values[i] : lo;
+                hi = values[i] > hi ? values[i] : hi;
+            }
+            state.count += n;
+            state.sum += static_cast<double>(sum);
+            if (lo < state.min) state.min = lo;
+            if (hi > state.max) state.max = hi;
+        } else {
+            for (size_t i = 0; i < n; ++i) {
+                if (IsLive(live, first_id + static_cast<unsigned int>(i))) state.Add(values[i]);
+            }
+        }
+    }
+    return state;
+}
+
+size_t CompressedIntColumn::CompressedBytes() const {
+    size_t bytes = tail_.capacity() * sizeof(int32_t);
+    for (const Block& b : blocks_) {
+        bytes += sizeof(Block) + b.words.capacity() * sizeof(uint32_t);
+    }
+    return bytes;
+}
+
+Footprint CompressedIntColumn::Memory() const {
+    Footprint footprint;
+    footprint.Add(sizeof(CompressedIntColumn));
+    footprint += VectorBuffer(blocks_);
+    for (const Block& block : blocks_) {
+        footprint += VectorBuffer(block.words);
+    }
+    footprint += VectorBuffer(tail_);
+    return footprint;
+}
@@ -0,0 +1,119 @@
+#include "data_chunk.hpp"
+
+#include <stdexcept>
+
+#include "value_types.hpp"
+
+namespace {
+
+const std::string kEmptyText;
+
+}  // namespace
+
+void ValueVector::Reset(DataType new_type, size_t new_size) {
+    type = new_type;
+    size = new_size;
+    nulls.resize(new_size);
+    if (type == DataType::kString) {
+        texts.resize(new_size);
+    } else if (type == DataType::kDouble) {
+        numbers.resize(new_size);
+    } else {
+        integers.resize(new_size);
+    }
+}
+
+Value ValueVector::Get(size_t i) const {
+    if (nulls[i]) return Value::Null(type);
+    if (type == DataType::kString) return Value::Text(*texts[i]);
+    if (type == DataType::kDouble) return Value::Number(numbers[i]);
+    return Value::Integer(type, integers[i]);
+}
+
+void ValueVector::Set(size_t i, const Value& value) {
+    Set(i, Value(value));
+}
+
+void ValueVector::Set(size_t i, Value&& value) {
+    if (!value.null && value.type != type) {
+        throw std::invalid_argument(std::string("A ") + DataTypeName(value.type) + " value in a " +
+                                    DataTypeName(type) + " vector");
+    }
+    nulls[i] = value.null;
+    if (type == DataType::kString) {
+        if (strings.size() < size) strings.resize(size);
+        strings[i] = std::move(value.text);
+        texts[i] = value.null ? &kEmptyText : &strings[i];
+    } else if (type == DataType::kDouble) {
+        numbers[i] = value.null ? 0 : value.number;
+    } else {
+        integers[i] = value.null ? 0 : value.integer;
+    }
+}
+
+bool Batch::Load(const std::vector<Row>& rows, size_t count, const std::vector<std::pair<int, DataType>>& inputs) {
+    size = count;
+    for (const auto& [slot, type] : inputs) {
+        if (columns.size() <= static_cast<size_t>(slot)) columns.resize(static_cast<size_t>(slot) + 1);
+        ValueVector& column = columns[static_cast<size_t>(slot)];
+        column.Reset(type, count);
+        bool mismatch = false;
+        for (size_t i = 0; i < count; ++i) {
+            const Value& value = rows[i][static_cast<size_t>(slot)];
+            column.nulls[i] = value.null;
+            mismatch |= !value.null && value.type != type;
+        }
+        if (mismatch) return false;
+        if (type == DataType::kString) {
+            for (size_t i = 0; i < count; ++i) {
+                const Value& value = rows[i][static_cast<size_t>(slot)];
+                column.texts[i] = value.null ? &kEmptyText : &value.text;
+            }
+        } else if (type == DataType::kDouble) {
+            for (size_t i = 0; i < count; ++i) {
+                const Value& value = rows[i][static_cast<size_t>(slot)];
+                column.numbers[i] = value.null ? 0 : value.number;
+            }
+        } else {
+            for (size_t i = 0; i < count; ++i) {
+                const Value& value = rows[i][static_cast<size_t>(slot)];
+                column.integers[i] = value.null ? 0 : value.integer;
+            }
+        }
+    }
+    return true;
+}
+
+
+void DataChunk::Reset(const std::vector<DataType>& types, size_t size) {
+    batch.size = size;
+    batch.columns.resize(types.size());
+    for (size_t c = 0; c < types.size(); ++c) {
+        batch.columns[c].Reset(types[c], size);
+    }
+    selective = false;
+    selection.clear();
+}
+
+void DataChunk::GetRow(size_t i, Row& row) const {
+    const size_t index = Index(i);
+    row.resize(batch.columns.size());
+    for (size_t c = 0; c < row.size(); ++c) {
+        row[c] = batch.columns[c].Get(index);
+    }
+}
+
+void DataChunk::Select(const std::vector<uint32_t>& rows) {
+    if (!selective) {
+        selection = rows;
+        selective = true;
+        return;
+    }
+    size_t kept = 0;
+    size_t j = 0;
+    for (const uint32_t row : selection) {
+        while (j < rows.size() && rows[j] < row) ++j;
+        if (j < rows.size() && rows[j] == row) selection[kept++] = row;
+    }
+    selection.resize(kept);
+}
@@ -1,42 +1,328 @@
 #include "db.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sstream>
 #include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "async_io.hpp"
+#include "sql_parser.hpp"
+#include "value_types.hpp"
 
 
 
 /* maps table name -> table. table_ is an instance of db_table.
 In simple words, it gives a table that can dynamically adjusting its row/col a name and saved them into a map.*/
 void Database::CreateTable(const std::string& table_name) {
-    if (tables_.find(table_name) != tables_.end()) {
+    ScopedLatency timer(metrics_, MetricOp::kCreateTable);
+    if (tables_.find(table_name) != tables_.end() || HasPartitionedTable(table_name)) {
         throw std::invalid_argument("Table already exists");
     }
-    tables_[table_name] = new DbTable();
+    if (wal_ != nullptr) {
+        BinaryWriter payload;
+        payload.PutString(table_name);
+        wal_->AppendAndCommit(WalRecordType::kCreateTable, payload.Data());
+    }
+    DbTable* table = new DbTable();
+    if (wal_ != nullptr) table->AttachLog(wal_, table_name);
+    tables_[table_name] = table;
 }
 
 // Drop a table
 void Database::DropTable(const std::string& table_name) {
+    ScopedLatency timer(metrics_, MetricOp::kDropTable);
     if (tables_.find(table_name) == tables_.end()) {
         throw std::out_of_range("Table does not exist");
     }
+    for (const auto& [view_name, view] : views_) {
+        if (view->TableName() == table_name) {
+            throw std::invalid_argument("Table is read by materialized view " + view_name);
+        }
+    }
+    if (wal_ != nullptr) {
+        BinaryWriter payload;
+        payload.PutString(table_name);
+        wal_->AppendAndCommit(WalRecordType::kDropTable, payload.Data());
+    }
+    plan_cache_.Invalidate(tables_[table_name]);
+    result_cache_.Invalidate(tables_[table_name]);
+    ++catalog_version_;
     delete tables_[table_name];
     tables_.erase(table_name);
 }
 
 DbTable& Database::GetTable(const std::string& table_name) {
-    if (tables_.find(table_name) == tables_.end()) {
+    ScopedLatency timer(metrics_, MetricOp::kCatalogLookup);
+    auto it = tables_.find(table_name);
+    if (it == tables_.end()) {
         throw std::out_of_range("Table does not exist");
     }
-    return *tables_[table_name];
+    return *it->second;
+}
+
+MaterializedView& Database::CreateMaterializedView(const std::string& view_name, const std::string& select_sql) {
+    if (views_.find(view_name) != views_.end()) {
+        throw std::invalid_argument("Materialized view already exists");
+    }
+    std::unique_ptr<MaterializedView> view(new MaterializedView(*this, view_name, select_sql));
+    return *(views_[view_name] = std::move(view));
+}
+
+void Database::DropMaterializedView(const std::string& view_name) {
+    if (views_.erase(view_name) == 0) {
+        throw std::out_of_range("Materialized view does not exist");
+    }
+}
+
+MaterializedView& Database::GetMaterializedView(const std::string& view_name) {
+    auto it = views_.find(view_name);
+    if (it == views_.end()) {
+        throw std::out_of_range("Materialized view does not exist");
+    }
+    return *it->second;
+}
+
+PartitionedTable& Database::CreatePartitionedTable(const std::string& table_name,
+                                                   const std::vector<std::pair<std::string, DataType>>& columns,
+                                                   const PartitionSpec& spec) {
+    ScopedLatency timer(metrics_, MetricOp::kCreateTable);
+    if (tables_.find(table_name) != tables_.end() || HasPartitionedTable(table_name)) {
+        throw std::invalid_argument("Table already exists");
+    }
+    std::unique_ptr<PartitionedTable> table(new PartitionedTable(columns, spec));
+    return *(partitioned_[table_name] = std::move(table));
+}
+
+void Database::DropPartitionedTable(const std::string& table_name) {
+    ScopedLatency timer(metrics_, MetricOp::kDropTable);
+    if (partitioned_.erase(table_name) == 0) {
+        throw std::out_of_range("Partitioned table does not exist");
+    }
+}
+
+PartitionedTable& Database::GetPartitionedTable(const std::string& table_name) {
+    ScopedLatency timer(metrics_, MetricOp::kCatalogLookup);
+    auto it = partitioned_.find(table_name);
+    if (it == partitioned_.end()) {
+        throw std::out_of_range("Partitioned table does not exist");
+    }
+    return *it->second;
+}
+
+QueryResult Database::Execute(const std::string& sql) {
+    return Run(*Plan(sql), nullptr);
+}
+
+PreparedStatement Database::Prepare(const std::string& sql) {
+    return PreparedStatement(this, Plan(sql));
+}
+
+// Every table a plan scans with its schema version.
+static void CollectSchemas(const PlanNode& plan, std::vector<std::pair<const DbTable*, uint64_t>>& schemas) {
+    if (plan.kind == PlanKind::kScan && plan.table != nullptr) {
+        schemas.emplace_back(plan.table, plan.table->SchemaVersion());
+    }
+    for (const PlanPtr& child : plan.children) {
+        CollectSchemas(*child, schemas);
+    }
+}
+
+PreparedQueryPtr Database::Plan(const std::string& sql) {
+    std::string key = NormalizeSql(sql);
+    PreparedQueryPtr cached = plan_cache_.Find(key, [this](const PreparedQuery& query) { return IsCurrent(query); });
+    if (cached != nullptr) return cached;
+
+    auto query = std::make_shared<PreparedQuery>();
+    query->sql = std::move(key);
+    query->statement = ParseSql(sql);
+    query->catalog_version = catalog_version_;
+    const Statement& statement = query->statement;
+    query->parameter_types.assign(statement.parameters, DataType::kString);
+    switch (statement.kind) {
+    case StatementKind::kSelect:
+        query->plan = PlanSelect(statement.select, *this);
+        break;
+    case StatementKind::kDelete:
+        query->plan = PlanRowIds(statement.table, statement.where.get(), *this);
+        break;
+    case StatementKind::kInsert: {
+        // A bare ? takes the type of its column; anything else the type binding gives it.
+        const DbTable& table = GetTable(statement.table);
+        query->schemas.emplace_back(&table, table.SchemaVersion());
+        const auto& descs = table.GetColumnDescriptions();
+        for (const std::vector<ExprPtr>& values : statement.values) {
+            for (size_t i = 0; i < values.size(); ++i) {
+                if (values[i]->kind != ExprKind::kParameter) {
+                    CollectParameterTypes(BindConstant(*values[i]).get(), query->parameter_types);
+                    continue;
+                }
+                int col = -1;
+                if (statement.columns.empty() && i < descs.size()) {
+                    col = static_cast<int>(i);
+                } else if (i < statement.columns.size()) {
+                    for (size_t c = 0; c < descs.size(); ++c) {
+                        if (descs[c].first == statement.columns[i]) col = static_cast<int>(c);
+                    }
+                }
+                if (col >= 0) query->parameter_types[values[i]->parameter] = descs[col].second;
+            }
+        }
+        break;
+    }
+    case StatementKind::kCreateTable:
+    case StatementKind::kDropTable:
+        return query;  // changes the catalog: never cached
+    }
+    if (query->plan != nullptr) {
+        CollectSchemas(*query->plan, query->schemas);
+        CollectParameterTypes(*query->plan, query->parameter_types);
+    }
+    plan_cache_.Insert(query);
+    return query;
+}
+
+bool Database::IsCurrent(const PreparedQuery& query) const {
+    if (query.catalog_version != catalog_version_) return false;  // its tables may be gone
+    for (const auto& [table, version] : query.schemas) {
+        if (table->SchemaVersion() != version) return false;
+    }
+    return true;
+}
+
+bool Database::IsCurrent(const CachedResult& entry) const {
+    if (entry.catalog_version != catalog_version_) return false;
+    for (const auto& [table, version] : entry.versions) {
+        if (table->DataVersion() != version) return false;
+    }
+    return true;
+}
+
+QueryResult Database::Run(const PreparedQuery& query, const std::vector<Value>* parameters) {
+    ParameterScope scope(parameters);
+    TraceSpan span("Query");
+    if (span) span.SetDetail(query.sql);
+    // The versions are taken before the query runs: a table it changed makes the stored result stale right away.
+    CachedResult entry;
+    const bool cacheable = query.statement.kind == StatementKind::kSelect && !query.statement.explain &&
+                           result_cache_.Budget() > 0;
+    if (cacheable) {
+        entry.key = ResultCache::Key(query.sql, parameters);
+        const QueryResult* cached =
+            result_cache_.Find(entry.key, [this](const CachedResult& stored) { return IsCurrent(stored); });
+        if (cached != nullptr) {
+            span.SetRows(0, cached->rows.size());
+            return *cached;
+        }
+        entry.catalog_version = catalog_version_;
+        for (const auto& [table, version] : query.schemas) {
+            entry.versions.emplace_back(table, table->DataVersion());
+        }
+    }
+    QueryResult result;
+    size_t count = ExecuteStatement(*this, query.statement, query.plan.get(), result, [&result](const Row& row) {
+        result.rows.push_back(row);
+    });
+    if (query.statement.kind != StatementKind::kSelect) result.affected = count;
+    span.SetRows(0, count);
+    if (cacheable) {
+        entry.result = result;
+        result_cache_.Insert(std::move(entry));
+    }
+    return result;
+}
+
+
+PreparedStatement::PreparedStatement(Database* db, PreparedQueryPtr query)
+    : db_(db), query_(std::move(query)), values_(query_->parameter_types.size()),
+      bound_(query_->parameter_types.size(), false) {}
+
+size_t PreparedStatement::CheckIndex(size_t index) const {
+    if (index == 0 || index > ParameterCount()) {
+        throw std::out_of_range("No parameter ?" + std::to_string(index) + " in " + query_->sql);
+    }
+    return index - 1;
+}
+
+DataType PreparedStatement::ParameterType(size_t index) const {
+    return query_->parameter_types[CheckIndex(index)];
+}
+
+// Converts a parameter value like INSERT converts a value for its column: NULL passes, numbers must convert exactly.
+static Value ConvertParameter(const Value& value, DataType type, size_t index) {
+    if (value.null) return Value::Null(type);
+    Value converted;
+    try {
+        converted = CastValue(value, type);
+    } catch (const std::exception&) {
+        throw std::invalid_argument("Cannot bind " + value.ToString() + " to parameter ?" + std::to_string(index + 1) +
+                                    " of type " + DataTypeName(type));
+    }
+    if (value.IsNumeric() && converted.IsNumeric() && CompareValues(converted, value) != 0) {
+        throw std::invalid_argument("Cannot bind " + value.ToString() + " to parameter ?" + std::to_string(index + 1) +
+                                    " of type " + DataTypeName(type) + " exactly");
+    }
+    return converted;
+}
+
+PreparedStatement& PreparedStatement::Bind(size_t index, const Value& value) {
+    const size_t i = CheckIndex(index);
+    ConvertParameter(value, query_->parameter_types[i], i);
+    values_[i] = value;
+    bound_[i] = true;
+    return *this;
+}
+
+void PreparedStatement::ClearBindings() {
+    std::fill(values_.begin(), values_.end(), Value());
+    std::fill(bound_.begin(), bound_.end(), false);
+}
+
+QueryResult PreparedStatement::Execute(const std::vector<Value>& values) {
+    if (values.size() != ParameterCount()) {
+        throw std::invalid_argument(std::to_string(values.size()) + " values for " + std::to_string(ParameterCount()) +
+                                    " parameters of " + query_->sql);
+    }
+    for (size_t i = 0; i < values.size(); ++i) {
+        Bind(i + 1, values[i]);
+    }
+    return Execute();
+}
+
+QueryResult PreparedStatement::Execute() {
+    if (!db_->IsCurrent(*query_)) query_ = db_->Plan(query_->sql);  // the text is normalized; it parses the same
+    std::vector<Value> parameters;
+    parameters.reserve(values_.size());
+    for (size_t i = 0; i < values_.size(); ++i) {
+        if (!bound_[i]) {
+            throw std::invalid_argument("No value bound to parameter ?" + std::to_string(i + 1));
+        }
+        parameters.push_back(ConvertParameter(values_[i], query_->parameter_types[i], i));
+    }
+    return db_->Run(*query_, &parameters);
 }
 
 Database::~Database() {
+    views_.clear();
     for (auto& [table_name, table] : tables_) {
         delete table;
     }
+    delete wal_;
 }
 
-Database::Database(const Database& rhs) {
+// Delegates to the default constructor, so that the destructor frees the tables copied so far if a copy throws.
+Database::Database(const Database& rhs) : Database() {
     for (const auto& [table_name, table] : rhs.tables_) {
-        tables_[table_name] = new DbTable(*table);
+        DbTable*& slot = tables_[table_name];
+        slot = new DbTable(*table);
+    }
+    for (const auto& [view_name, view] : rhs.views_) {
+        views_[view_name].reset(new MaterializedView(*this, *view));
+    }
+    for (const auto& [table_name, table] : rhs.partitioned_) {
+        partitioned_[table_name].reset(new PartitionedTable(*table));
     }
 }
 
@@ -47,28 +333,49 @@ Database::Database(const Database& rhs) {
 1. Self-assignment Check: If the current object is being assigned to itself (e.g., db = db),
 the function immediately returns the object (*this) to avoid unnecessary work.
 
-2. Clean Up Existing Resources:
-Deletes all dynamically allocated memory (delete table) in the current object's tables_ map and clears the map to prepare for the new data.
+2. Copy: Creates deep copies of the tables and partitioned tables of rhs in a temporary database first, and (for a
+durable database) logs the swap. If either throws, *this is left as it was.
 
-3. Deep Copy of rhs: Creates deep copies of the tables in the rhs object and stores them in the current object's tables_ map.
+3. Swap: Drops the views, swaps the tables and partitioned tables with the copy (whose destructor frees the old ones)
+and recreates the views of rhs over the new tables; they start stale, so a view that no longer plans copies too.
 
 */
 
 Database& Database::operator=(const Database& rhs) {
     if (this == &rhs) return *this;
-    for (auto& [table_name, table] : tables_) {
-        delete table;
+    Database copy(rhs);
+    if (wal_ != nullptr) { // a durable database logs the swap as drops followed by full table images
+        for (const auto& [table_name, table] : tables_) {
+            BinaryWriter payload;
+            payload.PutString(table_name);
+            wal_->Append(WalRecordType::kDropTable, payload.Data());
+        }
+        uint64_t lsn = 0;
+        for (const auto& [table_name, table] : rhs.tables_) {
+            BinaryWriter create;
+            create.PutString(table_name);
+            wal_->Append(WalRecordType::kCreateTable, create.Data());
+            BinaryWriter image;
+            image.PutString(table_name);
+            table->Serialize(image);
+            lsn = wal_->Append(WalRecordType::kReplaceTable, image.Data());
+        }
+        wal_->Commit(lsn == 0 ? wal_->LastLsn() : lsn);
     }
-    /*
-        for (auto& pair : tables_) {
-        delete pair.second; // Delete the table (value of the pair)
+    views_.clear();
+    copy.views_.clear();  // they listen to the tables that move to *this
+    tables_.swap(copy.tables_);
+    partitioned_.swap(copy.partitioned_);
+    plan_cache_.Clear();
+    result_cache_.Clear();
+    ++catalog_version_;
+    if (wal_ != nullptr) {
+        for (const auto& [table_name, table] : tables_) {
+            table->AttachLog(wal_, table_name);
+        }
     }
-    tables_.clear(); // Clear the map
-    */
-    tables_.clear();
-
-    for (const auto& [table_name, table] : rhs.tables_) {
-        tables_[table_name] = new DbTable(*table);
+    for (const auto& [view_name, view] : rhs.views_) {
+        views_[view_name].reset(new MaterializedView(*this, *view));
     }
   return *this;
 }
@@ -82,9 +389,410 @@ std::ostream& operator<<(std::ostream& os, const Database& db) {
 }
 
 
+// DbTable::MemoryUsage of every table, then the total including the table objects, the nodes of tables_ and the
+// catalog metrics.
+std::string Database::MemoryReport() const {
+    std::ostringstream os;
+    Footprint total;
+    for (const auto& [table_name, table] : tables_) {
+        const TableMemory memory = table->MemoryUsage();
+        os << "Table: " << table_name << " (" << memory.Total().allocated << " bytes)\n" << memory;
+        total += memory.Total();
+        total.Add(sizeof(DbTable));
+        total.used += sizeof(std::pair<const std::string, DbTable*>);
+        total.allocated += TreeNodeBytes(sizeof(std::pair<const std::string, DbTable*>));
+        total += StringHeap(table_name);
+    }
+    total += metrics_.Memory();
+    os << "Database: " << total.used << " bytes used, " << total.allocated << " bytes allocated\n";
+    return os.str();
+}
+
+
+MetricsSnapshot Database::GetMetrics() const {
+    MetricsSnapshot snapshot = metrics_.Snapshot();
+    for (const auto& [table_name, table] : tables_) {
+        snapshot += table->GetMetrics();
+    }
+    for (const auto& [table_name, table] : partitioned_) {
+        snapshot += table->GetMetrics();
+    }
+    return snapshot;
+}
+
+std::string Database::MetricsText() const {
+    std::ostringstream os;
+    WriteMetricsText(os, "catalog", metrics_.Snapshot());
+    for (const auto& [table_name, table] : tables_) {
+        WriteMetricsText(os, "table:" + table_name, table->GetMetrics());
+    }
+    for (const auto& [table_name, table] : partitioned_) {
+        WriteMetricsText(os, "partitioned:" + table_name, table->GetMetrics());
+    }
+    return os.str();
+}
+
+
 /* std::ostream& operator<<(std::ostream& os, const Database& db) {
     for (const auto& pair : db.tables_) {
         os << "Table: " << pair.first << "\n" << *pair.second << "\n";
     }
     return os;
 } */
+
+
+
+/*-------------------------------------------------------------------------------------------------------------
+ Durability: incremental checkpoints + write-ahead log.
+
+ data.<gen>.db = append-only sequence of chunk images, each [length (u32)][crc32 (u32)][chunk bytes]
+ manifest.db   = "DBMANIF1" | lsn covered (u64) | generation (u32) | data file size (u64) | table count (u32) |
+                 { name, schema (columns + zone maps), chunk count (u32),
+                   { chunk no (u32), offset (u64), length (u32) }* }* | crc32
+ wal.log       = records written by WriteAheadLog; only records with lsn > manifest lsn are replayed.
+
+ A checkpoint appends the dirty chunks past the end recorded in the current manifest, fdatasyncs the data file and
+ then atomically replaces the manifest, so a crash at any point leaves the previous checkpoint intact.
+-------------------------------------------------------------------------------------------------------------*/
+
+static const char kManifestMagic[8] = {'D', 'B', 'M', 'A', 'N', 'I', 'F', '1'};
+static const uint64_t kCompactionMinGarbage = 1 << 20;  // never compact for less than 1 MiB of garbage
+static const size_t kCheckpointBatch = 1 << 20;          // chunk images per write of a checkpoint
+
+static std::string ErrnoMessage(const std::string& what) {
+    return what + ": " + std::strerror(errno);
+}
+
+// Reads a whole file. Returns false if it does not exist.
+static bool ReadWholeFile(const std::string& path, std::string& out) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        if (errno == ENOENT) return false;
+        throw std::runtime_error(ErrnoMessage("Cannot open " + path));
+    }
+    out.clear();
+    char chunk[1 << 16];
+    for (;;) {
+        ssize_t n = ::read(fd, chunk, sizeof(chunk));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            ::close(fd);
+            throw std::runtime_error(ErrnoMessage("Cannot read " + path));
+        }
+        if (n == 0) break;
+        out.append(chunk, static_cast<size_t>(n));
+    }
+    ::close(fd);
+    return true;
+}
+
+static void PWriteAll(int fd, const std::string& data, uint64_t offset, const std::string& path) {
+    const char* p = data.data();
+    size_t left = data.size();
+    while (left > 0) {
+        ssize_t n = ::pwrite(fd, p, left, static_cast<off_t>(offset));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error(ErrnoMessage("Cannot write " + path));
+        }
+        p += n;
+        left -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+}
+
+static void PReadAll(int fd, std::string& out, size_t size, uint64_t offset, const std::string& path) {
+    out.resize(size);
+    size_t done = 0;
+    while (done < size) {
+        ssize_t n = ::pread(fd, &out[done], size - done, static_cast<off_t>(offset + done));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            throw std::runtime_error(ErrnoMessage("Cannot read " + path));
+        }
+        done += static_cast<size_t>(n);
+    }
+}
+
+static void FsyncDirectory(const std::string& dir) {
+    int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd >= 0) {
+        ::fsync(fd);
+        ::close(fd);
+    }
+}
+
+// Writes data to path atomically: write to a temporary file, fsync it, rename it over path, fsync the directory.
+static void WriteFileAtomically(const std::string& dir, const std::string& path, const std::string& data) {
+    std::string tmp = path + ".tmp";
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error(ErrnoMessage("Cannot create " + tmp));
+    }
+    try {
+        PWriteAll(fd, data, 0, tmp);
+        if (::fsync(fd) != 0) {
+            throw std::runtime_error(ErrnoMessage("Cannot fsync " + tmp));
+        }
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+    ::close(fd);
+    if (::rename(tmp.c_str(), path.c_str()) != 0) {
+        throw std::runtime_error(ErrnoMessage("Cannot rename " + tmp));
+    }
+    FsyncDirectory(dir);
+}
+
+
+void Database::Open(const std::string& data_dir, const WalOptions& options) {
+    if (wal_ != nullptr) {
+        throw std::runtime_error("Database is already open");
+    }
+    if (!tables_.empty()) {
+        throw std::invalid_argument("Database must be empty before Open");
+    }
+    if (::mkdir(data_dir.c_str(), 0755) != 0 && errno != EEXIST) {
+        throw std::runtime_error(ErrnoMessage("Cannot create " + data_dir));
+    }
+    data_dir_ = data_dir;
+    uint64_t checkpoint_lsn = LoadCheckpoint();
+    // Replay runs before the log is attached, so re-applying a record does not log it a second time.
+    WriteAheadLog::Replay(data_dir_ + "/wal.log", checkpoint_lsn,
+                          [this](const WalRecord& record) { ApplyLogRecord(record); });
+    wal_ = new WriteAheadLog(data_dir_ + "/wal.log", options);
+    wal_->SetNextLsn(checkpoint_lsn + 1);
+    for (auto& [table_name, table] : tables_) {
+        table->AttachLog(wal_, table_name);
+    }
+}
+
+CheckpointStats Database::Checkpoint() {
+    if (wal_ == nullptr) {
+        throw std::runtime_error("Database is not durable");
+    }
+    // Compact once the garbage left behind by rewritten chunks outweighs the live data.
+    uint64_t garbage = data_file_size_ - live_bytes_;
+    bool compact = garbage > kCompactionMinGarbage && garbage > live_bytes_;
+    return WriteCheckpoint(compact);
+}
+
+CheckpointStats Database::Compact() {
+    if (wal_ == nullptr) {
+        throw std::runtime_error("Database is not durable");
+    }
+    return WriteCheckpoint(true);
+}
+
+std::string Database::DataFilePath(uint32_t generation) const {
+    return data_dir_ + "/data." + std::to_string(generation) + ".db";
+}
+
+CheckpointStats Database::WriteCheckpoint(bool compact) {
+    CheckpointStats stats;
+    stats.compacted = compact;
+    uint64_t lsn = wal_->LastLsn();
+    uint32_t generation = compact ? data_generation_ + 1 : data_generation_;
+    uint64_t end = compact ? 0 : data_file_size_;
+
+    /* 1. Serialize the dirty chunks (every chunk of a rewritten table) and work out the new chunk index. The images
+    go to the end of the data file in batches of about kCheckpointBatch bytes, written while the next batch is
+    serialized. */
+    std::map<std::string, std::map<unsigned int, ChunkLocation>> index;
+    std::string data_path = DataFilePath(generation);
+    AsyncWriter out(data_path, end, compact);
+    std::string batch;
+    for (const auto& [table_name, table] : tables_) {
+        auto& chunks = index[table_name];
+        auto old = chunk_index_.find(table_name);
+        std::vector<unsigned int> todo;
+        if (compact || table->AllDirty() || old == chunk_index_.end()) {
+            todo = table->Chunks();
+        } else {
+            chunks = old->second;
+            todo = table->DirtyChunks();
+        }
+        size_t written = 0;
+        for (unsigned int chunk : todo) {
+            chunks.erase(chunk);
+            if (table->ChunkEmpty(chunk)) continue;  // every row of the chunk was deleted
+            BinaryWriter image;
+            table->SerializeChunk(chunk, image);
+            BinaryWriter header;
+            header.PutU32(static_cast<uint32_t>(image.Size()));
+            header.PutU32(Crc32(image.Data().data(), image.Size()));
+            ChunkLocation loc;
+            loc.offset = out.Offset() + batch.size();
+            loc.length = static_cast<uint32_t>(image.Size());
+            chunks[chunk] = loc;
+            batch.append(header.Data());
+            batch.append(image.Data());
+            ++written;
+            if (batch.size() >= kCheckpointBatch) {
+                out.Write(std::move(batch));
+                batch = std::string();
+            }
+        }
+        stats.chunks_written += written;
+        stats.chunks_kept += chunks.size() - written;
+    }
+    uint64_t live = 0;
+    for (const auto& [table_name, chunks] : index) {
+        for (const auto& [chunk, loc] : chunks) live += loc.length + 8;
+    }
+
+    // 2. Write the last batch and make the new chunk images durable.
+    out.Write(std::move(batch));
+    out.Sync();
+    out.Close();
+    const uint64_t chunk_bytes = out.Offset() - end;
+    end = out.Offset();
+
+    // 3. Commit the checkpoint by atomically replacing the manifest.
+    BinaryWriter manifest;
+    manifest.PutBytes(kManifestMagic, sizeof(kManifestMagic));
+    manifest.PutU64(lsn);
+    manifest.PutU32(generation);
+    manifest.PutU64(end);
+    manifest.PutU32(static_cast<uint32_t>(tables_.size()));
+    for (const auto& [table_name, table] : tables_) {
+        manifest.PutString(table_name);
+        table->SerializeSchema(manifest);
+        const auto& chunks = index[table_name];
+        manifest.PutU32(static_cast<uint32_t>(chunks.size()));
+        for (const auto& [chunk, loc] : chunks) {
+            manifest.PutU32(chunk);
+            manifest.PutU64(loc.offset);
+            manifest.PutU32(loc.length);
+        }
+    }
+    manifest.PutU32(Crc32(manifest.Data().data(), manifest.Size()));
+    WriteFileAtomically(data_dir_, data_dir_ + "/manifest.db", manifest.Data());
+
+    // 4. The checkpoint is durable: forget the old state and cut the log.
+    if (compact && generation != data_generation_) {
+        ::unlink(DataFilePath(data_generation_).c_str());
+    }
+    data_generation_ = generation;
+    data_file_size_ = end;
+    live_bytes_ = live;
+    chunk_index_ = std::move(index);
+    for (auto& [table_name, table] : tables_) {
+        table->ClearDirty();
+    }
+    wal_->Truncate();
+    stats.bytes_written = chunk_bytes + manifest.Size();
+    return stats;
+}
+
+void Database::ApplyLogRecord(const WalRecord& record) {
+    BinaryReader in(record.payload);
+    std::string table_name = in.GetString();
+    switch (record.type) {
+    case WalRecordType::kCreateTable:
+        CreateTable(table_name);
+        break;
+    case WalRecordType::kDropTable:
+        DropTable(table_name);
+        break;
+    case WalRecordType::kAddColumn: {
+        std::string col_name = in.GetString();
+        uint8_t type = in.GetU8();
+        uint8_t encoding = in.GetU8();
+        bool null_default = in.GetU8() != 0;
+        GetTable(table_name).AddColumn({col_name, static_cast<DataType>(type)}, static_cast<Encoding>(encoding),
+                                       null_default);
+        break;
+    }
+    case WalRecordType::kDeleteColumn:
+        GetTable(table_name).DeleteColumnByIdx(in.GetU32());
+        break;
+    case WalRecordType::kAddRow: {
+        uint32_t n = in.GetU32();
+        std::vector<std::string> cells;
+        cells.reserve(n);
+        for (uint32_t i = 0; i < n; ++i) {
+            cells.push_back(in.GetString());
+        }
+        GetTable(table_name).AddRow(cells);
+        break;
+    }
+    case WalRecordType::kAddRowWithNulls: {
+        uint32_t n = in.GetU32();
+        std::vector<std::optional<std::string>> cells(n);
+        for (uint32_t i = 0; i < n; ++i) {
+            if (in.GetU8() != 0) cells[i] = in.GetString();
+        }
+        GetTable(table_name).AddRow(cells);
+        break;
+    }
+    case WalRecordType::kDeleteRow:
+        GetTable(table_name).DeleteRowById(in.GetU32());
+        break;
+    case WalRecordType::kReplaceTable:
+        GetTable(table_name).Deserialize(in);
+        break;
+    default:
+        throw std::runtime_error("Unknown WAL record type");
+    }
+}
+
+// Loads the manifest and every chunk it references. Returns the lsn covered (0 when there is no checkpoint yet).
+uint64_t Database::LoadCheckpoint() {
+    std::string data;
+    std::string manifest_path = data_dir_ + "/manifest.db";
+    if (!ReadWholeFile(manifest_path, data)) return 0;
+    if (data.size() < sizeof(kManifestMagic) + 4 || std::memcmp(data.data(), kManifestMagic, sizeof(kManifestMagic)) != 0) {
+        throw std::runtime_error("Not a manifest file: " + manifest_path);
+    }
+    size_t body_size = data.size() - 4;
+    BinaryReader crc_reader(data.data() + body_size, 4);
+    if (Crc32(data.data(), body_size) != crc_reader.GetU32()) {
+        throw std::runtime_error("Manifest checksum mismatch: " + manifest_path);
+    }
+    BinaryReader in(data.data() + sizeof(kManifestMagic), body_size - sizeof(kManifestMagic));
+    uint64_t lsn = in.GetU64();
+    data_generation_ = in.GetU32();
+    data_file_size_ = in.GetU64();
+    live_bytes_ = 0;
+    uint32_t num_tables = in.GetU32();
+
+    std::string data_path = DataFilePath(data_generation_);
+    int fd = ::open(data_path.c_str(), O_RDONLY);
+    if (fd < 0 && num_tables > 0) {
+        throw std::runtime_error(ErrnoMessage("Cannot open " + data_path));
+    }
+    try {
+        std::string image;
+        for (uint32_t t = 0; t < num_tables; ++t) {
+            std::string table_name = in.GetString();
+            CreateTable(table_name);
+            DbTable& table = *tables_[table_name];
+            table.DeserializeSchema(in);
+            auto& chunks = chunk_index_[table_name];
+            uint32_t num_chunks = in.GetU32();
+            for (uint32_t c = 0; c < num_chunks; ++c) {
+                unsigned int chunk = in.GetU32();
+                ChunkLocation loc;
+                loc.offset = in.GetU64();
+                loc.length = in.GetU32();
+                PReadAll(fd, image, loc.length + 8, loc.offset, data_path);
+                BinaryReader header(image.data(), 8);
+                if (header.GetU32() != loc.length || header.GetU32() != Crc32(image.data() + 8, loc.length)) {
+                    throw std::runtime_error("Chunk checksum mismatch in " + data_path);
+                }
+                BinaryReader chunk_reader(image.data() + 8, loc.length);
+                table.DeserializeChunk(chunk_reader);
+                chunks[chunk] = loc;
+                live_bytes_ += loc.length + 8;
+            }
+            table.ClearDirty();
+        }
+    } catch (...) {
+        if (fd >= 0) ::close(fd);
+        throw;
+    }
+    if (fd >= 0) ::close(fd);
+    return lsn;
+}
@@ -1,7 +1,17 @@
 #include "db_table.hpp"
 
+#include <algorithm>
+#include <iomanip>
+#include <limits>
+#include <stdexcept>
 
-/*! IN a database, one of an important function is dynamically adjust the number of cols and number of rows. 
+#include "bitmap.hpp"
+#include "query_trace.hpp"
+#include "value_types.hpp"
+#include "wal.hpp"
+
+
+/*! IN a database, one of an important function is dynamically adjust the number of cols and number of rows.
 This is what we are trying to achieve in AddColumn, DeleteColumnByIdx functions*/
 
 
@@ -22,29 +32,83 @@ void DbTable::ResizeRows() {
 }
 
 
-// add a new col. 
+// add a new col.
 void DbTable::AddColumn(const std::pair<std::string, DataType>& col_desc) {
+    AddColumn(col_desc, Encoding::kPlain);
+}
+
+void DbTable::AddColumn(const std::pair<std::string, DataType>& col_desc, Encoding encoding) {
+    AddColumn(col_desc, encoding, false);
+}
+
+/* Encoded and fixed-width columns keep their values in a Column object indexed by row id instead of one heap cell per row; their slot
+in the row arrays stays nullptr. The column starts at the smallest live id so rows that were deleted before it was
+added take no space. */
+void DbTable::AddColumn(const std::pair<std::string, DataType>& col_desc, Encoding encoding, bool null_default) {
+    ScopedLatency timer(metrics_, MetricOp::kAddColumn);
+    unsigned int base_id = rows_.empty() ? next_unique_id_ : rows_.begin()->first;
+    Column* column = NewColumn(col_desc.second, encoding, base_id); // throws for an unsupported type/encoding pair
+    if (wal_ != nullptr) {
+        try {
+            BinaryWriter payload;
+            payload.PutString(wal_name_);
+            payload.PutString(col_desc.first);
+            payload.PutU8(static_cast<uint8_t>(col_desc.second));
+            payload.PutU8(static_cast<uint8_t>(encoding));
+            payload.PutU8(null_default ? 1 : 0);
+            wal_->AppendAndCommit(WalRecordType::kAddColumn, payload.Data());
+        } catch (...) {
+            delete column;
+            throw;
+        }
+    }
     if (col_descs_.size() == row_col_capacity_) {
         ResizeRows();
     }
+    all_dirty_ = true; // every stored chunk changes layout
+    ++schema_version_;
+    ++data_version_;
     // Add the new column description to the vector
     col_descs_.push_back(col_desc); /*!mark difference in name*/
-    // For each row, add a default value for the new column
+    columns_.push_back(column);
+    zone_maps_.emplace_back(col_desc.second);
+    validity_.emplace_back();
+    cell_memory_.emplace_back();
+    stats_.emplace_back(col_desc.second);
+    const size_t col = col_descs_.size() - 1;
+    if (column != nullptr) {
+        for (unsigned int id = base_id; id < next_unique_id_; ++id) {
+            if (null_default) {
+                column->AppendNull();
+            } else {
+                column->AppendDefault();
+            }
+        }
+    }
+    // For each row, add a default value (or NULL, which has no cell) for the new column
     for (auto& pair : rows_) { //this means you are iterating over all the elements (key-value pairs) of the std::map named rows_.
         void** row = pair.second;
-        // Add a default value for the new column based on the data type
-        if (col_desc.second == DataType::kString) {
-            row[col_descs_.size() - 1] = new std::string("");
-        } else if (col_desc.second == DataType::kDouble) {
-            row[col_descs_.size() - 1] = new double(0.0);
-        } else if (col_desc.second == DataType::kInt) {
-            row[col_descs_.size() - 1] = new int(0);
+        row[col] = column == nullptr && !null_default ? NewDefaultCell(col) : nullptr;
+        if (null_default) {
+            SetNull(col, pair.first);
+            zone_maps_.back().AddNull(pair.first);
+            stats_.back().AddNull();
+        } else if (col_desc.second == DataType::kString) {
+            zone_maps_.back().AddString(pair.first, "");
+            stats_.back().AddString("");
+        } else if (IsInt64Type(col_desc.second)) {
+            zone_maps_.back().AddInteger(pair.first, 0);
+            stats_.back().AddNumber(0);
+        } else {
+            zone_maps_.back().AddNumber(pair.first, 0);
+            stats_.back().AddNumber(0);
         }
     }
 }
 
 // removing a col if we found this col is unnecessary. The specific col we are removing is index col_idx
 void DbTable::DeleteColumnByIdx(unsigned int col_idx) {
+    ScopedLatency timer(metrics_, MetricOp::kDeleteColumn);
     if (col_idx >= col_descs_.size()) {
         throw std::out_of_range("Col index out of range");
     }
@@ -54,58 +118,152 @@ void DbTable::DeleteColumnByIdx(unsigned int col_idx) {
             "fail to delete the last column with rows present");
     }
     // we cannot remove the last col.
+    if (wal_ != nullptr) {
+        BinaryWriter payload;
+        payload.PutString(wal_name_);
+        payload.PutU32(col_idx);
+        wal_->AppendAndCommit(WalRecordType::kDeleteColumn, payload.Data());
+    }
     for (auto& pair : rows_) {
         void** row = pair.second;
-        if (col_descs_[col_idx].second == DataType::kString) {
-            delete static_cast<std::string*>(row[col_idx]);
-        } else if (col_descs_[col_idx].second == DataType::kDouble) {
-            delete static_cast<double*>(row[col_idx]);
-        } else if (col_descs_[col_idx].second == DataType::kInt) {
-            delete static_cast<int*>(row[col_idx]);
-        }
+        FreeCell(col_idx, row[col_idx]);
     for (size_t i = col_idx; i < col_descs_.size() - 1; ++i) {
         row[i] = row[i + 1]; // resize
     }
 }
+    delete columns_[col_idx];
+    columns_.erase(columns_.begin() + col_idx);
     col_descs_.erase(col_descs_.begin() + col_idx);
+    zone_maps_.erase(zone_maps_.begin() + col_idx);
+    validity_.erase(validity_.begin() + col_idx);
+    cell_memory_.erase(cell_memory_.begin() + col_idx);
+    stats_.erase(stats_.begin() + col_idx);
+    all_dirty_ = true;
+    ++schema_version_;
+    ++data_version_;
     //!!col_descs_.erase(col_descs_.begin() + col_idx) is removing the column description at a specific index (col_idx) from the vector col_descs_
 }
 
 
 
-// add a new row below of bottom row. 
+// add a new row below of bottom row.
 void DbTable::AddRow(const std::initializer_list<std::string>& col_data) {
-    if (col_data.size() != col_descs_.size()) {
+    InsertRow(col_data.begin(), nullptr, col_data.size());
+}
+
+void DbTable::AddRow(const std::vector<std::string>& col_data) {
+    InsertRow(col_data.data(), nullptr, col_data.size());
+}
+
+void DbTable::AddRow(const std::vector<std::optional<std::string>>& col_data) {
+    std::vector<std::string> cells(col_data.size());
+    std::vector<char> nulls(col_data.size(), 0);
+    bool any_null = false;
+    for (size_t i = 0; i < col_data.size(); ++i) {
+        if (col_data[i].has_value()) {
+            cells[i] = *col_data[i];
+        } else {
+            nulls[i] = 1;
+            any_null = true;
+        }
+    }
+    InsertRow(cells.data(), any_null ? nulls.data() : nullptr, cells.size());
+}
+
+/* A NULL cell has no heap cell (its slot is nullptr) and a placeholder in an encoded column; either way the column's
+validity bit is cleared once the row is in. */
+void DbTable::InsertRow(const std::string* col_data, const char* nulls, size_t size) {
+    ScopedLatency timer(metrics_, MetricOp::kAddRow);
+    if (size != col_descs_.size()) {
         throw std::invalid_argument("Column data size mismatch");
-    } // std::initializer_list<std::string>& col_data serves as a collecttions of info intended to be added inside of the databse. Thus, its number should matched the num of col. 
+    } // std::initializer_list<std::string>& col_data serves as a collecttions of info intended to be added inside of the databse. Thus, its number should matched the num of col.
 
     void** new_row = new void*[row_col_capacity_]; // represents the new row that will be added.
     // Using row_col_capacity_ instead of col_data.size() ensures that the row aligns with the table's fixed structure and can handle all potential columns.
     size_t i = 0;
-
-    for (const auto& data : col_data) {
-        if (col_descs_[i].second == DataType::kString) {
-        new_row[i] = new std::string(data);
-    } else if (col_descs_[i].second == DataType::kDouble) {
-        new_row[i] = new double(std::stod(data));
-    } else if (col_descs_[i].second == DataType::kInt) {
-        new_row[i] = new int(std::stoi(data));
+    try {
+        for (; i < size; ++i) {
+            const bool null = nulls != nullptr && nulls[i] != 0;
+            if (columns_[i] != nullptr) {
+                PadColumn(i, next_unique_id_);
+                if (null) {
+                    columns_[i]->AppendNull();
+                } else {
+                    columns_[i]->Append(col_data[i]);
+                }
+                new_row[i] = nullptr;
+            } else {
+                new_row[i] = null ? nullptr : NewCell(i, col_data[i]);
+            }
+        }
+        // The row is only logged once every cell parsed, so replaying the log can never fail on it.
+        if (wal_ != nullptr) {
+            BinaryWriter payload;
+            payload.PutString(wal_name_);
+            payload.PutU32(static_cast<uint32_t>(size));
+            for (size_t j = 0; j < size; ++j) {
+                if (nulls != nullptr) {
+                    payload.PutU8(nulls[j] != 0 ? 0 : 1);
+                    if (nulls[j] != 0) continue;
+                }
+                payload.PutString(col_data[j]);
+            }
+            wal_->AppendAndCommit(nulls != nullptr ? WalRecordType::kAddRowWithNulls : WalRecordType::kAddRow,
+                                  payload.Data());
+        }
+    } catch (...) {
+        // undo the cells that were already created (i is the first cell that was not)
+        for (size_t j = 0; j < i; ++j) {
+            if (columns_[j] != nullptr) {
+                columns_[j]->PopBack();
+            } else {
+                FreeCell(j, new_row[j]);
+            }
+        }
+        delete[] new_row;
+        throw;
     }
-        ++i;
+    MarkDirty(next_unique_id_);
+    SetLive(next_unique_id_, true);
+    for (size_t j = 0; nulls != nullptr && j < size; ++j) {
+        if (nulls[j] != 0) SetNull(j, next_unique_id_);
     }
+    AddToZones(next_unique_id_, new_row);
+    AddToStats(next_unique_id_, new_row);
     rows_[next_unique_id_++] = new_row;
+    ++data_version_;
+    for (TableListener* listener : listeners_) {
+        listener->OnInsert(*this, next_unique_id_ - 1);
+    }
 }
 
 
 // delete a existing row by id
 void DbTable::DeleteRowById(unsigned int id) {
+    ScopedLatency timer(metrics_, MetricOp::kDeleteRow);
     if (rows_.find(id) == rows_.end()) { // this essentiallly means if we did not find id.
     /* Comparing the result of find() with my_map.end() is the classic way to check for the existence of a key in C++ maps.
     It is the same as rows.contains(id), but contains function was introduced only after C++20. */
         throw std::out_of_range("Row ID does not exist");
     }
+    if (wal_ != nullptr) {
+        BinaryWriter payload;
+        payload.PutString(wal_name_);
+        payload.PutU32(id);
+        wal_->AppendAndCommit(WalRecordType::kDeleteRow, payload.Data());
+    }
+    for (TableListener* listener : listeners_) {
+        listener->OnDelete(*this, id);
+    }
     FreeRowMemory(id);
     rows_.erase(id);
+    ++data_version_;
+    SetLive(id, false);
+    RemoveFromZones(id);
+    for (ColumnStats& stats : stats_) {
+        stats.RemoveRow();
+    }
+    MarkDirty(id);
 }
 
 
@@ -118,52 +276,84 @@ DbTable::DbTable(const DbTable& rhs):
     next_unique_id_(rhs.next_unique_id_),
     row_col_capacity_(rhs.row_col_capacity_),
     col_descs_(rhs.col_descs_) {
-    for (const auto& [id, row] : rhs.rows_) {
-    void** new_row = new void*[row_col_capacity_];
-    for (size_t i = 0; i < col_descs_.size(); ++i) {
-        if (col_descs_[i].second == DataType::kString) {
-            new_row[i] = new std::string(*(static_cast<std::string*>(row[i])));
-        } else if (col_descs_[i].second == DataType::kDouble) {
-            new_row[i] = new double(*(static_cast<double*>(row[i])));
-        } else if (col_descs_[i].second == DataType::kInt) {
-            new_row[i] = new int(*(static_cast<int*>(row[i])));
-        }
-    }
-    rows_[id] = new_row;
-    }
+    CopyContents(rhs);
 }
 
 // copy assignment operator
 DbTable& DbTable::operator=(const DbTable& rhs) {
     if (this == &rhs) return *this;
-    for (auto& [id, row] : rows_) {
-        FreeRowMemory(id);
+    if (wal_ != nullptr) { // a durable table that is overwritten logs the complete new image
+        BinaryWriter payload;
+        payload.PutString(wal_name_);
+        rhs.Serialize(payload);
+        wal_->AppendAndCommit(WalRecordType::kReplaceTable, payload.Data());
     }
-    rows_.clear();
+    ClearRows();
+    ClearColumns();
+    all_dirty_ = true;
     next_unique_id_ = rhs.next_unique_id_;
     row_col_capacity_ = rhs.row_col_capacity_;
     col_descs_ = rhs.col_descs_;
+    CopyContents(rhs);
+    return *this;
+}
+
+// Deep copies the encoded columns and rows of rhs (col_descs_ and row_col_capacity_ must already match rhs).
+void DbTable::CopyContents(const DbTable& rhs) {
+    for (const Column* column : rhs.columns_) {
+        columns_.push_back(column == nullptr ? nullptr : column->Clone());
+    }
+    live_ = rhs.live_;
+    zone_maps_ = rhs.zone_maps_;
+    zone_rows_ = rhs.zone_rows_;
+    validity_ = rhs.validity_;
+    stats_ = rhs.stats_;
+    cell_memory_.assign(col_descs_.size(), Footprint()); // counted again as the cells are copied
     for (const auto& [id, row] : rhs.rows_) {
-        void** new_row = new void*[row_col_capacity_];
-        for (size_t i = 0; i < col_descs_.size(); ++i) {
-        if (col_descs_[i].second == DataType::kString) {
-            new_row[i] = new std::string(*(static_cast<std::string*>(row[i])));
-        } else if (col_descs_[i].second == DataType::kDouble) {
-            new_row[i] = new double(*(static_cast<double*>(row[i])));
-        } else if (col_descs_[i].second == DataType::kInt) {
-            new_row[i] = new int(*(static_cast<int*>(row[i])));
-        }
+    void** new_row = new void*[row_col_capacity_];
+    for (size_t i = 0; i < col_descs_.size(); ++i) {
+        new_row[i] = CopyCell(i, row[i]);
     }
     rows_[id] = new_row;
     }
-    return *this;
 }
 
 // destructor
 DbTable::~DbTable() {
+    ClearRows();
+    ClearColumns();
+}
+
+// Frees every row (but keeps the column descriptions).
+void DbTable::ClearRows() {
     for (auto& [id, row] : rows_) {
         FreeRowMemory(id);
     }
+    rows_.clear();
+    ++data_version_;
+    live_.clear();
+    zone_rows_.clear();
+    for (ZoneMap& zones : zone_maps_) {
+        zones.Clear();
+    }
+    for (std::vector<uint64_t>& bits : validity_) {
+        bits.clear();
+    }
+}
+
+// Frees the encoded column objects (and forgets the column descriptions).
+void DbTable::ClearColumns() {
+    for (Column* column : columns_) {
+        delete column;
+    }
+    columns_.clear();
+    col_descs_.clear();
+    zone_maps_.clear();
+    validity_.clear();
+    cell_memory_.clear();
+    stats_.clear();
+    ++schema_version_;
+    ++data_version_;
 }
 
 
@@ -172,30 +362,232 @@ void DbTable::FreeRowMemory(unsigned int id) {
     if (rows_.find(id) != rows_.end()) { // "we find id!!!". The condition if (rows_.find(id) != rows_.end()) is logically equivalent to if (rows_.contains(id))[opposite, seems wield]
         void** row = rows_[id];
         for (size_t i = 0; i < col_descs_.size(); ++i) {
-            if (col_descs_[i].second == DataType::kString) {
-            delete static_cast<std::string*>(row[i]);
+            FreeCell(i, row[i]);
+    }
+    delete[] row;
+    }
+}
+
+
+/* Cell helpers. A plain cell is a heap object whose type follows the column's DataType; encoded columns have no cell
+(their slot is nullptr), so every helper is a no-op / a lookup in the Column object for them. Every cell is counted
+in cell_memory_ from creation to FreeCell. */
+void* DbTable::NewDefaultCell(size_t col) {
+    if (col_descs_[col].second == DataType::kString) {
+        return TrackCell(col, new std::string(""));
+    } else if (col_descs_[col].second == DataType::kDouble) {
+        return TrackCell(col, new double(0.0));
+    } else if (col_descs_[col].second == DataType::kInt) {
+        return TrackCell(col, new int(0));
+    }
+    return nullptr;
+}
+
+void* DbTable::NewCell(size_t col, const std::string& text) {
+    if (col_descs_[col].second == DataType::kString) {
+        return TrackCell(col, new std::string(text));
+    } else if (col_descs_[col].second == DataType::kDouble) {
+        return TrackCell(col, new double(std::stod(text)));
+    } else if (col_descs_[col].second == DataType::kInt) {
+        return TrackCell(col, new int(std::stoi(text)));
+    }
+    return nullptr;
+}
+
+void* DbTable::CopyCell(size_t col, const void* cell) {
+    if (columns_[col] != nullptr || cell == nullptr) return nullptr;
+    if (col_descs_[col].second == DataType::kString) {
+        return TrackCell(col, new std::string(*(static_cast<const std::string*>(cell))));
+    } else if (col_descs_[col].second == DataType::kDouble) {
+        return TrackCell(col, new double(*(static_cast<const double*>(cell))));
+    } else if (col_descs_[col].second == DataType::kInt) {
+        return TrackCell(col, new int(*(static_cast<const int*>(cell))));
+    }
+    return nullptr;
+}
+
+void* DbTable::TrackCell(size_t col, void* cell) {
+    cell_memory_[col] += CellFootprint(col, cell);
+    return cell;
+}
+
+Footprint DbTable::CellFootprint(size_t col, const void* cell) const {
+    Footprint footprint;
+    if (cell == nullptr) {
+        return footprint;
+    }
+    if (col_descs_[col].second == DataType::kString) {
+        footprint.Add(sizeof(std::string));
+        footprint += StringHeap(*static_cast<const std::string*>(cell));
+    } else if (col_descs_[col].second == DataType::kDouble) {
+        footprint.Add(sizeof(double));
+    } else if (col_descs_[col].second == DataType::kInt) {
+        footprint.Add(sizeof(int));
+    }
+    return footprint;
+}
+
+void DbTable::FreeCell(size_t col, void* cell) {
+    cell_memory_[col] -= CellFootprint(col, cell);
+    if (col_descs_[col].second == DataType::kString) {
+        delete static_cast<std::string*>(cell);
+    } else if (col_descs_[col].second == DataType::kDouble) {
+        delete static_cast<double*>(cell);
+    } else if (col_descs_[col].second == DataType::kInt) {
+        delete static_cast<int*>(cell);
+    }
+}
+
+// Same text GetRows() has always produced (std::to_string for numbers); NULL is "".
+std::string DbTable::CellToString(size_t col, unsigned int id, void** row) const {
+    if (CellIsNull(col, id)) {
+        return "";
+    }
+    if (columns_[col] != nullptr) {
+        return columns_[col]->GetString(id - columns_[col]->BaseId());
+    }
+    if (col_descs_[col].second == DataType::kString) {
+        return *static_cast<std::string*>(row[col]);
+    } else if (col_descs_[col].second == DataType::kDouble) {
+        double value = *static_cast<double*>(row[col]);
+        return std::to_string(value);
+    } else if (col_descs_[col].second == DataType::kInt) {
+        int value = *static_cast<int*>(row[col]);
+        return std::to_string(value);
+    }
+    return "";
+}
+
+// Encoded columns are indexed by id, so ids that never got a value (gaps left by deleted rows) get a default first.
+void DbTable::PadColumn(size_t col, unsigned int id) {
+    Column* column = columns_[col];
+    while (column->BaseId() + column->Size() < id) {
+        column->AppendDefault();
+    }
+}
+
+void DbTable::CountZoneRow(unsigned int id) {
+    size_t zone = id / ZoneMap::kZoneRows;
+    if (zone >= zone_rows_.size()) {
+        zone_rows_.resize(zone + 1, 0);
+    }
+    ++zone_rows_[zone];
+}
+
+// Widens the bounds of every column's zone with the values of a row that was just stored.
+void DbTable::AddToZones(unsigned int id, void** row) {
+    CountZoneRow(id);
+    for (size_t i = 0; i < col_descs_.size(); ++i) {
+        const Column* column = columns_[i];
+        if (CellIsNull(i, id)) {
+            zone_maps_[i].AddNull(id);
+        } else if (col_descs_[i].second == DataType::kString) {
+            if (column != nullptr) {
+                zone_maps_[i].AddString(id, column->GetString(id - column->BaseId()));
+            } else {
+                zone_maps_[i].AddString(id, *static_cast<std::string*>(row[i]));
+            }
+        } else if (IsInt64Type(col_descs_[i].second)) {
+            zone_maps_[i].AddInteger(id, column->GetInteger(id - column->BaseId()));
+        } else if (column != nullptr) {
+            zone_maps_[i].AddNumber(id, column->GetNumber(id - column->BaseId()));
         } else if (col_descs_[i].second == DataType::kDouble) {
-            delete static_cast<double*>(row[i]);
-        } else if (col_descs_[i].second == DataType::kInt) {
-            delete static_cast<int*>(row[i]);
+            zone_maps_[i].AddNumber(id, *static_cast<double*>(row[i]));
+        } else {
+            zone_maps_[i].AddNumber(id, *static_cast<int*>(row[i]));
         }
     }
-    delete[] row;
+}
+
+void DbTable::AddToStats(unsigned int id, void** row) {
+    for (size_t i = 0; i < col_descs_.size(); ++i) {
+        AddValueToStats(stats_[i], i, id, row);
     }
 }
 
+// Feeds the value of one cell to stats the way AddToZones reads it (int64 types as their stored integer).
+void DbTable::AddValueToStats(ColumnStats& stats, size_t col, unsigned int id, void** row) const {
+    const Column* column = columns_[col];
+    const DataType type = col_descs_[col].second;
+    if (CellIsNull(col, id)) {
+        stats.AddNull();
+    } else if (type == DataType::kString) {
+        if (column != nullptr) {
+            stats.AddString(column->GetString(id - column->BaseId()));
+        } else {
+            stats.AddString(*static_cast<std::string*>(row[col]));
+        }
+    } else if (IsInt64Type(type)) {
+        stats.AddNumber(static_cast<double>(column->GetInteger(id - column->BaseId())));
+    } else if (column != nullptr) {
+        stats.AddNumber(column->GetNumber(id - column->BaseId()));
+    } else if (type == DataType::kDouble) {
+        stats.AddNumber(*static_cast<double*>(row[col]));
+    } else {
+        stats.AddNumber(*static_cast<int*>(row[col]));
+    }
+}
+
+void DbTable::RemoveFromZones(unsigned int id) {
+    size_t zone = id / ZoneMap::kZoneRows;
+    if (--zone_rows_[zone] == 0) {
+        for (ZoneMap& zones : zone_maps_) {
+            zones.Reset(zone);
+        }
+        return;
+    }
+    for (size_t i = 0; i < col_descs_.size(); ++i) {
+        if (CellIsNull(i, id)) zone_maps_[i].RemoveNull(id);
+    }
+}
+
+void DbTable::SetLive(unsigned int id, bool live) {
+    size_t word = id / 64;
+    if (word >= live_.size()) {
+        if (!live) return;
+        live_.resize(word + 1, 0);
+    }
+    if (live) {
+        live_[word] |= uint64_t{1} << (id % 64);
+    } else {
+        live_[word] &= ~(uint64_t{1} << (id % 64));
+    }
+}
+
+
+bool DbTable::CellIsNull(size_t col, unsigned int id) const {
+    const std::vector<uint64_t>& bits = validity_[col];
+    size_t word = id / 64;
+    return word < bits.size() && ((bits[word] >> (id % 64)) & 1) == 0;
+}
+
+// The first NULL of a column creates its validity bitmap, which changes how every stored chunk is laid out.
+void DbTable::SetNull(size_t col, unsigned int id) {
+    std::vector<uint64_t>& bits = validity_[col];
+    if (bits.empty()) {
+        all_dirty_ = true;
+    }
+    size_t word = id / 64;
+    if (word >= bits.size()) {
+        bits.resize(word + 1, ~uint64_t{0});
+    }
+    bits[word] &= ~(uint64_t{1} << (id % 64));
+}
+
+// The live rows whose value in col is not NULL: live_ itself when the column holds no NULL, else live_ & validity.
+const std::vector<uint64_t>& DbTable::LiveValues(size_t col, std::vector<uint64_t>& scratch) const {
+    if (validity_[col].empty()) {
+        return live_;
+    }
+    AndBitmaps(live_, validity_[col], scratch);
+    return scratch;
+}
+
 
 std::ostream& operator<<(std::ostream& os, const DbTable& table) {
+    ScopedLatency timer(table.metrics_, MetricOp::kExport);
     for (size_t i = 0; i < table.col_descs_.size(); ++i) {
-        os << table.col_descs_[i].first << "(";
-    if (table.col_descs_[i].second == DataType::kString) {
-        os << "std::string";
-    } else if (table.col_descs_[i].second == DataType::kDouble) {
-        os << "double";
-    } else if (table.col_descs_[i].second == DataType::kInt) {
-        os << "int";
-    }
-        os << ")";
+        os << table.col_descs_[i].first << "(" << DataTypeName(table.col_descs_[i].second) << ")";
     if (i < table.col_descs_.size() - 1) {
         os << ", ";
     }
@@ -203,7 +595,11 @@ std::ostream& operator<<(std::ostream& os, const DbTable& table) {
     os << "\n";
     for (const auto& [id, row] : table.rows_) {
         for (size_t i = 0; i < table.col_descs_.size(); ++i) {
-        if (table.col_descs_[i].second == DataType::kString) {
+        if (table.CellIsNull(i, id)) {
+          os << "NULL";
+        } else if (table.columns_[i] != nullptr) {
+          table.columns_[i]->Print(id - table.columns_[i]->BaseId(), os);
+        } else if (table.col_descs_[i].second == DataType::kString) {
           os << *(static_cast<std::string*>(row[i]));
         } else if (table.col_descs_[i].second == DataType::kDouble) {
           os << *(static_cast<double*>(row[i]));
@@ -222,6 +618,14 @@ std::ostream& operator<<(std::ostream& os, const DbTable& table) {
 
 /*This function, DbTable::GetRows(), extracts all the rows of the table as a std::vector<std::vector<std::string>>, with all data as string*/
 std::vector<std::vector<std::string>> DbTable::GetRows() const {
+    ScopedLatency timer(metrics_, MetricOp::kExport);
+    TraceSpan span("Export");
+    if (span) {
+        uint64_t bytes = 0;
+        for (size_t i = 0; i < col_descs_.size(); ++i) bytes += ScanBytes(i, rows_.size());
+        span.SetRows(rows_.size(), rows_.size());
+        span.SetBytes(bytes);
+    }
     std::vector<std::vector<std::string>> rows_output;
     rows_output.reserve(rows_.size()); // If you want to reserve for efficiency
     // rows_ is your map: std::unordered_map<unsigned int, void**> rows_;
@@ -231,17 +635,793 @@ std::vector<std::vector<std::string>> DbTable::GetRows() const {
         row_data.reserve(col_descs_.size());
         for (size_t i = 0; i < col_descs_.size(); ++i) {
             // Convert each cell to a string based on its DataType
-            if (col_descs_[i].second == DataType::kString) {
-                row_data.push_back(*static_cast<std::string*>(row[i]));
+            row_data.push_back(CellToString(i, id, row));
+        }
+        rows_output.push_back(std::move(row_data));
+    }
+    return rows_output;
+}
+
+void DbTable::ExportCsv(const std::string& path, const AsyncIoOptions& options) const {
+    static const size_t kBufferBytes = 1 << 20;
+    ScopedLatency timer(metrics_, MetricOp::kExport);
+    TraceSpan span("Export");
+    if (span) span.SetRows(rows_.size(), rows_.size());
+    AsyncWriter out(path, 0, true, options);
+    std::string buffer;
+    buffer.reserve(kBufferBytes + 4096);
+    for (size_t i = 0; i < col_descs_.size(); ++i) {
+        if (i > 0) buffer += ',';
+        buffer += col_descs_[i].first;
+    }
+    buffer += '\n';
+    uint64_t bytes = 0;
+    for (const auto& [id, row] : rows_) {
+        for (size_t i = 0; i < col_descs_.size(); ++i) {
+            if (i > 0) buffer += ',';
+            buffer += CellToString(i, id, row);
+        }
+        buffer += '\n';
+        if (buffer.size() >= kBufferBytes) {
+            bytes += buffer.size();
+            out.Write(std::move(buffer));
+            buffer = std::string();
+            buffer.reserve(kBufferBytes + 4096);
+        }
+    }
+    bytes += buffer.size();
+    out.Write(std::move(buffer));
+    out.Close();
+    if (span) span.SetBytes(bytes);
+}
+
+std::vector<std::string> DbTable::GetRow(unsigned int id) const {
+    auto it = rows_.find(id);
+    if (it == rows_.end()) {
+        throw std::out_of_range("Row ID does not exist");
+    }
+    std::vector<std::string> row_data;
+    row_data.reserve(col_descs_.size());
+    for (size_t i = 0; i < col_descs_.size(); ++i) {
+        row_data.push_back(CellToString(i, id, it->second));
+    }
+    return row_data;
+}
+
+DbTable::RowCursor DbTable::Rows() const {
+    RowCursor cursor;
+    cursor.it_ = rows_.begin();
+    cursor.end_ = rows_.end();
+    return cursor;
+}
+
+DbTable::RowCursor DbTable::Seek(unsigned int id) const {
+    RowCursor cursor;
+    cursor.it_ = rows_.lower_bound(id);
+    cursor.end_ = rows_.end();
+    return cursor;
+}
+
+// Reads a cell the way AddToZones does: int64 types as their stored integer, other encoded columns through their
+// typed getters, plain cells straight from the row array.
+Value DbTable::GetValue(const RowCursor& row, unsigned int col_idx) const {
+    if (col_idx >= col_descs_.size()) {
+        throw std::out_of_range("Col index out of range");
+    }
+    const DataType type = col_descs_[col_idx].second;
+    const unsigned int id = row.Id();
+    if (CellIsNull(col_idx, id)) {
+        return Value::Null(type);
+    }
+    const Column* column = columns_[col_idx];
+    if (column != nullptr) {
+        const size_t pos = id - column->BaseId();
+        if (type == DataType::kString) return Value::Text(column->GetString(pos));
+        if (type == DataType::kDouble) return Value::Number(column->GetNumber(pos));
+        if (type == DataType::kInt) return Value::Integer(type, static_cast<int64_t>(column->GetNumber(pos)));
+        return Value::Integer(type, column->GetInteger(pos));
+    }
+    const void* cell = row.it_->second[col_idx];
+    if (type == DataType::kString) return Value::Text(*static_cast<const std::string*>(cell));
+    if (type == DataType::kDouble) return Value::Number(*static_cast<const double*>(cell));
+    return Value::Integer(type, *static_cast<const int*>(cell));
+}
+
+Encoding DbTable::GetColumnEncoding(unsigned int col_idx) const {
+    if (col_idx >= col_descs_.size()) {
+        throw std::out_of_range("Col index out of range");
+    }
+    return columns_[col_idx] == nullptr ? Encoding::kPlain : columns_[col_idx]->GetEncoding();
+}
+
+const Column* DbTable::GetColumn(unsigned int col_idx) const {
+    if (col_idx >= col_descs_.size()) {
+        throw std::out_of_range("Col index out of range");
+    }
+    return columns_[col_idx];
+}
+
+const ZoneMap& DbTable::GetZoneMap(unsigned int col_idx) const {
+    if (col_idx >= col_descs_.size()) {
+        throw std::out_of_range("Col index out of range");
+    }
+    return zone_maps_[col_idx];
+}
+
+
+TableMemory DbTable::MemoryUsage() const {
+    TableMemory memory;
+    for (size_t i = 0; i < col_descs_.size(); ++i) {
+        ColumnMemory column;
+        column.name = col_descs_[i].first;
+        column.type = col_descs_[i].second;
+        column.encoding = GetColumnEncoding(static_cast<unsigned int>(i));
+        column.data = columns_[i] != nullptr ? columns_[i]->Memory() : cell_memory_[i];
+        column.validity = VectorBuffer(validity_[i]);
+        column.zone_map = zone_maps_[i].Memory();
+        column.stats = stats_[i].Memory();
+        memory.columns.push_back(column);
+    }
+    const size_t rows = rows_.size();
+    memory.row_arrays.used = rows * col_descs_.size() * sizeof(void*);
+    memory.row_arrays.allocated = rows * AllocatedBytes(row_col_capacity_ * sizeof(void*));
+    memory.unused_row_capacity = rows * (row_col_capacity_ - col_descs_.size()) * sizeof(void*);
+    memory.map_nodes.used = rows * sizeof(std::pair<const unsigned int, void**>);
+    memory.map_nodes.allocated = rows * TreeNodeBytes(sizeof(std::pair<const unsigned int, void**>));
+    Footprint& book = memory.bookkeeping;
+    book += VectorBuffer(live_);
+    book += VectorBuffer(zone_rows_);
+    book.used += dirty_chunks_.size() * sizeof(unsigned int);
+    book.allocated += dirty_chunks_.size() * TreeNodeBytes(sizeof(unsigned int));
+    book += VectorBuffer(col_descs_);
+    for (const auto& desc : col_descs_) {
+        book += StringHeap(desc.first);
+    }
+    book += VectorBuffer(columns_);
+    book += VectorBuffer(zone_maps_);
+    book += VectorBuffer(validity_);
+    book += VectorBuffer(cell_memory_);
+    memory.metrics = metrics_.Memory();
+    return memory;
+}
+
+Footprint TableMemory::Total() const {
+    Footprint total = row_arrays;
+    total += map_nodes;
+    total += bookkeeping;
+    total += metrics;
+    for (const ColumnMemory& column : columns) {
+        total += column.Total();
+    }
+    return total;
+}
+
+static const char* EncodingName(Encoding encoding) {
+    switch (encoding) {
+    case Encoding::kPlain: return "plain";
+    case Encoding::kDictionary: return "dictionary";
+    case Encoding::kCompressed: return "compressed";
+    case Encoding::kRunLength: return "run-length";
+    case Encoding::kCompact: return "compact";
+    }
+    return "";
+}
+
+// One line per column and per kind of overhead: bytes used, bytes allocated and the slack between them.
+std::ostream& operator<<(std::ostream& os, const TableMemory& memory) {
+    auto line = [&os](const std::string& label, const std::string& kind, const Footprint& bytes) {
+        os << "  " << std::left << std::setw(32) << label << std::setw(24) << kind << std::right
+           << std::setw(14) << bytes.used << std::setw(14) << bytes.allocated << std::setw(14) << bytes.Slack()
+           << "\n";
+    };
+    os << "  " << std::left << std::setw(32) << "part" << std::setw(24) << "storage" << std::right
+       << std::setw(14) << "used" << std::setw(14) << "allocated" << std::setw(14) << "slack" << "\n";
+    for (const ColumnMemory& column : memory.columns) {
+        line(column.name, std::string(DataTypeName(column.type)) + " " + EncodingName(column.encoding), column.data);
+        Footprint extra = column.validity;
+        extra += column.zone_map;
+        extra += column.stats;
+        line("", "  validity, zones, stats", extra);
+    }
+    line("row arrays", "unused slots: " + std::to_string(memory.unused_row_capacity), memory.row_arrays);
+    line("row map nodes", "", memory.map_nodes);
+    line("bookkeeping", "", memory.bookkeeping);
+    line("metrics", "", memory.metrics);
+    line("total", "", memory.Total());
+    return os;
+}
+
+
+/* Zones of col_idx with live rows whose bounds may satisfy `value op constant`, merged into id ranges. The constant is
+parsed the way the column's scan parses it (so int columns truncate "2.5" to 2 here too, and a date or timestamp is
+compared as the integer it is stored as). A NaN constant or a zone holding NaN cannot be ordered, so such zones are
+always scanned. */
+std::vector<DbTable::ZoneRange> DbTable::ZoneRanges(unsigned int col_idx, CompareOp op, const std::string& value) const {
+    const ZoneMap& zones = zone_maps_[col_idx];
+    const DataType type = col_descs_[col_idx].second;
+    double number = 0;
+    int64_t integer = 0;
+    if (IsInt64Type(type)) {
+        integer = ParseInt64Value(type, value);
+    } else if (type == DataType::kInt) {
+        number = static_cast<double>(std::stoll(value));
+    } else if (type == DataType::kDouble) {
+        number = std::stod(value);
+    }
+    const bool ordered = number == number;
+    std::vector<ZoneRange> ranges;
+    for (size_t zone = 0; zone < zone_rows_.size(); ++zone) {
+        if (zone_rows_[zone] == 0) continue;
+        bool all_match = false;
+        if (type == DataType::kString) {
+            if (!zones.MayMatch(zone, op, value)) continue;
+            all_match = zones.AllMatch(zone, op, value);
+        } else if (IsInt64Type(type)) {
+            if (!zones.MayMatch(zone, op, integer)) continue;
+            all_match = zones.AllMatch(zone, op, integer);
+        } else if (ordered) {
+            if (!zones.MayMatch(zone, op, number)) continue;
+            all_match = zones.AllMatch(zone, op, number);
+        }
+        const unsigned int first_id = static_cast<unsigned int>(zone * ZoneMap::kZoneRows);
+        const unsigned int end_id = next_unique_id_ - first_id > ZoneMap::kZoneRows ?
+            first_id + ZoneMap::kZoneRows : next_unique_id_;
+        if (!ranges.empty() && ranges.back().end_id == first_id && ranges.back().all_match == all_match) {
+            ranges.back().end_id = end_id;
+        } else {
+            ranges.push_back({first_id, end_id, all_match});
+        }
+    }
+    return ranges;
+}
+
+PositionRanges DbTable::ToPositions(const Column* column, const std::vector<ZoneRange>& zones) const {
+    PositionRanges positions;
+    const size_t base = column->BaseId();
+    for (const ZoneRange& zone : zones) {
+        size_t first = zone.first_id > base ? zone.first_id - base : 0;
+        size_t end = zone.end_id > base ? zone.end_id - base : 0;
+        if (end > column->Size()) end = column->Size();
+        if (first >= end) continue;
+        if (!positions.empty() && positions.back().second == first) {
+            positions.back().second = end;
+        } else {
+            positions.emplace_back(first, end);
+        }
+    }
+    return positions;
+}
+
+/* Tracing helpers (see query_trace.hpp); only called while a trace is active. ScanBytes estimates what reading `rows`
+values of a column touches: a row map node and the cell for plain columns, the column's bytes per value otherwise. */
+uint64_t DbTable::ScanBytes(size_t col, uint64_t rows) const {
+    if (columns_[col] != nullptr) {
+        const size_t size = columns_[col]->Size();
+        return size == 0 ? 0 : rows * columns_[col]->Memory().used / size;
+    }
+    size_t cell = sizeof(int);
+    if (col_descs_[col].second == DataType::kString) {
+        cell = sizeof(std::string);
+    } else if (col_descs_[col].second == DataType::kDouble) {
+        cell = sizeof(double);
+    }
+    return rows * (sizeof(std::pair<const unsigned int, void**>) + sizeof(void*) + cell);
+}
+
+uint64_t DbTable::RowsInZones(const std::vector<ZoneRange>& zones) const {
+    uint64_t rows = 0;
+    for (const ZoneRange& zone : zones) {
+        const size_t end = std::min<size_t>((zone.end_id + ZoneMap::kZoneRows - 1) / ZoneMap::kZoneRows, zone_rows_.size());
+        for (size_t z = zone.first_id / ZoneMap::kZoneRows; z < end; ++z) {
+            rows += zone_rows_[z];
+        }
+    }
+    return rows;
+}
+
+std::string DbTable::ScanDetail(size_t col, const std::string& op, const std::string& value) const {
+    std::string detail = col_descs_[col].first;
+    if (!op.empty()) detail += " " + op;
+    if (!value.empty()) detail += " " + value;
+    return detail;
+}
+
+void DbTable::TraceScan(TraceSpan& span, size_t col, uint64_t rows_in, uint64_t rows_out) const {
+    span.SetRows(rows_in, rows_out);
+    span.SetBytes(ScanBytes(col, rows_in));
+}
+
+// ZoneRanges as a ZonePrune operator: rows in are the live rows, rows out those in the zones left to scan.
+std::vector<DbTable::ZoneRange> DbTable::PrunedZones(unsigned int col_idx, CompareOp op, const std::string& value) const {
+    TraceSpan span("ZonePrune");
+    std::vector<ZoneRange> zones = ZoneRanges(col_idx, op, value);
+    if (span) {
+        span.SetRows(rows_.size(), RowsInZones(zones));
+        span.SetBytes(zone_rows_.size() * (sizeof(uint32_t) + 2 * sizeof(int64_t)));
+    }
+    return zones;
+}
+
+/* Scans. Zones that cannot match are never visited. Encoded columns answer from their own storage; plain columns walk
+the part of the row map inside the remaining zones and compare the heap cells in their native type (the constant is
+parsed once, so a bad constant throws std::invalid_argument like AddRow does). */
+std::vector<unsigned int> DbTable::Filter(unsigned int col_idx, CompareOp op, const std::string& value) const {
+    ScopedLatency timer(metrics_, MetricOp::kScan);
+    TraceSpan span("Filter");
+    std::vector<unsigned int> ids = FilterIds(col_idx, op, value);
+    if (span) {
+        span.SetDetail(ScanDetail(col_idx, CompareOpSymbol(op), value));
+        span.SetRows(rows_.size(), ids.size());
+    }
+    return ids;
+}
+
+std::vector<unsigned int> DbTable::FilterIds(unsigned int col_idx, CompareOp op, const std::string& value) const {
+    if (col_idx >= col_descs_.size()) {
+        throw std::out_of_range("Col index out of range");
+    }
+    std::vector<unsigned int> ids;
+    const std::vector<ZoneRange> zones = PrunedZones(col_idx, op, value);
+    TraceSpan scan(columns_[col_idx] != nullptr ? "ColumnScan" : "RowScan");
+    if (columns_[col_idx] != nullptr) {
+        std::vector<uint64_t> scratch;
+        columns_[col_idx]->Filter(op, value, LiveValues(col_idx, scratch), ToPositions(columns_[col_idx], zones), ids);
+        if (scan) TraceScan(scan, col_idx, RowsInZones(zones), ids.size());
+        return ids;
+    }
+    DataType type = col_descs_[col_idx].second;
+    double double_constant = type == DataType::kDouble ? std::stod(value) : 0;
+    long long int_constant = type == DataType::kInt ? std::stoll(value) : 0;
+    for (const ZoneRange& zone : zones) {
+        auto it = rows_.lower_bound(zone.first_id);
+        auto end = rows_.lower_bound(zone.end_id);
+        if (zone.all_match) { // a zone holding a NULL never matches entirely
+            for (; it != end; ++it) ids.push_back(it->first);
+        } else if (type == DataType::kString) {
+            for (; it != end; ++it) {
+                const auto* cell = static_cast<std::string*>(it->second[col_idx]);
+                if (cell != nullptr && Compare(*cell, op, value)) ids.push_back(it->first);
+            }
+        } else if (type == DataType::kDouble) {
+            for (; it != end; ++it) {
+                const auto* cell = static_cast<double*>(it->second[col_idx]);
+                if (cell != nullptr && Compare(*cell, op, double_constant)) ids.push_back(it->first);
+            }
+        } else if (type == DataType::kInt) {
+            for (; it != end; ++it) {
+                const auto* cell = static_cast<int*>(it->second[col_idx]);
+                if (cell != nullptr && Compare(static_cast<long long>(*cell), op, int_constant)) {
+                    ids.push_back(it->first);
+                }
+            }
+        }
+    }
+    if (scan) TraceScan(scan, col_idx, RowsInZones(zones), ids.size());
+    return ids;
+}
+
+// Run-length columns count whole runs with popcounts over the live bitmap instead of listing ids.
+size_t DbTable::Count(unsigned int col_idx, CompareOp op, const std::string& value) const {
+    ScopedLatency timer(metrics_, MetricOp::kScan);
+    if (col_idx >= col_descs_.size()) {
+        throw std::out_of_range("Col index out of range");
+    }
+    TraceSpan span("Count");
+    if (span) span.SetDetail(ScanDetail(col_idx, CompareOpSymbol(op), value));
+    size_t count = 0;
+    if (columns_[col_idx] != nullptr) {
+        const std::vector<ZoneRange> zones = PrunedZones(col_idx, op, value);
+        TraceSpan scan("ColumnScan");
+        std::vector<uint64_t> scratch;
+        count = columns_[col_idx]->CountMatches(op, value, LiveValues(col_idx, scratch),
+                                                ToPositions(columns_[col_idx], zones));
+        if (scan) TraceScan(scan, col_idx, RowsInZones(zones), count);
+    } else {
+        count = FilterIds(col_idx, op, value).size();
+    }
+    span.SetRows(rows_.size(), count);
+    return count;
+}
+
+// Live rows whose validity bit is clear, found a word (64 ids) at a time.
+std::vector<unsigned int> DbTable::FilterNull(unsigned int col_idx) const {
+    ScopedLatency timer(metrics_, MetricOp::kScan);
+    if (col_idx >= col_descs_.size()) {
+        throw std::out_of_range("Col index out of range");
+    }
+    TraceSpan span("FilterNull");
+    std::vector<unsigned int> ids;
+    const std::vector<uint64_t>& bits = validity_[col_idx];
+    for (size_t word = 0; word < bits.size() && word < live_.size(); ++word) {
+        uint64_t nulls = live_[word] & ~bits[word];
+        while (nulls != 0) {
+            ids.push_back(static_cast<unsigned int>(word * 64 + static_cast<size_t>(__builtin_ctzll(nulls))));
+            nulls &= nulls - 1;
+        }
+    }
+    if (span) {
+        span.SetDetail(ScanDetail(col_idx, "IS NULL", ""));
+        span.SetRows(rows_.size(), ids.size());
+        span.SetBytes(2 * std::min(bits.size(), live_.size()) * sizeof(uint64_t));
+    }
+    return ids;
+}
+
+bool DbTable::IsNull(unsigned int id, unsigned int col_idx) const {
+    if (col_idx >= col_descs_.size()) {
+        throw std::out_of_range("Col index out of range");
+    }
+    if (rows_.find(id) == rows_.end()) {
+        throw std::out_of_range("Row ID does not exist");
+    }
+    return CellIsNull(col_idx, id);
+}
+
+size_t DbTable::NullCount(unsigned int col_idx) const {
+    if (col_idx >= col_descs_.size()) {
+        throw std::out_of_range("Col index out of range");
+    }
+    if (validity_[col_idx].empty()) {
+        return 0;
+    }
+    std::vector<uint64_t> scratch;
+    return rows_.size() - CountBits(LiveValues(col_idx, scratch));
+}
+
+std::map<std::string, size_t> DbTable::GroupByCount(unsigned int col_idx) const {
+    ScopedLatency timer(metrics_, MetricOp::kScan);
+    if (col_idx >= col_descs_.size()) {
+        throw std::out_of_range("Col index out of range");
+    }
+    TraceSpan span("GroupByCount");
+    std::map<std::string, size_t> groups;
+    if (columns_[col_idx] != nullptr) {
+        std::vector<uint64_t> scratch;
+        columns_[col_idx]->GroupByCount(LiveValues(col_idx, scratch), groups);
+    } else {
+        for (const auto& [id, row] : rows_) {
+            if (row[col_idx] != nullptr) ++groups[CellToString(col_idx, id, row)];
+        }
+    }
+    if (span) {
+        span.SetDetail(ScanDetail(col_idx, "", ""));
+        TraceScan(span, col_idx, rows_.size(), groups.size());
+    }
+    return groups;
+}
+
+/* Aggregates over the numeric values of a column (kCount also works for strings). Compressed columns decode one block
+at a time; plain columns walk the row map. */
+double DbTable::Aggregate(unsigned int col_idx, AggregateFn fn) const {
+    ScopedLatency timer(metrics_, MetricOp::kScan);
+    if (col_idx >= col_descs_.size()) {
+        throw std::out_of_range("Col index out of range");
+    }
+    DataType type = col_descs_[col_idx].second;
+    TraceSpan span("Aggregate");
+    if (span) {
+        span.SetDetail(std::string(AggregateFnName(fn)) + "(" + col_descs_[col_idx].first + ")");
+        span.SetRows(rows_.size(), 1);
+    }
+    if (fn == AggregateFn::kCount) {
+        if (span) span.SetBytes(2 * live_.size() * sizeof(uint64_t));
+        return static_cast<double>(rows_.size() - NullCount(col_idx));
+    }
+    if (type == DataType::kString) {
+        throw std::invalid_argument("Cannot aggregate a string column");
+    }
+    if (span) span.SetBytes(ScanBytes(col_idx, rows_.size()));
+    if (columns_[col_idx] != nullptr) {
+        std::vector<uint64_t> scratch;
+        return columns_[col_idx]->Aggregate(LiveValues(col_idx, scratch)).Result(fn);
+    }
+    AggregateState state;
+    for (const auto& [id, row] : rows_) {
+        if (row[col_idx] == nullptr) continue;
+        if (type == DataType::kDouble) {
+            state.Add(*static_cast<double*>(row[col_idx]));
+        } else {
+            state.Add(*static_cast<int*>(row[col_idx]));
+        }
+    }
+    return state.Result(fn);
+}
+
+
+void DbTable::Analyze() {
+    TraceSpan span("Analyze");
+    for (size_t i = 0; i < col_descs_.size(); ++i) {
+        stats_[i].BeginAnalyze();
+        for (const auto& [id, row] : rows_) {
+            AddValueToStats(stats_[i], i, id, row);
+        }
+        stats_[i].FinishAnalyze();
+    }
+    span.SetRows(rows_.size(), rows_.size());
+}
+
+const ColumnStats& DbTable::GetColumnStats(unsigned int col_idx) const {
+    if (col_idx >= col_descs_.size()) {
+        throw std::out_of_range("Col index out of range");
+    }
+    return stats_[col_idx];
+}
+
+double DbTable::NullFraction(size_t col) const {
+    return rows_.empty() ? 0 : static_cast<double>(NullCount(static_cast<unsigned int>(col))) /
+                                   static_cast<double>(rows_.size());
+}
+
+// The constant is parsed like ZoneRanges parses it, so it lands in the same domain as the values that were counted.
+double DbTable::EstimateSelectivity(unsigned int col_idx, CompareOp op, const std::string& value) const {
+    const ColumnStats& stats = GetColumnStats(col_idx);
+    const DataType type = col_descs_[col_idx].second;
+    double selectivity = 0;
+    if (type == DataType::kString) {
+        selectivity = stats.Selectivity(op, value);
+    } else if (IsInt64Type(type)) {
+        selectivity = stats.Selectivity(op, static_cast<double>(ParseInt64Value(type, value)));
+    } else if (type == DataType::kInt) {
+        selectivity = stats.Selectivity(op, static_cast<double>(std::stoll(value)));
+    } else {
+        selectivity = stats.Selectivity(op, std::stod(value));
+    }
+    return selectivity * (1 - NullFraction(col_idx));
+}
+
+double DbTable::EstimateDistinct(unsigned int col_idx) const {
+    return GetColumnStats(col_idx).DistinctCount();
+}
+
+double DbTable::EstimateJoinSelectivity(const DbTable& left, unsigned int left_col,
+                                        const DbTable& right, unsigned int right_col) {
+    const double distinct = std::max({left.EstimateDistinct(left_col), right.EstimateDistinct(right_col), 1.0});
+    return (1 - left.NullFraction(left_col)) * (1 - right.NullFraction(right_col)) / distinct;
+}
+
+uint64_t DbTable::EstimateScanRows(unsigned int col_idx, CompareOp op, const std::string& value) const {
+    if (col_idx >= col_descs_.size()) {
+        throw std::out_of_range("Col index out of range");
+    }
+    return RowsInZones(ZoneRanges(col_idx, op, value));
+}
+
+// Every zone whose [min, max] holds the value is visited whole, so a zone counts with the part of the column's range
+// it covers (integer ranges count their endpoints: a zone holding a single key covers one value of the range).
+double DbTable::EstimateLookupRows(unsigned int col_idx) const {
+    if (col_idx >= col_descs_.size()) {
+        throw std::out_of_range("Col index out of range");
+    }
+    const DataType type = col_descs_[col_idx].second;
+    if (type == DataType::kString) return static_cast<double>(rows_.size());
+    const ZoneMap& zones = zone_maps_[col_idx];
+    const size_t count = std::min(zones.ZoneCount(), zone_rows_.size());
+    std::vector<std::pair<double, double>> bounds(count);
+    double lo = std::numeric_limits<double>::infinity();
+    double hi = -std::numeric_limits<double>::infinity();
+    for (size_t zone = 0; zone < count; ++zone) {
+        if (!zones.HasValues(zone) || zone_rows_[zone] == 0) continue;
+        if (IsInt64Type(type)) {
+            bounds[zone] = {static_cast<double>(zones.MinInteger(zone)), static_cast<double>(zones.MaxInteger(zone))};
+        } else {
+            bounds[zone] = {zones.Min(zone), zones.Max(zone)};
+        }
+        lo = std::min(lo, bounds[zone].first);
+        hi = std::max(hi, bounds[zone].second);
+    }
+    if (!(hi > lo)) return static_cast<double>(rows_.size());
+    const double step = type == DataType::kDouble ? 0 : 1;
+    double rows = 0;
+    for (size_t zone = 0; zone < count; ++zone) {
+        if (!zones.HasValues(zone) || zone_rows_[zone] == 0) continue;
+        const double covered = (bounds[zone].second - bounds[zone].first + step) / (hi - lo + step);
+        rows += zone_rows_[zone] * std::min(covered, 1.0);
+    }
+    return rows;
+}
+
+void DbTable::AttachLog(WriteAheadLog* wal, const std::string& table_name) {
+    wal_ = wal;
+    wal_name_ = table_name;
+}
+
+void DbTable::DetachLog() {
+    wal_ = nullptr;
+    wal_name_.clear();
+}
+
+void DbTable::AddListener(TableListener* listener) {
+    listeners_.push_back(listener);
+}
+
+void DbTable::RemoveListener(TableListener* listener) {
+    listeners_.erase(std::remove(listeners_.begin(), listeners_.end(), listener), listeners_.end());
+}
+
+
+/* Binary image of the table: schema (next id, capacity, column descriptions, zone maps) followed by every row as
+(id, cells). Cells are written natively (length-prefixed strings, 8-byte doubles, 4-byte ints, 8-byte int64 values,
+1-byte bools) whatever the column's encoding; in a column that holds NULLs every cell is preceded by a presence byte (0 = NULL, no cell follows). */
+void DbTable::Serialize(BinaryWriter& out) const {
+    SerializeSchema(out);
+    out.PutU32(static_cast<uint32_t>(rows_.size()));
+    for (const auto& [id, row] : rows_) {
+        SerializeRow(id, row, out);
+    }
+}
+
+void DbTable::Deserialize(BinaryReader& in) {
+    DeserializeSchema(in);
+    DeserializeRows(in);
+}
+
+void DbTable::SerializeSchema(BinaryWriter& out) const {
+    out.PutU32(next_unique_id_);
+    out.PutU32(row_col_capacity_);
+    out.PutU32(static_cast<uint32_t>(col_descs_.size()));
+    for (size_t i = 0; i < col_descs_.size(); ++i) {
+        out.PutString(col_descs_[i].first);
+        out.PutU8(static_cast<uint8_t>(col_descs_[i].second));
+        out.PutU8(static_cast<uint8_t>(GetColumnEncoding(static_cast<unsigned int>(i))));
+        out.PutU32(columns_[i] == nullptr ? 0 : columns_[i]->BaseId());
+        out.PutU8(validity_[i].empty() ? 0 : 1);
+    }
+    for (const ZoneMap& zones : zone_maps_) {
+        zones.Serialize(out);
+    }
+}
+
+// Replaces the whole table by an empty one with the schema read from in.
+void DbTable::DeserializeSchema(BinaryReader& in) {
+    ClearRows();
+    ClearColumns();
+    all_dirty_ = true;
+    dirty_chunks_.clear();
+    next_unique_id_ = in.GetU32();
+    row_col_capacity_ = in.GetU32();
+    uint32_t num_cols = in.GetU32();
+    if (num_cols > row_col_capacity_) {
+        throw std::runtime_error("Corrupt table image");
+    }
+    for (uint32_t i = 0; i < num_cols; ++i) {
+        std::string name = in.GetString();
+        uint8_t type = in.GetU8();
+        uint8_t encoding = in.GetU8();
+        unsigned int base_id = in.GetU32();
+        bool has_nulls = in.GetU8() != 0;
+        if (!IsKnownDataType(type) || !IsKnownEncoding(encoding)) {
+            throw std::runtime_error("Corrupt table image");
+        }
+        col_descs_.emplace_back(name, static_cast<DataType>(type));
+        columns_.push_back(NewColumn(static_cast<DataType>(type), static_cast<Encoding>(encoding), base_id));
+        zone_maps_.emplace_back(static_cast<DataType>(type));
+        cell_memory_.emplace_back();
+        stats_.emplace_back(static_cast<DataType>(type));
+        // A bitmap with no NULL yet: its presence alone makes the rows carry presence bytes.
+        validity_.emplace_back(has_nulls ? 1 : 0, ~uint64_t{0});
+    }
+    for (ZoneMap& zones : zone_maps_) {
+        zones.Deserialize(in);
+    }
+}
+
+// Writes (row count, rows) for the ids in [chunk * kChunkRows, (chunk + 1) * kChunkRows).
+void DbTable::SerializeChunk(unsigned int chunk, BinaryWriter& out) const {
+    auto begin = rows_.lower_bound(chunk * kChunkRows);
+    auto end = rows_.lower_bound((chunk + 1) * kChunkRows);
+    size_t count_pos = out.Size();
+    out.PutU32(0);
+    uint32_t count = 0;
+    for (auto it = begin; it != end; ++it, ++count) {
+        SerializeRow(it->first, it->second, out);
+    }
+    BinaryWriter count_bytes;
+    count_bytes.PutU32(count);
+    out.Data().replace(count_pos, 4, count_bytes.Data());
+}
+
+// Adds the rows of one serialized chunk (or of a full image) to the table. Chunks must arrive in id order.
+void DbTable::DeserializeChunk(BinaryReader& in) {
+    DeserializeRows(in);
+}
+
+bool DbTable::ChunkEmpty(unsigned int chunk) const {
+    auto it = rows_.lower_bound(chunk * kChunkRows);
+    return it == rows_.end() || it->first >= (chunk + 1) * kChunkRows;
+}
+
+// Chunks that changed since the last ClearDirty(). After a schema change that is every chunk holding rows.
+std::vector<unsigned int> DbTable::DirtyChunks() const {
+    if (!all_dirty_) {
+        return std::vector<unsigned int>(dirty_chunks_.begin(), dirty_chunks_.end());
+    }
+    return Chunks();
+}
+
+// Every chunk that holds at least one row (one map lookup per chunk, not per row).
+std::vector<unsigned int> DbTable::Chunks() const {
+    std::vector<unsigned int> chunks;
+    auto it = rows_.begin();
+    while (it != rows_.end()) {
+        unsigned int chunk = it->first / kChunkRows;
+        chunks.push_back(chunk);
+        it = rows_.lower_bound((chunk + 1) * kChunkRows);
+    }
+    return chunks;
+}
+
+void DbTable::ClearDirty() {
+    all_dirty_ = false;
+    dirty_chunks_.clear();
+}
+
+void DbTable::MarkDirty(unsigned int id) {
+    if (!all_dirty_) {
+        dirty_chunks_.insert(id / kChunkRows);
+    }
+}
+
+void DbTable::SerializeRow(unsigned int id, void** row, BinaryWriter& out) const {
+    out.PutU32(id);
+    for (size_t i = 0; i < col_descs_.size(); ++i) {
+        if (!validity_[i].empty()) {
+            const bool null = CellIsNull(i, id);
+            out.PutU8(null ? 0 : 1);
+            if (null) continue;
+        }
+        if (columns_[i] != nullptr) {
+            columns_[i]->SerializeValue(id - columns_[i]->BaseId(), out);
+        } else if (col_descs_[i].second == DataType::kString) {
+            out.PutString(*static_cast<std::string*>(row[i]));
+        } else if (col_descs_[i].second == DataType::kDouble) {
+            out.PutDouble(*static_cast<double*>(row[i]));
+        } else if (col_descs_[i].second == DataType::kInt) {
+            out.PutI32(*static_cast<int*>(row[i]));
+        }
+    }
+}
+
+void DbTable::DeserializeRows(BinaryReader& in) {
+    uint32_t num_rows = in.GetU32();
+    for (uint32_t r = 0; r < num_rows; ++r) {
+        unsigned int id = in.GetU32();
+        if (rows_.find(id) != rows_.end() || id >= next_unique_id_ ||
+            (!rows_.empty() && id < rows_.rbegin()->first)) {
+            throw std::runtime_error("Corrupt table image");
+        }
+        void** row = new void*[row_col_capacity_];
+        rows_[id] = row; // registered first so a truncated image is still freed by ClearRows
+        ++data_version_;
+        SetLive(id, true);
+        for (size_t i = 0; i < col_descs_.size(); ++i) {
+            row[i] = nullptr;
+        }
+        for (size_t i = 0; i < col_descs_.size(); ++i) {
+            const bool null = !validity_[i].empty() && in.GetU8() == 0;
+            if (null) {
+                SetNull(i, id);
+            }
+            if (columns_[i] != nullptr) {
+                if (id < columns_[i]->BaseId()) {
+                    throw std::runtime_error("Corrupt table image");
+                }
+                PadColumn(i, id);
+                if (null) {
+                    columns_[i]->AppendNull();
+                } else {
+                    columns_[i]->AppendSerialized(in);
+                }
+            } else if (null) {
+                continue;
+            } else if (col_descs_[i].second == DataType::kString) {
+                row[i] = TrackCell(i, new std::string(in.GetString()));
             } else if (col_descs_[i].second == DataType::kDouble) {
-                double value = *static_cast<double*>(row[i]);
-                row_data.push_back(std::to_string(value));
+                row[i] = TrackCell(i, new double(in.GetDouble()));
             } else if (col_descs_[i].second == DataType::kInt) {
-                int value = *static_cast<int*>(row[i]);
-                row_data.push_back(std::to_string(value));
+                row[i] = TrackCell(i, new int(in.GetI32()));
             }
         }
-        rows_output.push_back(std::move(row_data));
+        CountZoneRow(id);  // the zone maps themselves came with the schema
+        AddToStats(id, row);
     }
-    return rows_output;
 }
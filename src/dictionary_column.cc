@@ -0,0 +1,148 @@
+#include "dictionary_column.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+
+uint32_t DictionaryColumn::CodeAt(size_t pos) const {
+    if (width_ == 1) return codes8_[pos];
+    if (width_ == 2) return codes16_[pos];
+    return codes32_[pos];
+}
+
+// Returns the code of text, adding it to the dictionary (and widening the codes) when it is new.
+uint32_t DictionaryColumn::Intern(const std::string& text) {
+    auto it = lookup_.find(text);
+    if (it != lookup_.end()) return it->second;
+    uint32_t code = static_cast<uint32_t>(dictionary_.size());
+    if (code == 256 && width_ < 2) {
+        Widen(2);
+    } else if (code == 65536 && width_ < 4) {
+        Widen(4);
+    }
+    dictionary_.push_back(text);
+    lookup_.emplace(text, code);
+    return code;
+}
+
+void DictionaryColumn::AppendCode(uint32_t code) {
+    if (width_ == 1) {
+        codes8_.push_back(static_cast<uint8_t>(code));
+    } else if (width_ == 2) {
+        codes16_.push_back(static_cast<uint16_t>(code));
+    } else {
+        codes32_.push_back(code);
+    }
+    ++size_;
+}
+
+void DictionaryColumn::PopBack() {
+    if (width_ == 1) {
+        codes8_.pop_back();
+    } else if (width_ == 2) {
+        codes16_.pop_back();
+    } else {
+        codes32_.pop_back();
+    }
+    --size_;
+}
+
+// Re-encodes every code with a wider width (1 -> 2 -> 4 bytes).
+void DictionaryColumn::Widen(unsigned int width) {
+    if (width == 2) {
+        codes16_.assign(codes8_.begin(), codes8_.end());
+        std::vector<uint8_t>().swap(codes8_);
+    } else if (width_ == 1) {
+        codes32_.assign(codes8_.begin(), codes8_.end());
+        std::vector<uint8_t>().swap(codes8_);
+    } else {
+        codes32_.assign(codes16_.begin(), codes16_.end());
+        std::vector<uint16_t>().swap(codes16_);
+    }
+    width_ = width;
+}
+
+// Tight per-width loop: one byte/short/int load and one table lookup per row.
+template <typename Code>
+void DictionaryColumn::FilterCodes(const std::vector<Code>& codes, const std::vector<char>& match,
+                                   const std::vector<uint64_t>& live, const PositionRanges& ranges,
+                                   std::vector<unsigned int>& out) const {
+    for (const auto& [begin, end] : ranges) {
+        for (size_t pos = begin; pos < end; ++pos) {
+            unsigned int id = base_id_ + static_cast<unsigned int>(pos);
+            if (match[codes[pos]] && IsLive(live, id)) {
+                out.push_back(id);
+            }
+        }
+    }
+}
+
+template <typename Code>
+void DictionaryColumn::CountCodes(const std::vector<Code>& codes, const std::vector<uint64_t>& live,
+                                  std::vector<size_t>& counts) const {
+    for (size_t pos = 0; pos < size_; ++pos) {
+        if (IsLive(live, base_id_ + static_cast<unsigned int>(pos))) {
+            ++counts[codes[pos]];
+        }
+    }
+}
+
+/* The predicate is evaluated once per dictionary entry into a match table indexed by code; rows then only compare
+codes. For kEq that table has a single entry set (or none when the constant is not in the dictionary at all). */
+void DictionaryColumn::Filter(CompareOp op, const std::string& constant, const std::vector<uint64_t>& live,
+                              const PositionRanges& ranges, std::vector<unsigned int>& out) const {
+    std::vector<char> match(dictionary_.size(), 0);
+    if (op == CompareOp::kEq || op == CompareOp::kNe) {
+        auto it = lookup_.find(constant);
+        if (op == CompareOp::kNe) std::fill(match.begin(), match.end(), 1);
+        if (it != lookup_.end()) {
+            match[it->second] = op == CompareOp::kEq ? 1 : 0;
+        } else if (op == CompareOp::kEq) {
+            return;  // no row can match
+        }
+    } else {
+        for (size_t code = 0; code < dictionary_.size(); ++code) {
+            match[code] = Compare(dictionary_[code], op, constant) ? 1 : 0;
+        }
+    }
+    if (width_ == 1) {
+        FilterCodes(codes8_, match, live, ranges, out);
+    } else if (width_ == 2) {
+        FilterCodes(codes16_, match, live, ranges, out);
+    } else {
+        FilterCodes(codes32_, match, live, ranges, out);
+    }
+}
+
+void DictionaryColumn::GroupByCount(const std::vector<uint64_t>& live, std::map<std::string, size_t>& out) const {
+    std::vector<size_t> counts(dictionary_.size(), 0);
+    if (width_ == 1) {
+        CountCodes(codes8_, live, counts);
+    } else if (width_ == 2) {
+        CountCodes(codes16_, live, counts);
+    } else {
+        CountCodes(codes32_, live, counts);
+    }
+    for (size_t code = 0; code < counts.size(); ++code) {
+        if (counts[code] > 0) out[dictionary_[code]] += counts[code];
+    }
+}
+
+// Codes, the dictionary and its lookup table; every distinct string is held twice (dictionary_ and lookup_ keys).
+Footprint DictionaryColumn::Memory() const {
+    Footprint footprint;
+    footprint.Add(sizeof(DictionaryColumn));
+    footprint += VectorBuffer(codes8_);
+    footprint += VectorBuffer(codes16_);
+    footprint += VectorBuffer(codes32_);
+    footprint += VectorBuffer(dictionary_);
+    for (const std::string& value : dictionary_) {
+        footprint += StringHeap(value);
+    }
+    footprint.Add(lookup_.bucket_count() * sizeof(void*));
+    for (const auto& entry : lookup_) {
+        footprint.Add(sizeof(void*) + sizeof(entry) + sizeof(size_t));  // next pointer, value, cached hash
+        footprint += StringHeap(entry.first);
+    }
+    return footprint;
+}
@@ -1,5 +1,5 @@
 #include <iostream>
-#include <fstream>
+#include <stdexcept>
 #include <vector>
 #include <string>
 #include "db.hpp"
@@ -7,34 +7,12 @@
 
 // Function to export a table to a CSV file
 void ExportTableToCSV(const DbTable& table, const std::string& filename) {
-    std::ofstream csv_file(filename);
-    if (!csv_file.is_open()) {
-        std::cerr << "Failed to create " << filename << std::endl;
+    try {
+        table.ExportCsv(filename);
+    } catch (const std::runtime_error& e) {
+        std::cerr << "Failed to create " << filename << ": " << e.what() << std::endl;
         return;
     }
-
-    // Write the CSV header (column names)
-    const auto& column_descriptions = table.GetColumnDescriptions();
-    for (size_t i = 0; i < column_descriptions.size(); ++i) {
-        csv_file << column_descriptions[i].first; // Access column name
-        if (i < column_descriptions.size() - 1) {
-            csv_file << ",";
-        }
-    }
-    csv_file << "\n";
-
-    // Write the data rows
-    for (const auto& row : table.GetRows()) {
-        for (size_t i = 0; i < row.size(); ++i) {
-            csv_file << row[i];
-            if (i < row.size() - 1) {
-                csv_file << ",";
-            }
-        }
-        csv_file << "\n";
-    }
-
-    csv_file.close();
     std::cout << "Exported table to " << filename << std::endl;
 }
 
@@ -55,15 +33,15 @@ int main() {
         DbTable& stats_ = db.GetTable("league_data");
         stats_.AddColumn({"Team_Name", DataType::kString});
         stats_.AddColumn({"Ranking", DataType::kInt});
-        stats_.AddColumn({"Goal", DataType::kInt});
+        stats_.AddColumn({"Goal", DataType::kInt}, Encoding::kCompressed);
         stats_.AddColumn({"Average_shots_per_game", DataType::kDouble});
         stats_.AddColumn({"Average_shots_on_target_per_game", DataType::kDouble});
         stats_.AddColumn({"Average_passes_per_game", DataType::kInt});
         stats_.AddColumn({"Probability_of_successful_passes_per_game", DataType::kDouble});
         stats_.AddColumn({"Key_passes", DataType::kInt});
         stats_.AddColumn({"Goals_conceded", DataType::kInt});
-        stats_.AddColumn({"Tackles", DataType::kInt});
-        stats_.AddColumn({"Clearance", DataType::kInt});
+        stats_.AddColumn({"Tackles", DataType::kInt}, Encoding::kCompressed);
+        stats_.AddColumn({"Clearance", DataType::kInt}, Encoding::kCompressed);
 
         stats_.AddRow({"Shanghai ShenHua FC", "1", "23", "17.6", "5.9", "415", "0.8", "153", "12", "185", "275"});
         stats_.AddRow({"Chengdu RongCheng FC", "2", "18", "18.3", "6.9", "442", "0.79", "138", "7", "174", "246"});
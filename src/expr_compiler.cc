@@ -0,0 +1,561 @@
+#include "expr_compiler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+#include "value_types.hpp"
+
+namespace {
+
+const Row kNoRow;
+
+bool IsIntegerType(DataType type) {
+    return type != DataType::kString && type != DataType::kDouble;
+}
+
+// How a node reaches the value of one of its operands while a batch runs.
+struct Operand {
+    DataType type = DataType::kInt;
+    int slot = -1;                          // a column of the batch
+    bool constant = false;                  // a literal, or a parameter read once per batch
+    Value literal;
+    std::shared_ptr<const Expr> parameter;
+    Kernel kernel;                          // any other node, computed into scratch
+    std::shared_ptr<ValueVector> scratch;
+
+    bool NullLiteral() const { return constant && !parameter && literal.null; }
+};
+
+// An operand during one run: a vector, or a constant.
+struct Arg {
+    const ValueVector* vector = nullptr;
+    Value constant;
+};
+
+Arg Fetch(const Operand& operand, const Batch& batch) {
+    Arg arg;
+    if (operand.slot >= 0) {
+        arg.vector = &batch.columns[static_cast<size_t>(operand.slot)];
+    } else if (operand.kernel) {
+        operand.kernel(batch, *operand.scratch);
+        arg.vector = operand.scratch.get();
+    } else if (operand.parameter) {
+        arg.constant = Evaluate(*operand.parameter, kNoRow);
+        if (!arg.constant.null && arg.constant.type != operand.type) {  // the loops were picked for the planned type
+            throw std::invalid_argument("Parameter ?" + std::to_string(operand.parameter->parameter + 1) +
+                                        " is not of type " + DataTypeName(operand.type));
+        }
+    } else {
+        arg.constant = operand.literal;
+    }
+    return arg;
+}
+
+/*------------------------------------------------------------------------------------------------------------------
+ Readers hand the loops operand i. Every loop is a template over its readers, so a loop over a column and a constant
+ is compiled separately from one over two columns, and the type conversions of Value::AsDouble happen inline.
+------------------------------------------------------------------------------------------------------------------*/
+
+struct DoubleColumn {
+    const double* values;
+    const uint8_t* nulls;
+    static DoubleColumn From(const Arg& arg) { return {arg.vector->numbers.data(), arg.vector->nulls.data()}; }
+    double operator[](size_t i) const { return values[i]; }
+    bool Null(size_t i) const { return nulls[i] != 0; }
+};
+
+// Integer-backed values read as doubles, kDecimal scaled back (like Int64ValueToDouble).
+struct ScaledColumn {
+    const int64_t* values;
+    const uint8_t* nulls;
+    double scale;
+    static ScaledColumn From(const Arg& arg) {
+        const double scale = arg.vector->type == DataType::kDecimal ? static_cast<double>(kDecimalScale) : 1.0;
+        return {arg.vector->integers.data(), arg.vector->nulls.data(), scale};
+    }
+    double operator[](size_t i) const { return static_cast<double>(values[i]) / scale; }
+    bool Null(size_t i) const { return nulls[i] != 0; }
+};
+
+struct IntegerColumn {
+    const int64_t* values;
+    const uint8_t* nulls;
+    static IntegerColumn From(const Arg& arg) { return {arg.vector->integers.data(), arg.vector->nulls.data()}; }
+    int64_t operator[](size_t i) const { return values[i]; }
+    bool Null(size_t i) const { return nulls[i] != 0; }
+};
+
+struct TextColumn {
+    const std::string* const* values;
+    const uint8_t* nulls;
+    static TextColumn From(const Arg& arg) { return {arg.vector->texts.data(), arg.vector->nulls.data()}; }
+    const std::string& operator[](size_t i) const { return *values[i]; }
+    bool Null(size_t i) const { return nulls[i] != 0; }
+};
+
+template <typename T>
+struct Constant {
+    T value;
+    bool null;
+    static Constant From(const Arg& arg);
+    const T& operator[](size_t) const { return value; }
+    bool Null(size_t) const { return null; }
+};
+
+template <>
+Constant<double> Constant<double>::From(const Arg& arg) {
+    return {arg.constant.null ? 0 : arg.constant.AsDouble(), arg.constant.null};
+}
+
+template <>
+Constant<int64_t> Constant<int64_t>::From(const Arg& arg) {
+    return {arg.constant.null ? 0 : arg.constant.integer, arg.constant.null};
+}
+
+template <>
+Constant<std::string> Constant<std::string>::From(const Arg& arg) {
+    return {arg.constant.text, arg.constant.null};
+}
+
+template <typename T>
+struct Tag {
+    using type = T;
+};
+
+// The readers of operands read as doubles, integers or strings: With calls f with the tag of the one for operand.
+struct DoubleReaders {
+    template <typename F>
+    static Kernel With(const Operand& operand, F&& f) {
+        if (operand.constant) return f(Tag<Constant<double>>());
+        if (operand.type == DataType::kDouble) return f(Tag<DoubleColumn>());
+        return f(Tag<ScaledColumn>());
+    }
+};
+
+struct IntegerReaders {
+    template <typename F>
+    static Kernel With(const Operand& operand, F&& f) {
+        if (operand.constant) return f(Tag<Constant<int64_t>>());
+        return f(Tag<IntegerColumn>());
+    }
+};
+
+struct TextReaders {
+    template <typename F>
+    static Kernel With(const Operand& operand, F&& f) {
+        if (operand.constant) return f(Tag<Constant<std::string>>());
+        return f(Tag<TextColumn>());
+    }
+};
+
+template <typename Readers, typename Loop>
+Kernel UnaryKernel(const Operand& operand, DataType type, Loop loop) {
+    return Readers::With(operand, [&](auto tag) -> Kernel {
+        using A = typename decltype(tag)::type;
+        return [operand, type, loop](const Batch& batch, ValueVector& out) {
+            const Arg a = Fetch(operand, batch);
+            out.Reset(type, batch.size);
+            loop(A::From(a), batch.size, out);
+        };
+    });
+}
+
+template <typename Readers, typename Loop>
+Kernel BinaryKernel(const Operand& left, const Operand& right, DataType type, Loop loop) {
+    return Readers::With(left, [&](auto left_tag) {
+        return Readers::With(right, [&](auto right_tag) -> Kernel {
+            using L = typename decltype(left_tag)::type;
+            using R = typename decltype(right_tag)::type;
+            return [left, right, type, loop](const Batch& batch, ValueVector& out) {
+                const Arg a = Fetch(left, batch);
+                const Arg b = Fetch(right, batch);
+                out.Reset(type, batch.size);
+                loop(L::From(a), R::From(b), batch.size, out);
+            };
+        });
+    });
+}
+
+/*------------------------------------------------------------------------------------------------------------------
+ Loops. NULL operands and undefined results (division by zero) give NULL, which holds 0. Integer overflow is only
+ reported for rows that are not NULL, after the loop.
+------------------------------------------------------------------------------------------------------------------*/
+
+struct DoubleAdd {
+    static bool Defined(double) { return true; }
+    static double Apply(double x, double y) { return x + y; }
+};
+struct DoubleSub {
+    static bool Defined(double) { return true; }
+    static double Apply(double x, double y) { return x - y; }
+};
+struct DoubleMul {
+    static bool Defined(double) { return true; }
+    static double Apply(double x, double y) { return x * y; }
+};
+struct DoubleDiv {
+    static bool Defined(double y) { return y != 0; }
+    static double Apply(double x, double y) { return x / y; }
+};
+struct DoubleMod {
+    static bool Defined(double y) { return y != 0; }
+    static double Apply(double x, double y) { return std::fmod(x, y); }
+};
+
+template <typename Op>
+struct DoubleLoop {
+    template <typename L, typename R>
+    void operator()(const L& l, const R& r, size_t n, ValueVector& out) const {
+        double* values = out.numbers.data();
+        uint8_t* nulls = out.nulls.data();
+        for (size_t i = 0; i < n; ++i) {
+            const double x = l[i];
+            const double y = r[i];
+            const bool null = l.Null(i) || r.Null(i) || !Op::Defined(y);
+            values[i] = null ? 0 : Op::Apply(x, y);
+            nulls[i] = null;
+        }
+    }
+};
+
+// Apply returns true on overflow.
+struct IntegerAdd {
+    static bool Defined(int64_t) { return true; }
+    static bool Apply(int64_t x, int64_t y, int64_t& result) { return __builtin_add_overflow(x, y, &result); }
+};
+struct IntegerSub {
+    static bool Defined(int64_t) { return true; }
+    static bool Apply(int64_t x, int64_t y, int64_t& result) { return __builtin_sub_overflow(x, y, &result); }
+};
+struct IntegerMul {
+    static bool Defined(int64_t) { return true; }
+    static bool Apply(int64_t x, int64_t y, int64_t& result) { return __builtin_mul_overflow(x, y, &result); }
+};
+struct IntegerDiv {
+    static bool Defined(int64_t y) { return y != 0; }
+    static bool Apply(int64_t x, int64_t y, int64_t& result) {
+        if (y == -1) return __builtin_sub_overflow(int64_t(0), x, &result);  // INT64_MIN / -1 does not fit
+        result = x / (y == 0 ? 1 : y);
+        return false;
+    }
+};
+struct IntegerMod {
+    static bool Defined(int64_t y) { return y != 0; }
+    static bool Apply(int64_t x, int64_t y, int64_t& result) {
+        result = y == 0 || y == -1 ? 0 : x % y;
+        return false;
+    }
+};
+
+template <typename Op>
+struct IntegerLoop {
+    template <typename L, typename R>
+    void operator()(const L& l, const R& r, size_t n, ValueVector& out) const {
+        int64_t* values = out.integers.data();
+        uint8_t* nulls = out.nulls.data();
+        bool overflow = false;
+        for (size_t i = 0; i < n; ++i) {
+            const int64_t y = r[i];
+            int64_t result = 0;
+            const bool null = l.Null(i) || r.Null(i) || !Op::Defined(y);
+            overflow |= Op::Apply(l[i], y, result) && !null;
+            values[i] = null ? 0 : result;
+            nulls[i] = null;
+        }
+        if (overflow) throw std::out_of_range("Integer overflow");
+    }
+};
+
+// Three-way comparisons exactly like CompareValues (a NaN compares equal).
+int ThreeWay(int64_t x, int64_t y) {
+    return (x > y) - (x < y);
+}
+
+int ThreeWay(double x, double y) {
+    return (x > y) - (x < y);
+}
+
+int ThreeWay(const std::string& x, const std::string& y) {
+    return x.compare(y);
+}
+
+template <CompareOp kOp>
+struct CompareLoop {
+    template <typename L, typename R>
+    void operator()(const L& l, const R& r, size_t n, ValueVector& out) const {
+        int64_t* values = out.integers.data();
+        uint8_t* nulls = out.nulls.data();
+        for (size_t i = 0; i < n; ++i) {
+            const bool null = l.Null(i) || r.Null(i);
+            values[i] = !null && Compare(ThreeWay(l[i], r[i]), kOp, 0);
+            nulls[i] = null;
+        }
+    }
+};
+
+// Three-valued AND and OR over integer truth values (non-zero is true).
+struct AndLoop {
+    template <typename L, typename R>
+    void operator()(const L& l, const R& r, size_t n, ValueVector& out) const {
+        int64_t* values = out.integers.data();
+        uint8_t* nulls = out.nulls.data();
+        for (size_t i = 0; i < n; ++i) {
+            const bool left_null = l.Null(i);
+            const bool right_null = r.Null(i);
+            const bool left_false = !left_null && (l[i] == 0);
+            const bool right_false = !right_null && (r[i] == 0);
+            values[i] = !left_null && !right_null && !left_false && !right_false;
+            nulls[i] = !left_false && !right_false && (left_null || right_null);
+        }
+    }
+};
+
+struct OrLoop {
+    template <typename L, typename R>
+    void operator()(const L& l, const R& r, size_t n, ValueVector& out) const {
+        int64_t* values = out.integers.data();
+        uint8_t* nulls = out.nulls.data();
+        for (size_t i = 0; i < n; ++i) {
+            const bool left_null = l.Null(i);
+            const bool right_null = r.Null(i);
+            const bool either = (!left_null && (l[i] != 0)) || (!right_null && (r[i] != 0));
+            values[i] = either;
+            nulls[i] = !either && (left_null || right_null);
+        }
+    }
+};
+
+struct NotLoop {
+    template <typename A>
+    void operator()(const A& a, size_t n, ValueVector& out) const {
+        int64_t* values = out.integers.data();
+        uint8_t* nulls = out.nulls.data();
+        for (size_t i = 0; i < n; ++i) {
+            const bool null = a.Null(i);
+            values[i] = !null && (a[i] == 0);
+            nulls[i] = null;
+        }
+    }
+};
+
+struct NegateDoubleLoop {
+    template <typename A>
+    void operator()(const A& a, size_t n, ValueVector& out) const {
+        double* values = out.numbers.data();
+        uint8_t* nulls = out.nulls.data();
+        for (size_t i = 0; i < n; ++i) {
+            const bool null = a.Null(i);
+            values[i] = null ? 0 : -a[i];
+            nulls[i] = null;
+        }
+    }
+};
+
+struct NegateIntegerLoop {
+    template <typename A>
+    void operator()(const A& a, size_t n, ValueVector& out) const {
+        int64_t* values = out.integers.data();
+        uint8_t* nulls = out.nulls.data();
+        bool overflow = false;
+        for (size_t i = 0; i < n; ++i) {
+            const int64_t x = a[i];
+            const bool null = a.Null(i);
+            const bool min = x == std::numeric_limits<int64_t>::min();
+            overflow |= min && !null;
+            values[i] = null || min ? 0 : -x;
+            nulls[i] = null;
+        }
+        if (overflow) throw std::out_of_range("Integer overflow");
+    }
+};
+
+bool CompileOperand(const Expr& expr, Operand& operand, std::vector<std::pair<int, DataType>>& inputs);
+
+template <CompareOp kOp>
+Kernel CompareKernel(const Operand& left, const Operand& right) {
+    const bool left_integer = IsIntegerType(left.type);
+    const bool right_integer = IsIntegerType(right.type);
+    if (left_integer && right_integer &&
+        (left.type == DataType::kDecimal) == (right.type == DataType::kDecimal)) {
+        return BinaryKernel<IntegerReaders>(left, right, DataType::kBool, CompareLoop<kOp>());
+    }
+    const bool left_text = left.type == DataType::kString;
+    const bool right_text = right.type == DataType::kString;
+    if (!left_text && !right_text) return BinaryKernel<DoubleReaders>(left, right, DataType::kBool, CompareLoop<kOp>());
+    if (left_text && right_text) return BinaryKernel<TextReaders>(left, right, DataType::kBool, CompareLoop<kOp>());
+    return nullptr;  // a number never equals a string; left to Evaluate
+}
+
+Kernel ArithmeticKernel(BinaryOp op, const Operand& left, const Operand& right, DataType type) {
+    if (left.type == DataType::kString || right.type == DataType::kString) return nullptr;
+    if (type == DataType::kDouble) {
+        switch (op) {
+        case BinaryOp::kAdd: return BinaryKernel<DoubleReaders>(left, right, type, DoubleLoop<DoubleAdd>());
+        case BinaryOp::kSub: return BinaryKernel<DoubleReaders>(left, right, type, DoubleLoop<DoubleSub>());
+        case BinaryOp::kMul: return BinaryKernel<DoubleReaders>(left, right, type, DoubleLoop<DoubleMul>());
+        case BinaryOp::kDiv: return BinaryKernel<DoubleReaders>(left, right, type, DoubleLoop<DoubleDiv>());
+        default: return BinaryKernel<DoubleReaders>(left, right, type, DoubleLoop<DoubleMod>());
+        }
+    }
+    if (left.type == DataType::kDouble || right.type == DataType::kDouble) return nullptr;
+    switch (op) {
+    case BinaryOp::kAdd: return BinaryKernel<IntegerReaders>(left, right, type, IntegerLoop<IntegerAdd>());
+    case BinaryOp::kSub: return BinaryKernel<IntegerReaders>(left, right, type, IntegerLoop<IntegerSub>());
+    case BinaryOp::kMul: return BinaryKernel<IntegerReaders>(left, right, type, IntegerLoop<IntegerMul>());
+    case BinaryOp::kDiv: return BinaryKernel<IntegerReaders>(left, right, type, IntegerLoop<IntegerDiv>());
+    default: return BinaryKernel<IntegerReaders>(left, right, type, IntegerLoop<IntegerMod>());
+    }
+}
+
+// Whether AND, OR and NOT can read operand as an integer truth value.
+bool IsTruthOperand(const Operand& operand) {
+    return IsIntegerType(operand.type) || operand.NullLiteral();
+}
+
+// The kernel of an inner node; nullptr when it does not compile.
+Kernel CompileKernel(const Expr& expr, std::vector<std::pair<int, DataType>>& inputs) {
+    if (expr.kind == ExprKind::kAggregate) return nullptr;
+    std::vector<Operand> operands(expr.args.size());
+    for (size_t i = 0; i < expr.args.size(); ++i) {
+        if (!CompileOperand(*expr.args[i], operands[i], inputs)) return nullptr;
+    }
+    switch (expr.kind) {
+    case ExprKind::kIsNull: {
+        const Operand operand = operands[0];
+        const bool negated = expr.negated;
+        return [operand, negated](const Batch& batch, ValueVector& out) {
+            const Arg a = Fetch(operand, batch);
+            out.Reset(DataType::kBool, batch.size);
+            for (size_t i = 0; i < batch.size; ++i) {
+                const bool null = a.vector != nullptr ? a.vector->nulls[i] != 0 : a.constant.null;
+                out.integers[i] = null != negated;
+                out.nulls[i] = 0;
+            }
+        };
+    }
+    case ExprKind::kUnary:
+        if (expr.unary == UnaryOp::kNot) {
+            if (!IsTruthOperand(operands[0])) return nullptr;
+            return UnaryKernel<IntegerReaders>(operands[0], DataType::kBool, NotLoop());
+        }
+        if (expr.type == DataType::kDouble) {
+            if (operands[0].type == DataType::kString) return nullptr;
+            return UnaryKernel<DoubleReaders>(operands[0], expr.type, NegateDoubleLoop());
+        }
+        if (!IsIntegerType(operands[0].type)) return nullptr;
+        return UnaryKernel<IntegerReaders>(operands[0], expr.type, NegateIntegerLoop());
+    case ExprKind::kBinary:
+        break;
+    default:
+        return nullptr;
+    }
+
+    const Operand& left = operands[0];
+    const Operand& right = operands[1];
+    if (expr.binary == BinaryOp::kAnd || expr.binary == BinaryOp::kOr) {
+        if (!IsTruthOperand(left) || !IsTruthOperand(right)) return nullptr;
+        if (expr.binary == BinaryOp::kAnd) return BinaryKernel<IntegerReaders>(left, right, DataType::kBool, AndLoop());
+        return BinaryKernel<IntegerReaders>(left, right, DataType::kBool, OrLoop());
+    }
+    if (!IsComparison(expr.binary)) return ArithmeticKernel(expr.binary, left, right, expr.type);
+    switch (ToCompareOp(expr.binary)) {
+    case CompareOp::kEq: return CompareKernel<CompareOp::kEq>(left, right);
+    case CompareOp::kNe: return CompareKernel<CompareOp::kNe>(left, right);
+    case CompareOp::kLt: return CompareKernel<CompareOp::kLt>(left, right);
+    case CompareOp::kLe: return CompareKernel<CompareOp::kLe>(left, right);
+    case CompareOp::kGt: return CompareKernel<CompareOp::kGt>(left, right);
+    case CompareOp::kGe: return CompareKernel<CompareOp::kGe>(left, right);
+    }
+    return nullptr;
+}
+
+// The type of the Value Evaluate returns for expr: kBool for conditions, expr.type for arithmetic.
+DataType ResultType(const Expr& expr) {
+    const bool condition = expr.kind == ExprKind::kIsNull ||
+                           (expr.kind == ExprKind::kUnary && expr.unary == UnaryOp::kNot) ||
+                           (expr.kind == ExprKind::kBinary && (IsComparison(expr.binary) ||
+                                                               expr.binary == BinaryOp::kAnd ||
+                                                               expr.binary == BinaryOp::kOr));
+    return condition ? DataType::kBool : expr.type;
+}
+
+bool CompileOperand(const Expr& expr, Operand& operand, std::vector<std::pair<int, DataType>>& inputs) {
+    switch (expr.kind) {
+    case ExprKind::kLiteral:
+        operand.constant = true;
+        operand.literal = expr.literal;
+        operand.type = expr.literal.type;
+        return true;
+    case ExprKind::kParameter:
+        operand.constant = true;
+        operand.parameter = expr.Clone();
+        operand.type = expr.type;
+        return true;
+    case ExprKind::kColumn: {
+        operand.slot = expr.slot;
+        operand.type = expr.type;
+        const std::pair<int, DataType> input(expr.slot, expr.type);
+        if (std::find(inputs.begin(), inputs.end(), input) == inputs.end()) inputs.push_back(input);
+        return true;
+    }
+    default:
+        operand.kernel = CompileKernel(expr, inputs);
+        operand.type = ResultType(expr);
+        operand.scratch = std::make_shared<ValueVector>();
+        return static_cast<bool>(operand.kernel);
+    }
+}
+
+// The kernel of an expression that is a plain column or a constant.
+Kernel Materialize(const Operand& operand) {
+    if (operand.slot >= 0) {
+        const size_t slot = static_cast<size_t>(operand.slot);
+        return [slot](const Batch& batch, ValueVector& out) { out = batch.columns[slot]; };
+    }
+    auto value = std::make_shared<Value>();  // texts point into it
+    return [operand, value](const Batch& batch, ValueVector& out) {
+        *value = Fetch(operand, batch).constant;
+        out.Reset(value->type, batch.size);
+        for (size_t i = 0; i < batch.size; ++i) {
+            out.nulls[i] = value->null;
+            if (value->type == DataType::kString) {
+                out.texts[i] = &value->text;
+            } else if (value->type == DataType::kDouble) {
+                out.numbers[i] = value->null ? 0 : value->number;
+            } else {
+                out.integers[i] = value->null ? 0 : value->integer;
+            }
+        }
+    };
+}
+
+}  // namespace
+
+void CompiledExpr::Evaluate(const Batch& batch, ValueVector& out) const {
+    kernel_(batch, out);
+}
+
+// Keeps the rows Value::IsTrue would accept.
+void CompiledExpr::Select(const Batch& batch, std::vector<uint32_t>& selected) const {
+    const ValueVector& result = *scratch_;
+    kernel_(batch, *scratch_);
+    selected.clear();
+    if (result.type == DataType::kString) return;
+    for (size_t i = 0; i < batch.size; ++i) {
+        const bool value = result.type == DataType::kDouble ? result.numbers[i] != 0 : result.integers[i] != 0;
+        if (!result.nulls[i] && value) selected.push_back(static_cast<uint32_t>(i));
+    }
+}
+
+CompiledExpr CompileExpr(const Expr& expr) {
+    CompiledExpr compiled;
+    Operand root;
+    if (!CompileOperand(expr, root, compiled.inputs_)) return compiled;
+    compiled.type_ = root.type;
+    compiled.slot_ = root.slot;
+    compiled.kernel_ = root.kernel ? root.kernel : Materialize(root);
+    compiled.scratch_ = std::make_shared<ValueVector>();
+    return compiled;
+}
@@ -0,0 +1,149 @@
+#include "fixed_width_column.hpp"
+
+
+namespace {
+
+// The 64 bits of bits starting at bit `first` (bit `first` becomes bit 0; bits past the end read as 0).
+uint64_t BitsAt(const std::vector<uint64_t>& bits, size_t first) {
+    const size_t word = first / 64;
+    const unsigned shift = static_cast<unsigned>(first % 64);
+    uint64_t value = word < bits.size() ? bits[word] >> shift : 0;
+    if (shift != 0 && word + 1 < bits.size()) {
+        value |= bits[word + 1] << (64 - shift);
+    }
+    return value;
+}
+
+uint64_t LowBits(size_t count) {
+    return count >= 64 ? ~uint64_t{0} : (uint64_t{1} << count) - 1;
+}
+
+}  // namespace
+
+
+void Int64Column::Filter(CompareOp op, const std::string& constant, const std::vector<uint64_t>& live,
+                         const PositionRanges& ranges, std::vector<unsigned int>& out) const {
+    const int64_t c = ParseInt64Value(type_, constant);
+    for (const auto& [begin, end] : ranges) {
+        for (size_t pos = begin; pos < end; ++pos) {
+            const unsigned int id = base_id_ + static_cast<unsigned int>(pos);
+            if (Compare(values_[pos], op, c) && IsLive(live, id)) out.push_back(id);
+        }
+    }
+}
+
+void Int64Column::GroupByCount(const std::vector<uint64_t>& live, std::map<std::string, size_t>& out) const {
+    std::map<int64_t, size_t> counts;
+    for (size_t pos = 0; pos < values_.size(); ++pos) {
+        if (IsLive(live, base_id_ + static_cast<unsigned int>(pos))) ++counts[values_[pos]];
+    }
+    for (const auto& [value, count] : counts) {
+        out[FormatInt64Value(type_, value)] += count;
+    }
+}
+
+// min/max are taken over the integers (exact) and only converted once at the end.
+AggregateState Int64Column::Aggregate(const std::vector<uint64_t>& live) const {
+    AggregateState state;
+    int64_t min = 0, max = 0;
+    for (size_t pos = 0; pos < values_.size(); ++pos) {
+        if (!IsLive(live, base_id_ + static_cast<unsigned int>(pos))) continue;
+        const int64_t v = values_[pos];
+        if (state.count == 0 || v < min) min = v;
+        if (state.count == 0 || v > max) max = v;
+        ++state.count;
+        state.sum += Int64ValueToDouble(type_, v);
+    }
+    if (state.count > 0) {
+        state.min = Int64ValueToDouble(type_, min);
+        state.max = Int64ValueToDouble(type_, max);
+    }
+    return state;
+}
+
+
+void BoolColumn::AppendValue(bool value) {
+    if (size_ % 64 == 0) {
+        bits_.push_back(0);
+    }
+    if (value) {
+        bits_.back() |= uint64_t{1} << (size_ % 64);
+    }
+    ++size_;
+}
+
+void BoolColumn::PopBack() {
+    --size_;
+    bits_.back() &= ~(uint64_t{1} << (size_ % 64));  // keeps the bits past the end 0 for WordAt
+    if (size_ % 64 == 0) {
+        bits_.pop_back();
+    }
+}
+
+uint64_t BoolColumn::WordAt(size_t pos) const {
+    return BitsAt(bits_, pos);
+}
+
+/* Which rows of a 64-row window match: true rows if `true op c` holds, false rows if `false op c` holds, so the
+predicate costs two comparisons per scan and a few word operations per 64 rows. */
+void BoolColumn::Filter(CompareOp op, const std::string& constant, const std::vector<uint64_t>& live,
+                        const PositionRanges& ranges, std::vector<unsigned int>& out) const {
+    const int64_t c = ParseInt64Value(DataType::kBool, constant);
+    const bool match_true = Compare<int64_t>(1, op, c);
+    const bool match_false = Compare<int64_t>(0, op, c);
+    for (const auto& [begin, end] : ranges) {
+        for (size_t pos = begin; pos < end; pos += 64) {
+            const uint64_t values = WordAt(pos);
+            uint64_t matches = (match_true ? values : 0) | (match_false ? ~values : 0);
+            matches &= BitsAt(live, base_id_ + pos) & LowBits(end - pos);
+            while (matches != 0) {
+                out.push_back(base_id_ + static_cast<unsigned int>(pos) +
+                              static_cast<unsigned int>(__builtin_ctzll(matches)));
+                matches &= matches - 1;
+            }
+        }
+    }
+}
+
+size_t BoolColumn::CountMatches(CompareOp op, const std::string& constant, const std::vector<uint64_t>& live,
+                                const PositionRanges& ranges) const {
+    const int64_t c = ParseInt64Value(DataType::kBool, constant);
+    const bool match_true = Compare<int64_t>(1, op, c);
+    const bool match_false = Compare<int64_t>(0, op, c);
+    size_t count = 0;
+    for (const auto& [begin, end] : ranges) {
+        const size_t trues = CountTrue(live, begin, end);
+        if (match_true) count += trues;
+        if (match_false) count += CountLive(live, base_id_ + static_cast<unsigned int>(begin), end - begin) - trues;
+    }
+    return count;
+}
+
+size_t BoolColumn::CountTrue(const std::vector<uint64_t>& live, size_t first, size_t end) const {
+    size_t count = 0;
+    for (size_t pos = first; pos < end; pos += 64) {
+        const uint64_t word = WordAt(pos) & BitsAt(live, base_id_ + pos) & LowBits(end - pos);
+        count += static_cast<size_t>(__builtin_popcountll(word));
+    }
+    return count;
+}
+
+void BoolColumn::GroupByCount(const std::vector<uint64_t>& live, std::map<std::string, size_t>& out) const {
+    const size_t trues = CountTrue(live, 0, size_);
+    const size_t falses = CountLive(live, base_id_, size_) - trues;
+    if (falses > 0) out["false"] += falses;
+    if (trues > 0) out["true"] += trues;
+}
+
+// true is 1, false is 0: sum is the number of true rows.
+AggregateState BoolColumn::Aggregate(const std::vector<uint64_t>& live) const {
+    AggregateState state;
+    const size_t trues = CountTrue(live, 0, size_);
+    state.count = CountLive(live, base_id_, size_);
+    state.sum = static_cast<double>(trues);
+    if (state.count > 0) {
+        state.min = trues == state.count ? 1 : 0;
+        state.max = trues > 0 ? 1 : 0;
+    }
+    return state;
+}
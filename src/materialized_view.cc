@@ -0,0 +1,269 @@
+#include "materialized_view.hpp"
+
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+
+#include "db.hpp"
+#include "sql_parser.hpp"
+
+MaterializedView::MaterializedView(Database& db, const std::string& name, const std::string& select_sql)
+    : db_(db), name_(name), sql_(select_sql), statement_(ParseSql(select_sql)) {
+    if (statement_.kind != StatementKind::kSelect || statement_.explain) {
+        throw std::invalid_argument("A materialized view is defined by a SELECT");
+    }
+    if (statement_.select.from.size() != 1) {
+        throw std::invalid_argument("A materialized view reads exactly one table");
+    }
+    if (statement_.parameters > 0) {
+        throw std::invalid_argument("A materialized view cannot have parameters");
+    }
+    table_name_ = statement_.select.from[0].name;
+    table_ = &db_.GetTable(table_name_);
+    Build();
+    table_->AddListener(this);
+}
+
+MaterializedView::MaterializedView(Database& db, const MaterializedView& rhs)
+    : db_(db), name_(rhs.name_), sql_(rhs.sql_), table_name_(rhs.table_name_), statement_(ParseSql(rhs.sql_)),
+      stale_(true) {
+    table_ = &db_.GetTable(table_name_);
+    table_->AddListener(this);
+}
+
+MaterializedView::~MaterializedView() {
+    table_->RemoveListener(this);
+}
+
+QueryResult MaterializedView::Read() {
+    if (stale_ || table_->SchemaVersion() != schema_version_) Build();
+    QueryResult result;
+    for (const PlanColumn& column : plan_->columns) {
+        result.columns.push_back(column.name);
+        result.types.push_back(column.type);
+    }
+    if (aggregate_ == nullptr) {
+        result.rows.reserve(rows_.size());
+        for (const auto& [id, row] : rows_) {
+            result.rows.push_back(row);
+        }
+        return result;
+    }
+    result.rows.reserve(groups_.size());
+    for (const Group& group : groups_) {
+        Row row = group.key;
+        for (size_t i = 0; i < group.states.size(); ++i) {
+            row.push_back(group.states[i].Result(aggregate_->aggregates[i]));
+        }
+        bool kept = true;
+        for (const PlanNode* node : upper_) {
+            if (node->kind == PlanKind::kFilter) {
+                kept = Evaluate(*node->predicate, row).IsTrue();
+                if (!kept) break;
+                continue;
+            }
+            Row projected(node->exprs.size());
+            for (size_t i = 0; i < projected.size(); ++i) {
+                projected[i] = Evaluate(*node->exprs[i], row);
+            }
+            row.swap(projected);
+        }
+        if (kept) result.rows.push_back(std::move(row));
+    }
+    return result;
+}
+
+MaterializedViewStats MaterializedView::Stats() const {
+    MaterializedViewStats stats = stats_;
+    stats.rows = aggregate_ == nullptr ? rows_.size() : groups_.size();
+    return stats;
+}
+
+void MaterializedView::OnInsert(const DbTable&, unsigned int id) {
+    Delta(id, 1);
+}
+
+void MaterializedView::OnDelete(const DbTable&, unsigned int id) {
+    Delta(id, -1);
+}
+
+/* Splits the plan into the scan, the nodes that run on every row, the aggregate and the nodes that run on every group,
+then feeds it every row of the table. The view stays stale if this throws. */
+void MaterializedView::Build() {
+    ++stats_.rebuilds;
+    stale_ = true;
+    rows_.clear();
+    groups_.clear();
+    index_.clear();
+    scan_ = nullptr;
+    aggregate_ = nullptr;
+    lower_.clear();
+    upper_.clear();
+    plan_ = PlanSelect(statement_.select, db_);
+
+    std::vector<const PlanNode*> nodes;  // root first, down to the scan
+    const PlanNode* node = plan_.get();
+    while (node->kind != PlanKind::kScan) {
+        if (node->kind == PlanKind::kAggregate) {
+            aggregate_ = node;
+        } else if (node->kind != PlanKind::kFilter && node->kind != PlanKind::kProject) {
+            throw std::invalid_argument("A materialized view cannot use JOIN, ORDER BY or LIMIT");
+        }
+        nodes.push_back(node);
+        node = node->children[0].get();
+    }
+    scan_ = node;
+    bool above = false;
+    for (auto it = nodes.rbegin(); it != nodes.rend(); ++it) {
+        if (*it == aggregate_) {
+            above = true;
+        } else {
+            (above ? upper_ : lower_).push_back(*it);
+        }
+    }
+    schema_version_ = table_->SchemaVersion();
+
+    if (aggregate_ != nullptr && aggregate_->group_by.empty()) {  // one row even without input
+        groups_.push_back(Group{Row(), 0, std::vector<Accumulator>(aggregate_->aggregates.size())});
+        index_.emplace(Row(), groups_.begin());
+    }
+    for (DbTable::RowCursor row = table_->Rows(); row.Valid(); row.Next()) {
+        Apply(row, 1);
+    }
+    stale_ = false;
+}
+
+void MaterializedView::Delta(unsigned int id, int sign) {
+    if (sign > 0) {
+        ++stats_.inserts;
+    } else {
+        ++stats_.deletes;
+    }
+    if (stale_) return;
+    if (table_->SchemaVersion() != schema_version_) {
+        stale_ = true;
+        return;
+    }
+    try {
+        Apply(table_->Seek(id), sign);
+    } catch (const std::exception&) {  // Read() recomputes and reports the error
+        stale_ = true;
+    }
+}
+
+// Reads the scanned columns, checks the scan predicates and runs the Filter and Project nodes below the aggregate.
+bool MaterializedView::Passes(const DbTable::RowCursor& row, Row& values) const {
+    for (const ScanPredicate& predicate : scan_->predicates) {
+        const Value value = table_->GetValue(row, predicate.column);
+        if (value.null || !Compare(CompareValues(value, predicate.constant), predicate.op, 0)) return false;
+    }
+    values.resize(scan_->scan_columns.size());
+    for (size_t i = 0; i < values.size(); ++i) {
+        values[i] = table_->GetValue(row, scan_->scan_columns[i]);
+    }
+    for (const PlanNode* node : lower_) {
+        if (node->kind == PlanKind::kFilter) {
+            if (!Evaluate(*node->predicate, values).IsTrue()) return false;
+            continue;
+        }
+        Row projected(node->exprs.size());
+        for (size_t i = 0; i < projected.size(); ++i) {
+            projected[i] = Evaluate(*node->exprs[i], values);
+        }
+        values.swap(projected);
+    }
+    return true;
+}
+
+void MaterializedView::Apply(const DbTable::RowCursor& row, int sign) {
+    Row values;
+    if (!Passes(row, values)) return;
+    if (aggregate_ == nullptr) {
+        if (sign > 0) {
+            rows_[row.Id()] = std::move(values);
+        } else {
+            rows_.erase(row.Id());
+        }
+        return;
+    }
+    Row key(aggregate_->group_by.size());
+    for (size_t i = 0; i < key.size(); ++i) {
+        key[i] = Evaluate(*aggregate_->group_by[i], values);
+    }
+    auto found = index_.find(key);
+    if (found == index_.end()) {
+        if (sign < 0) return;  // a row the view never counted
+        groups_.push_back(Group{key, 0, std::vector<Accumulator>(aggregate_->aggregates.size())});
+        found = index_.emplace(std::move(key), std::prev(groups_.end())).first;
+    }
+    Group& group = *found->second;
+    group.rows += sign;
+    for (size_t i = 0; i < group.states.size(); ++i) {
+        const AggregateCall& call = aggregate_->aggregates[i];
+        if (call.arg) {
+            group.states[i].Add(call, Evaluate(*call.arg, values), sign);
+        } else {
+            group.states[i].count += sign;
+        }
+    }
+    if (group.rows == 0 && !aggregate_->group_by.empty()) {
+        groups_.erase(found->second);
+        index_.erase(found);
+    }
+}
+
+// Follows AggregateAccumulator of the executor, so a view returns what the query would.
+void MaterializedView::Accumulator::Add(const AggregateCall& call, const Value& value, int sign) {
+    if (value.null) return;
+    count += sign;
+    switch (call.fn) {
+    case AggregateFn::kCount:
+        break;
+    case AggregateFn::kSum:
+    case AggregateFn::kAvg:
+        if (call.type != DataType::kInt64) {
+            sum += sign * value.AsDouble();
+        } else if (sign > 0 ? __builtin_add_overflow(exact_sum, value.integer, &exact_sum)
+                            : __builtin_sub_overflow(exact_sum, value.integer, &exact_sum)) {
+            throw std::out_of_range("Integer overflow");
+        }
+        break;
+    case AggregateFn::kMin:
+    case AggregateFn::kMax: {
+        auto found = values.emplace(value, 0).first;
+        found->second += sign;
+        if (found->second == 0) values.erase(found);
+        break;
+    }
+    }
+}
+
+Value MaterializedView::Accumulator::Result(const AggregateCall& call) const {
+    if (call.fn == AggregateFn::kCount) return Value::Integer(DataType::kInt64, count);
+    if (count == 0) return Value::Null(call.type);
+    switch (call.fn) {
+    case AggregateFn::kSum:
+        return call.type == DataType::kInt64 ? Value::Integer(call.type, exact_sum) : Value::Number(sum);
+    case AggregateFn::kAvg:
+        return Value::Number(sum / static_cast<double>(count));
+    case AggregateFn::kMin:
+        return values.begin()->first;
+    default:
+        return values.rbegin()->first;
+    }
+}
+
+size_t MaterializedView::KeyHash::operator()(const Row& key) const {
+    size_t hash = 0;
+    for (const Value& v : key) {
+        hash ^= HashValue(v) + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+    }
+    return hash;
+}
+
+bool MaterializedView::KeyEqual::operator()(const Row& a, const Row& b) const {
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (CompareValues(a[i], b[i]) != 0) return false;
+    }
+    return true;
+}
@@ -0,0 +1,171 @@
+#include "metrics.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+const char* MetricOpName(MetricOp op) {
+    switch (op) {
+    case MetricOp::kAddRow: return "add_row";
+    case MetricOp::kDeleteRow: return "delete_row";
+    case MetricOp::kAddColumn: return "add_column";
+    case MetricOp::kDeleteColumn: return "delete_column";
+    case MetricOp::kScan: return "scan";
+    case MetricOp::kExport: return "export";
+    case MetricOp::kCatalogLookup: return "catalog_lookup";
+    case MetricOp::kCreateTable: return "create_table";
+    case MetricOp::kDropTable: return "drop_table";
+    }
+    return "";
+}
+
+// Bucket = (exponent - 3) * 16 + the 4 bits below the leading one; values below 16 are their own bucket.
+size_t HistogramSnapshot::BucketOf(uint64_t ns) {
+    if (ns < kSubBuckets) return static_cast<size_t>(ns);
+    const unsigned int exponent = 63 - static_cast<unsigned int>(__builtin_clzll(ns));
+    if (exponent >= 40) return kBuckets - 1;
+    return (exponent - 3) * kSubBuckets + static_cast<size_t>((ns >> (exponent - 4)) & (kSubBuckets - 1));
+}
+
+uint64_t HistogramSnapshot::BucketUpper(size_t bucket) {
+    if (bucket < kSubBuckets) return bucket;
+    const unsigned int shift = static_cast<unsigned int>(bucket / kSubBuckets) - 1;
+    const uint64_t lower = (kSubBuckets + bucket % kSubBuckets) << shift;
+    return lower + (uint64_t{1} << shift) - 1;
+}
+
+// The upper bound of the bucket holding the sample of rank ceil(p% of count), capped by the exact maximum.
+double HistogramSnapshot::Percentile(double p) const {
+    if (count == 0) return 0;
+    const double wanted = std::ceil(std::clamp(p, 0.0, 100.0) / 100 * static_cast<double>(count));
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(wanted));
+    uint64_t seen = 0;
+    for (size_t b = 0; b < buckets.size(); ++b) {
+        seen += buckets[b];
+        if (seen >= rank) return static_cast<double>(std::min(BucketUpper(b), max_ns));
+    }
+    return static_cast<double>(max_ns);
+}
+
+HistogramSnapshot& HistogramSnapshot::operator+=(const HistogramSnapshot& rhs) {
+    for (size_t b = 0; b < kBuckets; ++b) {
+        buckets[b] += rhs.buckets[b];
+    }
+    count += rhs.count;
+    sum_ns += rhs.sum_ns;
+    max_ns = std::max(max_ns, rhs.max_ns);
+    return *this;
+}
+
+MetricsSnapshot& MetricsSnapshot::operator+=(const MetricsSnapshot& rhs) {
+    for (size_t op = 0; op < kMetricOps; ++op) {
+        ops[op].errors += rhs.ops[op].errors;
+        ops[op].latency += rhs.ops[op].latency;
+    }
+    return *this;
+}
+
+void WriteMetricsText(std::ostream& os, const std::string& scope, const MetricsSnapshot& snapshot) {
+    static const char* const kQuantiles[] = {"0.5", "0.9", "0.99", "0.999"};
+    for (size_t op = 0; op < kMetricOps; ++op) {
+        const OpMetrics& metrics = snapshot.ops[op];
+        if (metrics.latency.count == 0) continue;
+        const std::string labels = "scope=\"" + scope + "\",op=\"" + MetricOpName(static_cast<MetricOp>(op)) + "\"";
+        os << "db_ops_total{" << labels << "} " << metrics.latency.count << "\n";
+        os << "db_op_errors_total{" << labels << "} " << metrics.errors << "\n";
+        for (const char* quantile : kQuantiles) {
+            os << "db_op_latency_ns{" << labels << ",quantile=\"" << quantile << "\"} "
+               << static_cast<uint64_t>(metrics.latency.Percentile(std::stod(quantile) * 100)) << "\n";
+        }
+        os << "db_op_latency_ns_max{" << labels << "} " << metrics.latency.max_ns << "\n";
+        os << "db_op_latency_ns_sum{" << labels << "} " << metrics.latency.sum_ns << "\n";
+        os << "db_op_latency_ns_count{" << labels << "} " << metrics.latency.count << "\n";
+    }
+}
+
+Metrics::~Metrics() {
+    for (std::atomic<Shard*>& slot : shards_) {
+        Shard* shard = slot.load(std::memory_order_acquire);
+        if (shard == nullptr) continue;
+        for (std::atomic<OpHistogram*>& histogram : shard->ops) {
+            delete histogram.load(std::memory_order_acquire);
+        }
+        delete shard;
+    }
+}
+
+/* Threads are dealt shard numbers round robin as they first record anything, so up to kShards threads never share
+one; the shard itself is created by whichever thread gets there first. */
+Metrics::Shard& Metrics::LocalShard() {
+    static std::atomic<size_t> next_thread{0};
+    thread_local const size_t index = next_thread.fetch_add(1, std::memory_order_relaxed) % kShards;
+    Shard* shard = shards_[index].load(std::memory_order_acquire);
+    if (shard == nullptr) {
+        Shard* fresh = new Shard();
+        if (shards_[index].compare_exchange_strong(shard, fresh, std::memory_order_acq_rel)) {
+            shard = fresh;
+        } else {
+            delete fresh;  // another thread of the same shard won; shard now holds its pointer
+        }
+    }
+    return *shard;
+}
+
+// Like the shards, an operation's histogram is created by whichever thread of the shard records it first.
+Metrics::OpHistogram& Metrics::Histogram(Shard& shard, MetricOp op) {
+    std::atomic<OpHistogram*>& slot = shard.ops[static_cast<size_t>(op)];
+    OpHistogram* histogram = slot.load(std::memory_order_acquire);
+    if (histogram == nullptr) {
+        OpHistogram* fresh = new OpHistogram();
+        if (slot.compare_exchange_strong(histogram, fresh, std::memory_order_acq_rel)) {
+            histogram = fresh;
+        } else {
+            delete fresh;
+        }
+    }
+    return *histogram;
+}
+
+void Metrics::Record(MetricOp op, uint64_t ns, bool failed) {
+    OpHistogram& histogram = Histogram(LocalShard(), op);
+    histogram.buckets[HistogramSnapshot::BucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+    histogram.sum_ns.fetch_add(ns, std::memory_order_relaxed);
+    if (failed) histogram.errors.fetch_add(1, std::memory_order_relaxed);
+    uint64_t max = histogram.max_ns.load(std::memory_order_relaxed);
+    while (ns > max && !histogram.max_ns.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {
+    }
+}
+
+MetricsSnapshot Metrics::Snapshot() const {
+    MetricsSnapshot snapshot;
+    for (const std::atomic<Shard*>& slot : shards_) {
+        const Shard* shard = slot.load(std::memory_order_acquire);
+        if (shard == nullptr) continue;
+        for (size_t op = 0; op < kMetricOps; ++op) {
+            const OpHistogram* histogram = shard->ops[op].load(std::memory_order_acquire);
+            if (histogram == nullptr) continue;
+            HistogramSnapshot& latency = snapshot.ops[op].latency;
+            for (size_t b = 0; b < HistogramSnapshot::kBuckets; ++b) {
+                const uint64_t n = histogram->buckets[b].load(std::memory_order_relaxed);
+                latency.buckets[b] += n;
+                latency.count += n;
+            }
+            latency.sum_ns += histogram->sum_ns.load(std::memory_order_relaxed);
+            latency.max_ns = std::max(latency.max_ns, histogram->max_ns.load(std::memory_order_relaxed));
+            snapshot.ops[op].errors += histogram->errors.load(std::memory_order_relaxed);
+        }
+    }
+    return snapshot;
+}
+
+Footprint Metrics::Memory() const {
+    Footprint memory;
+    for (const std::atomic<Shard*>& slot : shards_) {
+        const Shard* shard = slot.load(std::memory_order_acquire);
+        if (shard == nullptr) continue;
+        memory.Add(sizeof(Shard));
+        for (const std::atomic<OpHistogram*>& histogram : shard->ops) {
+            if (histogram.load(std::memory_order_acquire) != nullptr) memory.Add(sizeof(OpHistogram));
+        }
+    }
+    return memory;
+}
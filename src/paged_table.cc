@@ -0,0 +1,291 @@
+#include "paged_table.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "binary_io.hpp"
+
+namespace {
+
+const char kMagic[8] = {'D', 'B', 'P', 'A', 'G', 'E', 'S', '1'};
+const size_t kPageHeader = 8;  // first id, slots, start of the records
+const size_t kSlotSize = 4;
+
+uint16_t Load16(const char* p) {
+    return static_cast<uint16_t>(static_cast<uint8_t>(p[0]) | static_cast<uint8_t>(p[1]) << 8);
+}
+
+void Store16(char* p, size_t v) {
+    p[0] = static_cast<char>(v & 0xFF);
+    p[1] = static_cast<char>((v >> 8) & 0xFF);
+}
+
+uint32_t Load32(const char* p) {
+    return static_cast<uint32_t>(Load16(p)) | static_cast<uint32_t>(Load16(p + 2)) << 16;
+}
+
+void Store32(char* p, uint32_t v) {
+    Store16(p, v & 0xFFFF);
+    Store16(p + 2, v >> 16);
+}
+
+uint32_t Slots(const char* page) {
+    return Load16(page + 4);
+}
+
+uint16_t SlotOffset(const char* page, uint32_t slot) {
+    return Load16(page + kPageHeader + slot * kSlotSize);
+}
+
+// The text DbTable::GetRow shows for a value (std::to_string for doubles).
+std::string CellText(const Value& value) {
+    if (!value.null && value.type == DataType::kDouble) return std::to_string(value.number);
+    return value.ToString();
+}
+
+}  // namespace
+
+PagedTable::PagedTable(const std::string& path, const std::vector<std::pair<std::string, DataType>>& columns,
+                       const BufferPoolOptions& options)
+    : pool_(path, options) {
+    if (pool_.PageCount() == 0) {
+        col_descs_ = columns;
+        pool_.NewPage();
+        WriteHeader();
+        return;
+    }
+    {
+        const PageGuard header = pool_.Fetch(0);
+        BinaryReader in(header.Data(), BufferPool::kPageSize);
+        char magic[sizeof(kMagic)];
+        for (char& c : magic) c = static_cast<char>(in.GetU8());
+        if (std::memcmp(magic, kMagic, sizeof(kMagic)) != 0) {
+            throw std::runtime_error(path + " is not a paged table");
+        }
+        next_id_ = in.GetU32();
+        const uint32_t count = in.GetU32();
+        for (uint32_t i = 0; i < count; ++i) {
+            std::string name = in.GetString();
+            const uint8_t type = in.GetU8();
+            if (!IsKnownDataType(type)) {
+                throw std::runtime_error(path + " has a column of unknown type " + std::to_string(type));
+            }
+            col_descs_.emplace_back(std::move(name), static_cast<DataType>(type));
+        }
+    }
+    if (!columns.empty() && columns != col_descs_) {
+        throw std::invalid_argument(path + " holds a table with other columns");
+    }
+    for (uint32_t page = 1; page < pool_.PageCount(); ++page) {
+        const PageGuard guard = pool_.Fetch(page, AccessHint::kScan);
+        first_ids_.push_back(Load32(guard.Data()));
+        for (uint32_t slot = 0; slot < Slots(guard.Data()); ++slot) {
+            row_count_ += SlotOffset(guard.Data(), slot) != 0;
+        }
+    }
+}
+
+PagedTable::~PagedTable() {
+    try {
+        Flush();
+    } catch (const std::exception&) {  // the pool's destructor tries the pages once more
+    }
+}
+
+void PagedTable::AddRow(const std::vector<std::optional<std::string>>& col_data) {
+    const std::string record = EncodeRow(col_data);
+    if (kPageHeader + kSlotSize + record.size() > BufferPool::kPageSize) {
+        throw std::invalid_argument("Row of " + std::to_string(record.size()) + " bytes does not fit in a page");
+    }
+    PageGuard page;
+    if (!first_ids_.empty()) {
+        page = pool_.Fetch(static_cast<uint32_t>(first_ids_.size()));
+        const char* data = page.Data();
+        const size_t free = Load16(data + 6) - (kPageHeader + Slots(data) * kSlotSize);
+        if (free < kSlotSize + record.size()) page.Release();
+    }
+    if (!page) {
+        page = pool_.NewPage();
+        char* data = page.MutableData();
+        Store32(data, next_id_);
+        Store16(data + 4, 0);
+        Store16(data + 6, BufferPool::kPageSize);
+        first_ids_.push_back(next_id_);
+    }
+    char* data = page.MutableData();
+    const uint32_t slot = Slots(data);
+    const size_t offset = Load16(data + 6) - record.size();
+    std::memcpy(data + offset, record.data(), record.size());
+    Store16(data + kPageHeader + slot * kSlotSize, offset);
+    Store16(data + kPageHeader + slot * kSlotSize + 2, record.size());
+    Store16(data + 4, slot + 1);
+    Store16(data + 6, offset);
+    ++next_id_;
+    ++row_count_;
+    header_dirty_ = true;
+}
+
+void PagedTable::DeleteRowById(unsigned int id) {
+    Location location;
+    if (!Find(id, location)) {
+        throw std::out_of_range("Row ID does not exist");
+    }
+    PageGuard page = pool_.Fetch(static_cast<uint32_t>(location.index + 1));
+    Store16(page.MutableData() + kPageHeader + location.slot * kSlotSize, 0);
+    --row_count_;
+}
+
+std::vector<std::string> PagedTable::GetRow(unsigned int id) const {
+    Location location;
+    if (!Find(id, location)) {
+        throw std::out_of_range("Row ID does not exist");
+    }
+    const PageGuard page = pool_.Fetch(static_cast<uint32_t>(location.index + 1));
+    Row row;
+    DecodeRow(page.Data(), location.slot, row);
+    std::vector<std::string> texts;
+    texts.reserve(row.size());
+    for (const Value& value : row) {
+        texts.push_back(CellText(value));
+    }
+    return texts;
+}
+
+std::vector<std::vector<std::string>> PagedTable::GetRows() const {
+    std::vector<std::vector<std::string>> rows;
+    rows.reserve(row_count_);
+    for (RowCursor row = Rows(); row.Valid(); row.Next()) {
+        std::vector<std::string> texts;
+        texts.reserve(col_descs_.size());
+        for (size_t col = 0; col < col_descs_.size(); ++col) {
+            texts.push_back(CellText(GetValue(row, static_cast<unsigned int>(col))));
+        }
+        rows.push_back(std::move(texts));
+    }
+    return rows;
+}
+
+std::vector<unsigned int> PagedTable::Filter(unsigned int col_idx, CompareOp op, const std::string& value) const {
+    if (col_idx >= col_descs_.size()) {
+        throw std::out_of_range("Column index out of range");
+    }
+    const Value constant = CastValue(Value::Text(value), col_descs_[col_idx].second);
+    std::vector<unsigned int> ids;
+    for (RowCursor row = Rows(); row.Valid(); row.Next()) {
+        const Value cell = GetValue(row, col_idx);
+        if (!cell.null && Compare(CompareValues(cell, constant), op, 0)) ids.push_back(row.Id());
+    }
+    return ids;
+}
+
+size_t PagedTable::Count(unsigned int col_idx, CompareOp op, const std::string& value) const {
+    return Filter(col_idx, op, value).size();
+}
+
+PagedTable::RowCursor PagedTable::Rows() const {
+    RowCursor cursor(this);
+    cursor.Settle();
+    return cursor;
+}
+
+Value PagedTable::GetValue(const RowCursor& row, unsigned int col_idx) const {
+    if (col_idx >= col_descs_.size()) {
+        throw std::out_of_range("Column index out of range");
+    }
+    if (!row.decoded_) {
+        DecodeRow(row.page_.Data(), row.slot_, row.row_);
+        row.decoded_ = true;
+    }
+    return row.row_[col_idx];
+}
+
+void PagedTable::RowCursor::Next() {
+    ++slot_;
+    Settle();
+}
+
+void PagedTable::RowCursor::Settle() {
+    decoded_ = false;
+    while (index_ < table_->first_ids_.size()) {
+        if (!page_) page_ = table_->pool_.Fetch(static_cast<uint32_t>(index_ + 1), AccessHint::kScan);
+        const char* data = page_.Data();
+        while (slot_ < Slots(data) && SlotOffset(data, slot_) == 0) {
+            ++slot_;
+        }
+        if (slot_ < Slots(data)) return;
+        page_.Release();
+        ++index_;
+        slot_ = 0;
+    }
+}
+
+void PagedTable::Flush() {
+    if (header_dirty_) WriteHeader();
+    pool_.Flush();
+}
+
+bool PagedTable::Find(unsigned int id, Location& location) const {
+    auto it = std::upper_bound(first_ids_.begin(), first_ids_.end(), id);
+    if (it == first_ids_.begin()) return false;
+    location.index = static_cast<size_t>(it - first_ids_.begin()) - 1;
+    location.slot = id - first_ids_[location.index];
+    const PageGuard page = pool_.Fetch(static_cast<uint32_t>(location.index + 1));
+    return location.slot < Slots(page.Data()) && SlotOffset(page.Data(), location.slot) != 0;
+}
+
+void PagedTable::WriteHeader() {
+    BinaryWriter out;
+    out.PutBytes(kMagic, sizeof(kMagic));
+    out.PutU32(next_id_);
+    out.PutU32(static_cast<uint32_t>(col_descs_.size()));
+    for (const auto& [name, type] : col_descs_) {
+        out.PutString(name);
+        out.PutU8(static_cast<uint8_t>(type));
+    }
+    if (out.Size() > BufferPool::kPageSize) {
+        throw std::invalid_argument("The column names of a paged table must fit in one page");
+    }
+    PageGuard header = pool_.Fetch(0);
+    std::memcpy(header.MutableData(), out.Data().data(), out.Size());
+    header_dirty_ = false;
+}
+
+std::string PagedTable::EncodeRow(const std::vector<std::optional<std::string>>& col_data) const {
+    if (col_data.size() != col_descs_.size()) {
+        throw std::invalid_argument("Expected " + std::to_string(col_descs_.size()) + " values, got " +
+                                    std::to_string(col_data.size()));
+    }
+    BinaryWriter out;
+    for (size_t i = 0; i < col_data.size(); ++i) {
+        out.PutU8(col_data[i].has_value() ? 1 : 0);
+        if (!col_data[i].has_value()) continue;
+        const Value value = CastValue(Value::Text(*col_data[i]), col_descs_[i].second);
+        if (value.type == DataType::kString) {
+            out.PutString(value.text);
+        } else if (value.type == DataType::kDouble) {
+            out.PutDouble(value.number);
+        } else {
+            out.PutU64(static_cast<uint64_t>(value.integer));
+        }
+    }
+    return out.Data();
+}
+
+void PagedTable::DecodeRow(const char* page, uint32_t slot, Row& row) const {
+    const char* entry = page + kPageHeader + slot * kSlotSize;
+    BinaryReader in(page + Load16(entry), Load16(entry + 2));
+    row.resize(col_descs_.size());
+    for (size_t i = 0; i < row.size(); ++i) {
+        const DataType type = col_descs_[i].second;
+        if (in.GetU8() == 0) {
+            row[i] = Value::Null(type);
+        } else if (type == DataType::kString) {
+            row[i] = Value::Text(in.GetString());
+        } else if (type == DataType::kDouble) {
+            row[i] = Value::Number(in.GetDouble());
+        } else {
+            row[i] = Value::Integer(type, static_cast<int64_t>(in.GetU64()));
+        }
+    }
+}
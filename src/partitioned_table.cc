@@ -0,0 +1,304 @@
+#include "partitioned_table.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include "value_types.hpp"
+
+PartitionSpec PartitionSpec::Hash(const std::string& column, size_t partitions) {
+    PartitionSpec spec;
+    spec.method = PartitionMethod::kHash;
+    spec.column = column;
+    spec.partitions = partitions;
+    return spec;
+}
+
+PartitionSpec PartitionSpec::Range(const std::string& column, const std::vector<std::string>& bounds) {
+    PartitionSpec spec;
+    spec.method = PartitionMethod::kRange;
+    spec.column = column;
+    spec.partitions = bounds.size() + 1;
+    spec.bounds = bounds;
+    return spec;
+}
+
+
+PartitionedTable::PartitionedTable(const std::vector<std::pair<std::string, DataType>>& columns,
+                                   const PartitionSpec& spec, size_t scan_threads)
+    : col_descs_(columns), spec_(spec) {
+    auto key = std::find_if(col_descs_.begin(), col_descs_.end(),
+                            [&](const std::pair<std::string, DataType>& col) { return col.first == spec_.column; });
+    if (key == col_descs_.end()) {
+        throw std::invalid_argument("Partition key " + spec_.column + " is not a column");
+    }
+    key_col_ = static_cast<unsigned int>(key - col_descs_.begin());
+    if (spec_.method == PartitionMethod::kRange) {
+        spec_.partitions = spec_.bounds.size() + 1;
+        for (const std::string& bound : spec_.bounds) {
+            try {
+                bounds_.push_back(KeyValue(bound));
+            } catch (const std::exception&) {
+                throw std::invalid_argument("Range bound " + bound + " is not a " + DataTypeName(key->second));
+            }
+            if (bounds_.size() > 1 && CompareValues(bounds_[bounds_.size() - 2], bounds_.back()) >= 0) {
+                throw std::invalid_argument("Range bounds must be strictly ascending");
+            }
+        }
+    } else if (spec_.partitions == 0) {
+        throw std::invalid_argument("A partitioned table needs at least one partition");
+    }
+    for (size_t i = 0; i < spec_.partitions; ++i) {
+        partitions_.push_back(std::make_unique<Part>());
+        for (const auto& col : col_descs_) {
+            partitions_.back()->table.AddColumn(col);
+        }
+    }
+    SetScanThreads(scan_threads);
+}
+
+PartitionedTable::PartitionedTable(const PartitionedTable& rhs)
+    : col_descs_(rhs.col_descs_), spec_(rhs.spec_), key_col_(rhs.key_col_), bounds_(rhs.bounds_) {
+    for (const auto& part : rhs.partitions_) {
+        std::shared_lock<std::shared_mutex> lock(part->mutex);
+        partitions_.push_back(std::make_unique<Part>());
+        partitions_.back()->table = part->table;
+    }
+    SetScanThreads(rhs.scan_threads_);
+}
+
+size_t PartitionedTable::PartitionFor(const std::optional<std::string>& key) const {
+    if (!key.has_value()) return 0;
+    const Value value = KeyValue(*key);
+    if (spec_.method == PartitionMethod::kHash) return HashValue(value) % partitions_.size();
+    auto it = std::upper_bound(bounds_.begin(), bounds_.end(), value,
+                               [](const Value& a, const Value& b) { return CompareValues(a, b) < 0; });
+    return static_cast<size_t>(it - bounds_.begin());
+}
+
+unsigned int PartitionedTable::AddRow(const std::vector<std::optional<std::string>>& col_data) {
+    if (col_data.size() != col_descs_.size()) {
+        throw std::invalid_argument("Expected " + std::to_string(col_descs_.size()) + " values, got " +
+                                    std::to_string(col_data.size()));
+    }
+    const size_t index = PartitionFor(col_data[key_col_]);
+    Part& part = *partitions_[index];
+    std::unique_lock<std::shared_mutex> lock(part.mutex);
+    const uint64_t id = static_cast<uint64_t>(part.table.NextId()) * partitions_.size() + index;
+    if (id > std::numeric_limits<unsigned int>::max()) {
+        throw std::out_of_range("Partition " + std::to_string(index) + " ran out of row ids");
+    }
+    part.table.AddRow(col_data);
+    return static_cast<unsigned int>(id);
+}
+
+void PartitionedTable::DeleteRowById(unsigned int id) {
+    Part& part = *partitions_[PartitionOf(id)];
+    std::unique_lock<std::shared_mutex> lock(part.mutex);
+    part.table.DeleteRowById(static_cast<unsigned int>(id / partitions_.size()));
+}
+
+std::vector<std::string> PartitionedTable::GetRow(unsigned int id) const {
+    const Part& part = *partitions_[PartitionOf(id)];
+    std::shared_lock<std::shared_mutex> lock(part.mutex);
+    return part.table.GetRow(static_cast<unsigned int>(id / partitions_.size()));
+}
+
+std::vector<std::vector<std::string>> PartitionedTable::GetRows() const {
+    std::vector<std::vector<std::string>> rows;
+    for (const auto& part : partitions_) {
+        std::shared_lock<std::shared_mutex> lock(part->mutex);
+        std::vector<std::vector<std::string>> more = part->table.GetRows();
+        rows.insert(rows.end(), std::make_move_iterator(more.begin()), std::make_move_iterator(more.end()));
+    }
+    return rows;
+}
+
+size_t PartitionedTable::RowCount() const {
+    size_t rows = 0;
+    for (const auto& part : partitions_) {
+        std::shared_lock<std::shared_mutex> lock(part->mutex);
+        rows += part->table.RowCount();
+    }
+    return rows;
+}
+
+std::vector<unsigned int> PartitionedTable::Filter(unsigned int col_idx, CompareOp op,
+                                                   const std::string& value) const {
+    const std::vector<size_t> parts = PrunePartitions(col_idx, op, value);
+    std::vector<std::vector<unsigned int>> found(parts.size());
+    Scan(parts, [&](size_t i, const DbTable& table) {
+        found[i] = table.Filter(col_idx, op, value);
+        for (unsigned int& id : found[i]) {
+            id = static_cast<unsigned int>(id * partitions_.size() + parts[i]);
+        }
+    });
+    std::vector<unsigned int> ids;
+    for (const std::vector<unsigned int>& more : found) {
+        ids.insert(ids.end(), more.begin(), more.end());
+    }
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+size_t PartitionedTable::Count(unsigned int col_idx, CompareOp op, const std::string& value) const {
+    const std::vector<size_t> parts = PrunePartitions(col_idx, op, value);
+    std::vector<size_t> counts(parts.size());
+    Scan(parts, [&](size_t i, const DbTable& table) { counts[i] = table.Count(col_idx, op, value); });
+    size_t count = 0;
+    for (size_t c : counts) count += c;
+    return count;
+}
+
+std::map<std::string, size_t> PartitionedTable::GroupByCount(unsigned int col_idx) const {
+    const std::vector<size_t> parts = AllPartitions();
+    std::vector<std::map<std::string, size_t>> groups(parts.size());
+    Scan(parts, [&](size_t i, const DbTable& table) { groups[i] = table.GroupByCount(col_idx); });
+    std::map<std::string, size_t> merged;
+    for (const auto& part : groups) {
+        for (const auto& [group, count] : part) merged[group] += count;
+    }
+    return merged;
+}
+
+// Every partition reports count, sum, min and max as far as fn needs them, and the states are merged.
+double PartitionedTable::Aggregate(unsigned int col_idx, AggregateFn fn) const {
+    const std::vector<size_t> parts = AllPartitions();
+    std::vector<AggregateState> states(parts.size());
+    Scan(parts, [&](size_t i, const DbTable& table) {
+        AggregateState& state = states[i];
+        state.count = static_cast<size_t>(table.Aggregate(col_idx, AggregateFn::kCount));
+        if (fn == AggregateFn::kSum || fn == AggregateFn::kAvg) {
+            state.sum = table.Aggregate(col_idx, AggregateFn::kSum);
+        }
+        if (fn == AggregateFn::kMin && state.count > 0) state.min = table.Aggregate(col_idx, AggregateFn::kMin);
+        if (fn == AggregateFn::kMax && state.count > 0) state.max = table.Aggregate(col_idx, AggregateFn::kMax);
+    });
+    AggregateState merged;
+    for (const AggregateState& state : states) {
+        merged.count += state.count;
+        merged.sum += state.sum;
+        merged.min = std::min(merged.min, state.min);
+        merged.max = std::max(merged.max, state.max);
+    }
+    return merged.Result(fn);
+}
+
+/* A range partition [lo, hi) can hold a key k with k op c unless: kEq, c is outside it; kLt/kLe, lo is already
+past c; kGt/kGe, c is at or past hi. Only kEq can prune a hash key. */
+std::vector<size_t> PartitionedTable::PrunePartitions(unsigned int col_idx, CompareOp op,
+                                                      const std::string& value) const {
+    if (col_idx >= col_descs_.size()) {
+        throw std::out_of_range("Column index out of range");
+    }
+    if (col_idx != key_col_ || op == CompareOp::kNe) return AllPartitions();
+    const Value constant = KeyValue(value);
+    if (spec_.method == PartitionMethod::kHash) {
+        if (op != CompareOp::kEq) return AllPartitions();
+        return {HashValue(constant) % partitions_.size()};
+    }
+    std::vector<size_t> parts;
+    for (size_t i = 0; i < partitions_.size(); ++i) {
+        const Value* lo = i > 0 ? &bounds_[i - 1] : nullptr;
+        const Value* hi = i < bounds_.size() ? &bounds_[i] : nullptr;
+        bool keep = true;
+        switch (op) {
+        case CompareOp::kEq:
+            keep = (lo == nullptr || CompareValues(*lo, constant) <= 0) &&
+                   (hi == nullptr || CompareValues(constant, *hi) < 0);
+            break;
+        case CompareOp::kLt:
+            keep = lo == nullptr || CompareValues(*lo, constant) < 0;
+            break;
+        case CompareOp::kLe:
+            keep = lo == nullptr || CompareValues(*lo, constant) <= 0;
+            break;
+        case CompareOp::kGt:
+        case CompareOp::kGe:
+            keep = hi == nullptr || CompareValues(constant, *hi) < 0;
+            break;
+        case CompareOp::kNe:
+            break;
+        }
+        if (keep) parts.push_back(i);
+    }
+    return parts;
+}
+
+PartitionStats PartitionedTable::Stats() const {
+    PartitionStats stats;
+    stats.scans = scans_.load();
+    stats.partitions_scanned = partitions_scanned_.load();
+    stats.partitions_pruned = partitions_pruned_.load();
+    stats.parallel_scans = parallel_scans_.load();
+    for (const auto& part : partitions_) {
+        std::shared_lock<std::shared_mutex> lock(part->mutex);
+        stats.rows.push_back(part->table.RowCount());
+    }
+    return stats;
+}
+
+MetricsSnapshot PartitionedTable::GetMetrics() const {
+    MetricsSnapshot snapshot;
+    for (const auto& part : partitions_) {
+        snapshot += part->table.GetMetrics();
+    }
+    return snapshot;
+}
+
+void PartitionedTable::SetScanThreads(size_t threads) {
+    scan_threads_ = threads > 0 ? threads : std::max<size_t>(1, std::thread::hardware_concurrency());
+}
+
+std::vector<size_t> PartitionedTable::AllPartitions() const {
+    std::vector<size_t> parts(partitions_.size());
+    for (size_t i = 0; i < parts.size(); ++i) parts[i] = i;
+    return parts;
+}
+
+/* Workers take the next partition from a shared counter, so a large partition does not hold up the others. The
+calling thread is one of them; the first exception of each worker is rethrown once all are done. */
+void PartitionedTable::Scan(const std::vector<size_t>& parts,
+                            const std::function<void(size_t, const DbTable&)>& scan) const {
+    ++scans_;
+    partitions_scanned_ += parts.size();
+    partitions_pruned_ += partitions_.size() - parts.size();
+    size_t rows = 0;
+    for (size_t index : parts) {
+        std::shared_lock<std::shared_mutex> lock(partitions_[index]->mutex);
+        rows += partitions_[index]->table.RowCount();
+    }
+    const size_t threads = rows < kParallelRows ? 1 : std::min(scan_threads_.load(), parts.size());
+    std::atomic<size_t> next{0};
+    std::vector<std::exception_ptr> errors(threads);
+    auto work = [&](size_t worker) {
+        try {
+            for (size_t i = next++; i < parts.size(); i = next++) {
+                const Part& part = *partitions_[parts[i]];
+                std::shared_lock<std::shared_mutex> lock(part.mutex);
+                scan(i, part.table);
+            }
+        } catch (...) {
+            errors[worker] = std::current_exception();
+        }
+    };
+    std::vector<std::thread> workers;
+    for (size_t worker = 1; worker < threads; ++worker) {
+        workers.emplace_back(work, worker);
+    }
+    if (threads > 1) ++parallel_scans_;
+    work(0);
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    for (const std::exception_ptr& error : errors) {
+        if (error) std::rethrow_exception(error);
+    }
+}
+
+Value PartitionedTable::KeyValue(const std::string& text) const {
+    return CastValue(Value::Text(text), col_descs_[key_col_].second);
+}
@@ -0,0 +1,73 @@
+#include "plan_cache.hpp"
+
+bool PreparedQuery::Uses(const DbTable* table) const {
+    for (const auto& [used, version] : schemas) {
+        if (used == table) return true;
+    }
+    return false;
+}
+
+PreparedQueryPtr PlanCache::Find(const std::string& sql, const std::function<bool(const PreparedQuery&)>& current) {
+    auto found = index_.find(sql);
+    if (found == index_.end()) {
+        ++stats_.misses;
+        return nullptr;
+    }
+    if (!current(**found->second)) {
+        Erase(found->second);
+        ++stats_.invalidations;
+        ++stats_.misses;
+        return nullptr;
+    }
+    ++stats_.hits;
+    lru_.splice(lru_.begin(), lru_, found->second);
+    return lru_.front();
+}
+
+void PlanCache::Insert(PreparedQueryPtr query) {
+    if (capacity_ == 0) return;
+    auto found = index_.find(query->sql);
+    if (found != index_.end()) Erase(found->second);
+    while (lru_.size() >= capacity_) {
+        Erase(std::prev(lru_.end()));
+        ++stats_.evictions;
+    }
+    lru_.push_front(std::move(query));
+    index_[lru_.front()->sql] = lru_.begin();
+}
+
+void PlanCache::Invalidate(const DbTable* table) {
+    for (auto it = lru_.begin(); it != lru_.end();) {
+        auto next = std::next(it);
+        if ((*it)->Uses(table)) {
+            Erase(it);
+            ++stats_.invalidations;
+        }
+        it = next;
+    }
+}
+
+void PlanCache::Clear() {
+    lru_.clear();
+    index_.clear();
+}
+
+void PlanCache::SetCapacity(size_t capacity) {
+    capacity_ = capacity;
+    while (lru_.size() > capacity_) {
+        Erase(std::prev(lru_.end()));
+        ++stats_.evictions;
+    }
+}
+
+PlanCacheStats PlanCache::Stats() const {
+    PlanCacheStats stats = stats_;
+    stats.entries = lru_.size();
+    stats.capacity = capacity_;
+    return stats;
+}
+
+void PlanCache::Erase(std::list<PreparedQueryPtr>::iterator it) {
+    index_.erase((*it)->sql);
+    lru_.erase(it);
+}
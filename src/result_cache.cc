@@ -0,0 +1,121 @@
+#include "result_cache.hpp"
+
+#include <iterator>
+
+#include "memory_usage.hpp"
+
+bool CachedResult::Uses(const DbTable* table) const {
+    for (const auto& [used, version] : versions) {
+        if (used == table) return true;
+    }
+    return false;
+}
+
+const QueryResult* ResultCache::Find(const std::string& key,
+                                     const std::function<bool(const CachedResult&)>& current) {
+    auto found = index_.find(key);
+    if (found == index_.end()) {
+        ++stats_.misses;
+        return nullptr;
+    }
+    if (!current(*found->second)) {
+        Erase(found->second);
+        ++stats_.invalidations;
+        ++stats_.misses;
+        return nullptr;
+    }
+    ++stats_.hits;
+    lru_.splice(lru_.begin(), lru_, found->second);
+    return &lru_.front().result;
+}
+
+void ResultCache::Insert(CachedResult entry) {
+    entry.bytes = ResultBytes(entry.result) + AllocatedBytes(entry.key.size() + 1);
+    auto found = index_.find(entry.key);
+    if (found != index_.end()) Erase(found->second);
+    if (entry.bytes > budget_) return;
+    Evict(entry.bytes);
+    bytes_ += entry.bytes;
+    lru_.push_front(std::move(entry));
+    index_[lru_.front().key] = lru_.begin();
+}
+
+void ResultCache::Invalidate(const DbTable* table) {
+    for (auto it = lru_.begin(); it != lru_.end();) {
+        auto next = std::next(it);
+        if (it->Uses(table)) {
+            Erase(it);
+            ++stats_.invalidations;
+        }
+        it = next;
+    }
+}
+
+void ResultCache::Clear() {
+    lru_.clear();
+    index_.clear();
+    bytes_ = 0;
+}
+
+void ResultCache::SetBudget(size_t bytes) {
+    budget_ = bytes;
+    Evict(0);
+}
+
+ResultCacheStats ResultCache::Stats() const {
+    ResultCacheStats stats = stats_;
+    stats.entries = lru_.size();
+    stats.bytes = bytes_;
+    stats.budget = budget_;
+    return stats;
+}
+
+/* The statement and every parameter are length-prefixed (length:sql, then type:length:text or type:N for NULL), so
+no text, whatever bytes it holds, can pass for a different statement or list of values. Types are part of the key:
+1 and 1.0 compare equal but print differently. */
+std::string ResultCache::Key(const std::string& sql, const std::vector<Value>* parameters) {
+    std::string key = std::to_string(sql.size()) + ':' + sql;
+    if (parameters == nullptr) return key;
+    for (const Value& value : *parameters) {
+        key += '\x1f';
+        key += std::to_string(static_cast<int>(value.type));
+        if (value.null) {
+            key += ":N";
+            continue;
+        }
+        const std::string text = value.ToString();
+        key += ':' + std::to_string(text.size()) + ':';
+        key += text;
+    }
+    return key;
+}
+
+// The rows and strings of a result as the heap holds them.
+size_t ResultCache::ResultBytes(const QueryResult& result) {
+    Footprint footprint = VectorBuffer(result.columns);
+    footprint += VectorBuffer(result.types);
+    footprint += VectorBuffer(result.rows);
+    for (const std::string& column : result.columns) {
+        footprint += StringHeap(column);
+    }
+    for (const Row& row : result.rows) {
+        footprint += VectorBuffer(row);
+        for (const Value& value : row) {
+            footprint += StringHeap(value.text);
+        }
+    }
+    return footprint.allocated;
+}
+
+void ResultCache::Erase(std::list<CachedResult>::iterator it) {
+    bytes_ -= it->bytes;
+    index_.erase(it->key);
+    lru_.erase(it);
+}
+
+void ResultCache::Evict(size_t needed) {
+    while (!lru_.empty() && bytes_ + needed > budget_) {
+        Erase(std::prev(lru_.end()));
+        ++stats_.evictions;
+    }
+}
@@ -0,0 +1,251 @@
+#include "run_length_column.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+
+
+/* Per-type parsing, formatting and serialization. Key is the type constants are parsed into: ints compare as 64-bit
+so that a constant outside the int range still compares correctly, like plain int columns do. */
+template <typename T> struct RunTraits;
+
+template <> struct RunTraits<int32_t> {
+    using Key = long long;
+    static int32_t Parse(const std::string& text) { return std::stoi(text); }
+    static Key ParseKey(const std::string& text) { return std::stoll(text); }
+    static std::string Format(int32_t v) { return std::to_string(v); }
+    static void Put(BinaryWriter& out, int32_t v) { out.PutI32(v); }
+    static int32_t Get(BinaryReader& in) { return in.GetI32(); }
+    static size_t Bytes(int32_t) { return sizeof(int32_t); }
+};
+
+template <> struct RunTraits<double> {
+    using Key = double;
+    static double Parse(const std::string& text) { return std::stod(text); }
+    static Key ParseKey(const std::string& text) { return std::stod(text); }
+    static std::string Format(double v) { return std::to_string(v); }
+    static void Put(BinaryWriter& out, double v) { out.PutDouble(v); }
+    static double Get(BinaryReader& in) { return in.GetDouble(); }
+    static size_t Bytes(double) { return sizeof(double); }
+};
+
+template <> struct RunTraits<std::string> {
+    using Key = std::string;
+    static const std::string& Parse(const std::string& text) { return text; }
+    static const Key& ParseKey(const std::string& text) { return text; }
+    static const std::string& Format(const std::string& v) { return v; }
+    static void Put(BinaryWriter& out, const std::string& v) { out.PutString(v); }
+    static std::string Get(BinaryReader& in) { return in.GetString(); }
+    static size_t Bytes(const std::string& v) { return sizeof(uint32_t) + v.size(); }  // length prefix + bytes
+};
+
+
+template <typename T>
+void RunLengthColumn<T>::AppendValue(const T& value) {
+    if (!values_.empty() && values_.back() == value && ends_.back() != UINT32_MAX) {
+        ++ends_.back();
+        return;
+    }
+    if (!values_.empty() && !(values_.back() < value)) {
+        sorted_ = false;
+    }
+    const uint32_t end = static_cast<uint32_t>(Size()) + 1;
+    values_.push_back(value);
+    ends_.push_back(end);
+}
+
+template <typename T>
+void RunLengthColumn<T>::Append(const std::string& text) {
+    AppendValue(RunTraits<T>::Parse(text));
+}
+
+template <typename T>
+void RunLengthColumn<T>::AppendDefault() {
+    AppendValue(T());
+}
+
+template <typename T>
+void RunLengthColumn<T>::AppendNull() {
+    if (values_.empty()) {
+        AppendDefault();
+    } else {
+        AppendValue(T(values_.back()));
+    }
+}
+
+// Shrinks the last run. A column that stopped being sorted stays unsorted: that only costs the binary search.
+template <typename T>
+void RunLengthColumn<T>::PopBack() {
+    const size_t last = values_.size() - 1;
+    if (--ends_[last] == RunStart(last)) {
+        values_.pop_back();
+        ends_.pop_back();
+    }
+}
+
+template <typename T>
+size_t RunLengthColumn<T>::RunOf(size_t pos) const {
+    return static_cast<size_t>(std::upper_bound(ends_.begin(), ends_.end(), pos) - ends_.begin());
+}
+
+template <typename T>
+std::string RunLengthColumn<T>::GetString(size_t pos) const {
+    return RunTraits<T>::Format(ValueAt(pos));
+}
+
+template <typename T>
+void RunLengthColumn<T>::Print(size_t pos, std::ostream& os) const {
+    os << ValueAt(pos);
+}
+
+template <typename T>
+double RunLengthColumn<T>::GetNumber(size_t pos) const {
+    if constexpr (std::is_arithmetic_v<T>) {
+        return static_cast<double>(ValueAt(pos));
+    } else {
+        return Column::GetNumber(pos);
+    }
+}
+
+template <typename T>
+void RunLengthColumn<T>::SerializeValue(size_t pos, BinaryWriter& out) const {
+    RunTraits<T>::Put(out, ValueAt(pos));
+}
+
+template <typename T>
+void RunLengthColumn<T>::AppendSerialized(BinaryReader& in) {
+    AppendValue(RunTraits<T>::Get(in));
+}
+
+/* Calls visit(first, end) with the part of every run inside ranges whose value satisfies `value op constant`. On a
+sorted column the matching runs of every operator but kNe form one contiguous window, found with two binary searches
+over the run values, and need no comparison at all. */
+template <typename T>
+template <typename Visit>
+void RunLengthColumn<T>::ForEachMatchingRun(CompareOp op, const std::string& constant, const PositionRanges& ranges,
+                                            Visit visit) const {
+    using Key = typename RunTraits<T>::Key;
+    const Key c = RunTraits<T>::ParseKey(constant);
+    const bool window = sorted_ && op != CompareOp::kNe;
+    size_t first_run = 0;
+    size_t last_run = values_.size();
+    if (window) {
+        const size_t lower = static_cast<size_t>(std::lower_bound(values_.begin(), values_.end(), c,
+            [](const T& v, const Key& k) { return v < k; }) - values_.begin());
+        const size_t upper = static_cast<size_t>(std::upper_bound(values_.begin(), values_.end(), c,
+            [](const Key& k, const T& v) { return k < v; }) - values_.begin());
+        switch (op) {
+        case CompareOp::kEq: first_run = lower; last_run = upper; break;
+        case CompareOp::kLt: last_run = lower; break;
+        case CompareOp::kLe: last_run = upper; break;
+        case CompareOp::kGt: first_run = upper; break;
+        case CompareOp::kGe: first_run = lower; break;
+        case CompareOp::kNe: break;
+        }
+    }
+    for (const auto& [begin, end] : ranges) {
+        if (begin >= end) continue;
+        for (size_t run = std::max(RunOf(begin), first_run); run < last_run && RunStart(run) < end; ++run) {
+            if (!window && !Compare<Key>(values_[run], op, c)) continue;
+            visit(std::max<size_t>(RunStart(run), begin), std::min<size_t>(ends_[run], end));
+        }
+    }
+}
+
+template <typename T>
+void RunLengthColumn<T>::Filter(CompareOp op, const std::string& constant, const std::vector<uint64_t>& live,
+                                const PositionRanges& ranges, std::vector<unsigned int>& out) const {
+    ForEachMatchingRun(op, constant, ranges, [&](size_t first, size_t end) {
+        const unsigned int first_id = base_id_ + static_cast<unsigned int>(first);
+        const unsigned int end_id = base_id_ + static_cast<unsigned int>(end);
+        const bool all_live = AllLive(live, first_id, end_id - first_id);
+        for (unsigned int id = first_id; id < end_id; ++id) {
+            if (all_live || IsLive(live, id)) out.push_back(id);
+        }
+    });
+}
+
+template <typename T>
+size_t RunLengthColumn<T>::CountMatches(CompareOp op, const std::string& constant, const std::vector<uint64_t>& live,
+                                        const PositionRanges& ranges) const {
+    size_t count = 0;
+    ForEachMatchingRun(op, constant, ranges, [&](size_t first, size_t end) {
+        count += CountLive(live, base_id_ + static_cast<unsigned int>(first), end - first);
+    });
+    return count;
+}
+
+template <typename T>
+void RunLengthColumn<T>::GroupByCount(const std::vector<uint64_t>& live, std::map<std::string, size_t>& out) const {
+    std::map<T, size_t> counts;
+    for (size_t run = 0; run < values_.size(); ++run) {
+        size_t n = CountLive(live, base_id_ + static_cast<unsigned int>(RunStart(run)), ends_[run] - RunStart(run));
+        if (n > 0) counts[values_[run]] += n;
+    }
+    for (const auto& [value, count] : counts) {
+        out[RunTraits<T>::Format(value)] += count;
+    }
+}
+
+// One multiply-add per run: sum += value * live rows of the run.
+template <typename T>
+AggregateState RunLengthColumn<T>::Aggregate(const std::vector<uint64_t>& live) const {
+    if constexpr (std::is_arithmetic_v<T>) {
+        AggregateState state;
+        for (size_t run = 0; run < values_.size(); ++run) {
+            size_t n = CountLive(live, base_id_ + static_cast<unsigned int>(RunStart(run)), ends_[run] - RunStart(run));
+            if (n == 0) continue;
+            const double v = static_cast<double>(values_[run]);
+            state.count += n;
+            state.sum += v * static_cast<double>(n);
+            if (v < state.min) state.min = v;
+            if (v > state.max) state.max = v;
+        }
+        return state;
+    } else {
+        return Column::Aggregate(live);
+    }
+}
+
+template <typename T>
+Footprint RunLengthColumn<T>::Memory() const {
+    Footprint footprint;
+    footprint.Add(sizeof(RunLengthColumn<T>));
+    footprint += VectorBuffer(values_);
+    footprint += VectorBuffer(ends_);
+    if constexpr (std::is_same_v<T, std::string>) {
+        for (const std::string& value : values_) {
+            footprint += StringHeap(value);
+        }
+    }
+    return footprint;
+}
+
+template <typename T>
+size_t RunLengthColumn<T>::EncodedBytes() const {
+    size_t bytes = 0;
+    for (const T& value : values_) {
+        bytes += RunTraits<T>::Bytes(value) + sizeof(uint32_t);
+    }
+    return bytes;
+}
+
+template <typename T>
+size_t RunLengthColumn<T>::RawBytes() const {
+    size_t bytes = 0;
+    for (size_t run = 0; run < values_.size(); ++run) {
+        bytes += RunTraits<T>::Bytes(values_[run]) * (ends_[run] - RunStart(run));
+    }
+    return bytes;
+}
+
+template <typename T>
+double RunLengthColumn<T>::CompressionRatio() const {
+    size_t encoded = EncodedBytes();
+    return encoded == 0 ? 1.0 : static_cast<double>(RawBytes()) / static_cast<double>(encoded);
+}
+
+
+template class RunLengthColumn<int32_t>;
+template class RunLengthColumn<double>;
+template class RunLengthColumn<std::string>;
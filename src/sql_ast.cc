@@ -0,0 +1,157 @@
+#include "sql_ast.hpp"
+
+#include <sstream>
+
+const char* BinaryOpSymbol(BinaryOp op) {
+    switch (op) {
+    case BinaryOp::kAdd: return "+";
+    case BinaryOp::kSub: return "-";
+    case BinaryOp::kMul: return "*";
+    case BinaryOp::kDiv: return "/";
+    case BinaryOp::kMod: return "%";
+    case BinaryOp::kEq: return "=";
+    case BinaryOp::kNe: return "<>";
+    case BinaryOp::kLt: return "<";
+    case BinaryOp::kLe: return "<=";
+    case BinaryOp::kGt: return ">";
+    case BinaryOp::kGe: return ">=";
+    case BinaryOp::kAnd: return "AND";
+    case BinaryOp::kOr: return "OR";
+    }
+    return "";
+}
+
+bool IsComparison(BinaryOp op) {
+    return op == BinaryOp::kEq || op == BinaryOp::kNe || op == BinaryOp::kLt || op == BinaryOp::kLe ||
+           op == BinaryOp::kGt || op == BinaryOp::kGe;
+}
+
+CompareOp ToCompareOp(BinaryOp op) {
+    switch (op) {
+    case BinaryOp::kNe: return CompareOp::kNe;
+    case BinaryOp::kLt: return CompareOp::kLt;
+    case BinaryOp::kLe: return CompareOp::kLe;
+    case BinaryOp::kGt: return CompareOp::kGt;
+    case BinaryOp::kGe: return CompareOp::kGe;
+    default: return CompareOp::kEq;
+    }
+}
+
+BinaryOp Mirror(BinaryOp op) {
+    switch (op) {
+    case BinaryOp::kLt: return BinaryOp::kGt;
+    case BinaryOp::kLe: return BinaryOp::kGe;
+    case BinaryOp::kGt: return BinaryOp::kLt;
+    case BinaryOp::kGe: return BinaryOp::kLe;
+    default: return op;
+    }
+}
+
+ExprPtr Expr::Clone() const {
+    ExprPtr copy(new Expr());
+    copy->kind = kind;
+    copy->literal = literal;
+    copy->table = table;
+    copy->name = name;
+    copy->unary = unary;
+    copy->binary = binary;
+    copy->negated = negated;
+    copy->fn = fn;
+    copy->star = star;
+    copy->parameter = parameter;
+    copy->slot = slot;
+    copy->type = type;
+    for (const ExprPtr& arg : args) {
+        copy->args.push_back(arg->Clone());
+    }
+    return copy;
+}
+
+static std::string AggregateSqlName(AggregateFn fn) {
+    std::string name = AggregateFnName(fn);
+    for (char& c : name) {
+        c = static_cast<char>(c - 'a' + 'A');
+    }
+    return name;
+}
+
+std::string Expr::ToString() const {
+    std::ostringstream os;
+    switch (kind) {
+    case ExprKind::kLiteral:
+        if (literal.null) {
+            os << "NULL";
+        } else if (literal.type == DataType::kString) {
+            os << '\'';
+            for (char c : literal.text) {
+                os << c;
+                if (c == '\'') os << c;
+            }
+            os << '\'';
+        } else {
+            os << literal;
+        }
+        break;
+    case ExprKind::kColumn:
+        if (!table.empty()) os << table << '.';
+        os << name;
+        break;
+    case ExprKind::kUnary:
+        os << (unary == UnaryOp::kNeg ? "-" : "NOT ") << args[0]->ToString();
+        break;
+    case ExprKind::kBinary:
+        os << '(' << args[0]->ToString() << ' ' << BinaryOpSymbol(binary) << ' ' << args[1]->ToString() << ')';
+        break;
+    case ExprKind::kIsNull:
+        os << args[0]->ToString() << (negated ? " IS NOT NULL" : " IS NULL");
+        break;
+    case ExprKind::kAggregate:
+        os << AggregateSqlName(fn) << '(' << (star ? "*" : args[0]->ToString()) << ')';
+        break;
+    case ExprKind::kParameter:
+        os << '?' << parameter + 1;
+        break;
+    }
+    return os.str();
+}
+
+ExprPtr MakeLiteral(Value value) {
+    ExprPtr expr(new Expr());
+    expr->kind = ExprKind::kLiteral;
+    expr->type = value.type;
+    expr->literal = std::move(value);
+    return expr;
+}
+
+ExprPtr MakeColumn(std::string table, std::string name) {
+    ExprPtr expr(new Expr());
+    expr->kind = ExprKind::kColumn;
+    expr->table = std::move(table);
+    expr->name = std::move(name);
+    return expr;
+}
+
+ExprPtr MakeUnary(UnaryOp op, ExprPtr operand) {
+    ExprPtr expr(new Expr());
+    expr->kind = ExprKind::kUnary;
+    expr->unary = op;
+    expr->args.push_back(std::move(operand));
+    return expr;
+}
+
+ExprPtr MakeBinary(BinaryOp op, ExprPtr left, ExprPtr right) {
+    ExprPtr expr(new Expr());
+    expr->kind = ExprKind::kBinary;
+    expr->binary = op;
+    expr->args.push_back(std::move(left));
+    expr->args.push_back(std::move(right));
+    return expr;
+}
+
+ExprPtr MakeParameter(int index) {
+    ExprPtr expr(new Expr());
+    expr->kind = ExprKind::kParameter;
+    expr->parameter = index;
+    expr->type = DataType::kString;
+    return expr;
+}
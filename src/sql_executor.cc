@@ -0,0 +1,1150 @@
+#include "sql_executor.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "db.hpp"
+#include "expr_compiler.hpp"
+
+namespace {
+
+int64_t CheckedAdd(int64_t a, int64_t b) {
+    int64_t result;
+    if (__builtin_add_overflow(a, b, &result)) throw std::out_of_range("Integer overflow");
+    return result;
+}
+
+Value Arithmetic(BinaryOp op, const Value& a, const Value& b, DataType type) {
+    if (a.null || b.null) return Value::Null(type);
+    if (type == DataType::kDouble) {
+        const double x = a.AsDouble();
+        const double y = b.AsDouble();
+        switch (op) {
+        case BinaryOp::kAdd: return Value::Number(x + y);
+        case BinaryOp::kSub: return Value::Number(x - y);
+        case BinaryOp::kMul: return Value::Number(x * y);
+        case BinaryOp::kDiv: return y == 0 ? Value::Null(type) : Value::Number(x / y);
+        default: return y == 0 ? Value::Null(type) : Value::Number(std::fmod(x, y));
+        }
+    }
+    const int64_t x = a.integer;
+    const int64_t y = b.integer;
+    int64_t result = 0;
+    switch (op) {
+    case BinaryOp::kAdd:
+        result = CheckedAdd(x, y);
+        break;
+    case BinaryOp::kSub:
+        if (__builtin_sub_overflow(x, y, &result)) throw std::out_of_range("Integer overflow");
+        break;
+    case BinaryOp::kMul:
+        if (__builtin_mul_overflow(x, y, &result)) throw std::out_of_range("Integer overflow");
+        break;
+    default:
+        if (y == 0) return Value::Null(type);
+        if (y == -1) {  // INT64_MIN / -1 does not fit
+            if (op == BinaryOp::kMod) return Value::Integer(type, 0);
+            if (x == std::numeric_limits<int64_t>::min()) throw std::out_of_range("Integer overflow");
+        }
+        result = op == BinaryOp::kDiv ? x / y : x % y;
+        break;
+    }
+    return Value::Integer(type, result);
+}
+
+Value Negate(const Value& v, DataType type) {
+    if (v.null) return Value::Null(type);
+    if (type == DataType::kDouble) return Value::Number(-v.AsDouble());
+    if (v.integer == std::numeric_limits<int64_t>::min()) throw std::out_of_range("Integer overflow");
+    return Value::Integer(type, -v.integer);
+}
+
+// Hash and equality of a row of keys, with NULL equal to NULL (GROUP BY puts NULLs in one group).
+struct KeyHash {
+    size_t operator()(const Row& key) const {
+        size_t hash = 0;
+        for (const Value& v : key) {
+            hash ^= HashValue(v) + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+        }
+        return hash;
+    }
+};
+
+struct KeyEqual {
+    bool operator()(const Row& a, const Row& b) const {
+        for (size_t i = 0; i < a.size(); ++i) {
+            if (CompareValues(a[i], b[i]) != 0) return false;
+        }
+        return true;
+    }
+};
+
+void EvaluateAll(const std::vector<ExprPtr>& exprs, const Row& row, Row& out) {
+    out.resize(exprs.size());
+    for (size_t i = 0; i < exprs.size(); ++i) {
+        out[i] = Evaluate(*exprs[i], row);
+    }
+}
+
+bool AnyNull(const Row& row) {
+    return std::any_of(row.begin(), row.end(), [](const Value& v) { return v.null; });
+}
+
+void Concat(const Row& left, const Row& right, Row& out) {
+    out.assign(left.begin(), left.end());
+    out.insert(out.end(), right.begin(), right.end());
+}
+
+thread_local const std::vector<Value>* active_parameters = nullptr;
+
+const Value& ParameterValue(int index) {
+    if (active_parameters == nullptr || static_cast<size_t>(index) >= active_parameters->size()) {
+        throw std::invalid_argument("No value for parameter ?" + std::to_string(index + 1));
+    }
+    return (*active_parameters)[static_cast<size_t>(index)];
+}
+
+// The predicates of a scan with their parameters filled in; false when one is NULL, which no row matches.
+bool ResolvePredicates(const PlanNode& scan, std::vector<ScanPredicate>& predicates) {
+    predicates = scan.predicates;
+    for (ScanPredicate& predicate : predicates) {
+        if (predicate.parameter < 0) continue;
+        predicate.constant = ParameterValue(predicate.parameter);
+        if (predicate.constant.null) return false;
+        predicate.text = predicate.constant.ToString();
+    }
+    return true;
+}
+
+// Whether the row at cursor passes the predicates from `first` on.
+bool MatchesPredicates(const std::vector<ScanPredicate>& predicates, const DbTable& table,
+                       const DbTable::RowCursor& cursor, size_t first) {
+    for (size_t i = first; i < predicates.size(); ++i) {
+        const ScanPredicate& predicate = predicates[i];
+        const Value value = table.GetValue(cursor, predicate.column);
+        if (value.null || !Compare(CompareValues(value, predicate.constant), predicate.op, 0)) return false;
+    }
+    return true;
+}
+
+/* A sequential scan walks every row and checks every predicate. With kFilter access the first predicate runs through
+DbTable::Filter, which prunes zones and scans encoded columns without decoding rows, and the others are checked on the
+rows it returns. */
+class ScanOperator : public Operator {
+public:
+    explicit ScanOperator(const PlanNode& plan): plan_(plan) {
+        for (const PlanColumn& column : plan_.columns) {
+            types_.push_back(column.type);
+        }
+    }
+
+    void Open() override {
+        started_ = false;
+        next_id_ = 0;
+        ids_.clear();
+        empty_ = !ResolvePredicates(plan_, predicates_);
+        if (Driven() && !empty_) {
+            const ScanPredicate& first = predicates_[0];
+            ids_ = plan_.table->Filter(first.column, first.op, first.text);
+        }
+    }
+
+    bool Next(Row& row) override {
+        if (empty_) return false;
+        while (Advance()) {
+            if (!Matches()) continue;
+            const size_t width = plan_.scan_columns.size();
+            row.resize(plan_.columns.size());
+            for (size_t i = 0; i < width; ++i) {
+                row[i] = plan_.table->GetValue(cursor_, plan_.scan_columns[i]);
+            }
+            if (plan_.with_row_id) row[width] = Value::Integer(DataType::kInt64, cursor_.Id());
+            return true;
+        }
+        return false;
+    }
+
+    bool ProducesChunks() const override { return true; }
+
+    bool NextChunk(DataChunk& chunk) override {
+        if (empty_) return false;
+        const size_t width = plan_.scan_columns.size();
+        chunk.Reset(types_, DataChunk::kCapacity);
+        size_t count = 0;
+        while (count < DataChunk::kCapacity && Advance()) {
+            if (!Matches()) continue;
+            for (size_t i = 0; i < width; ++i) {
+                chunk.batch.columns[i].Set(count, plan_.table->GetValue(cursor_, plan_.scan_columns[i]));
+            }
+            if (plan_.with_row_id) {
+                chunk.batch.columns[width].Set(count, Value::Integer(DataType::kInt64, cursor_.Id()));
+            }
+            ++count;
+        }
+        chunk.batch.size = count;
+        for (ValueVector& column : chunk.batch.columns) {
+            column.size = count;
+        }
+        return count > 0;
+    }
+
+private:
+    bool Driven() const { return plan_.access == ScanAccess::kFilter && !plan_.predicates.empty(); }
+
+    bool Advance() {
+        if (!Driven()) {
+            if (!started_) {
+                cursor_ = plan_.table->Rows();
+                started_ = true;
+            } else if (cursor_.Valid()) {  // a chunk can ask again after the last row
+                cursor_.Next();
+            }
+            return cursor_.Valid();
+        }
+        while (next_id_ < ids_.size()) {
+            const unsigned int id = ids_[next_id_++];
+            cursor_ = plan_.table->Seek(id);
+            if (cursor_.Valid() && cursor_.Id() == id) return true;
+        }
+        return false;
+    }
+
+    bool Matches() const { return MatchesPredicates(predicates_, *plan_.table, cursor_, Driven() ? 1 : 0); }
+
+    const PlanNode& plan_;
+    std::vector<DataType> types_;  // of the output slots
+    std::vector<ScanPredicate> predicates_;
+    bool empty_ = false;
+    DbTable::RowCursor cursor_;
+    bool started_ = false;
+    std::vector<unsigned int> ids_;
+    size_t next_id_ = 0;
+};
+
+const size_t kBatchRows = DataChunk::kCapacity;
+
+/* Pulls up to kBatchRows rows from input into rows (reusing their storage); sets done when the input ran out. */
+size_t PullBatch(Operator& input, std::vector<Row>& rows, bool& done) {
+    if (rows.size() < kBatchRows) rows.resize(kBatchRows);
+    size_t count = 0;
+    while (count < kBatchRows && input.Next(rows[count])) {
+        ++count;
+    }
+    done = count < kBatchRows;
+    return count;
+}
+
+/* Loads rows[0, count) into batch and runs compiled expressions over it. False when a value does not load or the
+compiled code throws (expr_compiler.hpp); the caller evaluates the rows with Evaluate instead. */
+template <typename Run>
+bool RunCompiled(const std::vector<std::pair<int, DataType>>& inputs, const std::vector<Row>& rows, size_t count,
+                 Batch& batch, Run run) {
+    if (!batch.Load(rows, count, inputs)) return false;
+    try {
+        run();
+    } catch (const std::exception&) {
+        return false;
+    }
+    return true;
+}
+
+/* Runs compiled expressions over the columns of chunk. False when a column does not have the type the expressions read
+it as or the compiled code throws; the caller evaluates the selected rows with Evaluate instead. */
+template <typename Run>
+bool RunCompiled(const std::vector<std::pair<int, DataType>>& inputs, const DataChunk& chunk, Run run) {
+    for (const auto& [slot, type] : inputs) {
+        if (chunk.batch.columns[static_cast<size_t>(slot)].type != type) return false;
+    }
+    try {
+        run();
+    } catch (const std::exception&) {
+        return false;
+    }
+    return true;
+}
+
+// Copies the selected rows of source, a column of chunk or computed over it, into out.
+void Gather(const ValueVector& source, const DataChunk& chunk, ValueVector& out) {
+    const size_t count = chunk.Count();
+    out.Reset(source.type, count);
+    for (size_t i = 0; i < count; ++i) {
+        out.nulls[i] = source.nulls[chunk.Index(i)];
+    }
+    if (source.type == DataType::kString) {
+        for (size_t i = 0; i < count; ++i) {
+            out.texts[i] = source.texts[chunk.Index(i)];
+        }
+    } else if (source.type == DataType::kDouble) {
+        for (size_t i = 0; i < count; ++i) {
+            out.numbers[i] = source.numbers[chunk.Index(i)];
+        }
+    } else {
+        for (size_t i = 0; i < count; ++i) {
+            out.integers[i] = source.integers[chunk.Index(i)];
+        }
+    }
+}
+
+/* A predicate that compiles runs over batches of rows; otherwise rows pass through one at a time. Over an input that
+produces chunks it narrows their selection instead. */
+class FilterOperator : public Operator {
+public:
+    FilterOperator(const PlanNode& plan, std::unique_ptr<Operator> input)
+        : plan_(plan), input_(std::move(input)), compiled_(CompileExpr(*plan.predicate)) {}
+
+    void Open() override {
+        input_->Open();
+        selected_.clear();
+        next_ = 0;
+        done_ = false;
+    }
+
+    bool Next(Row& row) override {
+        if (!compiled_.Compiled()) {
+            while (input_->Next(row)) {
+                if (Evaluate(*plan_.predicate, row).IsTrue()) return true;
+            }
+            return false;
+        }
+        while (next_ == selected_.size()) {
+            if (done_) return false;
+            Fill();
+        }
+        row.swap(rows_[selected_[next_++]]);
+        return true;
+    }
+
+    bool ProducesChunks() const override { return input_->ProducesChunks(); }
+
+    bool NextChunk(DataChunk& chunk) override {
+        while (input_->NextChunk(chunk)) {
+            const bool compiled = compiled_.Compiled() && RunCompiled(compiled_.Inputs(), chunk, [&] {
+                compiled_.Select(chunk.batch, selected_);
+            });
+            if (!compiled) {
+                selected_.clear();
+                for (size_t i = 0; i < chunk.Count(); ++i) {
+                    chunk.GetRow(i, row_);
+                    if (!Evaluate(*plan_.predicate, row_).IsTrue()) continue;
+                    selected_.push_back(static_cast<uint32_t>(chunk.Index(i)));
+                }
+            }
+            chunk.Select(selected_);
+            if (chunk.Count() > 0) return true;
+        }
+        return false;
+    }
+
+private:
+    void Fill() {
+        const size_t count = PullBatch(*input_, rows_, done_);
+        next_ = 0;
+        if (RunCompiled(compiled_.Inputs(), rows_, count, batch_, [&] { compiled_.Select(batch_, selected_); })) {
+            return;
+        }
+        selected_.clear();
+        for (size_t i = 0; i < count; ++i) {
+            if (Evaluate(*plan_.predicate, rows_[i]).IsTrue()) selected_.push_back(static_cast<uint32_t>(i));
+        }
+    }
+
+    const PlanNode& plan_;
+    std::unique_ptr<Operator> input_;
+    CompiledExpr compiled_;
+    std::vector<Row> rows_;
+    Batch batch_;
+    std::vector<uint32_t> selected_;  // rows_ (or rows of the chunk) that pass
+    Row row_;
+    size_t next_ = 0;
+    bool done_ = false;
+};
+
+/* Computed columns run over batches of rows when every expression compiles; plain columns are copied. Over an input
+that produces chunks it produces chunks too, of the selected rows only. */
+class ProjectOperator : public Operator {
+public:
+    ProjectOperator(const PlanNode& plan, std::unique_ptr<Operator> input): plan_(plan), input_(std::move(input)) {
+        bool computed = false;
+        batched_ = true;
+        for (const ExprPtr& expr : plan_.exprs) {
+            compiled_.push_back(CompileExpr(*expr));
+            const CompiledExpr& compiled = compiled_.back();
+            batched_ = batched_ && compiled.Compiled();
+            computed = computed || compiled.Slot() < 0;
+            for (const auto& input : compiled.Inputs()) {
+                if (std::find(inputs_.begin(), inputs_.end(), input) == inputs_.end()) inputs_.push_back(input);
+            }
+        }
+        vectorized_ = batched_ && input_->ProducesChunks();
+        batched_ = batched_ && computed;
+        results_.resize(plan_.exprs.size());
+        for (const PlanColumn& column : plan_.columns) {
+            types_.push_back(column.type);
+        }
+    }
+
+    void Open() override {
+        input_->Open();
+        count_ = 0;
+        next_ = 0;
+        done_ = false;
+    }
+
+    bool Next(Row& row) override {
+        if (!batched_) {
+            if (!input_->Next(input_row_)) return false;
+            EvaluateAll(plan_.exprs, input_row_, row);
+            return true;
+        }
+        while (next_ == count_) {
+            if (done_) return false;
+            Fill();
+        }
+        row.swap(outputs_[next_++]);
+        return true;
+    }
+
+    bool ProducesChunks() const override { return vectorized_; }
+
+    bool NextChunk(DataChunk& chunk) override {
+        if (!input_->NextChunk(input_chunk_)) return false;
+        const size_t count = input_chunk_.Count();
+        const bool compiled = RunCompiled(inputs_, input_chunk_, [&] {
+            for (size_t j = 0; j < compiled_.size(); ++j) {
+                if (compiled_[j].Slot() < 0) compiled_[j].Evaluate(input_chunk_.batch, results_[j]);
+            }
+        });
+        chunk.Reset(types_, count);
+        if (compiled) {
+            for (size_t j = 0; j < compiled_.size(); ++j) {
+                const int slot = compiled_[j].Slot();
+                Gather(slot >= 0 ? input_chunk_.batch.columns[static_cast<size_t>(slot)] : results_[j], input_chunk_,
+                       chunk.batch.columns[j]);
+            }
+            return true;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            input_chunk_.GetRow(i, input_row_);
+            for (size_t j = 0; j < compiled_.size(); ++j) {
+                chunk.batch.columns[j].Set(i, Evaluate(*plan_.exprs[j], input_row_));
+            }
+        }
+        return true;
+    }
+
+private:
+    void Fill() {
+        count_ = PullBatch(*input_, rows_, done_);
+        next_ = 0;
+        if (outputs_.size() < count_) outputs_.resize(count_);
+        const bool compiled = RunCompiled(inputs_, rows_, count_, batch_, [&] {
+            for (size_t j = 0; j < compiled_.size(); ++j) {
+                if (compiled_[j].Slot() < 0) compiled_[j].Evaluate(batch_, results_[j]);
+            }
+        });
+        for (size_t i = 0; i < count_; ++i) {
+            if (!compiled) {
+                EvaluateAll(plan_.exprs, rows_[i], outputs_[i]);
+                continue;
+            }
+            Row& out = outputs_[i];
+            out.resize(compiled_.size());
+            for (size_t j = 0; j < compiled_.size(); ++j) {
+                const int slot = compiled_[j].Slot();
+                out[j] = slot >= 0 ? rows_[i][static_cast<size_t>(slot)] : results_[j].Get(i);
+            }
+        }
+    }
+
+    const PlanNode& plan_;
+    std::unique_ptr<Operator> input_;
+    Row input_row_;
+    bool batched_ = false;
+    bool vectorized_ = false;                       // every expression compiles and the input produces chunks
+    std::vector<DataType> types_;                   // of the output columns
+    DataChunk input_chunk_;
+    std::vector<CompiledExpr> compiled_;
+    std::vector<std::pair<int, DataType>> inputs_;  // slots the expressions read
+    std::vector<Row> rows_;
+    Batch batch_;
+    std::vector<ValueVector> results_;  // per expression
+    std::vector<Row> outputs_;
+    size_t count_ = 0;
+    size_t next_ = 0;
+    bool done_ = false;
+};
+
+// Builds a hash table over the right input, then streams the left input through it.
+class HashJoinOperator : public Operator {
+public:
+    HashJoinOperator(const PlanNode& plan, std::unique_ptr<Operator> left, std::unique_ptr<Operator> right)
+        : plan_(plan), left_(std::move(left)), right_(std::move(right)) {}
+
+    void Open() override {
+        table_.clear();
+        matches_ = nullptr;
+        right_->Open();
+        Row row;
+        Row key;
+        while (right_->Next(row)) {
+            EvaluateAll(plan_.right_keys, row, key);
+            if (AnyNull(key)) continue;  // NULL never equals anything
+            table_[key].push_back(row);
+        }
+        left_->Open();
+    }
+
+    bool Next(Row& row) override {
+        while (true) {
+            if (matches_ != nullptr && next_match_ < matches_->size()) {
+                Concat(left_row_, (*matches_)[next_match_++], row);
+                if (!plan_.predicate || Evaluate(*plan_.predicate, row).IsTrue()) return true;
+                continue;
+            }
+            if (!left_->Next(left_row_)) return false;
+            EvaluateAll(plan_.left_keys, left_row_, key_);
+            auto it = AnyNull(key_) ? table_.end() : table_.find(key_);
+            matches_ = it == table_.end() ? nullptr : &it->second;
+            next_match_ = 0;
+        }
+    }
+
+private:
+    const PlanNode& plan_;
+    std::unique_ptr<Operator> left_;
+    std::unique_ptr<Operator> right_;
+    std::unordered_map<Row, std::vector<Row>, KeyHash, KeyEqual> table_;
+    Row left_row_;
+    Row key_;
+    const std::vector<Row>* matches_ = nullptr;
+    size_t next_match_ = 0;
+};
+
+class NestedLoopJoinOperator : public Operator {
+public:
+    NestedLoopJoinOperator(const PlanNode& plan, std::unique_ptr<Operator> left, std::unique_ptr<Operator> right)
+        : plan_(plan), left_(std::move(left)), right_(std::move(right)) {}
+
+    void Open() override {
+        right_rows_.clear();
+        right_->Open();
+        Row row;
+        while (right_->Next(row)) {
+            right_rows_.push_back(row);
+        }
+        left_->Open();
+        next_right_ = right_rows_.size();  // fetch a left row first
+    }
+
+    bool Next(Row& row) override {
+        while (true) {
+            if (next_right_ < right_rows_.size()) {
+                Concat(left_row_, right_rows_[next_right_++], row);
+                if (!plan_.predicate || Evaluate(*plan_.predicate, row).IsTrue()) return true;
+                continue;
+            }
+            if (right_rows_.empty() || !left_->Next(left_row_)) return false;
+            next_right_ = 0;
+        }
+    }
+
+private:
+    const PlanNode& plan_;
+    std::unique_ptr<Operator> left_;
+    std::unique_ptr<Operator> right_;
+    std::vector<Row> right_rows_;
+    Row left_row_;
+    size_t next_right_ = 0;
+};
+
+/* Runs no scan for its right side: for every left row, DbTable::Filter(kEq) finds the rows of the right table whose
+first key column equals the left key, which are sought and checked against the scan's predicates, the other keys and
+the join predicate. */
+class LookupJoinOperator : public Operator {
+public:
+    LookupJoinOperator(const PlanNode& plan, std::unique_ptr<Operator> left)
+        : plan_(plan), scan_(*plan.children[1]), left_(std::move(left)) {
+        key_column_ = scan_.scan_columns[plan_.right_keys[0]->slot];
+        key_type_ = scan_.columns[plan_.right_keys[0]->slot].type;
+    }
+
+    void Open() override {
+        ids_.clear();
+        next_id_ = 0;
+        empty_ = !ResolvePredicates(scan_, predicates_);
+        left_->Open();
+    }
+
+    bool Next(Row& row) override {
+        if (empty_) return false;
+        while (true) {
+            while (next_id_ < ids_.size()) {
+                const unsigned int id = ids_[next_id_++];
+                const DbTable::RowCursor cursor = scan_.table->Seek(id);
+                if (!cursor.Valid() || cursor.Id() != id || !MatchesPredicates(predicates_, *scan_.table, cursor, 0)) {
+                    continue;
+                }
+                right_row_.resize(scan_.scan_columns.size());
+                for (size_t i = 0; i < scan_.scan_columns.size(); ++i) {
+                    right_row_[i] = scan_.table->GetValue(cursor, scan_.scan_columns[i]);
+                }
+                if (!KeysMatch()) continue;
+                Concat(left_row_, right_row_, row);
+                if (!plan_.predicate || Evaluate(*plan_.predicate, row).IsTrue()) return true;
+            }
+            if (!left_->Next(left_row_)) return false;
+            ids_.clear();
+            next_id_ = 0;
+            Value constant;
+            if (ToFilterConstant(Evaluate(*plan_.left_keys[0], left_row_), key_type_, constant)) {
+                ids_ = scan_.table->Filter(key_column_, CompareOp::kEq, constant.ToString());
+            }
+        }
+    }
+
+private:
+    bool KeysMatch() const {
+        for (size_t i = 1; i < plan_.left_keys.size(); ++i) {
+            const Value left = Evaluate(*plan_.left_keys[i], left_row_);
+            const Value right = Evaluate(*plan_.right_keys[i], right_row_);
+            if (left.null || right.null || CompareValues(left, right) != 0) return false;
+        }
+        return true;
+    }
+
+    const PlanNode& plan_;
+    const PlanNode& scan_;
+    std::vector<ScanPredicate> predicates_;
+    bool empty_ = false;
+    std::unique_ptr<Operator> left_;
+    unsigned int key_column_ = 0;
+    DataType key_type_ = DataType::kString;
+    Row left_row_;
+    Row right_row_;
+    std::vector<unsigned int> ids_;
+    size_t next_id_ = 0;
+};
+
+struct AggregateAccumulator {
+    int64_t count = 0;
+    int64_t exact_sum = 0;
+    double sum = 0;
+    Value best;  // MIN / MAX so far
+
+    void Add(const AggregateCall& call, const Row& row) {
+        if (!call.arg) {
+            ++count;
+            return;
+        }
+        Add(call, Evaluate(*call.arg, row));
+    }
+
+    void Add(const AggregateCall& call, Value value) {
+        if (value.null) return;
+        ++count;
+        switch (call.fn) {
+        case AggregateFn::kCount:
+            break;
+        case AggregateFn::kSum:
+        case AggregateFn::kAvg:
+            if (call.type == DataType::kInt64) {
+                exact_sum = CheckedAdd(exact_sum, value.integer);
+            } else {
+                sum += value.AsDouble();
+            }
+            break;
+        case AggregateFn::kMin:
+            if (count == 1 || CompareValues(value, best) < 0) best = std::move(value);
+            break;
+        case AggregateFn::kMax:
+            if (count == 1 || CompareValues(value, best) > 0) best = std::move(value);
+            break;
+        }
+    }
+
+    Value Result(const AggregateCall& call) const {
+        if (call.fn == AggregateFn::kCount) return Value::Integer(DataType::kInt64, count);
+        if (count == 0) return Value::Null(call.type);
+        if (call.fn == AggregateFn::kSum) {
+            return call.type == DataType::kInt64 ? Value::Integer(call.type, exact_sum) : Value::Number(sum);
+        }
+        if (call.fn == AggregateFn::kAvg) return Value::Number(sum / static_cast<double>(count));
+        return best;
+    }
+};
+
+/* Groups come out in the order their first row arrived. Over an input that produces chunks the group keys and
+arguments are computed a chunk at a time when they all compile. */
+class AggregateOperator : public Operator {
+public:
+    AggregateOperator(const PlanNode& plan, std::unique_ptr<Operator> input)
+        : plan_(plan), input_(std::move(input)) {
+        compiled_ = true;
+        for (const ExprPtr& key : plan_.group_by) {
+            Compile(*key);
+        }
+        for (const AggregateCall& call : plan_.aggregates) {
+            if (call.arg) Compile(*call.arg);
+        }
+        key_values_.resize(plan_.group_by.size());
+        arg_values_.resize(plan_.aggregates.size());
+    }
+
+    void Open() override {
+        keys_.clear();
+        states_.clear();
+        groups_.clear();
+        next_group_ = 0;
+        input_->Open();
+        if (input_->ProducesChunks()) {
+            while (input_->NextChunk(chunk_)) {
+                AddChunk();
+            }
+        } else {
+            Row row;
+            while (input_->Next(row)) {
+                EvaluateAll(plan_.group_by, row, key_);
+                std::vector<AggregateAccumulator>& states = Group();
+                for (size_t i = 0; i < plan_.aggregates.size(); ++i) {
+                    states[i].Add(plan_.aggregates[i], row);
+                }
+            }
+        }
+        groups_.clear();
+        if (plan_.group_by.empty() && keys_.empty()) {  // SELECT COUNT(*) FROM empty
+            keys_.emplace_back();
+            states_.emplace_back(plan_.aggregates.size());
+        }
+    }
+
+    bool Next(Row& row) override {
+        if (next_group_ >= keys_.size()) return false;
+        row = keys_[next_group_];
+        for (size_t i = 0; i < plan_.aggregates.size(); ++i) {
+            row.push_back(states_[next_group_][i].Result(plan_.aggregates[i]));
+        }
+        ++next_group_;
+        return true;
+    }
+
+private:
+    void Compile(const Expr& expr) {
+        exprs_.push_back(CompileExpr(expr));
+        const CompiledExpr& compiled = exprs_.back();
+        compiled_ = compiled_ && compiled.Compiled();
+        for (const auto& input : compiled.Inputs()) {
+            if (std::find(inputs_.begin(), inputs_.end(), input) == inputs_.end()) inputs_.push_back(input);
+        }
+    }
+
+    // The accumulators of the group of key_, added if it is new.
+    std::vector<AggregateAccumulator>& Group() {
+        auto [it, inserted] = groups_.try_emplace(key_, keys_.size());
+        if (inserted) {
+            keys_.push_back(key_);
+            states_.emplace_back(plan_.aggregates.size());
+        }
+        return states_[it->second];
+    }
+
+    void AddChunk() {
+        const bool compiled = compiled_ && RunCompiled(inputs_, chunk_, [&] {
+            size_t next = 0;
+            for (ValueVector& values : key_values_) {
+                exprs_[next++].Evaluate(chunk_.batch, values);
+            }
+            for (size_t i = 0; i < plan_.aggregates.size(); ++i) {
+                if (plan_.aggregates[i].arg) exprs_[next++].Evaluate(chunk_.batch, arg_values_[i]);
+            }
+        });
+        key_.resize(plan_.group_by.size());
+        for (size_t r = 0; r < chunk_.Count(); ++r) {
+            if (!compiled) {
+                chunk_.GetRow(r, row_);
+                EvaluateAll(plan_.group_by, row_, key_);
+                std::vector<AggregateAccumulator>& states = Group();
+                for (size_t i = 0; i < plan_.aggregates.size(); ++i) {
+                    states[i].Add(plan_.aggregates[i], row_);
+                }
+                continue;
+            }
+            const size_t index = chunk_.Index(r);
+            for (size_t k = 0; k < key_.size(); ++k) {
+                key_[k] = key_values_[k].Get(index);
+            }
+            std::vector<AggregateAccumulator>& states = Group();
+            for (size_t i = 0; i < plan_.aggregates.size(); ++i) {
+                const AggregateCall& call = plan_.aggregates[i];
+                if (call.arg) {
+                    states[i].Add(call, arg_values_[i].Get(index));
+                } else {
+                    ++states[i].count;
+                }
+            }
+        }
+    }
+
+    const PlanNode& plan_;
+    std::unique_ptr<Operator> input_;
+    std::vector<Row> keys_;
+    std::vector<std::vector<AggregateAccumulator>> states_;
+    size_t next_group_ = 0;
+    std::unordered_map<Row, size_t, KeyHash, KeyEqual> groups_;  // key -> index into keys_, while Open runs
+    Row key_;
+    Row row_;
+    bool compiled_ = false;                    // every key and argument compiles
+    std::vector<CompiledExpr> exprs_;          // the keys, then the arguments of the aggregates that have one
+    std::vector<std::pair<int, DataType>> inputs_;
+    DataChunk chunk_;
+    std::vector<ValueVector> key_values_;      // per key, for the current chunk
+    std::vector<ValueVector> arg_values_;      // per aggregate
+};
+
+class SortOperator : public Operator {
+public:
+    SortOperator(const PlanNode& plan, std::unique_ptr<Operator> input): plan_(plan), input_(std::move(input)) {}
+
+    void Open() override {
+        rows_.clear();
+        keys_.clear();
+        next_row_ = 0;
+        input_->Open();
+        Row row;
+        Row key;
+        while (input_->Next(row)) {
+            key.resize(plan_.sort_keys.size());
+            for (size_t i = 0; i < plan_.sort_keys.size(); ++i) {
+                key[i] = Evaluate(*plan_.sort_keys[i].expr, row);
+            }
+            rows_.push_back(row);
+            keys_.push_back(key);
+        }
+        order_.resize(rows_.size());
+        for (size_t i = 0; i < order_.size(); ++i) {
+            order_[i] = i;
+        }
+        std::stable_sort(order_.begin(), order_.end(), [this](size_t a, size_t b) {
+            for (size_t i = 0; i < plan_.sort_keys.size(); ++i) {
+                const int c = CompareValues(keys_[a][i], keys_[b][i]);
+                if (c != 0) return plan_.sort_keys[i].descending ? c > 0 : c < 0;
+            }
+            return false;
+        });
+    }
+
+    bool Next(Row& row) override {
+        if (next_row_ >= order_.size()) return false;
+        row = std::move(rows_[order_[next_row_++]]);
+        return true;
+    }
+
+private:
+    const PlanNode& plan_;
+    std::unique_ptr<Operator> input_;
+    std::vector<Row> rows_;
+    std::vector<Row> keys_;
+    std::vector<size_t> order_;
+    size_t next_row_ = 0;
+};
+
+class LimitOperator : public Operator {
+public:
+    LimitOperator(const PlanNode& plan, std::unique_ptr<Operator> input): plan_(plan), input_(std::move(input)) {}
+
+    void Open() override {
+        input_->Open();
+        produced_ = 0;
+        skipped_ = 0;
+    }
+
+    // Stops pulling from the input once the limit is reached, so a scan below a LIMIT ends early.
+    bool Next(Row& row) override {
+        if (plan_.limit >= 0 && produced_ >= plan_.limit) return false;
+        while (input_->Next(row)) {
+            if (skipped_ < plan_.offset) {
+                ++skipped_;
+                continue;
+            }
+            ++produced_;
+            return true;
+        }
+        return false;
+    }
+
+private:
+    const PlanNode& plan_;
+    std::unique_ptr<Operator> input_;
+    int64_t produced_ = 0;
+    int64_t skipped_ = 0;
+};
+
+int FindColumn(const DbTable& table, const std::string& name) {
+    const auto& descs = table.GetColumnDescriptions();
+    for (size_t i = 0; i < descs.size(); ++i) {
+        if (descs[i].first == name) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+size_t ExecuteInsert(Database& db, const Statement& statement) {
+    DbTable& table = db.GetTable(statement.table);
+    const auto& descs = table.GetColumnDescriptions();
+    std::vector<size_t> targets;
+    if (statement.columns.empty()) {
+        for (size_t i = 0; i < descs.size(); ++i) {
+            targets.push_back(i);
+        }
+    }
+    for (const std::string& name : statement.columns) {
+        const int col = FindColumn(table, name);
+        if (col < 0) {
+            throw std::invalid_argument("Unknown column: " + name);
+        }
+        if (std::find(targets.begin(), targets.end(), static_cast<size_t>(col)) != targets.end()) {
+            throw std::invalid_argument("Column listed twice: " + name);
+        }
+        targets.push_back(static_cast<size_t>(col));
+    }
+
+    std::vector<std::vector<std::optional<std::string>>> rows;
+    for (const std::vector<ExprPtr>& values : statement.values) {
+        if (values.size() != targets.size()) {
+            throw std::invalid_argument("INSERT has " + std::to_string(values.size()) + " values for " +
+                                        std::to_string(targets.size()) + " columns");
+        }
+        std::vector<std::optional<std::string>> cells(descs.size());
+        for (size_t i = 0; i < values.size(); ++i) {
+            const Value value = Evaluate(*BindConstant(*values[i]), Row());
+            if (value.null) continue;
+            const auto& [name, type] = descs[targets[i]];
+            Value stored;
+            try {
+                stored = CastValue(value, type);
+            } catch (const std::exception&) {
+                throw std::invalid_argument("Cannot store " + value.ToString() + " in column " + name);
+            }
+            if (value.IsNumeric() && stored.IsNumeric() && CompareValues(stored, value) != 0) {
+                throw std::invalid_argument("Cannot store " + value.ToString() + " in column " + name + " exactly");
+            }
+            cells[targets[i]] = stored.ToString();
+        }
+        rows.push_back(std::move(cells));
+    }
+    for (const auto& cells : rows) {
+        table.AddRow(cells);
+    }
+    return rows.size();
+}
+
+size_t ExecuteDelete(Database& db, const Statement& statement, const PlanNode* plan) {
+    PlanPtr planned;
+    if (plan == nullptr) {
+        planned = PlanRowIds(statement.table, statement.where.get(), db);
+        plan = planned.get();
+    }
+    std::unique_ptr<Operator> root = BuildOperator(*plan);
+    root->Open();
+    std::vector<unsigned int> ids;
+    Row row;
+    while (root->Next(row)) {
+        ids.push_back(static_cast<unsigned int>(row.back().integer));
+    }
+    DbTable& table = db.GetTable(statement.table);
+    for (unsigned int id : ids) {
+        table.DeleteRowById(id);
+    }
+    return ids.size();
+}
+
+void ExecuteCreate(Database& db, const Statement& statement) {
+    if (statement.if_not_exists && db.HasTable(statement.table)) return;
+    for (size_t i = 0; i < statement.column_defs.size(); ++i) {
+        for (size_t j = 0; j < i; ++j) {
+            if (statement.column_defs[i].name == statement.column_defs[j].name) {
+                throw std::invalid_argument("Column listed twice: " + statement.column_defs[i].name);
+            }
+        }
+    }
+    db.CreateTable(statement.table);
+    try {
+        DbTable& table = db.GetTable(statement.table);
+        for (const ColumnDef& def : statement.column_defs) {
+            table.AddColumn({def.name, def.type}, def.encoding);
+        }
+    } catch (...) {
+        db.DropTable(statement.table);
+        throw;
+    }
+}
+
+}  // namespace
+
+Value Evaluate(const Expr& expr, const Row& row) {
+    switch (expr.kind) {
+    case ExprKind::kLiteral:
+        return expr.literal;
+    case ExprKind::kColumn:
+        return row[static_cast<size_t>(expr.slot)];
+    case ExprKind::kUnary: {
+        const Value operand = Evaluate(*expr.args[0], row);
+        if (expr.unary == UnaryOp::kNeg) return Negate(operand, expr.type);
+        return operand.null ? Value::Null(DataType::kBool) : Value::Bool(!operand.IsTrue());
+    }
+    case ExprKind::kIsNull:
+        return Value::Bool(Evaluate(*expr.args[0], row).null != expr.negated);
+    case ExprKind::kAggregate:
+        throw std::invalid_argument("Aggregate outside an aggregation: " + expr.ToString());
+    case ExprKind::kParameter:
+        return ParameterValue(expr.parameter);
+    case ExprKind::kBinary:
+        break;
+    }
+
+    const Value left = Evaluate(*expr.args[0], row);
+    if (expr.binary == BinaryOp::kAnd || expr.binary == BinaryOp::kOr) {
+        const bool deciding = expr.binary == BinaryOp::kOr;  // the value that settles the result alone
+        if (!left.null && left.IsTrue() == deciding) return Value::Bool(deciding);
+        const Value right = Evaluate(*expr.args[1], row);
+        if (!right.null && right.IsTrue() == deciding) return Value::Bool(deciding);
+        if (left.null || right.null) return Value::Null(DataType::kBool);
+        return Value::Bool(!deciding);
+    }
+    const Value right = Evaluate(*expr.args[1], row);
+    if (IsComparison(expr.binary)) {
+        if (left.null || right.null) return Value::Null(DataType::kBool);
+        return Value::Bool(Compare(CompareValues(left, right), ToCompareOp(expr.binary), 0));
+    }
+    return Arithmetic(expr.binary, left, right, expr.type);
+}
+
+std::unique_ptr<Operator> BuildOperator(const PlanNode& plan) {
+    std::vector<std::unique_ptr<Operator>> inputs;
+    for (const PlanPtr& child : plan.children) {
+        inputs.push_back(BuildOperator(*child));
+    }
+    switch (plan.kind) {
+    case PlanKind::kScan:
+        return std::unique_ptr<Operator>(new ScanOperator(plan));
+    case PlanKind::kFilter:
+        return std::unique_ptr<Operator>(new FilterOperator(plan, std::move(inputs[0])));
+    case PlanKind::kJoin:
+        switch (plan.join_method) {
+        case JoinMethod::kHash:
+            return std::unique_ptr<Operator>(new HashJoinOperator(plan, std::move(inputs[0]), std::move(inputs[1])));
+        case JoinMethod::kNestedLoop:
+            return std::unique_ptr<Operator>(
+                new NestedLoopJoinOperator(plan, std::move(inputs[0]), std::move(inputs[1])));
+        case JoinMethod::kLookup:
+            return std::unique_ptr<Operator>(new LookupJoinOperator(plan, std::move(inputs[0])));
+        }
+        break;
+    case PlanKind::kAggregate:
+        return std::unique_ptr<Operator>(new AggregateOperator(plan, std::move(inputs[0])));
+    case PlanKind::kProject:
+        return std::unique_ptr<Operator>(new ProjectOperator(plan, std::move(inputs[0])));
+    case PlanKind::kSort:
+        return std::unique_ptr<Operator>(new SortOperator(plan, std::move(inputs[0])));
+    case PlanKind::kLimit:
+        return std::unique_ptr<Operator>(new LimitOperator(plan, std::move(inputs[0])));
+    }
+    throw std::invalid_argument("Unknown plan node");
+}
+
+ParameterScope::ParameterScope(const std::vector<Value>* parameters): previous_(active_parameters) {
+    active_parameters = parameters;
+}
+
+ParameterScope::~ParameterScope() {
+    active_parameters = previous_;
+}
+
+size_t ExecuteStatement(Database& db, const Statement& statement, const PlanNode* planned, QueryResult& header,
+                        const std::function<void(const Row&)>& on_row) {
+    switch (statement.kind) {
+    case StatementKind::kSelect: {
+        PlanPtr owned;
+        if (planned == nullptr) owned = PlanSelect(statement.select, db);
+        const PlanNode* plan = planned != nullptr ? planned : owned.get();
+        if (statement.explain) {
+            header.columns = {"plan"};
+            header.types = {DataType::kString};
+            std::istringstream lines(plan->Explain());
+            std::string line;
+            size_t count = 0;
+            while (std::getline(lines, line)) {
+                on_row(Row{Value::Text(line)});
+                ++count;
+            }
+            return count;
+        }
+        for (const PlanColumn& column : plan->columns) {
+            header.columns.push_back(column.name);
+            header.types.push_back(column.type);
+        }
+        std::unique_ptr<Operator> root = BuildOperator(*plan);
+        root->Open();
+        Row row;
+        size_t count = 0;
+        if (root->ProducesChunks()) {
+            DataChunk chunk;
+            while (root->NextChunk(chunk)) {
+                for (size_t i = 0; i < chunk.Count(); ++i) {
+                    chunk.GetRow(i, row);
+                    on_row(row);
+                }
+                count += chunk.Count();
+            }
+            return count;
+        }
+        while (root->Next(row)) {
+            on_row(row);
+            ++count;
+        }
+        return count;
+    }
+    case StatementKind::kInsert:
+        return ExecuteInsert(db, statement);
+    case StatementKind::kDelete:
+        return ExecuteDelete(db, statement, planned);
+    case StatementKind::kCreateTable:
+        ExecuteCreate(db, statement);
+        return 0;
+    case StatementKind::kDropTable:
+        if (!statement.if_exists || db.HasTable(statement.table)) db.DropTable(statement.table);
+        return 0;
+    }
+    return 0;
+}
+
+std::vector<std::vector<std::string>> QueryResult::StringRows() const {
+    std::vector<std::vector<std::string>> strings;
+    strings.reserve(rows.size());
+    for (const Row& row : rows) {
+        std::vector<std::string> cells;
+        cells.reserve(row.size());
+        for (const Value& value : row) {
+            cells.push_back(value.ToString());
+        }
+        strings.push_back(std::move(cells));
+    }
+    return strings;
+}
+
+std::ostream& operator<<(std::ostream& os, const QueryResult& result) {
+    for (size_t i = 0; i < result.columns.size(); ++i) {
+        os << (i > 0 ? "\t" : "") << result.columns[i];
+    }
+    os << '\n';
+    for (const Row& row : result.rows) {
+        for (size_t i = 0; i < row.size(); ++i) {
+            os << (i > 0 ? "\t" : "") << row[i];
+        }
+        os << '\n';
+    }
+    return os;
+}
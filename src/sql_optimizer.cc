@@ -0,0 +1,365 @@
+#include "sql_optimizer.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+
+using Mask = uint64_t;  // a set of relations, bit r for scans[r]
+
+constexpr double kInfinity = std::numeric_limits<double>::infinity();
+
+bool Contains(Mask outer, Mask inner) {
+    return (outer & inner) == inner;
+}
+
+int Lowest(Mask set) {
+    return __builtin_ctzll(set);
+}
+
+void ShiftSlots(Expr& expr, int delta) {
+    if (expr.kind == ExprKind::kColumn) expr.slot += delta;
+    for (ExprPtr& arg : expr.args) {
+        ShiftSlots(*arg, delta);
+    }
+}
+
+void RemapSlots(Expr& expr, const std::vector<int>& local) {
+    if (expr.kind == ExprKind::kColumn) expr.slot = local[expr.slot];
+    for (ExprPtr& arg : expr.args) {
+        RemapSlots(*arg, local);
+    }
+}
+
+bool IsEquality(const Expr& expr) {
+    return expr.kind == ExprKind::kBinary && expr.binary == BinaryOp::kEq;
+}
+
+// A conjunct reading columns of more than one relation.
+struct Condition {
+    ExprPtr expr;  // bound to the universe
+    Mask relations = 0;
+    double selectivity = 1;
+};
+
+// The cheapest plan found for a set of relations.
+struct Choice {
+    double rows = 0;
+    double cost = kInfinity;
+    Mask left = 0;  // 0 for a single relation
+    Mask right = 0;
+    JoinMethod method = JoinMethod::kHash;
+    size_t lookup_condition = 0;  // kLookup: the condition whose right side is the looked up column
+};
+
+class JoinOptimizer {
+public:
+    JoinOptimizer(std::vector<PlanPtr> scans, std::vector<ExprPtr> conjuncts);
+    PlanPtr Run();
+
+private:
+    Mask RelationsOf(const Expr& expr) const;
+    double Selectivity(const Expr& condition) const;
+    double Rows(Mask set) const;
+    bool Connected(Mask left, Mask right) const;
+    int KeySide(const Condition& condition, Mask left, Mask right) const;
+    void Consider(Mask left, Mask right, double rows, Choice& best) const;
+    void PlanDynamic();
+    void PlanGreedy();
+    PlanPtr Build(Mask set, std::vector<int>& local);
+
+    std::vector<PlanPtr> leaves_;  // scan of every relation, under a Filter for what it cannot apply
+    std::vector<double> leaf_rows_;
+    std::vector<int> base_;        // first universe slot of every relation
+    std::vector<PlanColumn> universe_;
+    std::vector<int> relation_of_;  // relation of every universe slot
+    std::vector<Condition> conditions_;
+    std::vector<ExprPtr> constants_;  // conjuncts without columns
+    std::unordered_map<Mask, Choice> choices_;
+};
+
+JoinOptimizer::JoinOptimizer(std::vector<PlanPtr> scans, std::vector<ExprPtr> conjuncts) {
+    if (scans.size() > 64) {
+        throw std::invalid_argument("Cannot join more than 64 tables");
+    }
+    for (size_t r = 0; r < scans.size(); ++r) {
+        base_.push_back(static_cast<int>(universe_.size()));
+        universe_.insert(universe_.end(), scans[r]->columns.begin(), scans[r]->columns.end());
+        relation_of_.resize(universe_.size(), static_cast<int>(r));
+    }
+
+    std::vector<std::vector<ExprPtr>> local(scans.size());
+    for (ExprPtr& conjunct : conjuncts) {
+        const Mask relations = RelationsOf(*conjunct);
+        if (relations == 0) {
+            constants_.push_back(std::move(conjunct));
+        } else if ((relations & (relations - 1)) == 0) {
+            const int r = Lowest(relations);
+            ShiftSlots(*conjunct, -base_[r]);
+            local[r].push_back(std::move(conjunct));
+        } else {
+            const double selectivity = Selectivity(*conjunct);
+            conditions_.push_back({std::move(conjunct), relations, selectivity});
+        }
+    }
+
+    for (size_t r = 0; r < scans.size(); ++r) {
+        PlanPtr leaf = std::move(scans[r]);
+        ExprPtr rest = local[r].empty() ? nullptr : PushIntoScan(*leaf, Conjoin(local[r]));
+        double cost = leaf->estimated_cost;
+        if (rest) {
+            std::vector<ExprPtr> parts;
+            SplitAnd(std::move(rest), parts);
+            const double checked = leaf->estimated_rows;
+            double rows = checked;
+            for (size_t i = 0; i < parts.size(); ++i) {
+                rows *= CostModel::kDefaultSelectivity;
+            }
+            cost += checked * static_cast<double>(parts.size()) * CostModel::kCompareCost;
+            leaf = MakeFilter(std::move(leaf), Conjoin(parts));
+            leaf->estimated_rows = rows;
+        }
+        leaf_rows_.push_back(std::max(leaf->estimated_rows, 1.0));
+        Choice& choice = choices_[Mask(1) << r];
+        choice.rows = leaf_rows_.back();
+        choice.cost = cost;
+        leaves_.push_back(std::move(leaf));
+    }
+}
+
+Mask JoinOptimizer::RelationsOf(const Expr& expr) const {
+    Mask relations = expr.kind == ExprKind::kColumn ? Mask(1) << relation_of_[expr.slot] : 0;
+    for (const ExprPtr& arg : expr.args) {
+        relations |= RelationsOf(*arg);
+    }
+    return relations;
+}
+
+double JoinOptimizer::Selectivity(const Expr& condition) const {
+    if (!IsEquality(condition)) return CostModel::kDefaultSelectivity;
+    const Expr& a = *condition.args[0];
+    const Expr& b = *condition.args[1];
+    if (a.kind != ExprKind::kColumn || b.kind != ExprKind::kColumn) return CostModel::kDefaultEqualitySelectivity;
+    const PlanColumn& x = universe_[a.slot];
+    const PlanColumn& y = universe_[b.slot];
+    if (x.source == nullptr || y.source == nullptr) return CostModel::kDefaultEqualitySelectivity;
+    return DbTable::EstimateJoinSelectivity(*x.source, static_cast<unsigned int>(x.source_column), *y.source,
+                                            static_cast<unsigned int>(y.source_column));
+}
+
+double JoinOptimizer::Rows(Mask set) const {
+    double rows = 1;
+    for (size_t r = 0; r < leaf_rows_.size(); ++r) {
+        if (set & (Mask(1) << r)) rows *= leaf_rows_[r];
+    }
+    for (const Condition& condition : conditions_) {
+        if (Contains(set, condition.relations)) rows *= condition.selectivity;
+    }
+    return std::max(rows, 1.0);
+}
+
+bool JoinOptimizer::Connected(Mask left, Mask right) const {
+    for (const Condition& condition : conditions_) {
+        if (Contains(left | right, condition.relations) && (condition.relations & left) &&
+            (condition.relations & right)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// For an equality with one side on `left` and the other on `right`: the argument on the right (0 or 1), else -1.
+int JoinOptimizer::KeySide(const Condition& condition, Mask left, Mask right) const {
+    if (!IsEquality(*condition.expr)) return -1;
+    const Mask first = RelationsOf(*condition.expr->args[0]);
+    const Mask second = RelationsOf(*condition.expr->args[1]);
+    if (first == 0 || second == 0) return -1;
+    if (Contains(left, first) && Contains(right, second)) return 1;
+    if (Contains(right, first) && Contains(left, second)) return 0;
+    return -1;
+}
+
+// Costs every method of joining left (outer, probe side) with right and keeps the cheapest in best.
+void JoinOptimizer::Consider(Mask left, Mask right, double rows, Choice& best) const {
+    const Choice& outer = choices_.at(left);
+    const Choice& inner = choices_.at(right);
+    auto keep = [&](double cost, JoinMethod method, size_t lookup_condition) {
+        if (cost >= best.cost) return;
+        best.rows = rows;
+        best.cost = cost;
+        best.left = left;
+        best.right = right;
+        best.method = method;
+        best.lookup_condition = lookup_condition;
+    };
+
+    bool equi = false;
+    for (const Condition& condition : conditions_) {
+        if (Contains(left | right, condition.relations) && KeySide(condition, left, right) >= 0) equi = true;
+    }
+    const double output = rows * CostModel::kOutputCost;
+    if (equi) {
+        keep(outer.cost + inner.cost + inner.rows * CostModel::kHashBuildCost + outer.rows * CostModel::kHashProbeCost +
+                 output,
+             JoinMethod::kHash, 0);
+    } else {
+        keep(outer.cost + inner.cost + outer.rows * inner.rows * CostModel::kCompareCost + inner.rows + output,
+             JoinMethod::kNestedLoop, 0);
+    }
+
+    if ((right & (right - 1)) != 0) return;
+    const PlanNode& scan = *leaves_[Lowest(right)];
+    if (scan.kind != PlanKind::kScan) return;
+    // Rows one lookup finds before the scan's own predicates reject some.
+    const double fraction = leaf_rows_[Lowest(right)] / std::max(static_cast<double>(scan.table->RowCount()), 1.0);
+    const double matches = rows / std::min(fraction, 1.0);
+    for (size_t i = 0; i < conditions_.size(); ++i) {
+        const Condition& condition = conditions_[i];
+        const int side = Contains(left | right, condition.relations) ? KeySide(condition, left, right) : -1;
+        if (side < 0) continue;
+        const Expr& key = *condition.expr->args[side];
+        const Expr& probe = *condition.expr->args[1 - side];
+        if (key.kind != ExprKind::kColumn || key.type != probe.type) continue;
+        const PlanColumn& column = universe_[key.slot];
+        const double visited = scan.table->EstimateLookupRows(static_cast<unsigned int>(column.source_column));
+        const double checks = static_cast<double>(scan.predicates.size());
+        keep(outer.cost + outer.rows * (CostModel::kLookupCost + visited * CostModel::kFilterRowCost) +
+                 matches * (CostModel::kSeekCost + checks * CostModel::kCompareCost) + output,
+             JoinMethod::kLookup, i);
+    }
+}
+
+// Subsets are visited in increasing order, so both halves of every split are planned before the set itself.
+void JoinOptimizer::PlanDynamic() {
+    const Mask all = (Mask(1) << leaves_.size()) - 1;
+    for (Mask set = 3; set <= all; ++set) {
+        if ((set & (set - 1)) == 0) continue;
+        const double rows = Rows(set);
+        Choice best;
+        for (int pass = 0; pass < 2 && best.cost == kInfinity; ++pass) {
+            for (Mask left = (set - 1) & set; left > 0; left = (left - 1) & set) {
+                const Mask right = set ^ left;
+                if (pass == 0 && !Connected(left, right)) continue;  // cross products only as a last resort
+                Consider(left, right, rows, best);
+            }
+        }
+        choices_[set] = best;
+    }
+}
+
+// Joins the connected pair with the smallest result (then the cheapest) until a single plan is left.
+void JoinOptimizer::PlanGreedy() {
+    std::vector<Mask> parts;
+    for (size_t r = 0; r < leaves_.size(); ++r) {
+        parts.push_back(Mask(1) << r);
+    }
+    while (parts.size() > 1) {
+        Choice best;
+        bool best_connected = false;
+        size_t merged = 0;
+        size_t absorbed = 0;
+        for (size_t i = 0; i < parts.size(); ++i) {
+            for (size_t j = 0; j < parts.size(); ++j) {
+                if (i == j) continue;
+                const bool connected = Connected(parts[i], parts[j]);
+                if (best_connected && !connected) continue;
+                Choice candidate;
+                Consider(parts[i], parts[j], Rows(parts[i] | parts[j]), candidate);
+                const bool better = best.cost == kInfinity || connected != best_connected ||
+                                    candidate.rows < best.rows ||
+                                    (candidate.rows == best.rows && candidate.cost < best.cost);
+                if (!better) continue;
+                best = candidate;
+                best_connected = connected;
+                merged = i;
+                absorbed = j;
+            }
+        }
+        choices_[parts[merged] | parts[absorbed]] = best;
+        parts[merged] |= parts[absorbed];
+        parts.erase(parts.begin() + static_cast<std::ptrdiff_t>(absorbed));
+    }
+}
+
+/* Builds the plan of a set and records in `local` where every universe slot of its relations ends up. A condition is
+applied by the join that first has all of its relations: equalities between the two sides as keys (the looked up one
+first), anything else as the join's predicate. */
+PlanPtr JoinOptimizer::Build(Mask set, std::vector<int>& local) {
+    const Choice& choice = choices_.at(set);
+    if (choice.left == 0) {
+        const int r = Lowest(set);
+        PlanPtr leaf = std::move(leaves_[r]);
+        for (size_t i = 0; i < leaf->columns.size(); ++i) {
+            local[base_[r] + i] = static_cast<int>(i);
+        }
+        return leaf;
+    }
+    PlanPtr left = Build(choice.left, local);
+    PlanPtr right = Build(choice.right, local);
+    const int width = static_cast<int>(left->columns.size());
+    for (size_t slot = 0; slot < universe_.size(); ++slot) {
+        if (choice.right & (Mask(1) << relation_of_[slot])) local[slot] += width;
+    }
+
+    PlanPtr join(new PlanNode());
+    join->kind = PlanKind::kJoin;
+    join->join_method = choice.method;
+    join->columns = left->columns;
+    join->columns.insert(join->columns.end(), right->columns.begin(), right->columns.end());
+    std::vector<size_t> order;
+    if (choice.method == JoinMethod::kLookup) order.push_back(choice.lookup_condition);
+    for (size_t i = 0; i < conditions_.size(); ++i) {
+        if (choice.method != JoinMethod::kLookup || i != choice.lookup_condition) order.push_back(i);
+    }
+    std::vector<ExprPtr> rest;
+    for (size_t i : order) {
+        const Condition& condition = conditions_[i];
+        if (!Contains(set, condition.relations) || Contains(choice.left, condition.relations) ||
+            Contains(choice.right, condition.relations)) {
+            continue;
+        }
+        const int side = KeySide(condition, choice.left, choice.right);
+        ExprPtr expr = condition.expr->Clone();
+        RemapSlots(*expr, local);
+        if (side < 0) {
+            rest.push_back(std::move(expr));
+            continue;
+        }
+        ExprPtr right_key = std::move(expr->args[side]);
+        ShiftSlots(*right_key, -width);
+        join->left_keys.push_back(std::move(expr->args[1 - side]));
+        join->right_keys.push_back(std::move(right_key));
+    }
+    join->predicate = Conjoin(rest);
+    join->estimated_rows = choice.rows;
+    join->estimated_cost = choice.cost;
+    if (choice.method == JoinMethod::kLookup) right->access = ScanAccess::kSequential;  // never run as a scan
+    join->children.push_back(std::move(left));
+    join->children.push_back(std::move(right));
+    return join;
+}
+
+PlanPtr JoinOptimizer::Run() {
+    if (leaves_.size() > CostModel::kDpRelations) {
+        PlanGreedy();
+    } else {
+        PlanDynamic();
+    }
+    const Mask all = leaves_.size() == 64 ? ~Mask(0) : (Mask(1) << leaves_.size()) - 1;
+    std::vector<int> local(universe_.size(), -1);
+    PlanPtr plan = Build(all, local);
+    if (!constants_.empty()) plan = MakeFilter(std::move(plan), Conjoin(constants_));
+    return plan;
+}
+
+}  // namespace
+
+PlanPtr OptimizeJoins(std::vector<PlanPtr> scans, std::vector<ExprPtr> conjuncts) {
+    if (scans.empty()) {
+        throw std::invalid_argument("Nothing to join");
+    }
+    return JoinOptimizer(std::move(scans), std::move(conjuncts)).Run();
+}
@@ -0,0 +1,580 @@
+#include "sql_parser.hpp"
+
+#include <cctype>
+#include <stdexcept>
+
+namespace {
+
+enum class TokenKind { kIdentifier, kQuoted, kInteger, kNumber, kString, kSymbol, kEnd };
+
+struct Token {
+    TokenKind kind;
+    std::string text;  // identifiers as written, strings unescaped, symbols like "<="
+    size_t offset;
+};
+
+std::string Upper(const std::string& text) {
+    std::string upper = text;
+    for (char& c : upper) {
+        c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+    }
+    return upper;
+}
+
+std::vector<Token> Tokenize(const std::string& sql) {
+    std::vector<Token> tokens;
+    size_t i = 0;
+    while (i < sql.size()) {
+        const char c = sql[i];
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            ++i;
+        } else if (c == '-' && i + 1 < sql.size() && sql[i + 1] == '-') {  // comment to the end of the line
+            while (i < sql.size() && sql[i] != '\n') ++i;
+        } else if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
+            size_t start = i;
+            while (i < sql.size() && (std::isalnum(static_cast<unsigned char>(sql[i])) || sql[i] == '_')) ++i;
+            tokens.push_back({TokenKind::kIdentifier, sql.substr(start, i - start), start});
+        } else if (std::isdigit(static_cast<unsigned char>(c)) ||
+                   (c == '.' && i + 1 < sql.size() && std::isdigit(static_cast<unsigned char>(sql[i + 1])))) {
+            size_t start = i;
+            bool is_double = false;
+            while (i < sql.size() && std::isdigit(static_cast<unsigned char>(sql[i]))) ++i;
+            if (i < sql.size() && sql[i] == '.') {
+                is_double = true;
+                ++i;
+                while (i < sql.size() && std::isdigit(static_cast<unsigned char>(sql[i]))) ++i;
+            }
+            if (i < sql.size() && (sql[i] == 'e' || sql[i] == 'E')) {
+                size_t exponent = i + 1;
+                if (exponent < sql.size() && (sql[exponent] == '+' || sql[exponent] == '-')) ++exponent;
+                if (exponent < sql.size() && std::isdigit(static_cast<unsigned char>(sql[exponent]))) {
+                    is_double = true;
+                    i = exponent;
+                    while (i < sql.size() && std::isdigit(static_cast<unsigned char>(sql[i]))) ++i;
+                }
+            }
+            tokens.push_back({is_double ? TokenKind::kNumber : TokenKind::kInteger, sql.substr(start, i - start),
+                              start});
+        } else if (c == '\'' || c == '"') {
+            size_t start = i++;
+            std::string text;
+            while (true) {
+                if (i >= sql.size()) {
+                    throw std::invalid_argument("Unterminated " + std::string(c == '\'' ? "string" : "identifier") +
+                                                " at offset " + std::to_string(start));
+                }
+                if (sql[i] == c) {
+                    if (i + 1 < sql.size() && sql[i + 1] == c) {  // doubled quote
+                        text += c;
+                        i += 2;
+                        continue;
+                    }
+                    ++i;
+                    break;
+                }
+                text += sql[i++];
+            }
+            tokens.push_back({c == '\'' ? TokenKind::kString : TokenKind::kQuoted, text, start});
+        } else {
+            static const char* const kTwoChar[] = {"<=", ">=", "<>", "!="};
+            std::string symbol(1, c);
+            for (const char* two : kTwoChar) {
+                if (sql.compare(i, 2, two) == 0) symbol = two;
+            }
+            if (symbol.size() == 1 && std::string("(),.;*+-/%=<>?").find(c) == std::string::npos) {
+                throw std::invalid_argument("Unexpected character '" + symbol + "' at offset " + std::to_string(i));
+            }
+            tokens.push_back({TokenKind::kSymbol, symbol, i});
+            i += symbol.size();
+        }
+    }
+    tokens.push_back({TokenKind::kEnd, "", sql.size()});
+    return tokens;
+}
+
+// Words that end an expression or a table reference, so they are never taken as an implicit alias.
+bool IsReserved(const std::string& upper) {
+    static const char* const kReserved[] = {
+        "SELECT", "FROM", "WHERE", "GROUP", "BY", "HAVING", "ORDER", "LIMIT", "OFFSET", "JOIN", "INNER", "CROSS",
+        "ON", "AS", "AND", "OR", "NOT", "IS", "NULL", "ASC", "DESC", "VALUES", "INTO", "SET", "TRUE", "FALSE"};
+    for (const char* word : kReserved) {
+        if (upper == word) return true;
+    }
+    return false;
+}
+
+class Parser {
+public:
+    explicit Parser(const std::string& sql): tokens_(Tokenize(sql)) {}
+
+    Statement ParseStatement() {
+        Statement statement;
+        if (AcceptKeyword("EXPLAIN")) {
+            statement.explain = true;
+            if (!PeekKeyword("SELECT")) Fail("Expected SELECT after EXPLAIN");
+        }
+        if (PeekKeyword("SELECT")) {
+            statement.kind = StatementKind::kSelect;
+            ParseSelect(statement.select);
+        } else if (AcceptKeyword("INSERT")) {
+            statement.kind = StatementKind::kInsert;
+            ParseInsert(statement);
+        } else if (AcceptKeyword("DELETE")) {
+            statement.kind = StatementKind::kDelete;
+            ExpectKeyword("FROM");
+            statement.table = ParseName();
+            if (AcceptKeyword("WHERE")) statement.where = ParseExpr();
+        } else if (AcceptKeyword("CREATE")) {
+            statement.kind = StatementKind::kCreateTable;
+            ParseCreate(statement);
+        } else if (AcceptKeyword("DROP")) {
+            statement.kind = StatementKind::kDropTable;
+            ExpectKeyword("TABLE");
+            if (AcceptKeyword("IF")) {
+                ExpectKeyword("EXISTS");
+                statement.if_exists = true;
+            }
+            statement.table = ParseName();
+        } else {
+            Fail("Expected a statement");
+        }
+        AcceptSymbol(";");
+        if (Peek().kind != TokenKind::kEnd) Fail("Unexpected text after the statement");
+        statement.parameters = parameters_;
+        return statement;
+    }
+
+private:
+    const Token& Peek(size_t ahead = 0) const {
+        return tokens_[std::min(pos_ + ahead, tokens_.size() - 1)];
+    }
+
+    [[noreturn]] void Fail(const std::string& message) const {
+        const Token& token = Peek();
+        std::string near = token.kind == TokenKind::kEnd ? "end of input" : "'" + token.text + "'";
+        throw std::invalid_argument(message + " near " + near + " at offset " + std::to_string(token.offset));
+    }
+
+    bool PeekKeyword(const char* keyword, size_t ahead = 0) const {
+        const Token& token = Peek(ahead);
+        return token.kind == TokenKind::kIdentifier && Upper(token.text) == keyword;
+    }
+
+    bool AcceptKeyword(const char* keyword) {
+        if (!PeekKeyword(keyword)) return false;
+        ++pos_;
+        return true;
+    }
+
+    void ExpectKeyword(const char* keyword) {
+        if (!AcceptKeyword(keyword)) Fail(std::string("Expected ") + keyword);
+    }
+
+    bool PeekSymbol(const char* symbol) const {
+        return Peek().kind == TokenKind::kSymbol && Peek().text == symbol;
+    }
+
+    bool AcceptSymbol(const char* symbol) {
+        if (!PeekSymbol(symbol)) return false;
+        ++pos_;
+        return true;
+    }
+
+    void ExpectSymbol(const char* symbol) {
+        if (!AcceptSymbol(symbol)) Fail(std::string("Expected '") + symbol + "'");
+    }
+
+    bool PeekName() const {
+        const Token& token = Peek();
+        return token.kind == TokenKind::kQuoted ||
+               (token.kind == TokenKind::kIdentifier && !IsReserved(Upper(token.text)));
+    }
+
+    std::string ParseName() {
+        if (!PeekName()) Fail("Expected a name");
+        return tokens_[pos_++].text;
+    }
+
+    // [AS] alias, where a bare word only counts when it is not a keyword.
+    std::string ParseAlias() {
+        if (AcceptKeyword("AS")) return ParseName();
+        return PeekName() ? ParseName() : "";
+    }
+
+    void ParseSelect(SelectStmt& select) {
+        ExpectKeyword("SELECT");
+        do {
+            SelectItem item;
+            if (AcceptSymbol("*")) {
+                select.items.push_back(std::move(item));
+                continue;
+            }
+            if (PeekName() && Peek(1).kind == TokenKind::kSymbol && Peek(1).text == "." &&
+                Peek(2).kind == TokenKind::kSymbol && Peek(2).text == "*") {
+                item.table = ParseName();
+                pos_ += 2;
+                select.items.push_back(std::move(item));
+                continue;
+            }
+            item.expr = ParseExpr();
+            item.alias = ParseAlias();
+            select.items.push_back(std::move(item));
+        } while (AcceptSymbol(","));
+
+        ExpectKeyword("FROM");
+        select.from.push_back(ParseTableRef());
+        while (true) {
+            if (AcceptSymbol(",")) {
+                select.from.push_back(ParseTableRef());
+            } else if (AcceptKeyword("CROSS")) {
+                ExpectKeyword("JOIN");
+                select.from.push_back(ParseTableRef());
+            } else if (PeekKeyword("JOIN") || PeekKeyword("INNER")) {
+                AcceptKeyword("INNER");
+                ExpectKeyword("JOIN");
+                TableRef ref = ParseTableRef();
+                ExpectKeyword("ON");
+                ref.on = ParseExpr();
+                select.from.push_back(std::move(ref));
+            } else {
+                break;
+            }
+        }
+
+        if (AcceptKeyword("WHERE")) select.where = ParseExpr();
+        if (AcceptKeyword("GROUP")) {
+            ExpectKeyword("BY");
+            do {
+                select.group_by.push_back(ParseExpr());
+            } while (AcceptSymbol(","));
+        }
+        if (AcceptKeyword("HAVING")) select.having = ParseExpr();
+        if (AcceptKeyword("ORDER")) {
+            ExpectKeyword("BY");
+            do {
+                OrderItem item;
+                item.expr = ParseExpr();
+                if (AcceptKeyword("DESC")) {
+                    item.descending = true;
+                } else {
+                    AcceptKeyword("ASC");
+                }
+                select.order_by.push_back(std::move(item));
+            } while (AcceptSymbol(","));
+        }
+        if (AcceptKeyword("LIMIT")) {
+            select.limit = ParseCount();
+            if (AcceptKeyword("OFFSET")) select.offset = ParseCount();
+        }
+    }
+
+    int64_t ParseCount() {
+        if (Peek().kind != TokenKind::kInteger) Fail("Expected a row count");
+        return std::stoll(tokens_[pos_++].text);
+    }
+
+    TableRef ParseTableRef() {
+        TableRef ref;
+        ref.name = ParseName();
+        ref.alias = ParseAlias();
+        return ref;
+    }
+
+    void ParseInsert(Statement& statement) {
+        ExpectKeyword("INTO");
+        statement.table = ParseName();
+        if (AcceptSymbol("(")) {
+            do {
+                statement.columns.push_back(ParseName());
+            } while (AcceptSymbol(","));
+            ExpectSymbol(")");
+        }
+        ExpectKeyword("VALUES");
+        do {
+            ExpectSymbol("(");
+            std::vector<ExprPtr> row;
+            do {
+                row.push_back(ParseExpr());
+            } while (AcceptSymbol(","));
+            ExpectSymbol(")");
+            statement.values.push_back(std::move(row));
+        } while (AcceptSymbol(","));
+    }
+
+    void ParseCreate(Statement& statement) {
+        ExpectKeyword("TABLE");
+        if (AcceptKeyword("IF")) {
+            ExpectKeyword("NOT");
+            ExpectKeyword("EXISTS");
+            statement.if_not_exists = true;
+        }
+        statement.table = ParseName();
+        ExpectSymbol("(");
+        do {
+            ColumnDef def;
+            def.name = ParseName();
+            def.type = ParseType();
+            if (AcceptKeyword("ENCODING")) def.encoding = ParseEncoding();
+            statement.column_defs.push_back(def);
+        } while (AcceptSymbol(","));
+        ExpectSymbol(")");
+    }
+
+    DataType ParseType() {
+        if (Peek().kind != TokenKind::kIdentifier) Fail("Expected a type");
+        const std::string name = Upper(tokens_[pos_].text);
+        DataType type;
+        if (name == "TEXT" || name == "VARCHAR" || name == "STRING" || name == "CHAR") {
+            type = DataType::kString;
+        } else if (name == "INT" || name == "INTEGER") {
+            type = DataType::kInt;
+        } else if (name == "BIGINT" || name == "INT64") {
+            type = DataType::kInt64;
+        } else if (name == "DOUBLE" || name == "FLOAT" || name == "REAL") {
+            type = DataType::kDouble;
+        } else if (name == "BOOL" || name == "BOOLEAN") {
+            type = DataType::kBool;
+        } else if (name == "DATE") {
+            type = DataType::kDate;
+        } else if (name == "TIMESTAMP") {
+            type = DataType::kTimestamp;
+        } else if (name == "DECIMAL" || name == "NUMERIC") {
+            type = DataType::kDecimal;
+        } else {
+            Fail("Unknown type");
+        }
+        ++pos_;
+        if (AcceptSymbol("(")) {  // VARCHAR(20), DECIMAL(10, 4): the storage does not need the sizes
+            do {
+                ParseCount();
+            } while (AcceptSymbol(","));
+            ExpectSymbol(")");
+        }
+        return type;
+    }
+
+    Encoding ParseEncoding() {
+        if (Peek().kind != TokenKind::kIdentifier) Fail("Expected an encoding");
+        const std::string name = Upper(tokens_[pos_].text);
+        Encoding encoding;
+        if (name == "PLAIN") {
+            encoding = Encoding::kPlain;
+        } else if (name == "DICTIONARY") {
+            encoding = Encoding::kDictionary;
+        } else if (name == "COMPRESSED") {
+            encoding = Encoding::kCompressed;
+        } else if (name == "RUNLENGTH") {
+            encoding = Encoding::kRunLength;
+        } else if (name == "COMPACT") {
+            encoding = Encoding::kCompact;
+        } else {
+            Fail("Unknown encoding");
+        }
+        ++pos_;
+        return encoding;
+    }
+
+    ExprPtr ParseExpr() { return ParseOr(); }
+
+    ExprPtr ParseOr() {
+        ExprPtr left = ParseAnd();
+        while (AcceptKeyword("OR")) {
+            left = MakeBinary(BinaryOp::kOr, std::move(left), ParseAnd());
+        }
+        return left;
+    }
+
+    ExprPtr ParseAnd() {
+        ExprPtr left = ParseNot();
+        while (AcceptKeyword("AND")) {
+            left = MakeBinary(BinaryOp::kAnd, std::move(left), ParseNot());
+        }
+        return left;
+    }
+
+    ExprPtr ParseNot() {
+        if (AcceptKeyword("NOT")) return MakeUnary(UnaryOp::kNot, ParseNot());
+        return ParseComparison();
+    }
+
+    ExprPtr ParseComparison() {
+        ExprPtr left = ParseAdditive();
+        if (AcceptKeyword("IS")) {
+            ExprPtr test(new Expr());
+            test->kind = ExprKind::kIsNull;
+            test->negated = AcceptKeyword("NOT");
+            ExpectKeyword("NULL");
+            test->args.push_back(std::move(left));
+            return test;
+        }
+        static const std::pair<const char*, BinaryOp> kComparisons[] = {
+            {"=", BinaryOp::kEq}, {"<>", BinaryOp::kNe}, {"!=", BinaryOp::kNe}, {"<", BinaryOp::kLt},
+            {"<=", BinaryOp::kLe}, {">", BinaryOp::kGt}, {">=", BinaryOp::kGe}};
+        for (const auto& [symbol, op] : kComparisons) {
+            if (AcceptSymbol(symbol)) return MakeBinary(op, std::move(left), ParseAdditive());
+        }
+        return left;
+    }
+
+    ExprPtr ParseAdditive() {
+        ExprPtr left = ParseMultiplicative();
+        while (true) {
+            if (AcceptSymbol("+")) {
+                left = MakeBinary(BinaryOp::kAdd, std::move(left), ParseMultiplicative());
+            } else if (AcceptSymbol("-")) {
+                left = MakeBinary(BinaryOp::kSub, std::move(left), ParseMultiplicative());
+            } else {
+                return left;
+            }
+        }
+    }
+
+    ExprPtr ParseMultiplicative() {
+        ExprPtr left = ParseUnary();
+        while (true) {
+            if (AcceptSymbol("*")) {
+                left = MakeBinary(BinaryOp::kMul, std::move(left), ParseUnary());
+            } else if (AcceptSymbol("/")) {
+                left = MakeBinary(BinaryOp::kDiv, std::move(left), ParseUnary());
+            } else if (AcceptSymbol("%")) {
+                left = MakeBinary(BinaryOp::kMod, std::move(left), ParseUnary());
+            } else {
+                return left;
+            }
+        }
+    }
+
+    ExprPtr ParseUnary() {
+        if (AcceptSymbol("-")) {
+            ExprPtr operand = ParseUnary();
+            if (operand->kind == ExprKind::kLiteral && !operand->literal.null) {  // fold -5 into a literal
+                Value& v = operand->literal;
+                if (v.type == DataType::kDouble) {
+                    v.number = -v.number;
+                    return operand;
+                }
+                if (v.type == DataType::kInt64) {
+                    v.integer = -v.integer;
+                    return operand;
+                }
+            }
+            return MakeUnary(UnaryOp::kNeg, std::move(operand));
+        }
+        if (AcceptSymbol("+")) return ParseUnary();
+        return ParsePrimary();
+    }
+
+    ExprPtr ParsePrimary() {
+        const Token& token = Peek();
+        if (token.kind == TokenKind::kInteger) {
+            ++pos_;
+            try {
+                return MakeLiteral(Value::Integer(DataType::kInt64, std::stoll(token.text)));
+            } catch (const std::out_of_range&) {
+                return MakeLiteral(Value::Number(std::stod(token.text)));
+            }
+        }
+        if (token.kind == TokenKind::kNumber) {
+            ++pos_;
+            return MakeLiteral(Value::Number(std::stod(token.text)));
+        }
+        if (token.kind == TokenKind::kString) {
+            ++pos_;
+            return MakeLiteral(Value::Text(token.text));
+        }
+        if (AcceptSymbol("(")) {
+            ExprPtr inner = ParseExpr();
+            ExpectSymbol(")");
+            return inner;
+        }
+        if (AcceptSymbol("?")) return MakeParameter(static_cast<int>(parameters_++));
+        if (AcceptKeyword("NULL")) return MakeLiteral(Value::Null(DataType::kInt));
+        if (AcceptKeyword("TRUE")) return MakeLiteral(Value::Bool(true));
+        if (AcceptKeyword("FALSE")) return MakeLiteral(Value::Bool(false));
+        if (token.kind == TokenKind::kIdentifier && Peek(1).kind == TokenKind::kSymbol && Peek(1).text == "(") {
+            return ParseAggregate();
+        }
+        std::string name = ParseName();
+        if (AcceptSymbol(".")) return MakeColumn(name, ParseName());
+        return MakeColumn("", name);
+    }
+
+    ExprPtr ParseAggregate() {
+        static const std::pair<const char*, AggregateFn> kFunctions[] = {
+            {"COUNT", AggregateFn::kCount}, {"SUM", AggregateFn::kSum}, {"AVG", AggregateFn::kAvg},
+            {"MIN", AggregateFn::kMin}, {"MAX", AggregateFn::kMax}};
+        const std::string name = Upper(Peek().text);
+        ExprPtr call(new Expr());
+        call->kind = ExprKind::kAggregate;
+        bool known = false;
+        for (const auto& [function, fn] : kFunctions) {
+            if (name == function) {
+                call->fn = fn;
+                known = true;
+            }
+        }
+        if (!known) Fail("Unknown function");
+        pos_ += 2;
+        if (call->fn == AggregateFn::kCount && AcceptSymbol("*")) {
+            call->star = true;
+        } else {
+            call->args.push_back(ParseExpr());
+        }
+        ExpectSymbol(")");
+        return call;
+    }
+
+    std::vector<Token> tokens_;
+    size_t pos_ = 0;
+    size_t parameters_ = 0;
+};
+
+std::string Quote(const std::string& text, char quote) {
+    std::string quoted(1, quote);
+    for (char c : text) {
+        quoted += c;
+        if (c == quote) quoted += c;
+    }
+    return quoted + quote;
+}
+
+}  // namespace
+
+Statement ParseSql(const std::string& sql) {
+    return Parser(sql).ParseStatement();
+}
+
+std::string NormalizeSql(const std::string& sql) {
+    std::vector<Token> tokens = Tokenize(sql);
+    tokens.pop_back();  // kEnd
+    if (!tokens.empty() && tokens.back().kind == TokenKind::kSymbol && tokens.back().text == ";") tokens.pop_back();
+    std::string normalized;
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        const Token& token = tokens[i];
+        if (i > 0) normalized += ' ';
+        switch (token.kind) {
+        case TokenKind::kIdentifier: {
+            // Keywords: reserved words, the statement's leading words and function names (never a table after INTO
+            // or TABLE).
+            const std::string upper = Upper(token.text);
+            const bool leading = i == 0 || (i == 1 && Upper(tokens[0].text) == "EXPLAIN");
+            const bool call = i + 1 < tokens.size() && tokens[i + 1].text == "(" &&
+                              tokens[i + 1].kind == TokenKind::kSymbol &&
+                              (i == 0 || (Upper(tokens[i - 1].text) != "INTO" && Upper(tokens[i - 1].text) != "TABLE" &&
+                                          Upper(tokens[i - 1].text) != "EXISTS"));
+            normalized += IsReserved(upper) || leading || call ? upper : token.text;
+            break;
+        }
+        case TokenKind::kQuoted:
+            normalized += Quote(token.text, '"');
+            break;
+        case TokenKind::kString:
+            normalized += Quote(token.text, '\'');
+            break;
+        default:
+            normalized += token.text;
+            break;
+        }
+    }
+    return normalized;
+}
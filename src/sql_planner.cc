@@ -0,0 +1,800 @@
+#include "sql_planner.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
+#include "db.hpp"
+#include "sql_optimizer.hpp"
+#include "value_types.hpp"
+
+namespace {
+
+// The columns an expression can refer to: the output row of the node below it.
+using Scope = std::vector<PlanColumn>;
+
+// Slot of `table.name` (or of `name` in any table) in scope, -1 when nothing matches.
+int Resolve(const Scope& scope, const std::string& table, const std::string& name) {
+    int found = -1;
+    for (size_t i = 0; i < scope.size(); ++i) {
+        if (scope[i].name.empty() || scope[i].name != name) continue;
+        if (!table.empty() && scope[i].table != table) continue;
+        if (found >= 0) {
+            throw std::invalid_argument("Ambiguous column: " + name);
+        }
+        found = static_cast<int>(i);
+    }
+    return found;
+}
+
+bool IsExactType(DataType type) {
+    return type != DataType::kString && type != DataType::kDouble && type != DataType::kDecimal;
+}
+
+DataType ArithmeticType(DataType left, DataType right) {
+    if (left == DataType::kString || right == DataType::kString) {
+        throw std::invalid_argument("Arithmetic on text");
+    }
+    return IsExactType(left) && IsExactType(right) ? DataType::kInt64 : DataType::kDouble;
+}
+
+DataType AggregateType(AggregateFn fn, const Expr* arg) {
+    if (fn == AggregateFn::kCount) return DataType::kInt64;
+    if (fn == AggregateFn::kMin || fn == AggregateFn::kMax) return arg->type;
+    if (arg->type == DataType::kString) {
+        throw std::invalid_argument(std::string("Cannot ") + AggregateFnName(fn) + " text");
+    }
+    return fn == AggregateFn::kSum && IsExactType(arg->type) ? DataType::kInt64 : DataType::kDouble;
+}
+
+// A string literal compared with a typed expression is read as that type ('2024-01-31' against a date column).
+void CoerceLiteral(Expr& literal, DataType type) {
+    if (literal.kind != ExprKind::kLiteral || literal.literal.null || literal.literal.type != DataType::kString ||
+        type == DataType::kString) {
+        return;
+    }
+    try {
+        literal.literal = CastValue(literal.literal, type);
+    } catch (const std::exception&) {
+        throw std::invalid_argument("Cannot compare '" + literal.literal.text + "' with a " + DataTypeName(type) +
+                                    " value");
+    }
+    literal.type = type;
+}
+
+// A parameter takes the type of what it is compared or computed with; one next to another parameter stays text.
+void TypeParameter(Expr& parameter, const Expr& other) {
+    if (parameter.kind == ExprKind::kParameter && other.kind != ExprKind::kParameter) parameter.type = other.type;
+}
+
+ExprPtr Bind(const Expr& expr, const Scope& scope, bool aggregates) {
+    if (expr.kind == ExprKind::kLiteral || expr.kind == ExprKind::kParameter) {
+        return expr.Clone();
+    }
+    if (expr.kind == ExprKind::kColumn) {
+        const int slot = Resolve(scope, expr.table, expr.name);
+        if (slot < 0) {
+            throw std::invalid_argument("Unknown column: " + expr.ToString());
+        }
+        ExprPtr column = MakeColumn(scope[slot].table, scope[slot].name);
+        column->slot = slot;
+        column->type = scope[slot].type;
+        return column;
+    }
+    if (expr.kind == ExprKind::kAggregate && !aggregates) {
+        throw std::invalid_argument("Aggregate not allowed here: " + expr.ToString());
+    }
+
+    ExprPtr bound(new Expr());
+    bound->kind = expr.kind;
+    bound->unary = expr.unary;
+    bound->binary = expr.binary;
+    bound->negated = expr.negated;
+    bound->fn = expr.fn;
+    bound->star = expr.star;
+    for (const ExprPtr& arg : expr.args) {
+        bound->args.push_back(Bind(*arg, scope, aggregates && expr.kind != ExprKind::kAggregate));
+    }
+    switch (expr.kind) {
+    case ExprKind::kAggregate:
+        bound->type = AggregateType(expr.fn, expr.star ? nullptr : bound->args[0].get());
+        break;
+    case ExprKind::kUnary:
+        if (expr.unary == UnaryOp::kNot) {
+            if (bound->args[0]->kind == ExprKind::kParameter) bound->args[0]->type = DataType::kBool;
+            bound->type = DataType::kBool;
+        } else if (bound->args[0]->type == DataType::kString) {
+            throw std::invalid_argument("Cannot negate text");
+        } else {
+            const DataType type = bound->args[0]->type;
+            bound->type = type == DataType::kDouble || type == DataType::kDecimal ? type : DataType::kInt64;
+        }
+        break;
+    case ExprKind::kIsNull:
+        bound->type = DataType::kBool;
+        break;
+    default:
+        if (IsComparison(expr.binary)) {
+            CoerceLiteral(*bound->args[0], bound->args[1]->type);
+            CoerceLiteral(*bound->args[1], bound->args[0]->type);
+            TypeParameter(*bound->args[0], *bound->args[1]);
+            TypeParameter(*bound->args[1], *bound->args[0]);
+            bound->type = DataType::kBool;
+        } else if (expr.binary == BinaryOp::kAnd || expr.binary == BinaryOp::kOr) {
+            for (ExprPtr& arg : bound->args) {
+                if (arg->kind == ExprKind::kParameter) arg->type = DataType::kBool;
+            }
+            bound->type = DataType::kBool;
+        } else {
+            TypeParameter(*bound->args[0], *bound->args[1]);
+            TypeParameter(*bound->args[1], *bound->args[0]);
+            bound->type = ArithmeticType(bound->args[0]->type, bound->args[1]->type);
+        }
+        break;
+    }
+    return bound;
+}
+
+bool HasAggregate(const Expr* expr) {
+    if (expr == nullptr) return false;
+    if (expr->kind == ExprKind::kAggregate) return true;
+    for (const ExprPtr& arg : expr->args) {
+        if (HasAggregate(arg.get())) return true;
+    }
+    return false;
+}
+
+}  // namespace
+
+void SplitAnd(ExprPtr expr, std::vector<ExprPtr>& conjuncts) {
+    if (expr->kind == ExprKind::kBinary && expr->binary == BinaryOp::kAnd) {
+        SplitAnd(std::move(expr->args[0]), conjuncts);
+        SplitAnd(std::move(expr->args[1]), conjuncts);
+    } else {
+        conjuncts.push_back(std::move(expr));
+    }
+}
+
+ExprPtr Conjoin(std::vector<ExprPtr>& conjuncts) {
+    ExprPtr result;
+    for (ExprPtr& conjunct : conjuncts) {
+        if (!result) {
+            result = std::move(conjunct);
+        } else {
+            result = MakeBinary(BinaryOp::kAnd, std::move(result), std::move(conjunct));
+            result->type = DataType::kBool;
+        }
+    }
+    return result;
+}
+
+namespace {
+
+// Lowest and highest slot an expression reads (-1, -1 for a constant).
+void SlotRange(const Expr& expr, int& lowest, int& highest) {
+    if (expr.kind == ExprKind::kColumn) {
+        lowest = lowest < 0 ? expr.slot : std::min(lowest, expr.slot);
+        highest = std::max(highest, expr.slot);
+    }
+    for (const ExprPtr& arg : expr.args) {
+        SlotRange(*arg, lowest, highest);
+    }
+}
+
+// 0 when expr only reads slots below width, 1 when it only reads slots from width on, -1 otherwise.
+int Side(const Expr& expr, int width) {
+    int lowest = -1;
+    int highest = -1;
+    SlotRange(expr, lowest, highest);
+    if (lowest < 0) return -1;
+    if (highest < width) return 0;
+    return lowest >= width ? 1 : -1;
+}
+
+void ShiftSlots(Expr& expr, int delta) {
+    if (expr.kind == ExprKind::kColumn) expr.slot += delta;
+    for (ExprPtr& arg : expr.args) {
+        ShiftSlots(*arg, delta);
+    }
+}
+
+ExprPtr SlotRef(const PlanColumn& column, int slot) {
+    ExprPtr ref = MakeColumn(column.table, column.name);
+    ref->slot = slot;
+    ref->type = column.type;
+    return ref;
+}
+
+struct Source {
+    std::string name;
+    std::string qualifier;
+    const DbTable* table = nullptr;
+    std::vector<bool> needed;
+};
+
+int FindColumn(const DbTable& table, const std::string& name) {
+    const auto& descs = table.GetColumnDescriptions();
+    for (size_t i = 0; i < descs.size(); ++i) {
+        if (descs[i].first == name) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+// Marks every table column expr may refer to; names that match nothing are left for Bind to report.
+void MarkColumns(const Expr* expr, std::vector<Source>& sources) {
+    if (expr == nullptr) return;
+    if (expr->kind == ExprKind::kColumn) {
+        for (Source& source : sources) {
+            if (!expr->table.empty() && expr->table != source.qualifier) continue;
+            const int col = FindColumn(*source.table, expr->name);
+            if (col >= 0) source.needed[col] = true;
+        }
+    }
+    for (const ExprPtr& arg : expr->args) {
+        MarkColumns(arg.get(), sources);
+    }
+}
+
+PlanPtr MakeScan(const Source& source) {
+    PlanPtr scan(new PlanNode());
+    scan->kind = PlanKind::kScan;
+    scan->table_name = source.name;
+    scan->alias = source.qualifier;
+    scan->table = source.table;
+    const auto& descs = source.table->GetColumnDescriptions();
+    for (size_t i = 0; i < descs.size(); ++i) {
+        if (!source.needed[i]) continue;
+        scan->scan_columns.push_back(static_cast<unsigned int>(i));
+        scan->columns.push_back({source.qualifier, descs[i].first, descs[i].second, source.table, static_cast<int>(i)});
+    }
+    scan->estimated_rows = static_cast<double>(source.table->RowCount());
+    scan->estimated_cost = scan->estimated_rows * CostModel::kRowCost;
+    return scan;
+}
+
+/* `column op literal` as a predicate DbTable::Filter evaluates the same way; other literals stay in a Filter. A
+parameter of the column's type becomes a predicate whose constant is filled in when the scan opens. */
+bool ToScanPredicate(const Expr& conjunct, const PlanNode& scan, ScanPredicate& predicate) {
+    if (conjunct.kind != ExprKind::kBinary || !IsComparison(conjunct.binary)) return false;
+    const Expr* column = conjunct.args[0].get();
+    const Expr* literal = conjunct.args[1].get();
+    BinaryOp op = conjunct.binary;
+    if (column->kind != ExprKind::kColumn) {
+        std::swap(column, literal);
+        op = Mirror(op);
+    }
+    if (column->kind != ExprKind::kColumn || static_cast<size_t>(column->slot) >= scan.scan_columns.size()) {
+        return false;
+    }
+    if (literal->kind == ExprKind::kParameter && literal->type == column->type) {
+        predicate.column = scan.scan_columns[column->slot];
+        predicate.op = ToCompareOp(op);
+        predicate.parameter = literal->parameter;
+        return true;
+    }
+    if (literal->kind != ExprKind::kLiteral) return false;
+    Value constant;
+    if (!ToFilterConstant(literal->literal, column->type, constant)) return false;
+    predicate.column = scan.scan_columns[column->slot];
+    predicate.op = ToCompareOp(op);
+    predicate.text = constant.ToString();
+    predicate.constant = std::move(constant);
+    return true;
+}
+
+}  // namespace
+
+bool ToFilterConstant(const Value& value, DataType type, Value& constant) {
+    if (value.null) return false;
+    if ((type == DataType::kString) != (value.type == DataType::kString)) return false;
+    if ((type == DataType::kBool || type == DataType::kDate || type == DataType::kTimestamp) && value.type != type) {
+        return false;
+    }
+    try {
+        constant = CastValue(value, type);
+    } catch (const std::exception&) {
+        return false;
+    }
+    return CompareValues(constant, value) == 0;
+}
+
+/* Without a driving predicate every row is read and checked against every predicate. Driven by one, DbTable::Filter
+compares the rows of the zones it cannot prune, which is cheap per row, and only its matches are sought and checked
+against the others. */
+ExprPtr PushIntoScan(PlanNode& scan, ExprPtr condition) {
+    std::vector<ExprPtr> conjuncts;
+    SplitAnd(std::move(condition), conjuncts);
+    std::vector<ExprPtr> rest;
+    std::vector<std::pair<double, ScanPredicate>> pushed;
+    for (ExprPtr& conjunct : conjuncts) {
+        ScanPredicate predicate;
+        if (ToScanPredicate(*conjunct, scan, predicate)) {
+            double selectivity = 0;
+            if (predicate.parameter < 0) {
+                selectivity = scan.table->EstimateSelectivity(predicate.column, predicate.op, predicate.text);
+            } else if (predicate.op == CompareOp::kEq) {  // the value is not known yet: assume a typical one
+                selectivity = 1 / std::max(scan.table->EstimateDistinct(predicate.column), 1.0);
+            } else {
+                selectivity = CostModel::kDefaultSelectivity;
+            }
+            pushed.emplace_back(selectivity, std::move(predicate));
+        } else {
+            rest.push_back(std::move(conjunct));
+        }
+    }
+    std::stable_sort(pushed.begin(), pushed.end(),
+                     [](const auto& a, const auto& b) { return a.first < b.first; });
+    for (auto& [selectivity, predicate] : pushed) {
+        scan.predicates.push_back(std::move(predicate));
+    }
+    const double rows = static_cast<double>(scan.table->RowCount());
+    const double checks = static_cast<double>(scan.predicates.size());
+    scan.access = ScanAccess::kSequential;
+    scan.estimated_cost = rows * (CostModel::kRowCost + checks * CostModel::kCompareCost);
+    size_t driver = 0;
+    for (size_t i = 0; i < pushed.size(); ++i) {
+        const ScanPredicate& predicate = scan.predicates[i];
+        double visited = rows;
+        if (predicate.parameter < 0) {
+            visited = static_cast<double>(scan.table->EstimateScanRows(predicate.column, predicate.op, predicate.text));
+        } else if (predicate.op == CompareOp::kEq) {
+            visited = scan.table->EstimateLookupRows(predicate.column);
+        }
+        const double cost = visited * CostModel::kFilterRowCost +
+                            rows * pushed[i].first * (CostModel::kSeekCost + (checks - 1) * CostModel::kCompareCost);
+        if (cost < scan.estimated_cost) {
+            scan.access = ScanAccess::kFilter;
+            scan.estimated_cost = cost;
+            driver = i;
+        }
+    }
+    if (driver > 0) {
+        std::rotate(scan.predicates.begin(), scan.predicates.begin() + driver, scan.predicates.begin() + driver + 1);
+    }
+    for (const auto& entry : pushed) {
+        scan.estimated_rows *= entry.first;
+    }
+    return Conjoin(rest);
+}
+
+PlanPtr MakeFilter(PlanPtr input, ExprPtr predicate) {
+    PlanPtr filter(new PlanNode());
+    filter->kind = PlanKind::kFilter;
+    filter->columns = input->columns;
+    filter->predicate = std::move(predicate);
+    filter->estimated_rows = input->estimated_rows;
+    filter->children.push_back(std::move(input));
+    return filter;
+}
+
+namespace {
+
+// Equalities between one side and the other become hash keys, everything else the join's residual predicate.
+PlanPtr MakeJoin(PlanPtr left, PlanPtr right, const Expr* on) {
+    PlanPtr join(new PlanNode());
+    join->kind = PlanKind::kJoin;
+    join->columns = left->columns;
+    join->columns.insert(join->columns.end(), right->columns.begin(), right->columns.end());
+    const int width = static_cast<int>(left->columns.size());
+    if (on != nullptr) {
+        std::vector<ExprPtr> conjuncts;
+        SplitAnd(Bind(*on, join->columns, false), conjuncts);
+        std::vector<ExprPtr> rest;
+        for (ExprPtr& conjunct : conjuncts) {
+            if (conjunct->kind == ExprKind::kBinary && conjunct->binary == BinaryOp::kEq) {
+                const int first = Side(*conjunct->args[0], width);
+                const int second = Side(*conjunct->args[1], width);
+                if (first >= 0 && second >= 0 && first != second) {
+                    ExprPtr left_key = std::move(conjunct->args[first == 0 ? 0 : 1]);
+                    ExprPtr right_key = std::move(conjunct->args[first == 0 ? 1 : 0]);
+                    ShiftSlots(*right_key, -width);
+                    join->left_keys.push_back(std::move(left_key));
+                    join->right_keys.push_back(std::move(right_key));
+                    continue;
+                }
+            }
+            rest.push_back(std::move(conjunct));
+        }
+        join->predicate = Conjoin(rest);
+    }
+    join->join_method = join->left_keys.empty() ? JoinMethod::kNestedLoop : JoinMethod::kHash;
+    join->children.push_back(std::move(left));
+    join->children.push_back(std::move(right));
+    return join;
+}
+
+/* Rewrites an expression bound to the input of an Aggregate so it reads the Aggregate's output: subtrees equal to a
+group key become that key's slot and aggregate calls become the slot of their (shared) result. */
+ExprPtr RewriteAggregated(ExprPtr expr, PlanNode& aggregate, std::vector<std::string>& calls) {
+    const std::string key = expr->ToString();
+    for (size_t i = 0; i < aggregate.group_by.size(); ++i) {
+        if (aggregate.group_by[i]->ToString() == key) return SlotRef(aggregate.columns[i], static_cast<int>(i));
+    }
+    if (expr->kind == ExprKind::kAggregate) {
+        size_t call = std::find(calls.begin(), calls.end(), key) - calls.begin();
+        if (call == calls.size()) {
+            calls.push_back(key);
+            AggregateCall aggregate_call;
+            aggregate_call.fn = expr->fn;
+            if (!expr->star) aggregate_call.arg = std::move(expr->args[0]);
+            aggregate_call.type = expr->type;
+            aggregate.aggregates.push_back(std::move(aggregate_call));
+            aggregate.columns.push_back({"", key, expr->type});
+        }
+        const size_t slot = aggregate.group_by.size() + call;
+        return SlotRef(aggregate.columns[slot], static_cast<int>(slot));
+    }
+    if (expr->kind == ExprKind::kColumn) {
+        throw std::invalid_argument("Column " + key + " must appear in GROUP BY or in an aggregate");
+    }
+    for (ExprPtr& arg : expr->args) {
+        arg = RewriteAggregated(std::move(arg), aggregate, calls);
+    }
+    return expr;
+}
+
+std::string OutputName(const Expr& expr, const std::string& alias) {
+    if (!alias.empty()) return alias;
+    return expr.kind == ExprKind::kColumn ? expr.name : expr.ToString();
+}
+
+PlanPtr MakeProject(PlanPtr input, std::vector<ExprPtr> exprs, const std::vector<std::string>& names) {
+    PlanPtr project(new PlanNode());
+    project->kind = PlanKind::kProject;
+    for (size_t i = 0; i < exprs.size(); ++i) {
+        const Expr& expr = *exprs[i];
+        project->columns.push_back({expr.kind == ExprKind::kColumn ? expr.table : "", names[i], expr.type});
+    }
+    project->exprs = std::move(exprs);
+    project->children.push_back(std::move(input));
+    return project;
+}
+
+std::string QuoteIfText(const Value& value) {
+    return value.type == DataType::kString ? "'" + value.text + "'" : value.ToString();
+}
+
+const char* JoinMethodName(JoinMethod method) {
+    switch (method) {
+    case JoinMethod::kHash: return "HashJoin";
+    case JoinMethod::kNestedLoop: return "NestedLoopJoin";
+    case JoinMethod::kLookup: return "LookupJoin";
+    }
+    return "Join";
+}
+
+void ExplainNode(const PlanNode& node, int depth, std::ostream& os) {
+    os << std::string(static_cast<size_t>(depth) * 2, ' ');
+    switch (node.kind) {
+    case PlanKind::kScan: {
+        os << (node.access == ScanAccess::kFilter ? "FilterScan " : "Scan ") << node.table_name;
+        if (node.alias != node.table_name) os << " AS " << node.alias;
+        os << " [";
+        for (size_t i = 0; i < node.columns.size(); ++i) {
+            os << (i > 0 ? ", " : "") << node.columns[i].name;
+        }
+        os << "]";
+        const auto& descs = node.table->GetColumnDescriptions();
+        for (size_t i = 0; i < node.predicates.size(); ++i) {
+            const ScanPredicate& predicate = node.predicates[i];
+            os << (i == 0 ? " where " : " and ") << descs[predicate.column].first << ' '
+               << CompareOpSymbol(predicate.op) << ' ';
+            if (predicate.parameter >= 0) {
+                os << '?' << predicate.parameter + 1;
+            } else {
+                os << QuoteIfText(predicate.constant);
+            }
+        }
+        os << " (est. " << std::llround(node.estimated_rows) << " rows)";
+        break;
+    }
+    case PlanKind::kFilter:
+        os << "Filter " << node.predicate->ToString();
+        break;
+    case PlanKind::kJoin:
+        os << JoinMethodName(node.join_method);
+        for (size_t i = 0; i < node.left_keys.size(); ++i) {
+            os << (i == 0 ? " " : " AND ") << node.left_keys[i]->ToString() << " = " << node.right_keys[i]->ToString();
+        }
+        if (node.predicate) os << " filter " << node.predicate->ToString();
+        if (node.estimated_cost > 0) os << " (est. " << std::llround(node.estimated_rows) << " rows)";  // optimized
+        break;
+    case PlanKind::kAggregate:
+        os << "Aggregate";
+        for (size_t i = 0; i < node.group_by.size(); ++i) {
+            os << (i == 0 ? " group by " : ", ") << node.group_by[i]->ToString();
+        }
+        for (size_t i = 0; i < node.aggregates.size(); ++i) {
+            os << (i == 0 ? " compute " : ", ") << node.columns[node.group_by.size() + i].name;
+        }
+        break;
+    case PlanKind::kProject:
+        os << "Project ";
+        for (size_t i = 0; i < node.exprs.size(); ++i) {
+            const std::string text = node.exprs[i]->ToString();
+            os << (i > 0 ? ", " : "") << text;
+            if (OutputName(*node.exprs[i], "") != node.columns[i].name) os << " AS " << node.columns[i].name;
+        }
+        break;
+    case PlanKind::kSort:
+        os << "Sort ";
+        for (size_t i = 0; i < node.sort_keys.size(); ++i) {
+            os << (i > 0 ? ", " : "") << node.sort_keys[i].expr->ToString() << (node.sort_keys[i].descending ? " DESC" : "");
+        }
+        break;
+    case PlanKind::kLimit:
+        os << "Limit " << node.limit;
+        if (node.offset > 0) os << " offset " << node.offset;
+        break;
+    }
+    os << '\n';
+    for (const PlanPtr& child : node.children) {
+        ExplainNode(*child, depth + 1, os);
+    }
+}
+
+}  // namespace
+
+std::string PlanNode::Explain() const {
+    std::ostringstream os;
+    ExplainNode(*this, 0, os);
+    return os.str();
+}
+
+PlanPtr PlanSelect(const SelectStmt& select, Database& db, const PlannerOptions& options) {
+    std::vector<Source> sources;
+    for (const TableRef& ref : select.from) {
+        Source source;
+        source.name = ref.name;
+        source.qualifier = ref.alias.empty() ? ref.name : ref.alias;
+        for (const Source& other : sources) {
+            if (other.qualifier == source.qualifier) {
+                throw std::invalid_argument("Table name used twice in FROM: " + source.qualifier);
+            }
+        }
+        source.table = &db.GetTable(ref.name);
+        source.needed.assign(source.table->GetColumnDescriptions().size(), false);
+        sources.push_back(std::move(source));
+    }
+
+    // Scans only read the columns the query mentions.
+    for (const SelectItem& item : select.items) {
+        if (item.expr) {
+            MarkColumns(item.expr.get(), sources);
+            continue;
+        }
+        bool matched = false;
+        for (Source& source : sources) {
+            if (!item.table.empty() && item.table != source.qualifier) continue;
+            source.needed.assign(source.needed.size(), true);
+            matched = true;
+        }
+        if (!matched) {
+            throw std::invalid_argument("Unknown table: " + item.table);
+        }
+    }
+    for (const TableRef& ref : select.from) {
+        MarkColumns(ref.on.get(), sources);
+    }
+    MarkColumns(select.where.get(), sources);
+    for (const ExprPtr& expr : select.group_by) {
+        MarkColumns(expr.get(), sources);
+    }
+    MarkColumns(select.having.get(), sources);
+    for (const OrderItem& item : select.order_by) {
+        MarkColumns(item.expr.get(), sources);
+    }
+
+    PlanPtr plan;
+    Scope universe;  // the columns of all scans in FROM order
+    if (options.optimize) {
+        std::vector<PlanPtr> scans;
+        for (const Source& source : sources) {
+            scans.push_back(MakeScan(source));
+            universe.insert(universe.end(), scans.back()->columns.begin(), scans.back()->columns.end());
+        }
+        std::vector<ExprPtr> conjuncts;
+        for (const TableRef& ref : select.from) {
+            if (ref.on) SplitAnd(Bind(*ref.on, universe, false), conjuncts);
+        }
+        if (select.where) SplitAnd(Bind(*select.where, universe, false), conjuncts);
+        plan = OptimizeJoins(std::move(scans), std::move(conjuncts));
+    } else {
+        plan = MakeScan(sources[0]);
+        for (size_t i = 1; i < sources.size(); ++i) {
+            plan = MakeJoin(std::move(plan), MakeScan(sources[i]), select.from[i].on.get());
+        }
+        universe = plan->columns;
+        if (select.where) {
+            ExprPtr condition = Bind(*select.where, plan->columns, false);
+            if (plan->kind == PlanKind::kScan) condition = PushIntoScan(*plan, std::move(condition));
+            if (condition) plan = MakeFilter(std::move(plan), std::move(condition));
+        }
+    }
+
+    /* SELECT * and t.* expand to qualified columns in FROM order, so they keep working when two tables share a column
+    name and whatever order the joins run in. */
+    std::vector<ExprPtr> items;
+    std::vector<std::string> names;
+    for (const SelectItem& item : select.items) {
+        if (item.expr) {
+            items.push_back(item.expr->Clone());
+            names.push_back(item.alias);
+            continue;
+        }
+        for (const PlanColumn& column : universe) {
+            if (item.table.empty() || item.table == column.table) {
+                items.push_back(MakeColumn(column.table, column.name));
+                names.push_back(column.name);
+            }
+        }
+    }
+
+    bool aggregating = !select.group_by.empty() || HasAggregate(select.having.get());
+    for (const ExprPtr& item : items) {
+        aggregating = aggregating || HasAggregate(item.get());
+    }
+    for (const OrderItem& item : select.order_by) {
+        aggregating = aggregating || HasAggregate(item.expr.get());
+    }
+
+    const Scope input = plan->columns;
+    PlanNode* aggregate = nullptr;
+    std::vector<std::string> calls;
+    auto bind_output = [&](const Expr& expr) {
+        if (aggregate == nullptr) return Bind(expr, input, false);
+        return RewriteAggregated(Bind(expr, input, true), *aggregate, calls);
+    };
+    if (aggregating) {
+        PlanPtr node(new PlanNode());
+        node->kind = PlanKind::kAggregate;
+        for (const ExprPtr& expr : select.group_by) {
+            if (HasAggregate(expr.get())) {
+                throw std::invalid_argument("Aggregate not allowed in GROUP BY: " + expr->ToString());
+            }
+            ExprPtr key = Bind(*expr, input, false);
+            if (key->kind == ExprKind::kColumn) {
+                node->columns.push_back({key->table, key->name, key->type});
+            } else {
+                node->columns.push_back({"", key->ToString(), key->type});
+            }
+            node->group_by.push_back(std::move(key));
+        }
+        node->children.push_back(std::move(plan));
+        plan = std::move(node);
+        aggregate = plan.get();
+    }
+
+    std::vector<ExprPtr> outputs;
+    for (size_t i = 0; i < items.size(); ++i) {
+        outputs.push_back(bind_output(*items[i]));
+        names[i] = OutputName(*items[i], names[i]);
+    }
+    ExprPtr having;
+    if (select.having) {
+        if (aggregate == nullptr) {
+            throw std::invalid_argument("HAVING without GROUP BY or aggregates");
+        }
+        having = bind_output(*select.having);
+    }
+
+    /* ORDER BY a position, an output alias, an output expression, or anything else the input has: the latter is
+    computed as a hidden output and trimmed after the sort. */
+    const size_t visible = outputs.size();
+    std::vector<std::pair<size_t, bool>> order;
+    for (const OrderItem& item : select.order_by) {
+        const Expr& expr = *item.expr;
+        size_t slot = outputs.size();
+        if (expr.kind == ExprKind::kLiteral && expr.literal.type == DataType::kInt64 && !expr.literal.null) {
+            if (expr.literal.integer < 1 || static_cast<size_t>(expr.literal.integer) > visible) {
+                throw std::invalid_argument("ORDER BY position out of range: " + expr.ToString());
+            }
+            slot = static_cast<size_t>(expr.literal.integer - 1);
+        } else if (expr.kind == ExprKind::kColumn && expr.table.empty()) {
+            size_t matches = 0;
+            for (size_t i = 0; i < visible; ++i) {
+                if (names[i] != expr.name) continue;
+                slot = i;
+                ++matches;
+            }
+            if (matches > 1) slot = outputs.size();  // let Bind report the ambiguity
+        }
+        if (slot == outputs.size()) {
+            ExprPtr bound = bind_output(expr);
+            const std::string key = bound->ToString();
+            for (size_t i = 0; i < outputs.size() && slot == outputs.size(); ++i) {
+                if (outputs[i]->ToString() == key) slot = i;
+            }
+            if (slot == outputs.size()) {
+                outputs.push_back(std::move(bound));
+                names.push_back(key);
+            }
+        }
+        order.emplace_back(slot, item.descending);
+    }
+
+    if (having) plan = MakeFilter(std::move(plan), std::move(having));
+    plan = MakeProject(std::move(plan), std::move(outputs), names);
+    if (!order.empty()) {
+        PlanPtr sort(new PlanNode());
+        sort->kind = PlanKind::kSort;
+        sort->columns = plan->columns;
+        for (const auto& [slot, descending] : order) {
+            sort->sort_keys.push_back({SlotRef(plan->columns[slot], static_cast<int>(slot)), descending});
+        }
+        sort->children.push_back(std::move(plan));
+        plan = std::move(sort);
+    }
+    if (select.limit || select.offset > 0) {
+        PlanPtr limit(new PlanNode());
+        limit->kind = PlanKind::kLimit;
+        limit->columns = plan->columns;
+        limit->limit = select.limit.value_or(-1);
+        limit->offset = select.offset;
+        limit->children.push_back(std::move(plan));
+        plan = std::move(limit);
+    }
+    if (plan->columns.size() > visible) {
+        std::vector<ExprPtr> trimmed;
+        std::vector<std::string> trimmed_names;
+        for (size_t i = 0; i < visible; ++i) {
+            trimmed.push_back(SlotRef(plan->columns[i], static_cast<int>(i)));
+            trimmed_names.push_back(plan->columns[i].name);
+        }
+        plan = MakeProject(std::move(plan), std::move(trimmed), trimmed_names);
+    }
+    return plan;
+}
+
+PlanPtr PlanRowIds(const std::string& table_name, const Expr* where, Database& db) {
+    std::vector<Source> sources(1);
+    sources[0].name = sources[0].qualifier = table_name;
+    sources[0].table = &db.GetTable(table_name);
+    sources[0].needed.assign(sources[0].table->GetColumnDescriptions().size(), false);
+    MarkColumns(where, sources);
+    PlanPtr scan = MakeScan(sources[0]);
+    scan->with_row_id = true;
+    scan->columns.push_back({"", "", DataType::kInt64});
+    if (where == nullptr) return scan;
+    ExprPtr condition = PushIntoScan(*scan, Bind(*where, scan->columns, false));
+    if (!condition) return scan;
+    return MakeFilter(std::move(scan), std::move(condition));
+}
+
+ExprPtr BindConstant(const Expr& expr) {
+    return Bind(expr, Scope(), false);
+}
+
+void CollectParameterTypes(const Expr* expr, std::vector<DataType>& types) {
+    if (expr == nullptr) return;
+    if (expr->kind == ExprKind::kParameter && static_cast<size_t>(expr->parameter) < types.size()) {
+        types[expr->parameter] = expr->type;
+    }
+    for (const ExprPtr& arg : expr->args) {
+        CollectParameterTypes(arg.get(), types);
+    }
+}
+
+void CollectParameterTypes(const PlanNode& plan, std::vector<DataType>& types) {
+    for (const ScanPredicate& predicate : plan.predicates) {
+        if (predicate.parameter >= 0 && static_cast<size_t>(predicate.parameter) < types.size()) {
+            types[predicate.parameter] = plan.table->GetColumnDescriptions()[predicate.column].second;
+        }
+    }
+    CollectParameterTypes(plan.predicate.get(), types);
+    for (const auto* exprs : {&plan.left_keys, &plan.right_keys, &plan.group_by, &plan.exprs}) {
+        for (const ExprPtr& expr : *exprs) {
+            CollectParameterTypes(expr.get(), types);
+        }
+    }
+    for (const AggregateCall& call : plan.aggregates) {
+        CollectParameterTypes(call.arg.get(), types);
+    }
+    for (const SortKey& key : plan.sort_keys) {
+        CollectParameterTypes(key.expr.get(), types);
+    }
+    for (const PlanPtr& child : plan.children) {
+        CollectParameterTypes(*child, types);
+    }
+}
@@ -0,0 +1,82 @@
+#include "value.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+
+#include "value_types.hpp"
+
+double Value::AsDouble() const {
+    if (type == DataType::kDouble) return number;
+    if (type == DataType::kString) {
+        throw std::invalid_argument("Not a number: '" + text + "'");
+    }
+    return Int64ValueToDouble(type == DataType::kInt ? DataType::kInt64 : type, integer);
+}
+
+// Doubles get the fewest significant digits (up to 17) that std::stod reads back as the same value.
+std::string Value::ToString() const {
+    if (null) return "";
+    if (type == DataType::kString) return text;
+    if (type == DataType::kDouble) {
+        char buffer[32];
+        for (int digits = 15; digits <= 17; ++digits) {
+            std::snprintf(buffer, sizeof(buffer), "%.*g", digits, number);
+            if (std::strtod(buffer, nullptr) == number) break;
+        }
+        return buffer;
+    }
+    if (type == DataType::kInt) return std::to_string(integer);
+    return FormatInt64Value(type, integer);
+}
+
+int CompareValues(const Value& a, const Value& b) {
+    if (a.null || b.null) return (a.null ? 0 : 1) - (b.null ? 0 : 1);
+    if (a.type == DataType::kString || b.type == DataType::kString) {
+        if (a.type != b.type) return a.type == DataType::kString ? 1 : -1;  // numbers before strings
+        return a.text.compare(b.text);
+    }
+    const bool exact = a.IsInteger() && b.IsInteger() &&
+                       (a.type == DataType::kDecimal) == (b.type == DataType::kDecimal);
+    if (exact) return a.integer < b.integer ? -1 : (a.integer > b.integer ? 1 : 0);
+    const double x = a.AsDouble();
+    const double y = b.AsDouble();
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+size_t HashValue(const Value& v) {
+    if (v.null) return 0x9e3779b97f4a7c15ULL;
+    if (v.type == DataType::kString) return std::hash<std::string>()(v.text);
+    double d = v.AsDouble();
+    if (d == 0) d = 0;  // -0.0 == 0.0
+    return std::hash<double>()(d);
+}
+
+Value CastValue(const Value& v, DataType type) {
+    if (v.null) return Value::Null(type);
+    if (v.type == type) return v;
+    if (type == DataType::kString) return Value::Text(v.ToString());
+    if (type == DataType::kDouble) {
+        return Value::Number(v.type == DataType::kString ? std::stod(v.text) : v.AsDouble());
+    }
+    if (type == DataType::kInt) {
+        if (v.type == DataType::kString) return Value::Integer(type, std::stoi(v.text));
+        const double number = v.AsDouble();
+        if (!(number >= std::numeric_limits<int>::min() && number <= std::numeric_limits<int>::max())) {
+            throw std::out_of_range("Value out of range for int: " + v.ToString());
+        }
+        return Value::Integer(type, static_cast<int64_t>(number));
+    }
+    if (v.type == DataType::kString || v.type == DataType::kDouble || type == DataType::kDecimal) {
+        return Value::Integer(type, ParseInt64Value(type, v.ToString()));  // parses "1.5" as a decimal exactly
+    }
+    return Value::Integer(type, v.type == DataType::kDecimal ? v.integer / kDecimalScale : v.integer);
+}
+
+std::ostream& operator<<(std::ostream& os, const Value& v) {
+    if (v.null) return os << "NULL";
+    return os << v.ToString();
+}
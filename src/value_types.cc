@@ -0,0 +1,240 @@
+#include "value_types.hpp"
+
+#include <cctype>
+#include <cstdio>
+#include <stdexcept>
+
+
+namespace {
+
+// Reads exactly `digits` decimal digits at text[pos] (advancing pos).
+unsigned ReadDigits(const std::string& text, size_t& pos, size_t digits) {
+    unsigned value = 0;
+    for (size_t i = 0; i < digits; ++i, ++pos) {
+        if (pos >= text.size() || !std::isdigit(static_cast<unsigned char>(text[pos]))) {
+            throw std::invalid_argument("Malformed date/time: " + text);
+        }
+        value = value * 10 + static_cast<unsigned>(text[pos] - '0');
+    }
+    return value;
+}
+
+void Expect(const std::string& text, size_t& pos, char c) {
+    if (pos >= text.size() || text[pos] != c) {
+        throw std::invalid_argument("Malformed date/time: " + text);
+    }
+    ++pos;
+}
+
+bool IsLeapYear(int64_t year) {
+    return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+unsigned DaysInMonth(int64_t year, unsigned month) {
+    static const unsigned kDays[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    return month == 2 && IsLeapYear(year) ? 29 : kDays[month - 1];
+}
+
+// YYYY-MM-DD at text[pos] as days since the epoch.
+int64_t ReadDate(const std::string& text, size_t& pos) {
+    const int64_t year = ReadDigits(text, pos, 4);
+    Expect(text, pos, '-');
+    const unsigned month = ReadDigits(text, pos, 2);
+    Expect(text, pos, '-');
+    const unsigned day = ReadDigits(text, pos, 2);
+    if (month < 1 || month > 12 || day < 1 || day > DaysInMonth(year, month)) {
+        throw std::invalid_argument("Invalid date: " + text);
+    }
+    return DaysFromCivil(year, month, day);
+}
+
+int64_t FloorDiv(int64_t a, int64_t b) {
+    return a / b - (a % b != 0 && (a < 0) != (b < 0) ? 1 : 0);
+}
+
+const int64_t kMicrosPerDay = 86400LL * 1000000LL;
+
+int64_t ParseBool(const std::string& text) {
+    std::string lower;
+    for (char c : text) lower += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    if (lower == "true" || lower == "1") return 1;
+    if (lower == "false" || lower == "0") return 0;
+    throw std::invalid_argument("Malformed bool: " + text);
+}
+
+int64_t ParseTimestamp(const std::string& text) {
+    size_t pos = 0;
+    const int64_t days = ReadDate(text, pos);
+    int64_t micros = 0;
+    if (pos < text.size() && (text[pos] == ' ' || text[pos] == 'T')) {
+        ++pos;
+        const unsigned hour = ReadDigits(text, pos, 2);
+        Expect(text, pos, ':');
+        const unsigned minute = ReadDigits(text, pos, 2);
+        Expect(text, pos, ':');
+        const unsigned second = ReadDigits(text, pos, 2);
+        if (hour > 23 || minute > 59 || second > 59) {
+            throw std::invalid_argument("Invalid time: " + text);
+        }
+        micros = ((hour * 60LL + minute) * 60LL + second) * 1000000LL;
+        if (pos < text.size() && text[pos] == '.') {
+            ++pos;
+            int64_t scale = 100000;
+            size_t digits = 0;
+            for (; pos < text.size() && std::isdigit(static_cast<unsigned char>(text[pos])); ++pos, ++digits) {
+                if (digits >= 6) throw std::invalid_argument("Timestamps have microsecond precision: " + text);
+                micros += (text[pos] - '0') * scale;
+                scale /= 10;
+            }
+            if (digits == 0) throw std::invalid_argument("Malformed date/time: " + text);
+        }
+    }
+    if (pos < text.size() && text[pos] == 'Z') ++pos;
+    if (pos != text.size()) {
+        throw std::invalid_argument("Malformed date/time: " + text);
+    }
+    return days * kMicrosPerDay + micros;
+}
+
+// [-]digits[.digits] scaled by kDecimalScale, rounding half away from zero past the last kept digit.
+int64_t ParseDecimal(const std::string& text) {
+    size_t pos = 0;
+    const bool negative = !text.empty() && text[0] == '-';
+    if (!text.empty() && (text[0] == '-' || text[0] == '+')) ++pos;
+    const int64_t kLimit = INT64_MAX / 10;
+    int64_t value = 0;
+    size_t digits = 0;
+    for (; pos < text.size() && std::isdigit(static_cast<unsigned char>(text[pos])); ++pos, ++digits) {
+        if (value > kLimit) throw std::out_of_range("Decimal out of range: " + text);
+        value = value * 10 + (text[pos] - '0');
+    }
+    int fraction = 0;
+    if (pos < text.size() && text[pos] == '.') {
+        ++pos;
+        for (; pos < text.size() && std::isdigit(static_cast<unsigned char>(text[pos])); ++pos, ++digits) {
+            if (fraction < kDecimalDigits) {
+                if (value > kLimit) throw std::out_of_range("Decimal out of range: " + text);
+                value = value * 10 + (text[pos] - '0');
+                ++fraction;
+            } else if (fraction == kDecimalDigits) {
+                value += text[pos] >= '5' ? 1 : 0;  // first dropped digit rounds
+                ++fraction;
+            }
+        }
+    }
+    if (digits == 0 || pos != text.size()) {
+        throw std::invalid_argument("Malformed decimal: " + text);
+    }
+    for (; fraction < kDecimalDigits; ++fraction) {
+        if (value > kLimit) throw std::out_of_range("Decimal out of range: " + text);
+        value *= 10;
+    }
+    return negative ? -value : value;
+}
+
+}  // namespace
+
+
+// Howard Hinnant's days_from_civil: proleptic Gregorian calendar, exact for every int64 year that fits.
+int64_t DaysFromCivil(int64_t year, unsigned month, unsigned day) {
+    year -= month <= 2 ? 1 : 0;
+    const int64_t era = FloorDiv(year, 400);
+    const int64_t yoe = year - era * 400;
+    const int64_t doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    const int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+void CivilFromDays(int64_t days, int64_t& year, unsigned& month, unsigned& day) {
+    days += 719468;
+    const int64_t era = FloorDiv(days, 146097);
+    const int64_t doe = days - era * 146097;
+    const int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const int64_t mp = (5 * doy + 2) / 153;
+    day = static_cast<unsigned>(doy - (153 * mp + 2) / 5 + 1);
+    month = static_cast<unsigned>(mp < 10 ? mp + 3 : mp - 9);
+    year = yoe + era * 400 + (month <= 2 ? 1 : 0);
+}
+
+
+int64_t ParseInt64Value(DataType type, const std::string& text) {
+    switch (type) {
+    case DataType::kBool:
+        return ParseBool(text);
+    case DataType::kDate: {
+        size_t pos = 0;
+        const int64_t days = ReadDate(text, pos);
+        if (pos != text.size()) throw std::invalid_argument("Malformed date: " + text);
+        return days;
+    }
+    case DataType::kTimestamp:
+        return ParseTimestamp(text);
+    case DataType::kDecimal:
+        return ParseDecimal(text);
+    default: {
+        size_t used = 0;
+        const long long value = std::stoll(text, &used);
+        if (used != text.size()) throw std::invalid_argument("Malformed int64: " + text);
+        return value;
+    }
+    }
+}
+
+std::string FormatInt64Value(DataType type, int64_t value) {
+    char buffer[64];
+    switch (type) {
+    case DataType::kBool:
+        return value != 0 ? "true" : "false";
+    case DataType::kDate:
+    case DataType::kTimestamp: {
+        const int64_t days = type == DataType::kDate ? value : FloorDiv(value, kMicrosPerDay);
+        int64_t year;
+        unsigned month, day;
+        CivilFromDays(days, year, month, day);
+        int n = std::snprintf(buffer, sizeof(buffer), "%04lld-%02u-%02u", static_cast<long long>(year), month, day);
+        if (type == DataType::kTimestamp) {
+            const int64_t micros = value - days * kMicrosPerDay;
+            const int64_t seconds = micros / 1000000;
+            n += std::snprintf(buffer + n, sizeof(buffer) - n, " %02lld:%02lld:%02lld",
+                               static_cast<long long>(seconds / 3600), static_cast<long long>(seconds / 60 % 60),
+                               static_cast<long long>(seconds % 60));
+            if (micros % 1000000 != 0) {
+                std::snprintf(buffer + n, sizeof(buffer) - n, ".%06lld", static_cast<long long>(micros % 1000000));
+            }
+        }
+        return buffer;
+    }
+    case DataType::kDecimal: {
+        // magnitude as unsigned so INT64_MIN does not overflow
+        const uint64_t magnitude = value < 0 ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+        std::snprintf(buffer, sizeof(buffer), "%s%llu.%0*llu", value < 0 ? "-" : "",
+                      static_cast<unsigned long long>(magnitude / kDecimalScale), kDecimalDigits,
+                      static_cast<unsigned long long>(magnitude % kDecimalScale));
+        return buffer;
+    }
+    default:
+        return std::to_string(value);
+    }
+}
+
+double Int64ValueToDouble(DataType type, int64_t value) {
+    if (type == DataType::kDecimal) {
+        return static_cast<double>(value) / static_cast<double>(kDecimalScale);
+    }
+    return static_cast<double>(value);
+}
+
+const char* DataTypeName(DataType type) {
+    switch (type) {
+    case DataType::kString: return "std::string";
+    case DataType::kDouble: return "double";
+    case DataType::kInt: return "int";
+    case DataType::kInt64: return "int64";
+    case DataType::kBool: return "bool";
+    case DataType::kDate: return "date";
+    case DataType::kTimestamp: return "timestamp";
+    case DataType::kDecimal: return "decimal";
+    }
+    return "";
+}
@@ -0,0 +1,232 @@
+#include "wal.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+#include "binary_io.hpp"
+
+
+// Every record starts with a fixed header: payload length (4) + crc (4) + lsn (8) + type (1).
+static const std::size_t kRecordHeaderSize = 17;
+
+static std::string ErrnoMessage(const std::string& what) {
+    return what + ": " + std::strerror(errno);
+}
+
+// Writes the whole buffer, retrying on short writes / EINTR.
+static void WriteAll(int fd, const char* data, std::size_t size) {
+    while (size > 0) {
+        ssize_t n = ::write(fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error(ErrnoMessage("WAL write failed"));
+        }
+        data += n;
+        size -= static_cast<std::size_t>(n);
+    }
+}
+
+static void EncodeRecord(std::string& out, uint64_t lsn, WalRecordType type, const std::string& payload) {
+    BinaryWriter body;
+    body.PutU64(lsn);
+    body.PutU8(static_cast<uint8_t>(type));
+    body.Data().append(payload);
+    BinaryWriter header;
+    header.PutU32(static_cast<uint32_t>(payload.size()));
+    header.PutU32(Crc32(body.Data().data(), body.Size()));
+    out.append(header.Data());
+    out.append(body.Data());
+}
+
+
+WriteAheadLog::WriteAheadLog(const std::string& path, const WalOptions& options):
+    path_(path),
+    options_(options) {
+    // Find the end of the valid prefix so a torn tail from a crash is cut off before we append to it.
+    uint64_t last_lsn = 0;
+    uint64_t valid_end = Replay(path_, UINT64_MAX, [](const WalRecord&) {}, &last_lsn);
+    fd_ = ::open(path_.c_str(), O_WRONLY | O_CREAT, 0644);
+    if (fd_ < 0) {
+        throw std::runtime_error(ErrnoMessage("Cannot open WAL " + path_));
+    }
+    if (::ftruncate(fd_, static_cast<off_t>(valid_end)) != 0 || ::lseek(fd_, 0, SEEK_END) < 0) {
+        ::close(fd_);
+        throw std::runtime_error(ErrnoMessage("Cannot position WAL " + path_));
+    }
+    next_lsn_ = last_lsn + 1;
+    durable_lsn_ = last_lsn;
+    file_end_ = valid_end;
+}
+
+WriteAheadLog::~WriteAheadLog() {
+    if (fd_ >= 0) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return !flushing_; });
+        if (!pending_.empty() && error_.empty()) {
+            try {
+                FlushLocked(lock);
+            } catch (const std::exception&) {
+                // Nothing sensible to do in a destructor; uncommitted records are simply lost.
+            }
+        }
+        ::close(fd_);
+    }
+}
+
+uint64_t WriteAheadLog::Append(WalRecordType type, const std::string& payload) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!error_.empty()) {
+        throw std::runtime_error(error_);
+    }
+    uint64_t lsn = next_lsn_++;
+    EncodeRecord(pending_, lsn, type, payload);
+    return lsn;
+}
+
+/* Group commit.
+A committer whose record is not durable yet either becomes the leader (nobody is flushing) or waits for the
+current leader. The leader sleeps for the group-commit window so that concurrent committers can append their
+records, then writes everything pending and issues one fdatasync for the whole batch. Once a flush failed, nothing
+past durable_lsn_ can become durable any more, so every committer still waiting fails with the same error.*/
+void WriteAheadLog::Commit(uint64_t lsn) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (durable_lsn_ < lsn) {
+        if (!error_.empty()) {
+            throw std::runtime_error(error_);
+        } else if (flushing_) {
+            cv_.wait(lock);
+        } else {
+            FlushLocked(lock);
+        }
+    }
+}
+
+// Called with the lock held and flushing_ == false. Returns with the lock held.
+void WriteAheadLog::FlushLocked(std::unique_lock<std::mutex>& lock) {
+    flushing_ = true;
+    if (options_.group_commit_window.count() > 0) {
+        lock.unlock();
+        std::this_thread::sleep_for(options_.group_commit_window);
+        lock.lock();
+    }
+    std::string batch;
+    batch.swap(pending_);
+    uint64_t target = next_lsn_ - 1;
+    lock.unlock();
+
+    bool ok = true;
+    std::string error;
+    try {
+        WriteAll(fd_, batch.data(), batch.size());
+        if (options_.sync && ::fdatasync(fd_) != 0) {
+            throw std::runtime_error(ErrnoMessage("WAL fdatasync failed"));
+        }
+    } catch (const std::exception& e) {
+        ok = false;
+        error = e.what();
+    }
+
+    lock.lock();
+    flushing_ = false;
+    if (ok) {
+        durable_lsn_ = target;
+        file_end_ += batch.size();
+        ++sync_count_;
+    } else {
+        // Cut off whatever part of the batch reached the file, so no torn record hides later ones from replay.
+        if (::ftruncate(fd_, static_cast<off_t>(file_end_)) != 0 || ::lseek(fd_, 0, SEEK_END) < 0) {
+            error += "; " + ErrnoMessage("cannot cut WAL " + path_ + " back");
+        }
+        error_ = error;
+        pending_.clear();
+    }
+    cv_.notify_all();
+    if (!ok) {
+        throw std::runtime_error(error);
+    }
+}
+
+void WriteAheadLog::Truncate() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this] { return !flushing_; });
+    pending_.clear();
+    if (::ftruncate(fd_, 0) != 0 || ::lseek(fd_, 0, SEEK_SET) < 0 || (options_.sync && ::fdatasync(fd_) != 0)) {
+        throw std::runtime_error(ErrnoMessage("Cannot truncate WAL " + path_));
+    }
+    durable_lsn_ = next_lsn_ - 1;
+    file_end_ = 0;
+    error_.clear();
+}
+
+uint64_t WriteAheadLog::LastLsn() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return next_lsn_ - 1;
+}
+
+uint64_t WriteAheadLog::DurableLsn() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return durable_lsn_;
+}
+
+uint64_t WriteAheadLog::SyncCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return sync_count_;
+}
+
+void WriteAheadLog::SetNextLsn(uint64_t lsn) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (lsn > next_lsn_) {
+        next_lsn_ = lsn;
+        durable_lsn_ = lsn - 1;
+    }
+}
+
+uint64_t WriteAheadLog::Replay(const std::string& path, uint64_t after_lsn,
+                               const std::function<void(const WalRecord&)>& apply, uint64_t* last_lsn) {
+    if (last_lsn != nullptr) *last_lsn = 0;
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        if (errno == ENOENT) return 0;  // no log yet
+        throw std::runtime_error(ErrnoMessage("Cannot open WAL " + path));
+    }
+    std::string data;
+    char chunk[1 << 16];
+    for (;;) {
+        ssize_t n = ::read(fd, chunk, sizeof(chunk));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            ::close(fd);
+            throw std::runtime_error(ErrnoMessage("Cannot read WAL " + path));
+        }
+        if (n == 0) break;
+        data.append(chunk, static_cast<std::size_t>(n));
+    }
+    ::close(fd);
+
+    std::size_t pos = 0;
+    while (data.size() - pos >= kRecordHeaderSize) {
+        BinaryReader header(data.data() + pos, 8);
+        uint32_t payload_len = header.GetU32();
+        uint32_t crc = header.GetU32();
+        std::size_t body_len = 9 + static_cast<std::size_t>(payload_len);
+        if (data.size() - pos - 8 < body_len) break;  // torn tail
+        const char* body = data.data() + pos + 8;
+        if (Crc32(body, body_len) != crc) break;       // corrupt record: stop here
+        BinaryReader reader(body, body_len);
+        WalRecord record;
+        record.lsn = reader.GetU64();
+        record.type = static_cast<WalRecordType>(reader.GetU8());
+        record.payload.assign(body + 9, payload_len);
+        if (record.lsn > after_lsn) {
+            apply(record);
+        }
+        if (last_lsn != nullptr) *last_lsn = record.lsn;
+        pos += 8 + body_len;
+    }
+    return pos;
+}
@@ -0,0 +1,148 @@
+#include "zone_map.hpp"
+
+#include <stdexcept>
+
+#include "value_types.hpp"
+
+
+ZoneMap::Zone& ZoneMap::ZoneOf(unsigned int id) {
+    size_t zone = id / kZoneRows;
+    if (zone >= zones_.size()) {
+        zones_.resize(zone + 1);
+    }
+    return zones_[zone];
+}
+
+void ZoneMap::AddNumber(unsigned int id, double value) {
+    Zone& zone = ZoneOf(id);
+    if (value != value) {
+        zone.has_nan = true;
+        return;
+    }
+    if (!zone.has_values) {
+        zone.has_values = true;
+        zone.min = zone.max = value;
+        return;
+    }
+    if (value < zone.min) zone.min = value;
+    if (value > zone.max) zone.max = value;
+}
+
+void ZoneMap::AddString(unsigned int id, const std::string& value) {
+    Zone& zone = ZoneOf(id);
+    if (!zone.has_values) {
+        zone.has_values = true;
+        zone.str_min = zone.str_max = value;
+        return;
+    }
+    if (value < zone.str_min) zone.str_min = value;
+    if (zone.str_max < value) zone.str_max = value;
+}
+
+void ZoneMap::AddInteger(unsigned int id, int64_t value) {
+    Zone& zone = ZoneOf(id);
+    if (!zone.has_values) {
+        zone.has_values = true;
+        zone.int_min = zone.int_max = value;
+        return;
+    }
+    if (value < zone.int_min) zone.int_min = value;
+    if (value > zone.int_max) zone.int_max = value;
+}
+
+void ZoneMap::AddNull(unsigned int id) {
+    ++ZoneOf(id).null_count;
+}
+
+void ZoneMap::RemoveNull(unsigned int id) {
+    --ZoneOf(id).null_count;
+}
+
+void ZoneMap::Reset(size_t zone) {
+    if (zone < zones_.size()) {
+        zones_[zone] = Zone();
+    }
+}
+
+bool ZoneMap::MayMatch(size_t zone, CompareOp op, double constant) const {
+    if (!HasValues(zone)) return false;
+    return zones_[zone].has_nan || RangeMayMatch(zones_[zone].min, zones_[zone].max, op, constant);
+}
+
+bool ZoneMap::MayMatch(size_t zone, CompareOp op, const std::string& constant) const {
+    return HasValues(zone) && RangeMayMatch(zones_[zone].str_min, zones_[zone].str_max, op, constant);
+}
+
+bool ZoneMap::MayMatch(size_t zone, CompareOp op, int64_t constant) const {
+    return HasValues(zone) && RangeMayMatch(zones_[zone].int_min, zones_[zone].int_max, op, constant);
+}
+
+bool ZoneMap::AllMatch(size_t zone, CompareOp op, double constant) const {
+    return HasValues(zone) && !zones_[zone].has_nan && zones_[zone].null_count == 0 &&
+           RangeAllMatch(zones_[zone].min, zones_[zone].max, op, constant);
+}
+
+bool ZoneMap::AllMatch(size_t zone, CompareOp op, const std::string& constant) const {
+    return HasValues(zone) && zones_[zone].null_count == 0 &&
+           RangeAllMatch(zones_[zone].str_min, zones_[zone].str_max, op, constant);
+}
+
+bool ZoneMap::AllMatch(size_t zone, CompareOp op, int64_t constant) const {
+    return HasValues(zone) && zones_[zone].null_count == 0 &&
+           RangeAllMatch(zones_[zone].int_min, zones_[zone].int_max, op, constant);
+}
+
+Footprint ZoneMap::Memory() const {
+    Footprint footprint = VectorBuffer(zones_);
+    for (const Zone& zone : zones_) {
+        footprint += StringHeap(zone.str_min);
+        footprint += StringHeap(zone.str_max);
+    }
+    return footprint;
+}
+
+// Zone count, then per zone its NULL count and a flags byte (1: has values, 2: has NaN) followed by min and max when
+// it has values (doubles, strings for string columns, 8-byte integers for the int64 types).
+void ZoneMap::Serialize(BinaryWriter& out) const {
+    out.PutU32(static_cast<uint32_t>(zones_.size()));
+    for (const Zone& zone : zones_) {
+        out.PutU32(zone.null_count);
+        out.PutU8(static_cast<uint8_t>((zone.has_values ? 1 : 0) | (zone.has_nan ? 2 : 0)));
+        if (!zone.has_values) continue;
+        if (type_ == DataType::kString) {
+            out.PutString(zone.str_min);
+            out.PutString(zone.str_max);
+        } else if (IsInt64Type(type_)) {
+            out.PutU64(static_cast<uint64_t>(zone.int_min));
+            out.PutU64(static_cast<uint64_t>(zone.int_max));
+        } else {
+            out.PutDouble(zone.min);
+            out.PutDouble(zone.max);
+        }
+    }
+}
+
+void ZoneMap::Deserialize(BinaryReader& in) {
+    uint32_t count = in.GetU32();
+    if (count > in.Remaining()) {
+        throw std::runtime_error("Corrupt table image");
+    }
+    zones_.assign(count, Zone());
+    for (Zone& zone : zones_) {
+        zone.null_count = in.GetU32();
+        uint8_t flags = in.GetU8();
+        zone.has_values = (flags & 1) != 0;
+        zone.has_nan = (flags & 2) != 0;
+        if (!zone.has_values) continue;
+        if (type_ == DataType::kString) {
+            zone.str_min = in.GetString();
+            zone.str_max = in.GetString();
+        } else if (IsInt64Type(type_)) {
+            zone.int_min = static_cast<int64_t>(in.GetU64());
+            zone.int_max = static_cast<int64_t>(in.GetU64());
+        } else {
+            zone.min = in.GetDouble();
+            zone.max = in.GetDouble();
+        }
+    }
+}
@@ -6,12 +6,42 @@
 
 #include "db.hpp"
 #include "db_table.hpp"
+#include "dictionary_column.hpp"
+#include "compressed_int_column.hpp"
+#include "bitpacking.hpp"
+#include "run_length_column.hpp"
+#include "zone_map.hpp"
+#include "bitmap.hpp"
+#include "value_types.hpp"
+#include "fixed_width_column.hpp"
+#include "compact_string_column.hpp"
+#include "metrics.hpp"
+#include "query_trace.hpp"
+#include "sql_parser.hpp"
+#include "expr_compiler.hpp"
+#include "data_chunk.hpp"
+#include "buffer_pool.hpp"
+#include "paged_table.hpp"
+#include "async_io.hpp"
+#include "partitioned_table.hpp"
 
+#include <sys/resource.h>
+
+#include <atomic>
+#include <csignal>
 #include <sstream>
 #include <stdexcept>
 #include <string>
 #include <vector>
 #include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <optional>
+#include <random>
+#include <thread>
 
 
 // ─────────────────────────────────────────────────────────────────────────────
@@ -199,3 +229,2414 @@ TEST_CASE("Creating many tables and deep copying database") {
     REQUIRE_NOTHROW(copy.GetTable("t" + std::to_string(i)));
   }
 }
+
+// ─────────────────────────────────────────────────────────────────────────────
+//  Durability: write-ahead log, snapshot and recovery
+// ─────────────────────────────────────────────────────────────────────────────
+namespace {
+// Fresh scratch directory, removed again when the test ends.
+struct TempDir {
+  std::string path;
+  TempDir() {
+    char tmpl[] = "/tmp/db_test_XXXXXX";
+    path = ::mkdtemp(tmpl);
+  }
+  ~TempDir() { std::filesystem::remove_all(path); }
+};
+
+void BuildLeague(Database& db) {
+  db.CreateTable("league");
+  DbTable& t = db.GetTable("league");
+  t.AddColumn({"team", DataType::kString});
+  t.AddColumn({"rank", DataType::kInt});
+  t.AddColumn({"shots", DataType::kDouble});
+  t.AddRow({"Shanghai", "1", "17.6"});
+  t.AddRow({"Chengdu", "2", "18.3"});
+  t.AddRow({"Beijing", "3", "13.8"});
+}
+}  // namespace
+
+TEST_CASE("WAL replays every mutation after a crash") {
+  TempDir dir;
+  std::vector<std::vector<std::string>> expected;
+  {
+    Database db;
+    db.Open(dir.path);
+    BuildLeague(db);
+    db.CreateTable("scratch");
+    db.DropTable("scratch");
+    DbTable& t = db.GetTable("league");
+    t.DeleteRowById(1);
+    t.AddColumn({"note", DataType::kString});
+    t.DeleteColumnByIdx(2);
+    t.AddRow({"Henan", "14", "x"});
+    expected = t.GetRows();
+  }  // "crash": nothing but the log is on disk
+
+  Database recovered;
+  recovered.Open(dir.path);
+  REQUIRE(recovered.GetTable("league").GetRows() == expected);
+  REQUIRE_THROWS_AS(recovered.GetTable("scratch"), std::out_of_range);
+
+  // ids keep counting from where they were, so a replayed delete hits the same row
+  recovered.GetTable("league").DeleteRowById(3);
+  REQUIRE(recovered.GetTable("league").GetRows().size() == 2);
+}
+
+TEST_CASE("Checkpoint writes a snapshot and truncates the WAL") {
+  TempDir dir;
+  {
+    Database db;
+    db.Open(dir.path);
+    BuildLeague(db);
+    db.Checkpoint();
+    REQUIRE(std::filesystem::file_size(dir.path + "/wal.log") == 0);
+    db.GetTable("league").AddRow({"Henan", "14", "11.4"});  // only in the log
+  }
+  Database recovered;
+  recovered.Open(dir.path);
+  auto rows = recovered.GetTable("league").GetRows();
+  REQUIRE(rows.size() == 4);
+  REQUIRE(rows[3][0] == "Henan");
+
+  // a failed AddRow is never logged
+  REQUIRE_THROWS(recovered.GetTable("league").AddRow({"Bad", "not a number", "1"}));
+  Database again;
+  REQUIRE_THROWS_AS(again.Open(dir.path + "/missing/child"), std::runtime_error);
+}
+
+TEST_CASE("WAL ignores a torn or corrupt tail") {
+  TempDir dir;
+  {
+    Database db;
+    db.Open(dir.path);
+    BuildLeague(db);
+  }
+  {
+    std::ofstream wal(dir.path + "/wal.log", std::ios::binary | std::ios::app);
+    wal.write("\x20\x00\x00\x00garbage", 11);  // header of a record whose body never made it
+  }
+  Database recovered;
+  recovered.Open(dir.path);
+  REQUIRE(recovered.GetTable("league").GetRows().size() == 3);
+  recovered.GetTable("league").AddRow({"Henan", "14", "11.4"});  // appends after the valid prefix
+
+  Database again;
+  again.Open(dir.path);
+  REQUIRE(again.GetTable("league").GetRows().size() == 4);
+}
+
+TEST_CASE("Group commit batches concurrent committers into fewer syncs") {
+  TempDir dir;
+  WalOptions options;
+  options.group_commit_window = std::chrono::microseconds(500);
+  WriteAheadLog wal(dir.path + "/wal.log", options);
+
+  std::vector<std::thread> workers;
+  for (int t = 0; t < 4; ++t) {
+    workers.emplace_back([&wal] {
+      for (int i = 0; i < 25; ++i) wal.AppendAndCommit(WalRecordType::kDeleteRow, "payload");
+    });
+  }
+  for (auto& w : workers) w.join();
+
+  REQUIRE(wal.DurableLsn() == 100);
+  REQUIRE(wal.SyncCount() <= 100);
+  uint64_t replayed = 0;
+  WriteAheadLog::Replay(dir.path + "/wal.log", 0, [&replayed](const WalRecord&) { ++replayed; });
+  REQUIRE(replayed == 100);
+}
+
+TEST_CASE("A failed WAL write fails every waiting committer and breaks the log") {
+  TempDir dir;
+  const std::string path = dir.path + "/wal.log";
+  WalOptions options;
+  options.group_commit_window = std::chrono::microseconds(2000);
+  WriteAheadLog wal(path, options);
+  for (int i = 0; i < 3; ++i) wal.AppendAndCommit(WalRecordType::kDeleteRow, "before");
+  const uint64_t good_size = std::filesystem::file_size(path);
+
+  // The file may grow by 100 more bytes: the batch is cut short midway through its first record.
+  std::atomic<int> succeeded{0};
+  std::atomic<int> failed{0};
+  struct rlimit saved;
+  REQUIRE(::getrlimit(RLIMIT_FSIZE, &saved) == 0);
+  void (*saved_handler)(int) = std::signal(SIGXFSZ, SIG_IGN);
+  struct rlimit limited = saved;
+  limited.rlim_cur = good_size + 100;
+  REQUIRE(::setrlimit(RLIMIT_FSIZE, &limited) == 0);
+  std::vector<std::thread> workers;
+  for (int t = 0; t < 4; ++t) {
+    workers.emplace_back([&] {
+      try {
+        wal.AppendAndCommit(WalRecordType::kDeleteRow, std::string(300, 'x'));
+        ++succeeded;
+      } catch (const std::runtime_error&) {
+        ++failed;
+      }
+    });
+  }
+  for (auto& w : workers) w.join();
+  ::setrlimit(RLIMIT_FSIZE, &saved);
+  std::signal(SIGXFSZ, saved_handler);
+
+  REQUIRE(succeeded == 0);
+  REQUIRE(failed == 4);
+  REQUIRE(wal.DurableLsn() == 3);
+  REQUIRE(std::filesystem::file_size(path) == good_size);  // the torn record was cut off
+  REQUIRE_THROWS_AS(wal.Append(WalRecordType::kDeleteRow, "after"), std::runtime_error);
+  REQUIRE_THROWS_AS(wal.Commit(wal.LastLsn()), std::runtime_error);
+  wal.Commit(3);  // already durable before the failure
+
+  uint64_t replayed = 0;
+  WriteAheadLog::Replay(path, 0, [&replayed](const WalRecord&) { ++replayed; });
+  REQUIRE(replayed == 3);
+
+  // a checkpoint's Truncate starts over with a working log
+  wal.Truncate();
+  wal.AppendAndCommit(WalRecordType::kDeleteRow, "fresh");
+  replayed = 0;
+  WriteAheadLog::Replay(path, 0, [&replayed](const WalRecord&) { ++replayed; });
+  REQUIRE(replayed == 1);
+}
+
+TEST_CASE("Incremental checkpoint only rewrites dirty chunks") {
+  TempDir dir;
+  const unsigned int rows = 3 * DbTable::kChunkRows;
+  std::vector<std::vector<std::string>> expected;
+  {
+    Database db;
+    db.Open(dir.path);
+    db.CreateTable("events");
+    db.CreateTable("teams");
+    DbTable& events = db.GetTable("events");
+    events.AddColumn({"id", DataType::kInt});
+    events.AddColumn({"kind", DataType::kString});
+    for (unsigned int i = 0; i < rows; ++i) events.AddRow({std::to_string(i), "goal"});
+    db.GetTable("teams").AddColumn({"name", DataType::kString});
+    db.GetTable("teams").AddRow({"Henan"});
+
+    CheckpointStats first = db.Checkpoint();
+    REQUIRE(first.chunks_written == 4);  // 3 event chunks + 1 team chunk
+    REQUIRE(first.chunks_kept == 0);
+
+    CheckpointStats idle = db.Checkpoint();
+    REQUIRE(idle.chunks_written == 0);
+    REQUIRE(idle.chunks_kept == 4);
+
+    events.DeleteRowById(5);                        // chunk 0
+    events.AddRow({"99999", "card"});               // chunk 3 (new)
+    CheckpointStats churn = db.Checkpoint();
+    REQUIRE(churn.chunks_written == 2);
+    REQUIRE(churn.chunks_kept == 3);
+    REQUIRE(churn.bytes_written < first.bytes_written / 2);
+
+    for (unsigned int id = DbTable::kChunkRows; id < 2 * DbTable::kChunkRows; ++id) events.DeleteRowById(id);
+    db.DropTable("teams");
+    CheckpointStats emptied = db.Checkpoint();     // chunk 1 disappears, teams is gone
+    REQUIRE(emptied.chunks_written == 0);
+    REQUIRE(emptied.chunks_kept == 3);
+
+    events.AddRow({"7", "after checkpoint"});       // only in the WAL
+    expected = events.GetRows();
+  }
+  Database recovered;
+  recovered.Open(dir.path);
+  REQUIRE(recovered.GetTable("events").GetRows() == expected);
+  REQUIRE_THROWS_AS(recovered.GetTable("teams"), std::out_of_range);
+
+  CheckpointStats compacted = recovered.Compact();
+  REQUIRE(compacted.compacted);
+  REQUIRE(compacted.chunks_written == 3);
+  REQUIRE(!std::filesystem::exists(dir.path + "/data.0.db"));
+
+  Database again;
+  again.Open(dir.path);
+  REQUIRE(again.GetTable("events").GetRows() == expected);
+}
+
+TEST_CASE("Schema changes make the whole table dirty") {
+  DbTable t;
+  t.AddColumn({"v", DataType::kInt});
+  for (unsigned int i = 0; i < 2 * DbTable::kChunkRows; ++i) t.AddRow({"1"});
+  REQUIRE(t.AllDirty());
+  t.ClearDirty();
+  REQUIRE(t.DirtyChunks().empty());
+
+  t.DeleteRowById(DbTable::kChunkRows + 1);
+  REQUIRE(t.DirtyChunks() == std::vector<unsigned int>{1});
+
+  t.AddColumn({"w", DataType::kDouble});
+  REQUIRE(t.AllDirty());
+  REQUIRE(t.DirtyChunks() == std::vector<unsigned int>{0, 1});
+}
+
+// ─────────────────────────────────────────────────────────────────────────────
+//  Encoded columns and scans
+// ─────────────────────────────────────────────────────────────────────────────
+TEST_CASE("Dictionary-encoded string columns store codes") {
+  DbTable t;
+  t.AddColumn({"team", DataType::kString}, Encoding::kDictionary);
+  t.AddColumn({"goal", DataType::kInt});
+  const std::vector<std::string> teams = {"Henan FC", "Zhejiang FC", "Henan FC", "Dalian Yingbo FC", "Henan FC"};
+  for (size_t i = 0; i < teams.size(); ++i) t.AddRow({teams[i], std::to_string(i)});
+
+  REQUIRE(t.GetColumnEncoding(0) == Encoding::kDictionary);
+  REQUIRE(t.GetColumnEncoding(1) == Encoding::kPlain);
+  const auto* dict = dynamic_cast<const DictionaryColumn*>(t.GetColumn(0));
+  REQUIRE(dict != nullptr);
+  REQUIRE(dict->DictionarySize() == 3);
+  REQUIRE(dict->CodeWidth() == 1);
+  REQUIRE(t.GetRows()[1][0] == "Zhejiang FC");
+
+  SECTION("equality and range filters") {
+    REQUIRE(t.Filter(0, CompareOp::kEq, "Henan FC") == std::vector<unsigned int>{0, 2, 4});
+    REQUIRE(t.Filter(0, CompareOp::kEq, "Nobody").empty());
+    REQUIRE(t.Filter(0, CompareOp::kNe, "Henan FC") == std::vector<unsigned int>{1, 3});
+    REQUIRE(t.Filter(0, CompareOp::kLt, "Henan FC") == std::vector<unsigned int>{3});
+    t.DeleteRowById(2);
+    REQUIRE(t.Filter(0, CompareOp::kEq, "Henan FC") == std::vector<unsigned int>{0, 4});
+  }
+
+  SECTION("group by counts per code") {
+    auto groups = t.GroupByCount(0);
+    REQUIRE(groups.size() == 3);
+    REQUIRE(groups["Henan FC"] == 3);
+    REQUIRE(groups["Dalian Yingbo FC"] == 1);
+  }
+
+  SECTION("copies, new columns and column deletion keep values aligned") {
+    t.DeleteRowById(0);
+    t.AddColumn({"league", DataType::kString}, Encoding::kDictionary);
+    t.AddRow({"Henan FC", "9", "CSL"});
+    DbTable copy(t);
+    t.DeleteColumnByIdx(0);
+    auto rows = copy.GetRows();
+    REQUIRE(rows.size() == 5);
+    REQUIRE(rows[0] == std::vector<std::string>{"Zhejiang FC", "1", ""});
+    REQUIRE(rows[4] == std::vector<std::string>{"Henan FC", "9", "CSL"});
+    REQUIRE(t.GetRow(5) == std::vector<std::string>{"9", "CSL"});
+  }
+
+  SECTION("codes widen past 256 distinct values") {
+    for (int i = 0; i < 300; ++i) t.AddRow({"team" + std::to_string(i), "0"});
+    REQUIRE(dict->CodeWidth() == 2);
+    REQUIRE(t.GetRow(5 + 299)[0] == "team299");
+    REQUIRE(t.Filter(0, CompareOp::kEq, "team7") == std::vector<unsigned int>{12});
+  }
+
+  SECTION("a failed AddRow leaves no code behind") {
+    REQUIRE_THROWS(t.AddRow({"Henan FC", "not a number"}));
+    t.AddRow({"Wuhan FC", "5"});
+    REQUIRE(t.GetRow(5)[0] == "Wuhan FC");
+  }
+
+  REQUIRE_THROWS_AS(t.AddColumn({"x", DataType::kInt}, Encoding::kDictionary), std::invalid_argument);
+}
+
+TEST_CASE("Filter and GroupByCount on plain columns") {
+  DbTable t;
+  t.AddColumn({"team", DataType::kString});
+  t.AddColumn({"rank", DataType::kInt});
+  t.AddColumn({"shots", DataType::kDouble});
+  t.AddRow({"A", "3", "10.5"});
+  t.AddRow({"B", "1", "12.0"});
+  t.AddRow({"C", "2", "9.0"});
+
+  REQUIRE(t.Filter(1, CompareOp::kLe, "2") == std::vector<unsigned int>{1, 2});
+  REQUIRE(t.Filter(2, CompareOp::kGt, "10") == std::vector<unsigned int>{0, 1});
+  REQUIRE(t.Filter(0, CompareOp::kGe, "B") == std::vector<unsigned int>{1, 2});
+  REQUIRE(t.GroupByCount(1).size() == 3);
+  REQUIRE_THROWS_AS(t.Filter(1, CompareOp::kEq, "abc"), std::invalid_argument);
+  REQUIRE_THROWS_AS(t.Filter(7, CompareOp::kEq, "1"), std::out_of_range);
+}
+
+TEST_CASE("Dictionary columns survive checkpoint and WAL replay") {
+  TempDir dir;
+  {
+    Database db;
+    db.Open(dir.path);
+    db.CreateTable("t");
+    DbTable& t = db.GetTable("t");
+    t.AddColumn({"team", DataType::kString}, Encoding::kDictionary);
+    t.AddRow({"Henan FC"});
+    t.AddRow({"Wuhan FC"});
+    db.Checkpoint();
+    t.DeleteRowById(0);
+    t.AddRow({"Henan FC"});
+  }
+  Database db;
+  db.Open(dir.path);
+  DbTable& t = db.GetTable("t");
+  REQUIRE(t.GetColumnEncoding(0) == Encoding::kDictionary);
+  REQUIRE(t.Filter(0, CompareOp::kEq, "Henan FC") == std::vector<unsigned int>{2});
+}
+
+TEST_CASE("Bit-packing round-trips every width") {
+  std::vector<uint32_t> in(1024);
+  for (unsigned width = 0; width <= 32; ++width) {
+    uint32_t mask = width == 32 ? 0xFFFFFFFFu : (uint32_t{1} << width) - 1;
+    for (size_t i = 0; i < in.size(); ++i) in[i] = static_cast<uint32_t>(i * 2654435761u) & mask;
+    std::vector<uint32_t> packed(PackedWords(in.size(), width) + 1, 0);
+    PackBlock(in.data(), in.size(), width, packed.data());
+    std::vector<uint32_t> out(in.size());
+    UnpackBlock(packed.data(), in.size(), width, out.data());
+    REQUIRE(out == in);
+    REQUIRE(UnpackOne(packed.data(), 777, width) == in[777]);
+  }
+}
+
+TEST_CASE("Compressed int columns pick an encoding per block") {
+  DbTable t;
+  t.AddColumn({"goal", DataType::kInt}, Encoding::kCompressed);
+  t.AddColumn({"season", DataType::kInt}, Encoding::kCompressed);
+  t.AddColumn({"delta", DataType::kInt}, Encoding::kCompressed);
+  const int n = 3000;
+  for (int i = 0; i < n; ++i) {
+    t.AddRow({std::to_string(i % 7), std::to_string(2000 + i / 1024), std::to_string(-50000 + 3 * i)});
+  }
+  const auto* goal = dynamic_cast<const CompressedIntColumn*>(t.GetColumn(0));
+  const auto* season = dynamic_cast<const CompressedIntColumn*>(t.GetColumn(1));
+  const auto* delta = dynamic_cast<const CompressedIntColumn*>(t.GetColumn(2));
+  REQUIRE(goal->BlockCount() == 3);
+  REQUIRE(goal->BlockSealed(1));
+  REQUIRE_FALSE(goal->BlockSealed(2));
+  REQUIRE(goal->GetBlockEncoding(0) == BlockEncoding::kBitPack);
+  REQUIRE(goal->BlockWidth(0) == 3);
+  REQUIRE(season->GetBlockEncoding(0) == BlockEncoding::kFor);
+  REQUIRE(season->BlockWidth(0) == 0);
+  REQUIRE(delta->GetBlockEncoding(0) == BlockEncoding::kDelta);
+  REQUIRE(goal->CompressedBytes() < static_cast<size_t>(n) * sizeof(int));
+
+  auto rows = t.GetRows();
+  for (int i : {0, 1, 1023, 1024, 2047, 2999}) {
+    REQUIRE(rows[i] == std::vector<std::string>{std::to_string(i % 7), std::to_string(2000 + i / 1024),
+                                                std::to_string(-50000 + 3 * i)});
+  }
+
+  SECTION("filters skip blocks by range and decode the rest") {
+    REQUIRE(t.Filter(1, CompareOp::kEq, "2001").size() == 1024);
+    REQUIRE(t.Filter(1, CompareOp::kGt, "2002").empty());
+    REQUIRE(t.Filter(2, CompareOp::kLt, "-49990") == std::vector<unsigned int>{0, 1, 2, 3});
+    REQUIRE(t.Filter(0, CompareOp::kEq, "6").size() == 428);
+  }
+
+  SECTION("aggregates honour deleted rows") {
+    REQUIRE(t.Aggregate(1, AggregateFn::kMin) == 2000);
+    REQUIRE(t.Aggregate(1, AggregateFn::kMax) == 2002);
+    double goals = 0;
+    for (int i = 0; i < n; ++i) goals += i % 7;
+    REQUIRE(t.Aggregate(0, AggregateFn::kSum) == goals);
+    double before = t.Aggregate(2, AggregateFn::kSum);
+    t.DeleteRowById(5);
+    REQUIRE(t.Aggregate(2, AggregateFn::kSum) == before - (-50000 + 15));
+    REQUIRE(t.Aggregate(2, AggregateFn::kCount) == n - 1);
+    REQUIRE(t.GroupByCount(0)["5"] == 428 - 1);
+  }
+
+  SECTION("copies share nothing") {
+    DbTable copy(t);
+    t.DeleteColumnByIdx(2);
+    REQUIRE(copy.GetRow(2999)[2] == std::to_string(-50000 + 3 * 2999));
+  }
+
+  REQUIRE_THROWS_AS(t.AddColumn({"x", DataType::kDouble}, Encoding::kCompressed), std::invalid_argument);
+  REQUIRE_THROWS_AS(t.Aggregate(9, AggregateFn::kSum), std::out_of_range);
+}
+
+TEST_CASE("Run-length columns answer from runs") {
+  DbTable t;
+  t.AddColumn({"season", DataType::kInt}, Encoding::kRunLength);
+  t.AddColumn({"flag", DataType::kString}, Encoding::kRunLength);
+  t.AddColumn({"rating", DataType::kDouble}, Encoding::kRunLength);
+  const int n = 1000;
+  for (int i = 0; i < n; ++i) {
+    t.AddRow({std::to_string(2000 + i / 100), i / 250 % 2 == 0 ? "Y" : "N", i < 500 ? "7.5" : "2.25"});
+  }
+  const auto* season = dynamic_cast<const RunLengthColumn<int32_t>*>(t.GetColumn(0));
+  const auto* flag = dynamic_cast<const RunLengthColumn<std::string>*>(t.GetColumn(1));
+  REQUIRE(season->RunCount() == 10);
+  REQUIRE(season->Sorted());
+  REQUIRE(flag->RunCount() == 4);
+  REQUIRE_FALSE(flag->Sorted());
+  REQUIRE(season->RawBytes() == n * sizeof(int32_t));
+  REQUIRE(season->CompressionRatio() == Approx(50.0));
+  REQUIRE(t.GetRow(250) == std::vector<std::string>{"2002", "N", "7.500000"});
+
+  SECTION("filters and counts on sorted and unsorted runs") {
+    REQUIRE(t.Filter(0, CompareOp::kEq, "2003").size() == 100);
+    REQUIRE(t.Filter(0, CompareOp::kEq, "2003").front() == 300);
+    REQUIRE(t.Count(0, CompareOp::kLt, "2002") == 200);
+    REQUIRE(t.Count(0, CompareOp::kLe, "2002") == 300);
+    REQUIRE(t.Count(0, CompareOp::kGt, "2008") == 100);
+    REQUIRE(t.Count(0, CompareOp::kGe, "1999") == 1000);
+    REQUIRE(t.Count(0, CompareOp::kNe, "2000") == 900);
+    REQUIRE(t.Count(0, CompareOp::kEq, "2050") == 0);
+    REQUIRE(t.Count(1, CompareOp::kEq, "Y") == 500);
+    REQUIRE(t.Count(2, CompareOp::kGt, "3") == 500);
+  }
+
+  SECTION("deleted rows are skipped inside runs") {
+    t.DeleteRowById(0);
+    t.DeleteRowById(299);
+    REQUIRE(t.Count(0, CompareOp::kLt, "2003") == 298);
+    REQUIRE(t.Filter(0, CompareOp::kEq, "2002").back() == 298);
+    REQUIRE(t.GroupByCount(0)["2000"] == 99);
+    REQUIRE(t.GroupByCount(1) == std::map<std::string, size_t>{{"N", 499}, {"Y", 499}});
+    double sum = 0;
+    for (int i = 1; i < n; ++i) sum += i == 299 ? 0 : 2000 + i / 100;
+    REQUIRE(t.Aggregate(0, AggregateFn::kSum) == sum);
+    REQUIRE(t.Aggregate(2, AggregateFn::kMin) == 2.25);
+    REQUIRE(t.Aggregate(2, AggregateFn::kAvg) == Approx((498 * 7.5 + 500 * 2.25) / 998));
+  }
+
+  SECTION("out-of-order values end the sorted fast path") {
+    t.AddRow({"2001", "Y", "1"});
+    REQUIRE_FALSE(season->Sorted());
+    REQUIRE(t.Count(0, CompareOp::kEq, "2001") == 101);
+    REQUIRE(t.Filter(0, CompareOp::kLe, "2000").size() == 100);
+    std::ostringstream out;
+    out << t;
+    REQUIRE(out.str().find("2001, Y, 1\n") != std::string::npos);
+  }
+
+  SECTION("a failed AddRow rolls the runs back") {
+    REQUIRE_THROWS_AS(t.AddRow({"2009", "N", "oops"}), std::invalid_argument);
+    REQUIRE(season->RunCount() == 10);
+    REQUIRE(season->Size() == n);
+    t.AddRow({"2010", "N", "1"});
+    REQUIRE(season->RunCount() == 11);
+  }
+}
+
+TEST_CASE("Run-length columns survive checkpoint and WAL replay") {
+  TempDir dir;
+  {
+    Database db;
+    db.Open(dir.path);
+    db.CreateTable("t");
+    DbTable& t = db.GetTable("t");
+    t.AddColumn({"season", DataType::kInt}, Encoding::kRunLength);
+    for (int i = 0; i < 10; ++i) t.AddRow({"2023"});
+    db.Checkpoint();
+    t.AddRow({"2024"});
+  }
+  Database db;
+  db.Open(dir.path);
+  DbTable& t = db.GetTable("t");
+  REQUIRE(t.GetColumnEncoding(0) == Encoding::kRunLength);
+  REQUIRE(t.GroupByCount(0) == std::map<std::string, size_t>{{"2023", 10}, {"2024", 1}});
+  REQUIRE(dynamic_cast<const RunLengthColumn<int32_t>*>(t.GetColumn(0))->RunCount() == 2);
+}
+
+TEST_CASE("Zone maps bound every column per 64K ids") {
+  const unsigned int zone = ZoneMap::kZoneRows;
+  DbTable t;
+  t.AddColumn({"day", DataType::kInt});
+  t.AddColumn({"team", DataType::kString}, Encoding::kDictionary);
+  t.AddColumn({"goals", DataType::kInt}, Encoding::kCompressed);
+  t.AddColumn({"season", DataType::kInt}, Encoding::kRunLength);
+  t.AddColumn({"xg", DataType::kDouble});
+  const unsigned int n = 3 * zone;
+  for (unsigned int i = 0; i < n; ++i) {
+    t.AddRow({std::to_string(i / 100), i < zone ? "A" : (i < 2 * zone ? "B" : "C"), std::to_string(i % 5),
+              std::to_string(2020 + i / zone), i == 5 ? "nan" : "1.5"});
+  }
+  const ZoneMap& days = t.GetZoneMap(0);
+  REQUIRE(days.ZoneCount() == 3);
+  REQUIRE(days.Min(1) == zone / 100);
+  REQUIRE(days.Max(2) == (n - 1) / 100);
+  REQUIRE(t.GetZoneMap(1).MinString(1) == "B");
+  REQUIRE(t.GetZoneMap(1).MaxString(2) == "C");
+  REQUIRE(t.GetZoneMap(3).Min(2) == 2022);
+
+  SECTION("filters over skipped and whole zones match a full scan") {
+    const std::string day = std::to_string(zone / 100 + 7);
+    auto ids = t.Filter(0, CompareOp::kEq, day);
+    REQUIRE(ids.size() == 100);
+    REQUIRE(ids.front() == (zone / 100 + 7) * 100);
+    REQUIRE(t.Filter(0, CompareOp::kGe, "0").size() == n);
+    REQUIRE(t.Filter(1, CompareOp::kEq, "B").front() == zone);
+    REQUIRE(t.Count(1, CompareOp::kGt, "A") == 2 * zone);
+    REQUIRE(t.Filter(2, CompareOp::kEq, "3").size() == n / 5);
+    REQUIRE(t.Count(3, CompareOp::kNe, "2021") == 2 * zone);
+    REQUIRE(t.Count(4, CompareOp::kNe, "1.5") == 1);
+    REQUIRE(t.Count(4, CompareOp::kEq, "1.5") == n - 1);
+  }
+
+  SECTION("an emptied zone is reset and skipped") {
+    for (unsigned int id = zone; id < 2 * zone; ++id) t.DeleteRowById(id);
+    REQUIRE_FALSE(t.GetZoneMap(0).HasValues(1));
+    REQUIRE(t.Count(1, CompareOp::kEq, "B") == 0);
+    REQUIRE(t.Filter(3, CompareOp::kLt, "2022").size() == zone);
+    t.AddColumn({"extra", DataType::kInt});
+    REQUIRE(t.GetZoneMap(5).HasValues(0));
+    REQUIRE_FALSE(t.GetZoneMap(5).HasValues(1));
+    REQUIRE(t.Count(5, CompareOp::kEq, "0") == 2 * zone);
+  }
+
+  SECTION("copies and deleted columns keep the maps aligned") {
+    DbTable copy(t);
+    copy.DeleteColumnByIdx(0);
+    REQUIRE(copy.GetZoneMap(0).MaxString(0) == "A");
+    REQUIRE(t.GetZoneMap(0).Max(0) == (zone - 1) / 100);
+  }
+}
+
+TEST_CASE("Zone maps are persisted with the checkpoint") {
+  TempDir dir;
+  {
+    Database db;
+    db.Open(dir.path);
+    db.CreateTable("t");
+    DbTable& t = db.GetTable("t");
+    t.AddColumn({"season", DataType::kInt});
+    t.AddColumn({"team", DataType::kString});
+    t.AddRow({"2023", "Henan FC"});
+    t.AddRow({"2024", "Wuhan FC"});
+    db.Checkpoint();
+  }
+  std::ifstream manifest(dir.path + "/manifest.db", std::ios::binary);
+  std::string bytes((std::istreambuf_iterator<char>(manifest)), std::istreambuf_iterator<char>());
+  REQUIRE(bytes.find("Henan FC") != std::string::npos);  // the zone minimum of the team column
+
+  Database db;
+  db.Open(dir.path);
+  DbTable& t = db.GetTable("t");
+  REQUIRE(t.GetZoneMap(0).Min(0) == 2023);
+  REQUIRE(t.GetZoneMap(0).Max(0) == 2024);
+  REQUIRE(t.GetZoneMap(1).MaxString(0) == "Wuhan FC");
+  REQUIRE(t.Filter(0, CompareOp::kGt, "2023") == std::vector<unsigned int>{1});
+}
+
+TEST_CASE("Bitmap helpers work a word at a time") {
+  std::vector<uint64_t> a = {~uint64_t{0}, 0xF0F0, 0xFF, 0x1};
+  std::vector<uint64_t> b = {0x3, 0xFFFF, 0x0F};
+  std::vector<uint64_t> out;
+  AndBitmaps(a, b, out);
+  REQUIRE(out == std::vector<uint64_t>{0x3, 0xF0F0, 0x0F, 0x1});  // missing words of b count as all ones
+  REQUIRE(CountBits(out) == 2 + 8 + 4 + 1);
+  AndBitmaps({}, b, out);
+  REQUIRE(out.empty());
+}
+
+TEST_CASE("NULLs are stored in validity bitmaps") {
+  using Row = std::vector<std::optional<std::string>>;
+  DbTable t;
+  t.AddColumn({"team", DataType::kString});
+  t.AddColumn({"goals", DataType::kInt});
+  t.AddColumn({"xg", DataType::kDouble}, Encoding::kRunLength);
+  t.AddColumn({"coach", DataType::kString}, Encoding::kDictionary);
+  t.AddRow({"Henan FC", "3", "1.5", "Li"});
+  t.AddRow(Row{"Wuhan FC", std::nullopt, std::nullopt, "Wang"});
+  t.AddRow(Row{"Dalian FC", "1", "0.5", std::nullopt});
+  t.AddRow(Row{std::nullopt, "5", "0.5", "Li"});
+
+  REQUIRE(t.IsNull(1, 1));
+  REQUIRE(t.IsNull(1, 2));
+  REQUIRE_FALSE(t.IsNull(0, 1));
+  REQUIRE(t.NullCount(1) == 1);
+  REQUIRE(t.NullCount(3) == 1);
+  REQUIRE(t.GetRow(1) == std::vector<std::string>{"Wuhan FC", "", "", "Wang"});
+  std::ostringstream out;
+  out << t;
+  REQUIRE(out.str().find("Wuhan FC, NULL, NULL, Wang\n") != std::string::npos);
+  REQUIRE_THROWS_AS(t.IsNull(9, 0), std::out_of_range);
+
+  SECTION("NULL never satisfies a comparison") {
+    REQUIRE(t.Filter(1, CompareOp::kNe, "3") == std::vector<unsigned int>{2, 3});
+    REQUIRE(t.Filter(0, CompareOp::kGe, "") == std::vector<unsigned int>{0, 1, 2});
+    REQUIRE(t.Count(2, CompareOp::kLt, "1") == 2);
+    REQUIRE(t.Count(3, CompareOp::kNe, "Li") == 1);
+    REQUIRE(t.FilterNull(1) == std::vector<unsigned int>{1});
+    REQUIRE(t.FilterNull(0) == std::vector<unsigned int>{3});
+    REQUIRE(t.GroupByCount(3) == std::map<std::string, size_t>{{"Li", 2}, {"Wang", 1}});
+  }
+
+  SECTION("aggregates skip NULLs") {
+    REQUIRE(t.Aggregate(1, AggregateFn::kCount) == 3);
+    REQUIRE(t.Aggregate(1, AggregateFn::kSum) == 9);
+    REQUIRE(t.Aggregate(1, AggregateFn::kAvg) == 3);
+    REQUIRE(t.Aggregate(2, AggregateFn::kAvg) == Approx(2.5 / 3));
+    REQUIRE(t.Aggregate(0, AggregateFn::kCount) == 3);
+    t.DeleteRowById(1);
+    REQUIRE(t.NullCount(1) == 0);
+    REQUIRE(t.Aggregate(2, AggregateFn::kCount) == 3);
+  }
+
+  SECTION("zone maps count NULLs and keep them out of the bounds") {
+    const ZoneMap& goals = t.GetZoneMap(1);
+    REQUIRE(goals.NullCount(0) == 1);
+    REQUIRE(goals.Min(0) == 1);
+    REQUIRE_FALSE(goals.AllMatch(0, CompareOp::kGe, 0.0));
+    t.DeleteRowById(1);
+    REQUIRE(goals.NullCount(0) == 0);
+    REQUIRE(t.Filter(1, CompareOp::kGe, "0") == std::vector<unsigned int>{0, 2, 3});
+  }
+
+  SECTION("new columns can default to NULL") {
+    t.AddColumn({"stadium", DataType::kString}, Encoding::kPlain, true);
+    t.AddColumn({"season", DataType::kInt}, Encoding::kCompressed, true);
+    REQUIRE(t.NullCount(4) == 4);
+    REQUIRE(t.NullCount(5) == 4);
+    t.AddRow(Row{"Henan FC", "2", "1", "Li", "Hanghai", "2024"});
+    REQUIRE(t.FilterNull(4).size() == 4);
+    REQUIRE(t.Filter(5, CompareOp::kGe, "0") == std::vector<unsigned int>{4});
+    REQUIRE(t.Aggregate(5, AggregateFn::kMax) == 2024);
+  }
+
+  SECTION("copies keep their own bitmaps") {
+    DbTable copy(t);
+    t.DeleteColumnByIdx(0);
+    REQUIRE(copy.IsNull(3, 0));
+    REQUIRE(t.IsNull(1, 0));
+  }
+}
+
+TEST_CASE("NULLs survive checkpoint and WAL replay") {
+  using Row = std::vector<std::optional<std::string>>;
+  TempDir dir;
+  {
+    Database db;
+    db.Open(dir.path);
+    db.CreateTable("t");
+    DbTable& t = db.GetTable("t");
+    t.AddColumn({"team", DataType::kString});
+    t.AddColumn({"goals", DataType::kInt}, Encoding::kCompressed);
+    t.AddRow({"Henan FC", "3"});
+    db.Checkpoint();
+    t.AddRow(Row{std::nullopt, "4"});  // replayed from the log
+    REQUIRE(t.AllDirty());              // the first NULL changes the layout of every stored chunk
+    db.Checkpoint();
+    t.AddRow(Row{"Wuhan FC", std::nullopt});
+  }
+  Database db;
+  db.Open(dir.path);
+  DbTable& t = db.GetTable("t");
+  REQUIRE(t.FilterNull(0) == std::vector<unsigned int>{1});
+  REQUIRE(t.FilterNull(1) == std::vector<unsigned int>{2});
+  REQUIRE(t.GetZoneMap(0).NullCount(0) == 1);
+  REQUIRE(t.Aggregate(1, AggregateFn::kSum) == 7);
+  REQUIRE(t.GetRow(0) == std::vector<std::string>{"Henan FC", "3"});
+}
+
+TEST_CASE("Fixed-width values parse and format exactly") {
+  REQUIRE(ParseInt64Value(DataType::kInt64, "9007199254740993") == 9007199254740993LL);
+  REQUIRE(ParseInt64Value(DataType::kBool, "TRUE") == 1);
+  REQUIRE(ParseInt64Value(DataType::kBool, "0") == 0);
+  REQUIRE(ParseInt64Value(DataType::kDate, "1970-01-02") == 1);
+  REQUIRE(ParseInt64Value(DataType::kDate, "1969-12-31") == -1);
+  REQUIRE(FormatInt64Value(DataType::kDate, ParseInt64Value(DataType::kDate, "2024-02-29")) == "2024-02-29");
+  REQUIRE(ParseInt64Value(DataType::kTimestamp, "1970-01-01T00:00:01Z") == 1000000);
+  REQUIRE(ParseInt64Value(DataType::kTimestamp, "2024-03-01") ==
+          ParseInt64Value(DataType::kTimestamp, "2024-03-01 00:00:00"));
+  REQUIRE(FormatInt64Value(DataType::kTimestamp, ParseInt64Value(DataType::kTimestamp, "2024-03-01 12:34:56.5")) ==
+          "2024-03-01 12:34:56.500000");
+  REQUIRE(FormatInt64Value(DataType::kTimestamp, -1) == "1969-12-31 23:59:59.999999");
+  REQUIRE(ParseInt64Value(DataType::kDecimal, "12.34") == 123400);
+  REQUIRE(ParseInt64Value(DataType::kDecimal, "-0.00005") == -1);  // rounds half away from zero
+  REQUIRE(FormatInt64Value(DataType::kDecimal, -123456) == "-12.3456");
+  REQUIRE(FormatInt64Value(DataType::kDecimal, 5) == "0.0005");
+
+  REQUIRE_THROWS_AS(ParseInt64Value(DataType::kBool, "yes"), std::invalid_argument);
+  REQUIRE_THROWS_AS(ParseInt64Value(DataType::kDate, "2023-02-29"), std::invalid_argument);
+  REQUIRE_THROWS_AS(ParseInt64Value(DataType::kDate, "2023-1-01"), std::invalid_argument);
+  REQUIRE_THROWS_AS(ParseInt64Value(DataType::kTimestamp, "2023-01-01 24:00:00"), std::invalid_argument);
+  REQUIRE_THROWS_AS(ParseInt64Value(DataType::kDecimal, "1.2.3"), std::invalid_argument);
+  REQUIRE_THROWS_AS(ParseInt64Value(DataType::kInt64, "12abc"), std::invalid_argument);
+  REQUIRE_THROWS_AS(ParseInt64Value(DataType::kDecimal, "99999999999999999999"), std::out_of_range);
+}
+
+TEST_CASE("Fixed-width columns filter and aggregate natively") {
+  using Row = std::vector<std::optional<std::string>>;
+  DbTable t;
+  t.AddColumn({"match", DataType::kInt64});
+  t.AddColumn({"home", DataType::kBool});
+  t.AddColumn({"day", DataType::kDate});
+  t.AddColumn({"kickoff", DataType::kTimestamp});
+  t.AddColumn({"xg", DataType::kDecimal});
+  t.AddRow({"5000000000", "true", "2024-03-01", "2024-03-01 19:35:00", "1.25"});
+  t.AddRow({"5000000001", "false", "2024-03-02", "2024-03-02 15:00:00", "0.5"});
+  t.AddRow(Row{"5000000002", std::nullopt, "2024-03-09", "2024-03-09 20:00:00", std::nullopt});
+  t.AddRow({"5000000003", "1", "2024-03-16", "2024-03-16T17:30:00", "2.0001"});
+
+  REQUIRE(t.GetColumnEncoding(2) == Encoding::kPlain);
+  REQUIRE(dynamic_cast<const BoolColumn*>(t.GetColumn(1)) != nullptr);
+  REQUIRE(t.GetRow(3) == std::vector<std::string>{"5000000003", "true", "2024-03-16", "2024-03-16 17:30:00",
+                                                  "2.0001"});
+  std::ostringstream os;
+  os << t;
+  REQUIRE(os.str().rfind("match(int64), home(bool), day(date), kickoff(timestamp), xg(decimal)\n", 0) == 0);
+  REQUIRE(os.str().find("5000000002, NULL, 2024-03-09, 2024-03-09 20:00:00, NULL") != std::string::npos);
+
+  REQUIRE(t.Filter(0, CompareOp::kGt, "5000000001") == std::vector<unsigned int>{2, 3});
+  REQUIRE(t.Filter(1, CompareOp::kEq, "true") == std::vector<unsigned int>{0, 3});
+  REQUIRE(t.Filter(1, CompareOp::kNe, "true") == std::vector<unsigned int>{1});  // NULL never matches
+  REQUIRE(t.Count(1, CompareOp::kGe, "false") == 3);
+  REQUIRE(t.Filter(2, CompareOp::kLt, "2024-03-09") == std::vector<unsigned int>{0, 1});
+  REQUIRE(t.Filter(3, CompareOp::kGe, "2024-03-02 15:00:00") == std::vector<unsigned int>{1, 2, 3});
+  REQUIRE(t.Filter(3, CompareOp::kLt, "2024-03-09") == std::vector<unsigned int>{0, 1});
+  REQUIRE(t.Filter(4, CompareOp::kEq, "0.50") == std::vector<unsigned int>{1});
+  REQUIRE_THROWS_AS(t.Filter(2, CompareOp::kEq, "March"), std::invalid_argument);
+
+  REQUIRE(t.Aggregate(0, AggregateFn::kMax) == 5000000003.0);
+  REQUIRE(t.Aggregate(1, AggregateFn::kSum) == 2);
+  REQUIRE(t.Aggregate(1, AggregateFn::kCount) == 3);
+  REQUIRE(t.Aggregate(4, AggregateFn::kSum) == Approx(3.7501));
+  REQUIRE(t.Aggregate(4, AggregateFn::kMin) == 0.5);
+  REQUIRE(t.GroupByCount(1) == std::map<std::string, size_t>{{"false", 1}, {"true", 2}});
+  REQUIRE(t.GroupByCount(2).begin()->first == "2024-03-01");
+
+  REQUIRE(t.GetZoneMap(0).MinInteger(0) == 5000000000LL);
+  REQUIRE(t.GetZoneMap(0).AllMatch(0, CompareOp::kGe, int64_t{5000000000}));
+
+  REQUIRE_THROWS_AS(t.AddRow({"1", "maybe", "2024-01-01", "2024-01-01", "0"}), std::invalid_argument);
+  REQUIRE(t.GetRows().size() == 4);
+  REQUIRE(t.Filter(1, CompareOp::kEq, "false") == std::vector<unsigned int>{1});  // the failed row left no bit behind
+  REQUIRE_THROWS_AS(t.AddColumn({"flag", DataType::kBool}, Encoding::kRunLength), std::invalid_argument);
+
+  t.DeleteRowById(0);
+  REQUIRE(t.Filter(1, CompareOp::kEq, "true") == std::vector<unsigned int>{3});
+}
+
+TEST_CASE("Bool columns scan 64 rows per word") {
+  DbTable t;
+  t.AddColumn({"id", DataType::kInt});
+  t.AddRow({"0"});
+  t.DeleteRowById(0);
+  t.AddColumn({"even", DataType::kBool});  // starts at id 1, so words and ids are not aligned
+  for (int i = 1; i < 300; ++i) {
+    t.AddRow({std::to_string(i), i % 2 == 0 ? "true" : "false"});
+  }
+  for (unsigned int id = 10; id < 200; id += 7) {
+    t.DeleteRowById(id);
+  }
+  std::vector<unsigned int> expected;
+  for (const auto& row : t.GetRows()) {
+    if (row[1] == "true") expected.push_back(static_cast<unsigned int>(std::stoi(row[0])));
+  }
+  REQUIRE(t.Filter(1, CompareOp::kEq, "true") == expected);
+  REQUIRE(t.Count(1, CompareOp::kEq, "true") == expected.size());
+  REQUIRE(t.Count(1, CompareOp::kEq, "false") == t.GetRows().size() - expected.size());
+  REQUIRE(t.Aggregate(1, AggregateFn::kSum) == static_cast<double>(expected.size()));
+}
+
+TEST_CASE("Fixed-width columns survive checkpoint and WAL replay") {
+  TempDir dir;
+  {
+    Database db;
+    db.Open(dir.path);
+    db.CreateTable("t");
+    DbTable& t = db.GetTable("t");
+    t.AddColumn({"kickoff", DataType::kTimestamp});
+    t.AddColumn({"home", DataType::kBool});
+    t.AddRow({"2024-03-01 19:35:00.25", "true"});
+    db.Checkpoint();
+    t.AddColumn({"xg", DataType::kDecimal});  // replayed from the log
+    t.AddRow({"2024-03-02 15:00:00", "false", "-1.5"});
+  }
+  Database db;
+  db.Open(dir.path);
+  DbTable& t = db.GetTable("t");
+  REQUIRE(t.GetRows() == std::vector<std::vector<std::string>>{
+      {"2024-03-01 19:35:00.250000", "true", "0.0000"}, {"2024-03-02 15:00:00", "false", "-1.5000"}});
+  REQUIRE(t.Filter(0, CompareOp::kGt, "2024-03-01T19:35:00") == std::vector<unsigned int>{0, 1});
+  REQUIRE(t.GetZoneMap(0).MaxInteger(0) == ParseInt64Value(DataType::kTimestamp, "2024-03-02 15:00:00"));
+}
+
+TEST_CASE("Compact string columns keep short strings inline") {
+  using Row = std::vector<std::optional<std::string>>;
+  DbTable t;
+  t.AddColumn({"team", DataType::kString}, Encoding::kCompact);
+  t.AddColumn({"goals", DataType::kInt});
+  t.AddRow({"Henan FC", "3"});
+  t.AddRow({"Shanghai Shenhua FC", "5"});  // 19 bytes: goes to the heap
+  t.AddRow({"Shanghai Port FC", "2"});
+  t.AddRow(Row{std::nullopt, "1"});
+  t.AddRow({"", "0"});
+  t.AddRow({"Henan FC", "4"});
+
+  const auto* column = dynamic_cast<const CompactStringColumn*>(t.GetColumn(0));
+  REQUIRE(column != nullptr);
+  REQUIRE(t.GetColumnEncoding(0) == Encoding::kCompact);
+  REQUIRE(CompactStringColumn::IsInline(column->Header(0)));
+  REQUIRE_FALSE(CompactStringColumn::IsInline(column->Header(1)));
+  REQUIRE(column->HeapBytes() == std::string("Shanghai Shenhua FC").size() + std::string("Shanghai Port FC").size());
+  REQUIRE(t.GetRow(1) == std::vector<std::string>{"Shanghai Shenhua FC", "5"});
+
+  SECTION("filters agree with std::string comparisons") {
+    REQUIRE(t.Filter(0, CompareOp::kEq, "Henan FC") == std::vector<unsigned int>{0, 5});
+    REQUIRE(t.Filter(0, CompareOp::kEq, "Shanghai Port FC") == std::vector<unsigned int>{2});
+    REQUIRE(t.Filter(0, CompareOp::kEq, "Shanghai Port FX").empty());  // same prefix and length
+    REQUIRE(t.Filter(0, CompareOp::kNe, "Henan FC") == std::vector<unsigned int>{1, 2, 4});
+    REQUIRE(t.Filter(0, CompareOp::kLt, "Shanghai Q") == std::vector<unsigned int>{0, 2, 4, 5});
+    REQUIRE(t.Filter(0, CompareOp::kGt, "Shanghai Port FC") == std::vector<unsigned int>{1});
+    REQUIRE(t.Filter(0, CompareOp::kGe, "Shan") == std::vector<unsigned int>{1, 2});
+    REQUIRE(t.Filter(0, CompareOp::kLe, "") == std::vector<unsigned int>{4});
+    REQUIRE(t.GroupByCount(0) == std::map<std::string, size_t>{
+        {"", 1}, {"Henan FC", 2}, {"Shanghai Port FC", 1}, {"Shanghai Shenhua FC", 1}});
+  }
+
+  SECTION("copies share nothing and failed rows give their heap bytes back") {
+    DbTable copy(t);
+    REQUIRE_THROWS_AS(t.AddRow({"Changchun Yatai FC", "many"}), std::invalid_argument);
+    REQUIRE(column->HeapBytes() == 35);
+    t.DeleteColumnByIdx(0);
+    REQUIRE(copy.GetRows() == std::vector<std::vector<std::string>>{{"Henan FC", "3"}, {"Shanghai Shenhua FC", "5"},
+        {"Shanghai Port FC", "2"}, {"", "1"}, {"", "0"}, {"Henan FC", "4"}});
+  }
+
+  SECTION("the layout survives serialization") {
+    BinaryWriter out;
+    t.Serialize(out);
+    BinaryReader in(out.Data());
+    DbTable loaded;
+    loaded.Deserialize(in);
+    REQUIRE(loaded.GetColumnEncoding(0) == Encoding::kCompact);
+    REQUIRE(loaded.GetRows() == t.GetRows());
+    REQUIRE(loaded.IsNull(3, 0));
+  }
+}
+
+TEST_CASE("Memory usage follows rows, cells and columns") {
+  DbTable t;
+  t.AddColumn({"team", DataType::kString});
+  t.AddColumn({"goals", DataType::kInt});
+  t.AddColumn({"city", DataType::kString}, Encoding::kDictionary);
+  const TableMemory empty = t.MemoryUsage();
+  REQUIRE(empty.columns.size() == 3);
+  REQUIRE(empty.columns[0].data.used == 0);
+  REQUIRE(empty.map_nodes.allocated == 0);
+
+  t.AddRow({"Henan FC", "3", "Zhengzhou"});
+  const TableMemory one = t.MemoryUsage();
+  REQUIRE(one.columns[0].data.used == sizeof(std::string));         // fits in the string object
+  REQUIRE(one.columns[0].data.allocated == AllocatedBytes(sizeof(std::string)));
+  REQUIRE(one.columns[1].data.used == sizeof(int));
+  REQUIRE(one.columns[2].data.used > 0);
+  REQUIRE(one.columns[2].encoding == Encoding::kDictionary);
+  REQUIRE(one.map_nodes.allocated > 0);
+
+  const std::string long_name = "Shanghai Shenhua Football Club";
+  t.AddRow({long_name, "5", "Shanghai"});
+  const TableMemory two = t.MemoryUsage();
+  REQUIRE(two.columns[0].data.used >= 2 * sizeof(std::string) + long_name.size() + 1);
+  REQUIRE(two.unused_row_capacity % (2 * sizeof(void*)) == 0);
+  REQUIRE(two.Total().allocated >= two.Total().used);
+  // one shard with the add_column and add_row histograms, not one for every operation
+  REQUIRE(two.metrics.used > 0);
+  REQUIRE(two.metrics.used < 3 * HistogramSnapshot::kBuckets * sizeof(uint64_t));
+
+  SECTION("copies report the same footprint") {
+    DbTable copy(t);
+    const TableMemory copied = copy.MemoryUsage();
+    REQUIRE(copied.metrics.used == 0);  // metrics are not copied
+    REQUIRE(copied.Total().used == two.Total().used - two.metrics.used);
+  }
+
+  SECTION("deleted rows give their cells back") {
+    t.DeleteRowById(1);
+    REQUIRE(t.MemoryUsage().columns[0].data.used == one.columns[0].data.used);
+    REQUIRE(t.MemoryUsage().columns[1].data.used == one.columns[1].data.used);
+    REQUIRE(t.MemoryUsage().map_nodes.used == one.map_nodes.used);
+  }
+
+  SECTION("dropped columns leave the report") {
+    t.DeleteColumnByIdx(0);
+    const TableMemory dropped = t.MemoryUsage();
+    REQUIRE(dropped.columns.size() == 2);
+    REQUIRE(dropped.columns[0].name == "goals");
+    REQUIRE(dropped.columns[0].data.used == 2 * sizeof(int));
+  }
+
+  SECTION("the report lists every column and the database total") {
+    std::ostringstream os;
+    os << two;
+    REQUIRE(os.str().find("city") != std::string::npos);
+    REQUIRE(os.str().find("dictionary") != std::string::npos);
+    Database db;
+    db.CreateTable("league");
+    db.GetTable("league").AddColumn({"team", DataType::kString}, Encoding::kCompact);
+    db.GetTable("league").AddRow({long_name});
+    const std::string report = db.MemoryReport();
+    REQUIRE(report.find("Table: league") != std::string::npos);
+    REQUIRE(report.find("compact") != std::string::npos);
+    REQUIRE(report.find("metrics") != std::string::npos);
+    REQUIRE(report.find("Database: ") != std::string::npos);
+  }
+}
+
+TEST_CASE("Latency histograms bound every percentile within a sub-bucket") {
+  for (uint64_t ns : {0ull, 15ull, 16ull, 31ull, 32ull, 1000ull, 123456789ull, (1ull << 39) + 5}) {
+    const size_t bucket = HistogramSnapshot::BucketOf(ns);
+    REQUIRE(HistogramSnapshot::BucketUpper(bucket) >= ns);
+    REQUIRE(HistogramSnapshot::BucketUpper(bucket) - ns <= ns / HistogramSnapshot::kSubBuckets);
+    if (bucket > 0) REQUIRE(HistogramSnapshot::BucketUpper(bucket - 1) < ns);
+  }
+  REQUIRE(HistogramSnapshot::BucketOf(~0ull) == HistogramSnapshot::kBuckets - 1);
+
+  Metrics metrics;
+  for (uint64_t ns = 1; ns <= 1000; ++ns) metrics.Record(MetricOp::kScan, ns * 1000, ns == 1000);
+  const MetricsSnapshot snapshot = metrics.Snapshot();
+  const OpMetrics& scans = snapshot[MetricOp::kScan];
+  REQUIRE(scans.latency.count == 1000);
+  REQUIRE(scans.errors == 1);
+  REQUIRE(scans.latency.max_ns == 1000000);
+  REQUIRE(scans.latency.Mean() == Approx(500500));
+  REQUIRE(scans.latency.Percentile(50) >= 500000);
+  REQUIRE(scans.latency.Percentile(50) <= 500000 * 17 / 16);
+  REQUIRE(scans.latency.Percentile(100) == 1000000);
+  REQUIRE(metrics.Snapshot()[MetricOp::kAddRow].latency.count == 0);
+}
+
+TEST_CASE("Tables and databases count their operations") {
+  Database db;
+  db.CreateTable("league");
+  DbTable& t = db.GetTable("league");
+  t.AddColumn({"team", DataType::kString});
+  t.AddColumn({"goals", DataType::kInt}, Encoding::kCompressed);
+  for (int i = 0; i < 100; ++i) t.AddRow({"team" + std::to_string(i % 10), std::to_string(i)});
+  REQUIRE_THROWS_AS(t.AddRow({"team", "many"}), std::invalid_argument);
+  t.DeleteRowById(0);
+  REQUIRE(t.Count(0, CompareOp::kEq, "team3") == 10);  // one scan, not two
+  t.GroupByCount(0);
+  t.GetRows();
+  REQUIRE_THROWS_AS(db.GetTable("cup"), std::out_of_range);
+
+  std::vector<std::thread> readers;
+  for (int r = 0; r < 4; ++r) {
+    readers.emplace_back([&t]() {
+      for (int i = 0; i < 50; ++i) t.Filter(1, CompareOp::kGe, "50");
+    });
+  }
+  for (std::thread& reader : readers) reader.join();
+
+  const MetricsSnapshot table = t.GetMetrics();
+  REQUIRE(table[MetricOp::kAddColumn].latency.count == 2);
+  REQUIRE(table[MetricOp::kAddRow].latency.count == 101);
+  REQUIRE(table[MetricOp::kAddRow].errors == 1);
+  REQUIRE(table[MetricOp::kDeleteRow].latency.count == 1);
+  REQUIRE(table[MetricOp::kScan].latency.count == 202);
+  REQUIRE(table[MetricOp::kExport].latency.count == 1);
+
+  const MetricsSnapshot all = db.GetMetrics();
+  REQUIRE(all[MetricOp::kCreateTable].latency.count == 1);
+  REQUIRE(all[MetricOp::kCatalogLookup].latency.count == 2);
+  REQUIRE(all[MetricOp::kCatalogLookup].errors == 1);
+  REQUIRE(all[MetricOp::kScan].latency.count == 202);
+
+  const std::string text = db.MetricsText();
+  REQUIRE(text.find("db_ops_total{scope=\"catalog\",op=\"catalog_lookup\"} 2\n") != std::string::npos);
+  REQUIRE(text.find("db_ops_total{scope=\"table:league\",op=\"add_row\"} 101\n") != std::string::npos);
+  REQUIRE(text.find("db_op_errors_total{scope=\"table:league\",op=\"add_row\"} 1\n") != std::string::npos);
+  REQUIRE(text.find("op=\"scan\",quantile=\"0.99\"}") != std::string::npos);
+  REQUIRE(text.find("drop_table") == std::string::npos);  // never ran
+
+  DbTable copy(t);
+  REQUIRE(copy.GetMetrics()[MetricOp::kAddRow].latency.count == 0);
+}
+
+TEST_CASE("Query traces record every operator of a scan") {
+  DbTable t;
+  t.AddColumn({"team", DataType::kString});
+  t.AddColumn({"goals", DataType::kInt}, Encoding::kCompressed);
+  for (int i = 0; i < 100; ++i) t.AddRow({"team" + std::to_string(i % 10), std::to_string(i)});
+
+  REQUIRE(QueryTrace::Active() == nullptr);
+  t.Filter(0, CompareOp::kEq, "team3");  // untraced
+
+  QueryTrace trace;
+  {
+    TraceScope scope(&trace);
+    REQUIRE(QueryTrace::Active() == &trace);
+    TraceSpan query("Query");
+    REQUIRE(t.Filter(0, CompareOp::kEq, "team3").size() == 10);
+    REQUIRE(t.Count(1, CompareOp::kGe, "1000") == 0);  // pruned by the zone map
+    t.Aggregate(1, AggregateFn::kSum);
+    t.GroupByCount(0);
+  }
+  REQUIRE(QueryTrace::Active() == nullptr);
+
+  const std::vector<QueryTrace::Span>& spans = trace.Spans();
+  std::vector<std::string> names;
+  for (const QueryTrace::Span& span : spans) names.push_back(span.name);
+  REQUIRE(names == std::vector<std::string>{"Query", "Filter", "ZonePrune", "RowScan", "Count", "ZonePrune",
+                                            "ColumnScan", "Aggregate", "GroupByCount"});
+  REQUIRE(spans[0].parent == -1);
+  REQUIRE(spans[1].parent == 0);
+  REQUIRE(spans[2].parent == 1);
+  REQUIRE(spans[3].parent == 1);
+
+  const QueryTrace::Span* filter = trace.Find("Filter");
+  REQUIRE(filter->detail == "team = team3");
+  REQUIRE(filter->rows_in == 100);
+  REQUIRE(filter->rows_out == 10);
+  REQUIRE(spans[3].rows_in == 100);
+  REQUIRE(spans[3].bytes > 0);
+  REQUIRE(spans[0].wall_ns >= filter->wall_ns);
+  REQUIRE(spans[5].rows_out == 0);  // no zone can hold goals >= 1000
+  REQUIRE(spans[6].rows_in == 0);
+  REQUIRE(trace.Find("Aggregate")->detail == "sum(goals)");
+  REQUIRE(trace.Find("GroupByCount")->rows_out == 10);
+
+  std::ostringstream text;
+  trace.Print(text);
+  REQUIRE(text.str().find("\n  Filter (team = team3)  rows 100 -> 10") != std::string::npos);
+  REQUIRE(text.str().find("\n    RowScan  rows 100 -> 10") != std::string::npos);
+
+  std::ostringstream json;
+  trace.WriteChromeTrace(json);
+  REQUIRE(json.str().rfind("{\"traceEvents\":[", 0) == 0);
+  REQUIRE(json.str().find("{\"name\":\"ColumnScan\",\"cat\":\"operator\",\"ph\":\"X\"") != std::string::npos);
+  REQUIRE(json.str().find("\"rows_in\":100,\"rows_out\":10") != std::string::npos);
+
+  trace.Clear();
+  REQUIRE(trace.Spans().empty());
+}
+
+TEST_CASE("HyperLogLog estimates distinct counts within a few percent") {
+  HyperLogLog small;
+  for (int i = 0; i < 100; ++i) small.Add(HyperLogLog::Hash(static_cast<double>(i % 10)));
+  REQUIRE(small.Estimate() == Approx(10).epsilon(0.05));
+
+  HyperLogLog a, b;
+  for (int i = 0; i < 100000; ++i) {
+    a.Add(HyperLogLog::Hash("team" + std::to_string(i)));
+    b.Add(HyperLogLog::Hash("team" + std::to_string(i + 50000)));
+  }
+  REQUIRE(a.Estimate() == Approx(100000).epsilon(0.05));
+  a.Merge(b);
+  REQUIRE(a.Estimate() == Approx(150000).epsilon(0.05));
+  REQUIRE(HyperLogLog::Hash(0.0) == HyperLogLog::Hash(-0.0));
+}
+
+TEST_CASE("Column statistics estimate selectivities") {
+  DbTable t;
+  t.AddColumn({"team", DataType::kString}, Encoding::kDictionary);
+  t.AddColumn({"goals", DataType::kInt});
+  t.AddColumn({"played", DataType::kDate});
+  // "Henan FC" is half of the rows, the other teams share the rest; goals are uniform over 0..999.
+  for (int i = 0; i < 10000; ++i) {
+    const std::string team = i % 2 == 0 ? "Henan FC" : "team" + std::to_string(i % 100);
+    t.AddRow(std::vector<std::optional<std::string>>{team, std::to_string(i % 1000),
+                                                     i % 10 == 0 ? std::nullopt : std::optional<std::string>("2024-03-01")});
+  }
+
+  SECTION("inserts alone keep distinct counts and ranges") {
+    REQUIRE_FALSE(t.GetColumnStats(0).Analyzed());
+    REQUIRE(t.EstimateDistinct(0) == Approx(51).epsilon(0.05));
+    REQUIRE(t.EstimateDistinct(1) == Approx(1000).epsilon(0.05));
+    REQUIRE(t.EstimateSelectivity(1, CompareOp::kLt, "250") == Approx(0.25).margin(0.01));
+    REQUIRE(t.EstimateSelectivity(1, CompareOp::kGt, "5000") == 0);
+    REQUIRE(t.GetColumnStats(1).ModifiedSinceAnalyze() == 10000);
+  }
+
+  SECTION("analyze builds histograms and most common values") {
+    t.Analyze();
+    const ColumnStats& team = t.GetColumnStats(0);
+    REQUIRE(team.Analyzed());
+    REQUIRE(team.ModifiedSinceAnalyze() == 0);
+    REQUIRE(team.Strings().MostCommon().front() == std::make_pair(std::string("Henan FC"), uint64_t{5000}));
+    REQUIRE(t.EstimateSelectivity(0, CompareOp::kEq, "Henan FC") == Approx(0.5));
+    REQUIRE(t.EstimateSelectivity(0, CompareOp::kEq, "team7") == Approx(0.01).margin(0.005));
+    REQUIRE(t.EstimateSelectivity(0, CompareOp::kEq, "zebra") == 0);  // past the max
+    REQUIRE(t.EstimateSelectivity(0, CompareOp::kNe, "Henan FC") == Approx(0.5));
+
+    REQUIRE(t.GetColumnStats(1).Numbers().BucketCount() == ValueStats<double>::kHistogramBuckets);
+    for (int bound : {100, 500, 900}) {
+      const double actual = static_cast<double>(t.Count(1, CompareOp::kLe, std::to_string(bound))) / 10000;
+      REQUIRE(t.EstimateSelectivity(1, CompareOp::kLe, std::to_string(bound)) == Approx(actual).margin(0.02));
+    }
+    REQUIRE(t.EstimateSelectivity(2, CompareOp::kEq, "2024-03-01") == Approx(0.9));  // NULLs never match
+
+    // inserts after analyze land in the existing buckets
+    for (int i = 0; i < 10000; ++i) t.AddRow({"Henan FC", "5", "2024-03-02"});
+    REQUIRE(t.EstimateSelectivity(0, CompareOp::kEq, "Henan FC") == Approx(0.75));
+    REQUIRE(t.EstimateSelectivity(1, CompareOp::kLt, "500") == Approx(0.75).margin(0.02));
+    REQUIRE(t.GetColumnStats(0).ModifiedSinceAnalyze() == 10000);
+    t.Analyze();
+    REQUIRE(t.EstimateSelectivity(1, CompareOp::kEq, "5") == Approx(10010.0 / 20000));
+  }
+
+  SECTION("join selectivity uses the larger distinct count") {
+    DbTable teams;
+    teams.AddColumn({"name", DataType::kString});
+    for (int i = 0; i < 100; ++i) teams.AddRow({"team" + std::to_string(i)});
+    REQUIRE(DbTable::EstimateJoinSelectivity(t, 0, teams, 0) == Approx(0.01).epsilon(0.05));
+  }
+
+  SECTION("statistics follow copies and schema changes") {
+    t.Analyze();
+    DbTable copy(t);
+    REQUIRE(copy.EstimateSelectivity(0, CompareOp::kEq, "Henan FC") == Approx(0.5));
+    copy.DeleteColumnByIdx(0);
+    REQUIRE(copy.EstimateDistinct(0) == Approx(1000).epsilon(0.05));
+    copy.AddColumn({"season", DataType::kInt});
+    REQUIRE(copy.EstimateSelectivity(2, CompareOp::kEq, "0") == Approx(1).epsilon(0.01));
+    REQUIRE_THROWS_AS(copy.GetColumnStats(3), std::out_of_range);
+    REQUIRE(t.MemoryUsage().columns[0].stats.used > 0);
+  }
+}
+
+TEST_CASE("ParseSql builds statements and reports syntax errors", "[sql]") {
+  Statement select = ParseSql(
+      "select t.name, COUNT(*) AS n FROM teams t JOIN goals g ON t.id = g.team_id "
+      "WHERE g.minute >= 45 and not g.own_goal GROUP BY t.name HAVING COUNT(*) > 1 ORDER BY n DESC LIMIT 3 OFFSET 1;");
+  REQUIRE(select.kind == StatementKind::kSelect);
+  REQUIRE(select.select.items.size() == 2);
+  REQUIRE(select.select.items[1].alias == "n");
+  REQUIRE(select.select.from.size() == 2);
+  REQUIRE(select.select.from[0].alias == "t");
+  REQUIRE(select.select.from[1].on->ToString() == "(t.id = g.team_id)");
+  REQUIRE(select.select.where->ToString() == "((g.minute >= 45) AND NOT g.own_goal)");
+  REQUIRE(select.select.order_by[0].descending);
+  REQUIRE(*select.select.limit == 3);
+  REQUIRE(select.select.offset == 1);
+
+  Statement insert = ParseSql("INSERT INTO \"Goal Log\" (player, minute) VALUES ('O''Neil', -3), ('Wu', 1.5e1)");
+  REQUIRE(insert.table == "Goal Log");
+  REQUIRE(insert.values.size() == 2);
+  REQUIRE(insert.values[0][0]->literal.text == "O'Neil");
+  REQUIRE(insert.values[0][1]->literal.integer == -3);
+  REQUIRE(insert.values[1][1]->literal.number == 15);
+
+  Statement create = ParseSql("CREATE TABLE IF NOT EXISTS t (name VARCHAR(20) ENCODING DICTIONARY, day DATE)");
+  REQUIRE(create.if_not_exists);
+  REQUIRE(create.column_defs[0].encoding == Encoding::kDictionary);
+  REQUIRE(create.column_defs[1].type == DataType::kDate);
+  REQUIRE(ParseSql("drop table if exists t").if_exists);
+  REQUIRE(ParseSql("EXPLAIN SELECT * FROM t").explain);
+
+  REQUIRE_THROWS_AS(ParseSql("SELECT FROM t"), std::invalid_argument);
+  REQUIRE_THROWS_AS(ParseSql("SELECT a FROM t WHERE"), std::invalid_argument);
+  REQUIRE_THROWS_AS(ParseSql("SELECT 'open FROM t"), std::invalid_argument);
+  REQUIRE_THROWS_AS(ParseSql("SELECT a FROM t extra words"), std::invalid_argument);
+  REQUIRE_THROWS_AS(ParseSql("CREATE TABLE t (a BLOB)"), std::invalid_argument);
+}
+
+TEST_CASE("Database::Execute runs DDL, INSERT and DELETE", "[sql]") {
+  Database db;
+  db.Execute("CREATE TABLE players (name TEXT ENCODING COMPACT, team TEXT ENCODING DICTIONARY, goals INT, "
+             "rating DOUBLE, born DATE, salary DECIMAL)");
+  DbTable& players = db.GetTable("players");
+  REQUIRE(players.GetColumnDescriptions().size() == 6);
+  REQUIRE(players.GetColumnEncoding(1) == Encoding::kDictionary);
+
+  QueryResult inserted = db.Execute(
+      "INSERT INTO players VALUES ('Wu Lei', 'Shanghai', 20, 7.5, '1991-11-19', 1.25), "
+      "('Zhang Yuning', 'Beijing', 9, 6.8, '1997-01-05', 2), ('Nobody', NULL, NULL, NULL, NULL, NULL)");
+  REQUIRE(inserted.affected == 3);
+  REQUIRE(players.GetRow(0) == std::vector<std::string>{"Wu Lei", "Shanghai", "20", "7.500000", "1991-11-19",
+                                                         "1.2500"});
+  REQUIRE(players.IsNull(2, 1));
+  db.Execute("INSERT INTO players (goals, name) VALUES (4, 'Partial')");
+  REQUIRE(players.GetRow(3)[0] == "Partial");
+  REQUIRE(players.IsNull(3, 4));
+
+  // a bad value in any row adds nothing
+  REQUIRE_THROWS_AS(db.Execute("INSERT INTO players (name, goals) VALUES ('a', 1), ('b', 'many')"),
+                    std::invalid_argument);
+  REQUIRE_THROWS_AS(db.Execute("INSERT INTO players (name, goals) VALUES ('a', 1.5)"), std::invalid_argument);
+  REQUIRE_THROWS_AS(db.Execute("INSERT INTO players (name) VALUES ('a', 'b')"), std::invalid_argument);
+  REQUIRE(players.RowCount() == 4);
+
+  REQUIRE(db.Execute("DELETE FROM players WHERE goals < 10 OR goals IS NULL").affected == 3);
+  REQUIRE(players.RowCount() == 1);
+  REQUIRE(db.Execute("DELETE FROM players").affected == 1);
+  REQUIRE(players.RowCount() == 0);
+
+  REQUIRE_THROWS_AS(db.Execute("CREATE TABLE players (a INT)"), std::invalid_argument);
+  REQUIRE_NOTHROW(db.Execute("CREATE TABLE IF NOT EXISTS players (a INT)"));
+  REQUIRE_THROWS_AS(db.Execute("CREATE TABLE bad (a INT ENCODING DICTIONARY)"), std::invalid_argument);
+  REQUIRE_FALSE(db.HasTable("bad"));
+  db.Execute("DROP TABLE players");
+  REQUIRE_FALSE(db.HasTable("players"));
+  REQUIRE_NOTHROW(db.Execute("DROP TABLE IF EXISTS players"));
+  REQUIRE_THROWS_AS(db.Execute("DROP TABLE players"), std::out_of_range);
+}
+
+namespace {
+Database SoccerDatabase() {
+  Database db;
+  db.Execute("CREATE TABLE teams (id INT, name TEXT, city TEXT ENCODING DICTIONARY)");
+  db.Execute("INSERT INTO teams VALUES (1, 'Shanghai Port', 'Shanghai'), (2, 'Beijing Guoan', 'Beijing'), "
+             "(3, 'Shandong Taishan', 'Jinan'), (4, 'Empty FC', NULL)");
+  db.Execute("CREATE TABLE players (name TEXT, team_id INT, goals INT, games INT, rating DOUBLE)");
+  db.Execute("INSERT INTO players VALUES ('Wu Lei', 1, 20, 28, 7.5), ('Oscar', 1, 9, 25, 7.9), "
+             "('Zhang Yuning', 2, 9, 30, 6.8), ('Fabio', 2, 12, 20, NULL), ('Cryzan', 3, 15, 29, 7.1), "
+             "('Free Agent', NULL, 0, 0, NULL)");
+  return db;
+}
+}  // namespace
+
+TEST_CASE("Database::Execute answers SELECT queries", "[sql]") {
+  Database db = SoccerDatabase();
+
+  SECTION("projection, filters and ordering") {
+    QueryResult result = db.Execute("SELECT name, goals * 2 AS double_goals FROM players "
+                                    "WHERE goals >= 9 AND rating > 7 ORDER BY goals DESC, name");
+    REQUIRE(result.columns == std::vector<std::string>{"name", "double_goals"});
+    REQUIRE(result.types[1] == DataType::kInt64);
+    REQUIRE(result.StringRows() == std::vector<std::vector<std::string>>{
+                                       {"Wu Lei", "40"}, {"Cryzan", "30"}, {"Oscar", "18"}});
+    REQUIRE(db.Execute("SELECT * FROM teams").columns.size() == 3);
+    REQUIRE(db.Execute("SELECT name FROM players WHERE rating IS NULL ORDER BY 1").StringRows() ==
+            std::vector<std::vector<std::string>>{{"Fabio"}, {"Free Agent"}});
+    // NULL ratings are neither > 7 nor <= 7
+    REQUIRE(db.Execute("SELECT name FROM players WHERE rating > 7 OR rating <= 7").rows.size() == 4);
+    REQUIRE(db.Execute("SELECT name FROM players WHERE NOT (rating > 7)").rows.size() == 1);
+    // sorted by a column that is not selected, then limited
+    REQUIRE(db.Execute("SELECT name FROM players ORDER BY games DESC LIMIT 2 OFFSET 1").StringRows() ==
+            std::vector<std::vector<std::string>>{{"Cryzan"}, {"Wu Lei"}});
+  }
+
+  SECTION("arithmetic follows SQL types and NULLs") {
+    QueryResult result = db.Execute("SELECT goals / games, goals % 7, rating / 0, goals / 0.5 FROM players "
+                                    "WHERE name = 'Wu Lei'");
+    REQUIRE(result.rows[0][0].integer == 0);  // integer division
+    REQUIRE(result.rows[0][1].integer == 6);
+    REQUIRE(result.rows[0][2].null);          // division by zero
+    REQUIRE(result.rows[0][3].number == 40);
+    REQUIRE_THROWS_AS(db.Execute("SELECT name + 1 FROM players"), std::invalid_argument);
+  }
+
+  SECTION("aggregates and GROUP BY") {
+    QueryResult totals = db.Execute("SELECT COUNT(*), COUNT(rating), SUM(goals), AVG(goals), MIN(name), MAX(rating) "
+                                    "FROM players");
+    REQUIRE(totals.StringRows() == std::vector<std::vector<std::string>>{
+                                       {"6", "4", "65", "10.833333333333334", "Cryzan", "7.9"}});
+    REQUIRE(db.Execute("SELECT COUNT(*), SUM(goals) FROM players WHERE goals > 100").StringRows() ==
+            std::vector<std::vector<std::string>>{{"0", ""}});
+
+    QueryResult groups = db.Execute("SELECT team_id, COUNT(*) AS n, SUM(goals) FROM players "
+                                    "GROUP BY team_id HAVING COUNT(*) > 1 ORDER BY SUM(goals) DESC");
+    REQUIRE(groups.StringRows() == std::vector<std::vector<std::string>>{{"1", "2", "29"}, {"2", "2", "21"}});
+    REQUIRE(db.Execute("SELECT team_id FROM players GROUP BY team_id").rows.size() == 4);  // NULL is one group
+    REQUIRE_THROWS_AS(db.Execute("SELECT name, COUNT(*) FROM players GROUP BY team_id"), std::invalid_argument);
+    REQUIRE_THROWS_AS(db.Execute("SELECT name FROM players WHERE COUNT(*) > 1"), std::invalid_argument);
+  }
+
+  SECTION("joins") {
+    QueryResult joined = db.Execute("SELECT t.name, p.name FROM players p JOIN teams t ON p.team_id = t.id "
+                                    "WHERE t.city <> 'Jinan' ORDER BY p.goals DESC");
+    REQUIRE(joined.StringRows() == std::vector<std::vector<std::string>>{
+                                       {"Shanghai Port", "Wu Lei"}, {"Beijing Guoan", "Fabio"},
+                                       {"Shanghai Port", "Oscar"}, {"Beijing Guoan", "Zhang Yuning"}});
+    QueryResult per_city = db.Execute("SELECT city, SUM(goals) FROM teams JOIN players ON id = team_id "
+                                      "GROUP BY city ORDER BY city");
+    REQUIRE(per_city.StringRows() == std::vector<std::vector<std::string>>{
+                                         {"Beijing", "21"}, {"Jinan", "15"}, {"Shanghai", "29"}});
+    // non-equality conditions run as a nested loop join
+    REQUIRE(db.Execute("SELECT a.name, b.name FROM players a JOIN players b ON a.goals < b.goals "
+                       "WHERE b.name = 'Cryzan'").rows.size() == 4);
+    REQUIRE(db.Execute("SELECT * FROM teams, players").rows.size() == 24);
+    REQUIRE_THROWS_AS(db.Execute("SELECT name FROM teams JOIN players ON id = team_id"), std::invalid_argument);
+    REQUIRE_THROWS_AS(db.Execute("SELECT x FROM teams"), std::invalid_argument);
+    REQUIRE_THROWS_AS(db.Execute("SELECT * FROM nowhere"), std::out_of_range);
+  }
+}
+
+TEST_CASE("SQL plans push single-table predicates into the scan", "[sql]") {
+  Database db = SoccerDatabase();
+  db.Execute("CREATE TABLE matches (day DATE, home INT ENCODING COMPRESSED, score INT)");
+  DbTable& matches = db.GetTable("matches");
+  for (int i = 0; i < 3000; ++i) {
+    matches.AddRow({FormatInt64Value(DataType::kDate, 19000 + i / 10), std::to_string(i % 4 + 1),
+                    std::to_string(i % 5)});
+  }
+
+  QueryResult plan = db.Execute("EXPLAIN SELECT home, COUNT(*) FROM matches "
+                                "WHERE day >= '2022-01-01' AND score > 2.5 AND home = 1 GROUP BY home");
+  std::string text;
+  for (const auto& row : plan.StringRows()) text += row[0] + "\n";
+  INFO(text);
+  REQUIRE(text.find("Scan matches [day, home, score] where ") != std::string::npos);
+  REQUIRE(text.find("home = 1") != std::string::npos);
+  REQUIRE(text.find("day >= 2022-01-01") != std::string::npos);
+  REQUIRE(text.find("Filter (matches.score > 2.5)") != std::string::npos);  // 2.5 does not fit the int column
+  REQUIRE(text.find("Aggregate group by matches.home") != std::string::npos);
+
+  QueryResult counted = db.Execute("SELECT home, COUNT(*) FROM matches "
+                                   "WHERE day >= '2022-01-01' AND score > 2.5 AND home = 1 GROUP BY home");
+  size_t expected = 0;
+  for (int i = 0; i < 3000; ++i) {
+    if (19000 + i / 10 >= 18993 && i % 5 > 2 && i % 4 == 0) ++expected;
+  }
+  REQUIRE(counted.rows.size() == 1);
+  REQUIRE(counted.rows[0][1].integer == static_cast<int64_t>(expected));
+
+  QueryTrace trace;
+  {
+    TraceScope scope(&trace);
+    db.Execute("SELECT COUNT(*) FROM matches WHERE day < '2022-01-03'");
+  }
+  const QueryTrace::Span* query = trace.Find("Query");
+  const QueryTrace::Span* filter = trace.Find("Filter");
+  REQUIRE(query != nullptr);
+  REQUIRE(filter != nullptr);
+  REQUIRE(trace.Spans()[static_cast<size_t>(filter->parent)].name == "Query");
+  REQUIRE(query->rows_out == 1);
+
+  REQUIRE(db.Execute("EXPLAIN SELECT p.name FROM players p JOIN teams t ON p.team_id = t.id")
+              .StringRows()[1][0].find("HashJoin p.team_id = t.id") != std::string::npos);
+  REQUIRE_THROWS_AS(db.Execute("SELECT * FROM matches WHERE day = 'soon'"), std::invalid_argument);
+}
+
+namespace {
+// Rows of a SELECT planned with or without the optimizer, as sorted text.
+std::vector<std::string> RunSelect(Database& db, const std::string& sql, bool optimize) {
+  PlannerOptions options;
+  options.optimize = optimize;
+  PlanPtr plan = PlanSelect(ParseSql(sql).select, db, options);
+  std::unique_ptr<Operator> root = BuildOperator(*plan);
+  root->Open();
+  std::vector<std::string> rows;
+  Row row;
+  while (root->Next(row)) {
+    std::string line;
+    for (const Value& value : row) line += value.ToString() + "|";
+    rows.push_back(line);
+  }
+  std::sort(rows.begin(), rows.end());
+  return rows;
+}
+}  // namespace
+
+TEST_CASE("The optimizer orders joins by cost and pushes filters below them", "[sql][optimizer]") {
+  Database db;
+  db.Execute("CREATE TABLE sales (store_id INT, product_id INT, amount INT)");
+  db.Execute("CREATE TABLE stores (id INT, region TEXT ENCODING DICTIONARY)");
+  db.Execute("CREATE TABLE products (id INT, category TEXT)");
+  DbTable& sales = db.GetTable("sales");
+  for (int i = 0; i < 4000; ++i) {
+    sales.AddRow({std::to_string(i % 40), std::to_string(i % 300), std::to_string(i % 17)});
+  }
+  for (int i = 0; i < 40; ++i) {
+    db.GetTable("stores").AddRow({std::to_string(i), i % 4 == 0 ? "north" : "south"});
+  }
+  for (int i = 0; i < 300; ++i) {
+    db.GetTable("products").AddRow({std::to_string(i), "c" + std::to_string(i % 30)});
+  }
+
+  const std::string star = "SELECT s.region, p.category, SUM(f.amount) FROM sales f "
+                           "JOIN stores s ON f.store_id = s.id JOIN products p ON f.product_id = p.id "
+                           "WHERE s.region = 'north' AND p.category = 'c8' AND f.amount > 3 "
+                           "GROUP BY s.region, p.category";
+  std::string text;
+  for (const auto& row : db.Execute("EXPLAIN " + star).StringRows()) text += row[0] + "\n";
+  INFO(text);
+  // Every single-table condition is applied by its scan, nothing is filtered above the joins.
+  REQUIRE(text.find("stores AS s [id, region] where region = 'north'") != std::string::npos);
+  REQUIRE(text.find("products AS p [id, category] where category = 'c8'") != std::string::npos);
+  REQUIRE(text.find("sales AS f [store_id, product_id, amount] where amount > 3") != std::string::npos);
+  REQUIRE(text.find("Filter (") == std::string::npos);
+  // The fact table is the probe side of both hash joins: the dimensions are built.
+  REQUIRE(text.find("  HashJoin") != std::string::npos);
+  REQUIRE(text.find("(est. ") < text.find("Scan sales"));
+  REQUIRE(text.rfind("Scan sales") < text.rfind("Scan stores"));
+  REQUIRE(text.rfind("Scan sales") < text.rfind("Scan products"));
+
+  const std::vector<std::string> queries = {
+      star,
+      "SELECT * FROM sales f JOIN stores s ON f.store_id = s.id WHERE s.region = 'south' AND f.amount = 16",
+      "SELECT s.id, p.id FROM stores s, products p WHERE s.id = p.id - 250 AND s.region = 'north'",
+      "SELECT COUNT(*) FROM sales f, stores s WHERE f.store_id < s.id AND s.id < 3 AND 1 = 1",
+      "SELECT p.category, COUNT(*) FROM products p JOIN sales f ON f.product_id = p.id AND f.store_id = 5 "
+      "JOIN stores s ON s.id = f.store_id GROUP BY p.category",
+  };
+  for (const std::string& query : queries) {
+    INFO(query);
+    const std::vector<std::string> optimized = RunSelect(db, query, true);
+    REQUIRE(!optimized.empty());
+    REQUIRE(optimized == RunSelect(db, query, false));
+  }
+  // SELECT * keeps FROM order whatever order the joins run in.
+  REQUIRE(db.Execute("SELECT * FROM sales f JOIN stores s ON f.store_id = s.id WHERE s.id = 1").columns ==
+          std::vector<std::string>{"store_id", "product_id", "amount", "id", "region"});
+}
+
+TEST_CASE("The optimizer plans long join chains greedily", "[sql][optimizer]") {
+  Database db;
+  const int tables = 12;
+  std::string query = "SELECT COUNT(*), SUM(t11.v) FROM t0";
+  for (int t = 0; t < tables; ++t) {
+    const std::string name = "t" + std::to_string(t);
+    db.Execute("CREATE TABLE " + name + " (id INT, v INT)");
+    for (int i = 0; i < 20 + 10 * t; ++i) {
+      db.GetTable(name).AddRow({std::to_string(i), std::to_string(i % (t + 2))});
+    }
+    if (t > 0) query += " JOIN " + name + " ON t" + std::to_string(t - 1) + ".id = " + name + ".id";
+  }
+  query += " WHERE t5.v = 1";
+
+  QueryResult result = db.Execute(query);
+  int64_t count = 0;
+  int64_t sum = 0;
+  for (int i = 0; i < 20; ++i) {
+    if (i % 7 != 1) continue;
+    ++count;
+    sum += i % 13;
+  }
+  REQUIRE(result.rows[0][0].integer == count);
+  REQUIRE(result.rows[0][1].integer == sum);
+  const std::string plan = db.Execute("EXPLAIN " + query).StringRows()[2][0];
+  REQUIRE(plan.find("Join") != std::string::npos);
+
+  std::string cross = "SELECT COUNT(*) FROM t0 a";
+  for (int t = 1; t < 65; ++t) cross += ", t0 x" + std::to_string(t);
+  REQUIRE_THROWS_AS(db.Execute(cross), std::invalid_argument);
+}
+
+TEST_CASE("The optimizer chooses lookups and scan access paths", "[sql][optimizer]") {
+  Database db;
+  db.Execute("CREATE TABLE events (id INT, kind INT)");
+  db.Execute("CREATE TABLE picks (event_id INT, note TEXT)");
+  DbTable& events = db.GetTable("events");
+  for (int i = 0; i < 140000; ++i) {
+    events.AddRow({std::to_string(i), std::to_string(i % 7)});
+  }
+  db.Execute("INSERT INTO picks VALUES (5, 'first'), (131072, 'late'), (-1, 'missing')");
+
+  const std::string lookup = "SELECT p.note, e.kind FROM picks p JOIN events e ON p.event_id = e.id WHERE e.kind > 1";
+  std::string text;
+  for (const auto& row : db.Execute("EXPLAIN " + lookup).StringRows()) text += row[0] + "\n";
+  INFO(text);
+  REQUIRE(text.find("LookupJoin p.event_id = e.id") != std::string::npos);
+  REQUIRE(text.find("  Scan events AS e [id, kind] where kind > 1") != std::string::npos);
+  REQUIRE(RunSelect(db, lookup, true) == std::vector<std::string>{"first|5|", "late|4|"});
+  REQUIRE(RunSelect(db, lookup, false) == RunSelect(db, lookup, true));
+
+  // A key that prunes all but one zone goes through DbTable::Filter; one that matches most rows is read in order.
+  REQUIRE(db.Execute("EXPLAIN SELECT kind FROM events WHERE id = 70000").StringRows()[1][0].find(
+              "FilterScan events [id, kind] where id = 70000") != std::string::npos);
+  REQUIRE(db.Execute("EXPLAIN SELECT kind FROM events WHERE kind >= 1 AND id > 10").StringRows()[1][0].find(
+              "  Scan events") == 0);
+  REQUIRE(db.Execute("SELECT COUNT(*) FROM events WHERE id = 70000 AND kind = 0").rows[0][0].integer == 1);
+  REQUIRE(db.Execute("SELECT COUNT(*) FROM events WHERE kind >= 1 AND id > 10").rows[0][0].integer ==
+          140000 - 11 - (140000 - 11) / 7);
+}
+
+TEST_CASE("NormalizeSql ignores layout and keyword case", "[sql][plan_cache]") {
+  REQUIRE(NormalizeSql("select  name,count(*)\n from players -- all of them\n where goals>=? group by name;") ==
+          "SELECT name , COUNT ( * ) FROM players WHERE goals >= ? GROUP BY name");
+  REQUIRE(NormalizeSql("SELECT \"Goal Scored\" FROM t WHERE n = 'it''s'") ==
+          "SELECT \"Goal Scored\" FROM t WHERE n = 'it''s'");
+  REQUIRE(NormalizeSql("select Name from Players") != NormalizeSql("select name from players"));
+  REQUIRE_THROWS_AS(NormalizeSql("SELECT 'open"), std::invalid_argument);
+}
+
+TEST_CASE("Prepared statements bind parameters and reuse their plan", "[sql][plan_cache]") {
+  Database db = SoccerDatabase();
+  PreparedStatement by_team = db.Prepare("SELECT name FROM players WHERE team_id = ? AND goals >= ? ORDER BY name");
+  REQUIRE(by_team.ParameterCount() == 2);
+  REQUIRE(by_team.ParameterType(1) == DataType::kInt);
+  REQUIRE(by_team.ParameterType(2) == DataType::kInt);
+  std::string plan;
+  for (const auto& row : db.Execute("EXPLAIN SELECT name FROM players WHERE team_id = ? AND goals >= ?").StringRows()) {
+    plan += row[0] + "\n";
+  }
+  INFO(plan);
+  REQUIRE(plan.find("team_id = ?1") != std::string::npos);
+
+  const PlanCacheStats before = db.GetPlanCacheStats();
+  REQUIRE(by_team.Execute({Value::Integer(DataType::kInt, 1), Value::Integer(DataType::kInt, 10)}).StringRows() ==
+          std::vector<std::vector<std::string>>{{"Wu Lei"}});
+  REQUIRE(by_team.Bind(1, Value::Text("2")).Bind(2, Value::Number(9)).Execute().StringRows() ==
+          std::vector<std::vector<std::string>>{{"Fabio"}, {"Zhang Yuning"}});
+  // NULL compares as unknown, so it matches nothing
+  REQUIRE(by_team.Bind(1, Value::Null(DataType::kInt)).Execute().rows.empty());
+  REQUIRE(db.GetPlanCacheStats().misses == before.misses);
+
+  // the same statement written differently shares the cached plan
+  REQUIRE_THROWS_AS(db.Execute("select name from players where team_id = ? and goals >= ? order by name"),
+                    std::invalid_argument);  // no values to run it with
+  REQUIRE(db.GetPlanCacheStats().hits == before.hits + 1);
+
+  REQUIRE_THROWS_AS(by_team.Bind(2, Value::Text("many")), std::invalid_argument);
+  REQUIRE_THROWS_AS(by_team.Bind(2, Value::Number(2.5)), std::invalid_argument);
+  REQUIRE_THROWS_AS(by_team.Bind(3, Value::Integer(DataType::kInt, 1)), std::out_of_range);
+  REQUIRE_THROWS_AS(by_team.Execute({Value::Integer(DataType::kInt, 1)}), std::invalid_argument);
+  by_team.ClearBindings();
+  REQUIRE_THROWS_AS(by_team.Execute(), std::invalid_argument);
+
+  PreparedStatement insert = db.Prepare("INSERT INTO players (name, goals, rating) VALUES (?, ?, ? * 2)");
+  REQUIRE(insert.ParameterType(1) == DataType::kString);
+  REQUIRE(insert.ParameterType(2) == DataType::kInt);
+  for (int i = 0; i < 3; ++i) {
+    REQUIRE(insert.Execute({Value::Text("Youth " + std::to_string(i)), Value::Integer(DataType::kInt, 30 + i),
+                            Value::Number(3)}).affected == 1);
+  }
+  PreparedStatement remove = db.Prepare("DELETE FROM players WHERE goals > ?");
+  REQUIRE(remove.Execute({Value::Integer(DataType::kInt, 30)}).affected == 2);
+  REQUIRE(db.Execute("SELECT name, rating FROM players WHERE goals >= 30").StringRows() ==
+          std::vector<std::vector<std::string>>{{"Youth 0", "6"}});
+  REQUIRE_THROWS_AS(db.Execute("SELECT name FROM players WHERE goals > ?"), std::invalid_argument);
+}
+
+TEST_CASE("The plan cache is invalidated by schema changes and evicts the least recently used", "[sql][plan_cache]") {
+  Database db = SoccerDatabase();
+  PreparedStatement goals = db.Prepare("SELECT goals FROM players WHERE name = ?");
+  REQUIRE(goals.Execute({Value::Text("Oscar")}).StringRows()[0][0] == "9");
+
+  // every schema change replans, so goals is read from wherever it is now
+  DbTable& players = db.GetTable("players");
+  players.AddColumn({"nickname", DataType::kString});
+  REQUIRE(goals.Execute().StringRows()[0][0] == "9");
+  REQUIRE(db.GetPlanCacheStats().invalidations == 1);
+  players.DeleteColumnByIdx(1);  // team_id
+  REQUIRE(goals.Execute().StringRows()[0][0] == "9");
+  REQUIRE(db.GetPlanCacheStats().invalidations == 2);
+  players.DeleteColumnByIdx(1);  // goals
+  REQUIRE_THROWS_AS(goals.Execute(), std::invalid_argument);
+  REQUIRE(db.GetPlanCacheStats().invalidations == 3);
+
+  db.Execute("SELECT name FROM players");
+  db.Execute("SELECT name FROM teams");
+  REQUIRE(db.GetPlanCacheStats().entries == 4);  // with the INSERTs of SoccerDatabase
+  db.DropTable("players");
+  REQUIRE(db.GetPlanCacheStats().entries == 2);
+  REQUIRE(db.GetPlanCacheStats().invalidations == 5);
+  REQUIRE_THROWS_AS(goals.Execute(), std::out_of_range);
+
+  db.SetPlanCacheCapacity(2);
+  for (const char* sql : {"SELECT id FROM teams", "SELECT city FROM teams", "SELECT name FROM teams"}) {
+    db.Execute(sql);
+  }
+  const PlanCacheStats stats = db.GetPlanCacheStats();
+  REQUIRE(stats.entries == 2);
+  REQUIRE(stats.capacity == 2);
+  REQUIRE(stats.evictions == 3);  // the two entries left after the DROP, then the first SELECT
+  db.Execute("SELECT city FROM teams");
+  REQUIRE(db.GetPlanCacheStats().hits == stats.hits + 1);
+  db.Execute("SELECT id FROM teams");
+  REQUIRE(db.GetPlanCacheStats().misses == stats.misses + 1);
+}
+
+TEST_CASE("Compiled expressions compute what Evaluate does", "[sql][compiled]") {
+  Database db;
+  db.Execute("CREATE TABLE t (name TEXT, g INT, s DOUBLE, d DECIMAL, big BIGINT, day DATE)");
+  db.Execute("INSERT INTO t VALUES ('a', 10, 4.0, 1.25, 9223372036854775806, '2024-01-02'), "
+             "('b', 3, 0, 2.5, -9223372036854775807, '2023-12-31'), ('c', 0, NULL, NULL, 0, NULL), "
+             "(NULL, NULL, 1.5, 0.0001, NULL, '2024-01-02'), ('b', -7, -2.25, -3, 5, '2000-02-29')");
+  const std::vector<std::string> exprs = {
+      "g / s > 1.5", "g * 2 - 1", "g / 0", "g % 3", "-g", "-s", "g / s", "s % 2", "d + 1", "d * s", "d > 1.25",
+      "g = d", "g > s", "name = 'b'", "name < 'b'", "name <> name", "g > 2 AND s < 3", "g > 2 OR s IS NULL",
+      "NOT (g = 3)", "s IS NOT NULL", "name IS NULL", "day >= '2024-01-01'", "big > 0", "g + 1 > 0 AND NULL",
+      "g < 0 OR NULL", "g", "1.5", "'text'", "NULL"};
+  std::string sql = "SELECT ";
+  for (size_t i = 0; i < exprs.size(); ++i) sql += (i > 0 ? ", " : "") + exprs[i];
+  const PlanPtr plan = PlanSelect(ParseSql(sql + " FROM t").select, db);
+  REQUIRE(plan->kind == PlanKind::kProject);
+
+  std::vector<Row> rows;
+  std::unique_ptr<Operator> input = BuildOperator(*plan->children[0]);
+  input->Open();
+  for (Row row; input->Next(row);) rows.push_back(row);
+  for (size_t e = 0; e < exprs.size(); ++e) {
+    INFO(exprs[e]);
+    const Expr& expr = *plan->exprs[e];
+    const CompiledExpr compiled = CompileExpr(expr);
+    REQUIRE(compiled.Compiled());
+    Batch batch;
+    REQUIRE(batch.Load(rows, rows.size(), compiled.Inputs()));
+    ValueVector out;
+    compiled.Evaluate(batch, out);
+    REQUIRE(out.size == rows.size());
+    for (size_t i = 0; i < rows.size(); ++i) {
+      const Value expected = Evaluate(expr, rows[i]);
+      const Value actual = out.Get(i);
+      INFO("row " << i << ": " << expected << " vs " << actual);
+      REQUIRE(actual.null == expected.null);
+      REQUIRE(actual.type == expected.type);
+      REQUIRE(CompareValues(actual, expected) == 0);
+    }
+  }
+
+  // integer overflow throws from compiled code like it does from Evaluate
+  const PlanPtr overflow = PlanSelect(ParseSql("SELECT big + 2 FROM t").select, db);
+  const CompiledExpr compiled = CompileExpr(*overflow->exprs[0]);
+  rows.clear();
+  input = BuildOperator(*overflow->children[0]);
+  input->Open();
+  for (Row row; input->Next(row);) rows.push_back(row);
+  Batch batch;
+  REQUIRE(batch.Load(rows, rows.size(), compiled.Inputs()));
+  ValueVector out;
+  REQUIRE_THROWS_AS(compiled.Evaluate(batch, out), std::out_of_range);
+  REQUIRE_THROWS_AS(db.Execute("SELECT big + 2 FROM t"), std::out_of_range);
+}
+
+TEST_CASE("Filter and Project run compiled over batches and fall back to Evaluate", "[sql][compiled]") {
+  Database db;
+  db.Execute("CREATE TABLE t (id INT, flag INT, big BIGINT, score DOUBLE)");
+  DbTable& t = db.GetTable("t");
+  for (int i = 0; i < 3000; ++i) {
+    t.AddRow({std::to_string(i), std::to_string(i % 2), i % 2 == 1 ? "9223372036854775807" : std::to_string(i),
+              std::to_string(i % 10 * 0.5)});
+  }
+  // spans several batches
+  REQUIRE(db.Execute("SELECT COUNT(*) FROM t WHERE id % 7 = 0 AND score * 2 > id % 5").rows[0][0].integer ==
+          db.Execute("SELECT COUNT(*) FROM t WHERE NOT (id % 7 <> 0 OR score * 2 <= id % 5)").rows[0][0].integer);
+  QueryResult projected = db.Execute("SELECT id, id * 2 + 1 AS odd, score / 2 FROM t WHERE id >= 1020 LIMIT 10");
+  REQUIRE(projected.rows.size() == 10);
+  REQUIRE(projected.StringRows()[4] == std::vector<std::string>{"1024", "2049", "1"});
+
+  // big + 1 overflows on the rows where flag = 1, which OR never evaluates it for; the batch reruns with Evaluate
+  REQUIRE(db.Execute("SELECT COUNT(*) FROM t WHERE flag = 1 OR big + 1 > 100").rows[0][0].integer == 1500 + 1450);
+  REQUIRE(db.Execute("SELECT big + flag FROM t WHERE flag = 0 AND id < 4").StringRows() ==
+          std::vector<std::vector<std::string>>{{"0"}, {"2"}});
+
+  // parameters are read once per batch
+  PreparedStatement prepared = db.Prepare("SELECT COUNT(*) FROM t WHERE id % ? = 0 AND score >= ?");
+  REQUIRE(prepared.Execute({Value::Integer(DataType::kInt64, 1000), Value::Number(0)}).rows[0][0].integer == 3);
+  REQUIRE(prepared.Execute({Value::Integer(DataType::kInt64, 3), Value::Null(DataType::kDouble)}).rows[0][0].integer ==
+          0);
+}
+
+TEST_CASE("DataChunk stores typed columns and narrows its selection", "[sql][vectorized]") {
+  DataChunk chunk;
+  chunk.Reset({DataType::kString, DataType::kDouble, DataType::kDecimal}, 4);
+  REQUIRE(chunk.Count() == 4);
+  const std::vector<std::string> names = {"ann", "bob", "cy", "dee"};
+  for (size_t i = 0; i < 4; ++i) {
+    chunk.batch.columns[0].Set(i, Value::Text(names[i]));
+    chunk.batch.columns[1].Set(i, i == 1 ? Value::Null(DataType::kDouble) : Value::Number(i * 1.5));
+    chunk.batch.columns[2].Set(i, CastValue(Value::Text(std::to_string(i) + ".25"), DataType::kDecimal));
+  }
+  REQUIRE_THROWS_AS(chunk.batch.columns[0].Set(0, Value::Number(1)), std::invalid_argument);
+
+  Row row;
+  chunk.GetRow(1, row);
+  REQUIRE(row.size() == 3);
+  REQUIRE(row[0].text == "bob");
+  REQUIRE(row[1].null);
+  REQUIRE(row[1].type == DataType::kDouble);
+  REQUIRE(row[2].ToString() == "1.2500");
+
+  chunk.Select({1, 2, 3});
+  chunk.Select({0, 2, 3});
+  REQUIRE(chunk.Count() == 2);
+  REQUIRE(chunk.Index(0) == 2);
+  chunk.GetRow(1, row);
+  REQUIRE(row[0].text == "dee");
+  REQUIRE(row[1].number == 4.5);
+}
+
+TEST_CASE("Scan, Filter, Project and Aggregate exchange chunks", "[sql][vectorized]") {
+  Database db;
+  db.Execute("CREATE TABLE t (id INT, name TEXT, g INT, s DOUBLE)");
+  DbTable& t = db.GetTable("t");
+  for (int i = 0; i < 5000; ++i) {
+    t.AddRow(std::vector<std::optional<std::string>>{
+        std::to_string(i), "n" + std::to_string(i % 37), std::to_string(i % 50),
+        i % 11 == 0 ? std::nullopt : std::optional<std::string>(std::to_string(i % 7 * 0.5))});
+  }
+
+  // the chunk and row interfaces of the same plan produce the same rows
+  const PlanPtr plan = PlanSelect(ParseSql("SELECT name, g * 2, s FROM t WHERE g % 3 = 0 AND s > 1").select, db);
+  std::unique_ptr<Operator> vectorized = BuildOperator(*plan);
+  std::unique_ptr<Operator> rows = BuildOperator(*plan);
+  REQUIRE(vectorized->ProducesChunks());
+  vectorized->Open();
+  rows->Open();
+  size_t chunks = 0;
+  size_t count = 0;
+  Row expected;
+  Row actual;
+  for (DataChunk chunk; vectorized->NextChunk(chunk); ++chunks) {
+    REQUIRE(chunk.Count() > 0);
+    REQUIRE(chunk.Count() <= DataChunk::kCapacity);
+    for (size_t i = 0; i < chunk.Count(); ++i, ++count) {
+      REQUIRE(rows->Next(expected));
+      chunk.GetRow(i, actual);
+      REQUIRE(actual.size() == expected.size());
+      for (size_t c = 0; c < actual.size(); ++c) {
+        REQUIRE(CompareValues(actual[c], expected[c]) == 0);
+      }
+    }
+  }
+  REQUIRE_FALSE(rows->Next(expected));
+  REQUIRE(chunks > 1);
+  REQUIRE(count == db.Execute("SELECT name, g * 2, s FROM t WHERE g % 3 = 0 AND s > 1").rows.size());
+
+  // aggregates over chunks
+  std::map<int64_t, std::vector<int64_t>> groups;  // g % 4 -> rows, non-NULL s, SUM(g)
+  for (int i = 0; i < 5000; ++i) {
+    if (i % 50 <= 10) continue;
+    std::vector<int64_t>& group = groups[i % 50 % 4];
+    group.resize(3);
+    ++group[0];
+    group[1] += i % 11 != 0;
+    group[2] += i % 50;
+  }
+  const QueryResult grouped = db.Execute("SELECT g % 4, COUNT(*), COUNT(s), SUM(g), MAX(name) FROM t WHERE g > 10 "
+                                         "GROUP BY g % 4 ORDER BY g % 4");
+  REQUIRE(grouped.rows.size() == groups.size());
+  for (const Row& group : grouped.rows) {
+    INFO(group[0]);
+    const std::vector<int64_t>& expected_group = groups.at(group[0].integer);
+    REQUIRE(group[1].integer == expected_group[0]);
+    REQUIRE(group[2].integer == expected_group[1]);
+    REQUIRE(group[3].integer == expected_group[2]);
+    REQUIRE(group[4].text == "n9");
+  }
+  // a join in between hands rows to the Aggregate instead
+  REQUIRE(db.Execute("SELECT COUNT(*), SUM(a.g) FROM t a JOIN t b ON a.id = b.id WHERE a.g > 10").StringRows() ==
+          db.Execute("SELECT COUNT(*), SUM(g) FROM t WHERE g > 10").StringRows());
+}
+
+namespace {
+
+std::vector<std::vector<std::string>> SortedRows(const QueryResult& result) {
+  std::vector<std::vector<std::string>> rows = result.StringRows();
+  std::sort(rows.begin(), rows.end());
+  return rows;
+}
+
+}  // namespace
+
+TEST_CASE("Materialized views with aggregates follow inserts and deletes", "[sql][views]") {
+  Database db;
+  db.Execute("CREATE TABLE stats (player TEXT, team TEXT, goals INT, rating DOUBLE)");
+  DbTable& stats = db.GetTable("stats");
+  for (int i = 0; i < 200; ++i) {
+    stats.AddRow(std::vector<std::optional<std::string>>{
+        "p" + std::to_string(i), "t" + std::to_string(i % 6), std::to_string(i % 17),
+        i % 9 == 0 ? std::nullopt : std::optional<std::string>(std::to_string(i % 5) + ".5")});
+  }
+  const std::string sql = "SELECT team, COUNT(*), COUNT(rating), SUM(goals) AS total, MIN(goals), MAX(player), "
+                          "AVG(rating) FROM stats WHERE goals > 2 GROUP BY team HAVING SUM(goals) > 0";
+  MaterializedView& view = db.CreateMaterializedView("by_team", sql);
+  REQUIRE(view.Read().columns == db.Execute(sql).columns);
+  REQUIRE(SortedRows(view.Read()) == SortedRows(db.Execute(sql)));
+
+  std::mt19937 rng(7);
+  std::vector<unsigned int> ids(200);
+  for (unsigned int i = 0; i < 200; ++i) ids[i] = i;
+  unsigned int next_id = 200;
+  for (int step = 0; step < 300; ++step) {
+    if (rng() % 3 == 0 && !ids.empty()) {
+      const size_t victim = rng() % ids.size();
+      stats.DeleteRowById(ids[victim]);
+      ids.erase(ids.begin() + static_cast<std::ptrdiff_t>(victim));
+    } else {
+      stats.AddRow({"q" + std::to_string(step), "t" + std::to_string(rng() % 8), std::to_string(rng() % 20),
+                    std::to_string(rng() % 40 / 4.0)});
+      ids.push_back(next_id++);
+    }
+  }
+  db.Execute("INSERT INTO stats VALUES ('zz', 'new', 50, 1.0)");
+  const size_t deleted = db.Execute("DELETE FROM stats WHERE team = 't1'").affected;
+  const QueryResult expected = db.Execute(sql);
+  const QueryResult actual = view.Read();
+  REQUIRE(actual.rows.size() == expected.rows.size());
+  REQUIRE(SortedRows(actual) == SortedRows(expected));
+  MaterializedViewStats view_stats = view.Stats();
+  REQUIRE(view_stats.rebuilds == 1);
+  REQUIRE(view_stats.inserts + view_stats.deletes == 300 + 1 + deleted);
+  REQUIRE(view_stats.rows == 8);  // t0..t7 without t1, plus 'new'
+
+  // MIN and MAX give the extreme back up when it is deleted; a group goes away with its last row
+  db.Execute("CREATE TABLE small (k TEXT, v INT)");
+  db.Execute("INSERT INTO small VALUES ('a', 5), ('a', 1), ('a', 9), ('b', 3)");
+  MaterializedView& extremes = db.CreateMaterializedView("extremes", "SELECT k, MIN(v), MAX(v), SUM(v) FROM small "
+                                                                      "GROUP BY k");
+  db.Execute("DELETE FROM small WHERE v = 1 OR v = 9 OR k = 'b'");
+  REQUIRE(extremes.Read().StringRows() == std::vector<std::vector<std::string>>{{"a", "5", "5", "5"}});
+  db.Execute("DELETE FROM small");
+  REQUIRE(extremes.Read().rows.empty());
+  MaterializedView& total = db.CreateMaterializedView("total", "SELECT COUNT(*), SUM(v) FROM small");
+  REQUIRE(total.Read().StringRows() == std::vector<std::vector<std::string>>{{"0", ""}});
+  db.Execute("INSERT INTO small VALUES ('c', 4), ('d', 6)");
+  REQUIRE(total.Read().StringRows() == std::vector<std::vector<std::string>>{{"2", "10"}});
+}
+
+TEST_CASE("Materialized views without aggregates, schema changes and the catalog", "[sql][views]") {
+  Database db;
+  db.Execute("CREATE TABLE t (id INT, name TEXT, score DOUBLE)");
+  db.Execute("INSERT INTO t VALUES (1, 'a', 1.5), (2, 'b', 7), (3, 'c', NULL), (4, 'd', 9.25)");
+  MaterializedView& view =
+      db.CreateMaterializedView("high", "SELECT name, score * 2 AS doubled FROM t WHERE score > 2");
+  REQUIRE(view.Read().columns == std::vector<std::string>{"name", "doubled"});
+  REQUIRE(view.Read().StringRows() == std::vector<std::vector<std::string>>{{"b", "14"}, {"d", "18.5"}});
+  db.Execute("INSERT INTO t VALUES (5, 'e', 3), (6, 'f', 0)");
+  db.Execute("DELETE FROM t WHERE id = 2");
+  REQUIRE(view.Read().StringRows() == std::vector<std::vector<std::string>>{{"d", "18.5"}, {"e", "6"}});
+  REQUIRE(view.Stats().rows == 2);
+
+  // a schema change leaves the view stale until it is read again
+  DbTable& t = db.GetTable("t");
+  t.AddColumn({"extra", DataType::kInt});
+  t.AddRow({"7", "g", "4", "1"});
+  REQUIRE(view.Read().StringRows() == std::vector<std::vector<std::string>>{{"d", "18.5"}, {"e", "6"}, {"g", "8"}});
+  REQUIRE(view.Stats().rebuilds == 2);
+  t.DeleteColumnByIdx(2);
+  REQUIRE_THROWS_AS(view.Read(), std::invalid_argument);  // score is gone
+  t.AddColumn({"score", DataType::kDouble});
+  REQUIRE(view.Read().rows.empty());  // every score defaults to 0
+
+  // copies recompute their views over their own tables
+  Database copy(db);
+  copy.Execute("INSERT INTO t VALUES (8, 'h', 0, 5)");
+  REQUIRE(copy.GetMaterializedView("high").Read().StringRows() == std::vector<std::vector<std::string>>{{"h", "10"}});
+  REQUIRE(view.Read().rows.empty());
+
+  REQUIRE_THROWS_AS(db.DropTable("t"), std::invalid_argument);
+  REQUIRE_THROWS_AS(db.CreateMaterializedView("high", "SELECT * FROM t"), std::invalid_argument);
+  db.Execute("CREATE TABLE u (id INT)");
+  REQUIRE_THROWS_AS(db.CreateMaterializedView("j", "SELECT * FROM t JOIN u ON t.id = u.id"), std::invalid_argument);
+  REQUIRE_THROWS_AS(db.CreateMaterializedView("o", "SELECT * FROM t ORDER BY id"), std::invalid_argument);
+  REQUIRE_THROWS_AS(db.CreateMaterializedView("l", "SELECT * FROM t LIMIT 1"), std::invalid_argument);
+  REQUIRE_THROWS_AS(db.CreateMaterializedView("p", "SELECT * FROM t WHERE id = ?"), std::invalid_argument);
+  REQUIRE_THROWS_AS(db.CreateMaterializedView("m", "SELECT * FROM missing"), std::out_of_range);
+  REQUIRE_FALSE(db.HasMaterializedView("j"));
+  db.DropMaterializedView("high");
+  REQUIRE_THROWS_AS(db.GetMaterializedView("high"), std::out_of_range);
+  db.DropTable("t");
+  REQUIRE_FALSE(db.HasTable("t"));
+}
+
+TEST_CASE("Copies of a database keep a view whose SELECT no longer plans", "[sql][views]") {
+  Database db;
+  db.Execute("CREATE TABLE t (a INT, b INT)");
+  db.Execute("INSERT INTO t VALUES (1, 2)");
+  db.CreateMaterializedView("bs", "SELECT b FROM t");
+  db.CreatePartitionedTable("p", {{"k", DataType::kInt}}, PartitionSpec::Hash("k", 2));
+  db.GetTable("t").DeleteColumnByIdx(1);  // the view is stale and b is gone
+
+  Database copy(db);
+  REQUIRE(copy.HasMaterializedView("bs"));
+  REQUIRE(copy.HasPartitionedTable("p"));
+  REQUIRE_THROWS_AS(copy.GetMaterializedView("bs").Read(), std::invalid_argument);
+  copy.GetTable("t").AddColumn({"b", DataType::kInt});
+  REQUIRE(copy.GetMaterializedView("bs").Read().StringRows() == std::vector<std::vector<std::string>>{{"0"}});
+  REQUIRE_THROWS_AS(db.GetMaterializedView("bs").Read(), std::invalid_argument);
+
+  Database target;
+  target.Execute("CREATE TABLE old (x INT)");
+  target.CreateMaterializedView("xs", "SELECT x FROM old");
+  target = db;
+  REQUIRE(target.HasTable("t"));
+  REQUIRE_FALSE(target.HasTable("old"));
+  REQUIRE_FALSE(target.HasMaterializedView("xs"));
+  REQUIRE(target.HasPartitionedTable("p"));
+  REQUIRE_THROWS_AS(target.GetMaterializedView("bs").Read(), std::invalid_argument);
+  target.Execute("INSERT INTO t VALUES (3)");
+  target.GetTable("t").AddColumn({"b", DataType::kInt});
+  REQUIRE(target.GetMaterializedView("bs").Read().rows.size() == 2);
+  REQUIRE(db.GetTable("t").GetRows().size() == 1);
+}
+
+TEST_CASE("The result cache returns stored rows until a table they come from changes", "[sql][result_cache]") {
+  Database db = SoccerDatabase();
+  REQUIRE(db.GetResultCacheStats().budget == 0);  // off by default
+  db.Execute("SELECT name FROM players");
+  REQUIRE(db.GetResultCacheStats().entries == 0);
+
+  db.SetResultCacheBudget(1 << 20);
+  const std::string join = "SELECT p.name, t.city FROM players p JOIN teams t ON p.team_id = t.id ORDER BY p.name";
+  const QueryResult first = db.Execute(join);
+  REQUIRE(db.GetResultCacheStats().misses == 1);
+  REQUIRE(db.Execute("select p.name, t.city from players p join teams t on p.team_id = t.id order by p.name")
+              .StringRows() == first.StringRows());
+  REQUIRE(db.GetResultCacheStats().hits == 1);
+  REQUIRE(db.GetResultCacheStats().entries == 1);
+  REQUIRE(db.GetResultCacheStats().bytes > 0);
+  REQUIRE(db.Execute("EXPLAIN " + join).rows.size() > 1);  // never cached
+  REQUIRE(db.GetResultCacheStats().entries == 1);
+
+  // every way of changing a table the query reads makes the next run see the change
+  DbTable& teams = db.GetTable("teams");
+  teams.AddRow({"5", "Wuhan Three Towns", "Wuhan"});
+  REQUIRE(db.Execute(join).StringRows() == first.StringRows());  // no player joins it, but it ran again
+  REQUIRE(db.GetResultCacheStats().invalidations == 1);
+  db.Execute("INSERT INTO players VALUES ('Crysan Jr', 5, 1, 2, 6.0)");
+  REQUIRE(db.Execute(join).rows.size() == first.rows.size() + 1);
+  REQUIRE(db.Execute(join).rows.size() == first.rows.size() + 1);
+  db.Execute("DELETE FROM players WHERE team_id = 5");
+  REQUIRE(db.Execute(join).StringRows() == first.StringRows());
+  teams.AddColumn({"founded", DataType::kInt});
+  REQUIRE(db.Execute(join).StringRows() == first.StringRows());
+  const ResultCacheStats stats = db.GetResultCacheStats();
+  REQUIRE(stats.hits == 2);
+  REQUIRE(stats.invalidations == 4);
+
+  // a write to another table leaves the entry alone
+  db.Execute("CREATE TABLE coaches (name TEXT)");
+  db.Execute("INSERT INTO coaches VALUES ('Li Tie')");
+  db.Execute(join);
+  REQUIRE(db.GetResultCacheStats().hits == stats.hits + 1);
+
+  // dropping a table removes its entries; a new table of the same name starts over
+  db.Execute("SELECT name FROM coaches");
+  db.DropTable("coaches");
+  REQUIRE(db.GetResultCacheStats().entries == 1);
+  db.Execute("CREATE TABLE coaches (name TEXT)");
+  REQUIRE(db.Execute("SELECT name FROM coaches").rows.empty());
+
+  // copies start with an empty cache that is off
+  Database copy = db;
+  REQUIRE(copy.GetResultCacheStats().entries == 0);
+  REQUIRE(copy.Execute(join).StringRows() == first.StringRows());
+}
+
+TEST_CASE("The result cache keys by parameter values and keeps within its byte budget", "[sql][result_cache]") {
+  Database db = SoccerDatabase();
+  db.SetResultCacheBudget(1 << 20);
+  PreparedStatement by_goals = db.Prepare("SELECT name FROM players WHERE goals >= ? ORDER BY name");
+  REQUIRE(by_goals.Execute({Value::Integer(DataType::kInt, 15)}).rows.size() == 2);
+  REQUIRE(by_goals.Execute({Value::Integer(DataType::kInt, 10)}).rows.size() == 3);
+  REQUIRE(by_goals.Execute({Value::Integer(DataType::kInt, 15)}).rows.size() == 2);
+  REQUIRE(by_goals.Execute({Value::Number(15)}).rows.size() == 2);  // bound as the same INT
+  REQUIRE(by_goals.Execute({Value::Null(DataType::kInt)}).rows.empty());
+  ResultCacheStats stats = db.GetResultCacheStats();
+  REQUIRE(stats.entries == 3);
+  REQUIRE(stats.hits == 2);
+  REQUIRE(stats.misses == 3);
+
+  // shrinking the budget evicts the least recently used until the rest fits
+  const size_t all = stats.bytes;
+  db.SetResultCacheBudget(all - 1);
+  stats = db.GetResultCacheStats();
+  REQUIRE(stats.entries == 2);
+  REQUIRE(stats.evictions == 1);
+  REQUIRE(stats.bytes < all);
+  REQUIRE(by_goals.Execute({Value::Null(DataType::kInt)}).rows.empty());  // used most recently, still there
+  REQUIRE(db.GetResultCacheStats().hits == stats.hits + 1);
+
+  // a result larger than the whole budget is returned but not stored
+  db.SetResultCacheBudget(64);
+  REQUIRE(db.GetResultCacheStats().entries == 0);
+  REQUIRE(db.Execute("SELECT * FROM players").rows.size() == 6);
+  REQUIRE(db.GetResultCacheStats().entries == 0);
+  REQUIRE(db.GetResultCacheStats().bytes == 0);
+
+  db.SetResultCacheBudget(0);
+  db.Execute("SELECT name FROM teams");
+  db.Execute("SELECT name FROM teams");
+  REQUIRE(db.GetResultCacheStats().entries == 0);
+}
+
+TEST_CASE("The result cache tells apart string parameters that hold its separators", "[sql][result_cache]") {
+  Database db;
+  db.SetResultCacheBudget(1 << 20);
+  db.Execute("CREATE TABLE pairs (a TEXT, b TEXT)");
+  const std::string sep = "\x1f" + std::to_string(static_cast<int>(DataType::kString)) + ":";
+  db.Execute("INSERT INTO pairs VALUES ('x', 'y" + sep + "z')");
+  PreparedStatement by_pair = db.Prepare("SELECT COUNT(*) FROM pairs WHERE a = ? AND b = ?");
+  REQUIRE(by_pair.Execute({Value::Text("x"), Value::Text("y" + sep + "z")}).StringRows()[0][0] == "1");
+  REQUIRE(by_pair.Execute({Value::Text("x" + sep + "y"), Value::Text("z")}).StringRows()[0][0] == "0");
+  REQUIRE(by_pair.Execute({Value::Text("x" + sep + "1:y"), Value::Text("z")}).StringRows()[0][0] == "0");
+  REQUIRE(by_pair.Execute({Value::Text("x"), Value::Text("y" + sep + "z")}).StringRows()[0][0] == "1");
+  const ResultCacheStats stats = db.GetResultCacheStats();
+  REQUIRE(stats.entries == 3);
+  REQUIRE(stats.hits == 1);
+}
+
+TEST_CASE("The buffer pool pins pages, replaces them with CLOCK and keeps scans in their ring", "[buffer_pool]") {
+  TempDir dir;
+  const std::string path = dir.path + "/pages.db";
+  BufferPoolOptions options;
+  options.frames = 8;
+  options.scan_frames = 4;
+  options.prefetch_pages = 2;
+  options.sync = false;
+  {
+    BufferPool pool(path, options);
+    for (uint32_t i = 0; i < 32; ++i) {
+      PageGuard page = pool.NewPage();
+      REQUIRE(page.PageNo() == i);
+      std::fill_n(page.MutableData(), BufferPool::kPageSize, static_cast<char>('a' + i % 26));
+    }
+    BufferPoolStats stats = pool.Stats();
+    REQUIRE(pool.PageCount() == 32);
+    REQUIRE(stats.cached == 8);
+    REQUIRE(stats.writes == 24);  // written back as their frames were reused
+    REQUIRE(stats.pinned == 0);
+    REQUIRE(pool.Fetch(0).Data()[100] == 'a');  // read back from the file
+
+    // pinned pages stay; once every frame is pinned nothing else can come in
+    std::vector<PageGuard> pinned;
+    for (uint32_t i = 0; i < 8; ++i) {
+      pinned.push_back(pool.Fetch(i));
+    }
+    REQUIRE(pool.Stats().pinned == 8);
+    REQUIRE_THROWS_AS(pool.Fetch(20), std::runtime_error);
+    REQUIRE_THROWS_AS(pool.Fetch(32), std::out_of_range);
+    PageGuard moved = std::move(pinned[0]);
+    pinned.clear();
+    REQUIRE(pool.Stats().pinned == 1);
+    moved.Release();
+    pool.Flush();
+    REQUIRE(pool.Stats().dirty == 0);
+  }
+
+  BufferPool pool(path, options);
+  REQUIRE(pool.PageCount() == 32);
+  for (int round = 0; round < 2; ++round) {  // a hot working set
+    for (uint32_t i = 0; i < 4; ++i) {
+      pool.Fetch(i);
+    }
+  }
+  for (uint32_t i = 0; i < 32; ++i) {
+    REQUIRE(pool.Fetch(i, AccessHint::kScan).Data()[BufferPool::kPageSize - 1] == static_cast<char>('a' + i % 26));
+  }
+  // the scan went through its ring of 4 frames: the hot pages are still cached, and every page was read once
+  for (uint32_t i = 0; i < 4; ++i) {
+    REQUIRE(pool.IsCached(i));
+  }
+  const BufferPoolStats stats = pool.Stats();
+  REQUIRE(stats.reads == 32);
+  REQUIRE(stats.prefetched == 14);  // read two at a time
+  REQUIRE(stats.misses == 4 + 14);
+
+  // a random fetch takes a scanned page out of the ring, so the next scan takes one frame from the pool to refill it
+  pool.Fetch(31);
+  for (uint32_t i = 4; i < 31; ++i) {
+    pool.Fetch(i, AccessHint::kScan);
+  }
+  size_t kept = pool.IsCached(31);
+  for (uint32_t i = 0; i < 4; ++i) {
+    kept += pool.IsCached(i);
+  }
+  REQUIRE(kept == 4);
+
+  BufferPoolOptions single;  // too small for a ring: scans share the one frame
+  single.frames = 1;
+  single.sync = false;
+  BufferPool tiny(path, single);
+  for (uint32_t i = 0; i < 32; ++i) {
+    const AccessHint hint = i % 3 == 0 ? AccessHint::kRandom : AccessHint::kScan;
+    REQUIRE(tiny.Fetch(i, hint).Data()[0] == static_cast<char>('a' + i % 26));
+  }
+  REQUIRE(tiny.Stats().reads == 32);
+}
+
+TEST_CASE("A scanned page whose write-back fails stays cached outside the scan ring", "[buffer_pool]") {
+  TempDir dir;
+  const std::string path = dir.path + "/pages.db";
+  BufferPoolOptions options;
+  options.frames = 8;
+  options.scan_frames = 4;
+  options.prefetch_pages = 1;
+  options.sync = false;
+  {
+    BufferPool pool(path, options);
+    for (uint32_t i = 0; i < 16; ++i) {
+      pool.NewPage();
+    }
+  }
+  BufferPool pool(path, options);
+  for (uint32_t i = 1; i <= 4; ++i) {  // fills the ring
+    PageGuard page = pool.Fetch(i, AccessHint::kScan);
+    if (i == 1) page.MutableData()[0] = 'x';
+  }
+  struct rlimit saved;
+  REQUIRE(::getrlimit(RLIMIT_FSIZE, &saved) == 0);
+  void (*saved_handler)(int) = std::signal(SIGXFSZ, SIG_IGN);
+  struct rlimit limited = saved;
+  limited.rlim_cur = BufferPool::kPageSize;  // page 1 can no longer be written
+  REQUIRE(::setrlimit(RLIMIT_FSIZE, &limited) == 0);
+  bool threw = false;
+  try {
+    pool.Fetch(5, AccessHint::kScan);  // recycles the frame of page 1
+  } catch (const std::runtime_error&) {
+    threw = true;
+  }
+  ::setrlimit(RLIMIT_FSIZE, &saved);
+  std::signal(SIGXFSZ, saved_handler);
+  REQUIRE(threw);
+  REQUIRE(pool.IsCached(1));
+  REQUIRE(pool.Stats().dirty == 1);
+
+  REQUIRE(pool.Fetch(1).Data()[0] == 'x');  // a random hit on the frame that left the ring
+  for (uint32_t i = 5; i < 16; ++i) {
+    pool.Fetch(i, AccessHint::kScan);
+  }
+  size_t scanned = 0;  // the ring still has its 4 frames, no more and no less
+  for (uint32_t i = 2; i < 16; ++i) {
+    scanned += pool.IsCached(i);
+  }
+  REQUIRE(scanned == 4);
+  REQUIRE(pool.IsCached(1));
+  pool.Flush();
+  REQUIRE(pool.Stats().dirty == 0);
+  BufferPool reopened(path, options);
+  REQUIRE(reopened.Fetch(1).Data()[0] == 'x');
+}
+
+TEST_CASE("Paged tables hold more rows than the buffer pool has frames", "[buffer_pool][paged_table]") {
+  TempDir dir;
+  const std::string path = dir.path + "/players.pages";
+  BufferPoolOptions options;
+  options.frames = 8;
+  options.scan_frames = 4;
+  options.prefetch_pages = 2;
+  options.sync = false;
+  const std::vector<std::pair<std::string, DataType>> columns = {
+      {"name", DataType::kString}, {"goals", DataType::kInt}, {"rating", DataType::kDouble},
+      {"salary", DataType::kDecimal}};
+  const unsigned int rows = 5000;
+  {
+    PagedTable table(path, columns, options);
+    for (unsigned int i = 0; i < rows; ++i) {
+      std::optional<std::string> rating;
+      if (i % 7 != 0) rating = std::to_string(i % 10) + ".5";
+      table.AddRow({"player" + std::to_string(i), std::to_string(i % 30), rating, std::to_string(i) + ".25"});
+    }
+    REQUIRE(table.PageCount() > 2 * options.frames);
+    REQUIRE(table.PoolStats().cached <= options.frames);
+    REQUIRE(table.GetRow(7) == std::vector<std::string>{"player7", "7", "", "7.2500"});
+    for (unsigned int id = 0; id < rows; id += 2) {
+      table.DeleteRowById(id);
+    }
+    REQUIRE(table.RowCount() == rows / 2);
+    REQUIRE_THROWS_AS(table.DeleteRowById(0), std::out_of_range);
+    REQUIRE_THROWS_AS(table.GetRow(rows), std::out_of_range);
+    REQUIRE_THROWS_AS(table.AddRow({"too few"}), std::invalid_argument);
+    const std::vector<std::optional<std::string>> huge = {std::string(9000, 'x'), "1", "1", "1"};
+    REQUIRE_THROWS_AS(table.AddRow(huge), std::invalid_argument);
+    REQUIRE_THROWS_AS(table.AddRow({"striker", "many", "1", "1"}), std::invalid_argument);
+  }
+
+  // reopened from the file alone
+  PagedTable table(path, {}, options);
+  REQUIRE(table.GetColumnDescriptions() == columns);
+  REQUIRE(table.RowCount() == rows / 2);
+  std::vector<unsigned int> expected;
+  size_t rated = 0;
+  for (unsigned int i = 1; i < rows; i += 2) {
+    if (i % 30 >= 25) expected.push_back(i);
+    rated += i % 7 != 0;
+  }
+  REQUIRE(table.Filter(1, CompareOp::kGe, "25") == expected);
+  REQUIRE(table.Count(2, CompareOp::kLt, "100") == rated);  // NULL ratings never match
+  size_t seen = 0;
+  for (PagedTable::RowCursor row = table.Rows(); row.Valid(); row.Next()) {
+    REQUIRE(row.Id() % 2 == 1);
+    REQUIRE(table.GetValue(row, 0).text == "player" + std::to_string(row.Id()));
+    ++seen;
+  }
+  REQUIRE(seen == rows / 2);
+  REQUIRE(table.GetRows()[0] == std::vector<std::string>{"player1", "1", "1.500000", "1.2500"});
+  REQUIRE(table.PoolStats().prefetched > 0);
+
+  table.AddRow({"late signing", "1", std::nullopt, "0"});
+  REQUIRE(table.GetRow(rows)[0] == "late signing");
+  const std::vector<std::pair<std::string, DataType>> other = {{"name", DataType::kString}};
+  REQUIRE_THROWS_AS(PagedTable(path, other, options), std::invalid_argument);
+}
+
+// ─────────────────────────────────────────────────────────────────────────────
+//  Asynchronous I/O
+// ─────────────────────────────────────────────────────────────────────────────
+namespace {
+std::string ReadFile(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+}  // namespace
+
+TEST_CASE("AsyncWriter writes every buffer in order with both backends", "[async_io]") {
+  TempDir dir;
+  const std::string path = dir.path + "/out.bin";
+  for (bool allow_io_uring : {true, false}) {
+    AsyncIoOptions options;
+    options.allow_io_uring = allow_io_uring;
+    options.queue_depth = 4;               // fewer slots than buffers
+    options.batch_bytes = 10000;
+    options.max_pending_bytes = 1 << 16;   // Write has to wait for the device
+    std::string expected;
+    AsyncIoStats stats;
+    {
+      AsyncWriter out(path, 0, true, options);
+      if (!allow_io_uring) REQUIRE(out.Backend() == AsyncIoBackend::kThreadPool);
+      for (int i = 0; i < 200; ++i) {
+        std::string buffer(static_cast<size_t>(1 + i * 97 % 5000), static_cast<char>('a' + i % 26));
+        expected += buffer;
+        out.Write(std::move(buffer));
+      }
+      out.Write("");  // nothing to do
+      REQUIRE(out.Offset() == expected.size());
+      out.Sync();
+      stats = out.Stats();
+      out.Close();
+      REQUIRE_THROWS_AS(out.Write("late"), std::runtime_error);
+    }
+    INFO(AsyncIoBackendName(allow_io_uring ? AsyncIoBackend::kIoUring : AsyncIoBackend::kThreadPool));
+    REQUIRE(ReadFile(path) == expected);
+    REQUIRE(stats.writes == 200);
+    REQUIRE(stats.bytes == expected.size());
+    REQUIRE(stats.syncs == 1);
+    REQUIRE(stats.submissions >= 1);
+    REQUIRE(stats.submissions <= 200);
+
+    // without truncate, writes land at the offset and keep the rest of the file
+    {
+      AsyncWriter patch(path, 10, false, options);
+      patch.Write("0123456789");
+    }
+    expected.replace(10, 10, "0123456789");
+    REQUIRE(ReadFile(path) == expected);
+  }
+  REQUIRE_THROWS_AS(AsyncWriter(dir.path + "/missing/out.bin", 0, true), std::runtime_error);
+}
+
+TEST_CASE("ExportCsv and checkpoints stream through the async writer", "[async_io]") {
+  TempDir dir;
+  Database db;
+  db.Open(dir.path);
+  BuildLeague(db);
+  DbTable& league = db.GetTable("league");
+  league.AddRow({"Henan", "14", std::nullopt});
+
+  AsyncIoOptions threads;
+  threads.allow_io_uring = false;
+  for (const AsyncIoOptions& options : {AsyncIoOptions(), threads}) {
+    const std::string csv = dir.path + "/league.csv";
+    league.ExportCsv(csv, options);
+    std::string expected = "team,rank,shots\n";
+    for (const auto& row : league.GetRows()) {
+      expected += row[0] + "," + row[1] + "," + row[2] + "\n";
+    }
+    REQUIRE(ReadFile(csv) == expected);
+  }
+  REQUIRE_THROWS_AS(league.ExportCsv(dir.path + "/missing/league.csv"), std::runtime_error);
+
+  // a table several MiB large goes out in many batches, both as CSV and as chunk images
+  db.CreateTable("big");
+  DbTable& big = db.GetTable("big");
+  big.AddColumn({"id", DataType::kInt});
+  big.AddColumn({"text", DataType::kString});
+  const std::string filler(200, 'x');
+  for (int i = 0; i < 20000; ++i) {
+    big.AddRow({std::to_string(i), filler + std::to_string(i)});
+  }
+  big.ExportCsv(dir.path + "/big.csv");
+  REQUIRE(std::filesystem::file_size(dir.path + "/big.csv") > (4u << 20));
+  const CheckpointStats stats = db.Checkpoint();
+  REQUIRE(stats.bytes_written > (4u << 20));
+  const auto expected = big.GetRows();
+  Database recovered;
+  recovered.Open(dir.path);
+  REQUIRE(recovered.GetTable("big").GetRows() == expected);
+  REQUIRE(recovered.GetTable("league").RowCount() == 4);
+}
+
+// ─────────────────────────────────────────────────────────────────────────────
+//  Partitioned tables
+// ─────────────────────────────────────────────────────────────────────────────
+TEST_CASE("Partitioned tables route rows by key and prune scans", "[partitioned]") {
+  const std::vector<std::pair<std::string, DataType>> columns = {
+      {"team", DataType::kString}, {"season", DataType::kInt}, {"goals", DataType::kDouble}};
+  static const char* const kTeams[] = {"Shanghai", "Beijing", "Shandong", "Wuhan", "Chengdu", "Henan"};
+  for (const PartitionSpec& spec : {PartitionSpec::Hash("team", 4), PartitionSpec::Range("season", {"2010", "2020"})}) {
+    PartitionedTable table(columns, spec, 3);
+    DbTable plain;
+    for (const auto& col : columns) plain.AddColumn(col);
+    std::map<unsigned int, unsigned int> plain_id;  // partitioned id -> id of the same row in plain
+    for (int i = 0; i < 600; ++i) {
+      std::vector<std::optional<std::string>> row = {kTeams[i % 6], std::to_string(2000 + i % 30),
+                                                     std::to_string(i % 17) + ".5"};
+      if (i % 50 == 0) row[2] = std::nullopt;
+      const unsigned int id = table.AddRow(row);
+      REQUIRE(table.PartitionOf(id) == table.PartitionFor(spec.method == PartitionMethod::kHash ? row[0] : row[1]));
+      plain_id[id] = plain.NextId();
+      plain.AddRow(row);
+    }
+    REQUIRE(table.PartitionCount() == 3 + (spec.method == PartitionMethod::kHash));
+    REQUIRE(table.RowCount() == 600);
+    for (const auto& [id, same] : plain_id) REQUIRE(table.GetRow(id) == plain.GetRow(same));
+
+    // every scan agrees with the same rows in one table
+    for (CompareOp op : {CompareOp::kEq, CompareOp::kNe, CompareOp::kLt, CompareOp::kLe, CompareOp::kGt,
+                         CompareOp::kGe}) {
+      for (const auto& [col, value] : std::vector<std::pair<unsigned int, std::string>>{
+               {0, "Wuhan"}, {1, "2010"}, {1, "2019"}, {1, "1999"}, {1, "2035"}, {2, "8.5"}}) {
+        const std::vector<unsigned int> ids = table.Filter(col, op, value);
+        REQUIRE(std::is_sorted(ids.begin(), ids.end()));
+        std::vector<unsigned int> same;
+        for (unsigned int id : ids) same.push_back(plain_id.at(id));
+        std::sort(same.begin(), same.end());
+        REQUIRE(same == plain.Filter(col, op, value));
+        REQUIRE(table.Count(col, op, value) == ids.size());
+      }
+    }
+    REQUIRE(table.GroupByCount(0) == plain.GroupByCount(0));
+    for (AggregateFn fn : {AggregateFn::kCount, AggregateFn::kSum, AggregateFn::kMin, AggregateFn::kMax,
+                           AggregateFn::kAvg}) {
+      REQUIRE(table.Aggregate(2, fn) == Approx(plain.Aggregate(2, fn)));
+    }
+
+    // pruning: a hash key reads one partition for =, a range key only the ranges that can match
+    if (spec.method == PartitionMethod::kHash) {
+      REQUIRE(table.PrunePartitions(0, CompareOp::kEq, "Wuhan").size() == 1);
+      REQUIRE(table.PrunePartitions(0, CompareOp::kLt, "Wuhan").size() == 4);
+    } else {
+      REQUIRE(table.PrunePartitions(1, CompareOp::kEq, "2015") == std::vector<size_t>{1});
+      REQUIRE(table.PrunePartitions(1, CompareOp::kLt, "2010") == std::vector<size_t>{0});
+      REQUIRE(table.PrunePartitions(1, CompareOp::kLe, "2010") == std::vector<size_t>{0, 1});
+      REQUIRE(table.PrunePartitions(1, CompareOp::kGe, "2020") == std::vector<size_t>{2});
+      REQUIRE(table.PrunePartitions(1, CompareOp::kNe, "2020").size() == 3);
+      REQUIRE(table.Stats().rows == std::vector<size_t>{200, 200, 200});
+    }
+    REQUIRE(table.PrunePartitions(2, CompareOp::kEq, "1.5").size() == table.PartitionCount());
+    const PartitionStats before = table.Stats();
+    table.Count(spec.method == PartitionMethod::kHash ? 0 : 1, CompareOp::kEq,
+                spec.method == PartitionMethod::kHash ? "Henan" : "2001");
+    REQUIRE(table.Stats().partitions_scanned == before.partitions_scanned + 1);
+    REQUIRE(table.Stats().partitions_pruned == before.partitions_pruned + table.PartitionCount() - 1);
+
+    const unsigned int victim = plain_id.begin()->first;
+    table.DeleteRowById(victim);
+    REQUIRE_THROWS_AS(table.GetRow(victim), std::out_of_range);
+    REQUIRE_THROWS_AS(table.DeleteRowById(victim), std::out_of_range);
+    REQUIRE(table.RowCount() == 599);
+    REQUIRE(table.PartitionFor(std::nullopt) == 0);
+  }
+  REQUIRE_THROWS_AS(PartitionedTable(columns, PartitionSpec::Hash("coach", 2)), std::invalid_argument);
+  REQUIRE_THROWS_AS(PartitionedTable(columns, PartitionSpec::Hash("team", 0)), std::invalid_argument);
+  REQUIRE_THROWS_AS(PartitionedTable(columns, PartitionSpec::Range("season", {"2020", "2010"})),
+                    std::invalid_argument);
+  REQUIRE_THROWS_AS(PartitionedTable(columns, PartitionSpec::Range("season", {"soon"})), std::invalid_argument);
+  PartitionedTable table(columns, PartitionSpec::Hash("team", 2));
+  REQUIRE_THROWS_AS(table.AddRow({"Wuhan", "2001"}), std::invalid_argument);
+}
+
+TEST_CASE("Partitioned tables take concurrent writers and scan in parallel", "[partitioned]") {
+  Database db;
+  const std::vector<std::pair<std::string, DataType>> columns = {{"writer", DataType::kInt}, {"n", DataType::kInt}};
+  PartitionedTable& table =
+      db.CreatePartitionedTable("events", columns, PartitionSpec::Range("writer", {"1", "2", "3"}));
+  REQUIRE(db.HasPartitionedTable("events"));
+  table.SetScanThreads(4);  // whatever the machine has
+  REQUIRE_THROWS_AS(db.CreateTable("events"), std::invalid_argument);
+  REQUIRE_THROWS_AS(db.CreatePartitionedTable("events", columns, PartitionSpec::Hash("n", 2)),
+                    std::invalid_argument);
+
+  // one writer per partition, each also scanning while the others write
+  const int kRows = 6000;
+  std::vector<std::thread> writers;
+  for (int writer = 0; writer < 4; ++writer) {
+    writers.emplace_back([&table, writer] {
+      for (int i = 0; i < kRows; ++i) {
+        table.AddRow({std::to_string(writer), std::to_string(i)});
+        if (i % 1000 == 0) table.Count(1, CompareOp::kGe, "0");
+      }
+    });
+  }
+  for (std::thread& writer : writers) writer.join();
+  REQUIRE(table.Stats().rows == std::vector<size_t>(4, kRows));
+  REQUIRE(table.Count(1, CompareOp::kLt, "100") == 400);
+  REQUIRE(table.Filter(0, CompareOp::kEq, "2").size() == static_cast<size_t>(kRows));
+  REQUIRE(table.Aggregate(1, AggregateFn::kSum) == Approx(4.0 * kRows * (kRows - 1) / 2));
+  REQUIRE(table.Stats().parallel_scans > 0);  // 24000 rows is above kParallelRows
+  REQUIRE(db.MetricsText().find("partitioned:events") != std::string::npos);
+
+  Database copy(db);
+  db.DropPartitionedTable("events");
+  REQUIRE_FALSE(db.HasPartitionedTable("events"));
+  REQUIRE_THROWS_AS(db.GetPartitionedTable("events"), std::out_of_range);
+  REQUIRE_THROWS_AS(db.DropPartitionedTable("events"), std::out_of_range);
+  REQUIRE(copy.GetPartitionedTable("events").RowCount() == 4u * kRows);
+}